@@ -0,0 +1,850 @@
+/*
+	Benchmarks for float_shredder.h, built on Google Benchmark.
+
+	Every function gets run a few different ways, each as its own benchmark
+	named <function>/<how>:
+
+	libm		the closest thing math.h has (frexpf, ldexpf, signbit...),
+			where there is one
+	memcpy		for the shuffles, just copying the same number of bytes
+	std		std::sort, for the radix sort
+	loop		a plain loop calling the scalar function on every float
+	scalar, sse2...	the Array version, once for every instruction set this
+			CPU can run, forced with ShredDispatchForce
+
+	and each of those at sizes going from fitting in L1 up to well past the
+	last level cache, so you can see where it stops being compute bound and
+	starts waiting on memory. Items/s and bytes/s (input plus output) come
+	out as the usual Google Benchmark counters, and time/elem is how long
+	each float took.
+
+	Run it with --benchmark_filter=ShredFloatExp/ and so on to just look at
+	one function.
+*/
+#include "float_shredder.h"
+#include "float_shredder_codec.h"
+#include "float_shredder_sort.h"
+
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// 4 KiB, 32 KiB, 256 KiB, 2 MiB, 16 MiB and 128 MiB of floats
+static const size_t bench_sizes[] = {
+	1 << 10, 1 << 13, 1 << 16, 1 << 19, 1 << 22, 1 << 25
+};
+static const size_t bench_max_size = 1 << 25;
+static const int bench_shift = 3;
+
+static const ShredIsa bench_isas[] = {
+	SHRED_ISA_SCALAR, SHRED_ISA_SSE2, SHRED_ISA_AVX2, SHRED_ISA_AVX512,
+	SHRED_ISA_NEON
+};
+
+/*
+	The input, built once at the biggest size and shared by everything.
+	It's normal floats of both signs spread over most of the exponent range,
+	so nothing gets to take a shortcut on zeros or specials.
+*/
+static const std::vector<float>& BenchFloats()
+{
+	static std::vector<float> floats;
+	if(floats.empty())
+	{
+		floats.resize(bench_max_size);
+		uint32_t state = 12345;
+		for(size_t i = 0; i < floats.size(); i++)
+		{
+			state = state * 1664525u + 1013904223u;
+			uint32_t exp = 64 + (state >> 8) % 128;
+			uint32_t mant = (state >> 3) & float_mantissa_mask;
+			uint32_t data = (state & float_sign_mask) |
+				(exp << float_exp_offset) | mant;
+			floats[i] = ShredDataToFloat(data);
+		}
+	}
+	return floats;
+}
+
+template <typename T> static const T* BenchInput();
+
+template <> const float* BenchInput<float>()
+{
+	return BenchFloats().data();
+}
+
+template <> const ShredHalf* BenchInput<ShredHalf>()
+{
+	static std::vector<ShredHalf> halves;
+	if(halves.empty())
+	{
+		const std::vector<float>& floats = BenchFloats();
+		halves.resize(floats.size());
+		for(size_t i = 0; i < floats.size(); i++)
+		{
+			// squash the exponents down into what a half can hold
+			halves[i] = ShredFloatToHalf(ShredFloatScalePow2(
+				ShredFloatMantissa(floats[i]), (int)(i % 24) - 12));
+		}
+	}
+	return halves.data();
+}
+
+/*
+	The approximations' slow paths would take over on the usual input, so
+	they get positive floats instead, and exp2 gets the log2s of those,
+	which lands in [-64, 65). With specials, every 16th float gets swapped
+	for a zero, negative, inf, NaN, subnormal or something past exp2's
+	range, to see what those cost mixed in with everything else.
+*/
+static const float* BenchApproxInput(bool exp2, bool specials = false)
+{
+	static const float special_values[] = {
+		0.0f, -3.0f, INFINITY, NAN, 1e-40f, 1000.0f
+	};
+	static std::vector<float> inputs[4];
+	std::vector<float>& input = inputs[exp2 * 2 + specials];
+	if(input.empty())
+	{
+		const std::vector<float>& floats = BenchFloats();
+		input.resize(floats.size());
+		for(size_t i = 0; i < floats.size(); i++)
+		{
+			float positive = fabsf(floats[i]);
+			input[i] = exp2 ? log2f(positive) : positive;
+			if(specials && i % 16 == 0)
+			{
+				input[i] = special_values[i / 16 % 6];
+			}
+		}
+	}
+	return input.data();
+}
+
+// a plain array, since std::vector<bool> can't hand out a bool*
+template <typename T> struct BenchBuffer
+{
+	T* data;
+	explicit BenchBuffer(size_t n) : data(new T[n]()) {}
+	~BenchBuffer() { delete[] data; }
+};
+
+static void BenchCounters(benchmark::State& state, size_t n,
+	size_t bytes_per_elem)
+{
+	int64_t items = (int64_t)state.iterations() * (int64_t)n;
+	state.SetItemsProcessed(items);
+	state.SetBytesProcessed(items * (int64_t)bytes_per_elem);
+	state.counters["time/elem"] = benchmark::Counter((double)n,
+		benchmark::Counter::kIsIterationInvariantRate |
+		benchmark::Counter::kInvert);
+}
+
+template <typename In, typename Out, Out (*Func)(In)>
+static void BenchLoop(benchmark::State& state)
+{
+	size_t n = (size_t)state.range(0);
+	const In* in = BenchInput<In>();
+	BenchBuffer<Out> out(n);
+	for(auto _ : state)
+	{
+		for(size_t i = 0; i < n; i++)
+		{
+			out.data[i] = Func(in[i]);
+		}
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, sizeof(In) + sizeof(Out));
+}
+
+template <typename In, typename Out, void (*Func)(const In*, Out*, size_t)>
+static void BenchArray(benchmark::State& state, ShredIsa isa)
+{
+	size_t n = (size_t)state.range(0);
+	const In* in = BenchInput<In>();
+	BenchBuffer<Out> out(n);
+	ShredDispatchForce(isa);
+	for(auto _ : state)
+	{
+		Func(in, out.data, n);
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, sizeof(In) + sizeof(Out));
+}
+
+template <float (*Func)(float, int)>
+static void BenchShiftLoop(benchmark::State& state)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	BenchBuffer<float> out(n);
+	for(auto _ : state)
+	{
+		for(size_t i = 0; i < n; i++)
+		{
+			out.data[i] = Func(in[i], bench_shift);
+		}
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, 2 * sizeof(float));
+}
+
+template <void (*Func)(const float*, float*, size_t, int)>
+static void BenchShiftArray(benchmark::State& state, ShredIsa isa)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	BenchBuffer<float> out(n);
+	ShredDispatchForce(isa);
+	for(auto _ : state)
+	{
+		Func(in, out.data, n, bench_shift);
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, 2 * sizeof(float));
+}
+
+template <float (*Func)(float), bool Exp2>
+static void BenchApproxLibm(benchmark::State& state)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchApproxInput(Exp2);
+	BenchBuffer<float> out(n);
+	for(auto _ : state)
+	{
+		for(size_t i = 0; i < n; i++)
+		{
+			out.data[i] = Func(in[i]);
+		}
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, 2 * sizeof(float));
+}
+
+template <float (*Func)(float, ShredApprox), ShredApprox Accuracy, bool Exp2>
+static void BenchApproxLoop(benchmark::State& state)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchApproxInput(Exp2);
+	BenchBuffer<float> out(n);
+	for(auto _ : state)
+	{
+		for(size_t i = 0; i < n; i++)
+		{
+			out.data[i] = Func(in[i], Accuracy);
+		}
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, 2 * sizeof(float));
+}
+
+template <void (*Func)(const float*, float*, size_t, ShredApprox),
+	ShredApprox Accuracy, bool Exp2, bool Specials = false>
+static void BenchApproxArray(benchmark::State& state, ShredIsa isa)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchApproxInput(Exp2, Specials);
+	BenchBuffer<float> out(n);
+	ShredDispatchForce(isa);
+	for(auto _ : state)
+	{
+		Func(in, out.data, n, Accuracy);
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, 2 * sizeof(float));
+}
+
+static void BenchSplitPlanes(benchmark::State& state, ShredIsa isa)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	BenchBuffer<uint8_t> signs(ShredSignPlaneSize(n));
+	BenchBuffer<uint8_t> exponents(n);
+	BenchBuffer<uint32_t> mantissas(n);
+	ShredDispatchForce(isa);
+	for(auto _ : state)
+	{
+		ShredFloatSplitPlanes(in, n, signs.data, exponents.data,
+			mantissas.data);
+		benchmark::DoNotOptimize(mantissas.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, 2 * sizeof(float) + 1);
+}
+
+static void BenchClassCount(benchmark::State& state, ShredIsa isa)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	size_t counts[SHRED_CLASS_COUNT];
+	ShredDispatchForce(isa);
+	for(auto _ : state)
+	{
+		ShredFloatClassCount(in, n, counts);
+		benchmark::DoNotOptimize(counts);
+	}
+	BenchCounters(state, n, sizeof(float));
+}
+
+static void BenchSummarize(benchmark::State& state, ShredIsa isa)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	ShredFloatSummary summary;
+	ShredDispatchForce(isa);
+	for(auto _ : state)
+	{
+		ShredFloatSummarize(in, n, &summary);
+		benchmark::DoNotOptimize(summary);
+	}
+	BenchCounters(state, n, sizeof(float));
+}
+
+// what ShredFloatSummarize replaces, a loop for each thing it finds
+static void BenchSummarizeLoops(benchmark::State& state)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	for(auto _ : state)
+	{
+		float min = INFINITY;
+		for(size_t i = 0; i < n; i++)
+		{
+			min = in[i] < min ? in[i] : min;
+		}
+		float max = -INFINITY;
+		for(size_t i = 0; i < n; i++)
+		{
+			max = in[i] > max ? in[i] : max;
+		}
+		double sum = 0.0;
+		double comp = 0.0;
+		for(size_t i = 0; i < n; i++)
+		{
+			if(isfinite(in[i]))
+			{
+				ShredKahanAdd(&sum, &comp, (double)in[i]);
+			}
+		}
+		size_t nans = 0;
+		for(size_t i = 0; i < n; i++)
+		{
+			nans += isnan(in[i]) != 0;
+		}
+		size_t infs = 0;
+		for(size_t i = 0; i < n; i++)
+		{
+			infs += isinf(in[i]) != 0;
+		}
+		size_t negatives = 0;
+		for(size_t i = 0; i < n; i++)
+		{
+			negatives += ShredFloatIsNegative(in[i]);
+		}
+		int32_t exp_min = 128;
+		int32_t exp_max = -127;
+		for(size_t i = 0; i < n; i++)
+		{
+			int32_t exp = ShredFloatExp(in[i]);
+			if(exp < 128)
+			{
+				exp_min = exp < exp_min ? exp : exp_min;
+				exp_max = exp > exp_max ? exp : exp_max;
+			}
+		}
+		benchmark::DoNotOptimize(min);
+		benchmark::DoNotOptimize(max);
+		benchmark::DoNotOptimize(sum + comp);
+		benchmark::DoNotOptimize(nans + infs + negatives);
+		benchmark::DoNotOptimize(exp_min + exp_max);
+	}
+	BenchCounters(state, n, sizeof(float));
+}
+
+// compares the input against a copy a few ULPs off, with the stats on
+static void BenchUlpDistance(benchmark::State& state, ShredIsa isa)
+{
+	size_t n = (size_t)state.range(0);
+	const float* a = BenchInput<float>();
+	BenchBuffer<float> b(n);
+	ShredFloatStepUlpsArray_scalar(a, b.data, n, 3);
+	BenchBuffer<uint32_t> out(n);
+	ShredUlpStats stats;
+	ShredDispatchForce(isa);
+	for(auto _ : state)
+	{
+		ShredFloatUlpDistanceArray(a, b.data, out.data, n, &stats);
+		benchmark::DoNotOptimize(out.data);
+		benchmark::DoNotOptimize(stats);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, 3 * sizeof(float));
+}
+
+// the shuffles and their inverses, In -> Out with the buffer sizes in bytes
+template <typename In, typename Out, void (*Func)(const In*, size_t, Out*)>
+static void BenchShuffle(benchmark::State& state, ShredIsa isa)
+{
+	size_t n = (size_t)state.range(0);
+	BenchBuffer<uint8_t> planes(ShredBitShuffleSize(n, float_bit_width));
+	BenchBuffer<float> floats(n);
+	memcpy(floats.data, BenchInput<float>(), n * sizeof(float));
+	// the unshuffles get real planes to work from
+	ShredFloatBitShuffle_scalar(floats.data, n, planes.data);
+	const In* in = (const In*)(const void*)(sizeof(In) == 1 ?
+		(const void*)planes.data : (const void*)floats.data);
+	Out* out = (Out*)(void*)(sizeof(Out) == 1 ? (void*)planes.data :
+		(void*)floats.data);
+	ShredDispatchForce(isa);
+	for(auto _ : state)
+	{
+		Func(in, n, out);
+		benchmark::DoNotOptimize(out);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, 2 * sizeof(float));
+}
+
+// MX style blocks of 32 with 8 bit elements, one exponent byte per block
+static void BenchBlockEncode(benchmark::State& state, ShredIsa isa)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	BenchBuffer<uint8_t> exps(ShredBlockCount(n, 32));
+	BenchBuffer<int8_t> out(n);
+	ShredDispatchForce(isa);
+	for(auto _ : state)
+	{
+		ShredFloatToBlockInt8(in, n, 32, 8, exps.data, out.data);
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, sizeof(float) + 1);
+}
+
+static void BenchBlockDecode(benchmark::State& state, ShredIsa isa)
+{
+	size_t n = (size_t)state.range(0);
+	BenchBuffer<uint8_t> exps(ShredBlockCount(n, 32));
+	BenchBuffer<int8_t> block(n);
+	ShredFloatToBlockInt8_scalar(BenchInput<float>(), n, 32, 8, exps.data,
+		block.data);
+	BenchBuffer<float> out(n);
+	ShredDispatchForce(isa);
+	for(auto _ : state)
+	{
+		ShredBlockInt8ToFloat(exps.data, block.data, n, 32, 8, out.data);
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, sizeof(float) + 1);
+}
+
+static ShredEndian BenchForeignEndian()
+{
+	return ShredNativeIsBigEndian() ? SHRED_ENDIAN_LITTLE : SHRED_ENDIAN_BIG;
+}
+
+// the way it was done before the Endian functions, swap everything first
+static void BenchExpSwapFirst(benchmark::State& state)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	BenchBuffer<float> swapped(n);
+	BenchBuffer<int32_t> out(n);
+	for(auto _ : state)
+	{
+		ShredFloatByteSwapArray(in, swapped.data, n);
+		ShredFloatExpArray(swapped.data, out.data, n);
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, sizeof(float) + sizeof(int32_t));
+}
+
+static void BenchExpEndian(benchmark::State& state, ShredIsa isa)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	BenchBuffer<int32_t> out(n);
+	ShredDispatchForce(isa);
+	for(auto _ : state)
+	{
+		ShredFloatExpArrayEndian(in, out.data, n, BenchForeignEndian());
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, sizeof(float) + sizeof(int32_t));
+}
+
+static void BenchMemcpy(benchmark::State& state)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	BenchBuffer<float> out(n);
+	for(auto _ : state)
+	{
+		memcpy(out.data, in, n * sizeof(float));
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, 2 * sizeof(float));
+}
+
+/*
+	The random floats above don't compress at all, so the codec gets
+	something shaped like telemetry instead: a slow wave with a little
+	jitter on top, which is what it's meant for.
+*/
+static const std::vector<float>& BenchSeries()
+{
+	static std::vector<float> series;
+	if(series.empty())
+	{
+		series.resize(bench_max_size);
+		for(size_t i = 0; i < series.size(); i++)
+		{
+			series[i] = (float)(20.0 + 5.0 * sin((double)i * 0.001)) +
+				(i % 17 == 0 ? 0.01f : 0.0f);
+		}
+	}
+	return series;
+}
+
+static void BenchGorillaEncode(benchmark::State& state)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchSeries().data();
+	BenchBuffer<uint8_t> out(ShredGorillaBound(n, 0));
+	size_t size = 0;
+	for(auto _ : state)
+	{
+		size = ShredGorillaEncode(in, n, 0, out.data);
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, sizeof(float));
+	state.counters["ratio"] = (double)(n * sizeof(float)) / (double)size;
+}
+
+static void BenchGorillaDecode(benchmark::State& state)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchSeries().data();
+	BenchBuffer<uint8_t> encoded(ShredGorillaBound(n, 0));
+	size_t size = ShredGorillaEncode(in, n, 0, encoded.data);
+	BenchBuffer<float> out(n);
+	for(auto _ : state)
+	{
+		if(!ShredGorillaDecode(encoded.data, size, out.data))
+		{
+			state.SkipWithError("decode failed");
+			break;
+		}
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, sizeof(float));
+}
+
+/*
+	Sorting is in place, so every iteration sorts a fresh copy of the input.
+	Both sides pay for that copy, which is small next to the sort.
+*/
+static void BenchStdSort(benchmark::State& state)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	BenchBuffer<float> keys(n);
+	for(auto _ : state)
+	{
+		memcpy(keys.data, in, n * sizeof(float));
+		std::sort(keys.data, keys.data + n);
+		benchmark::DoNotOptimize(keys.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, sizeof(float));
+}
+
+static void BenchRadixSort(benchmark::State& state)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	BenchBuffer<float> keys(n);
+	BenchBuffer<uint8_t> scratch(ShredFloatRadixScratchSize(n, false));
+	for(auto _ : state)
+	{
+		memcpy(keys.data, in, n * sizeof(float));
+		ShredFloatRadixSortScratch(keys.data, NULL, n, scratch.data);
+		benchmark::DoNotOptimize(keys.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, sizeof(float));
+}
+
+static void BenchExpPartition(benchmark::State& state)
+{
+	size_t n = (size_t)state.range(0);
+	const float* in = BenchInput<float>();
+	BenchBuffer<float> out(n);
+	size_t offsets[SHRED_PARTITION_BUCKETS + 1];
+	for(auto _ : state)
+	{
+		ShredFloatExpPartition(in, n, out.data, offsets);
+		benchmark::DoNotOptimize(out.data);
+		benchmark::ClobberMemory();
+	}
+	BenchCounters(state, n, 2 * sizeof(float));
+}
+
+// the math.h takes on the same things
+static int32_t LibmExp(float x)
+{
+	int exp;
+	frexpf(x, &exp);
+	return exp - 1;
+}
+
+static float LibmMantissa(float x)
+{
+	int exp;
+	return fabsf(frexpf(x, &exp)) * 2.0f;
+}
+
+static bool LibmIsNegative(float x)
+{
+	return signbit(x) != 0;
+}
+
+static float LibmScaleUp(float x, int shift)
+{
+	return ldexpf(x, shift);
+}
+
+static float LibmScaleDown(float x, int shift)
+{
+	return ldexpf(x, -shift);
+}
+
+// the ordered keys as they'd be written out to an index, big-endian
+static void BenchOrderedKey(const float* in, uint32_t* out, size_t n)
+{
+	ShredFloatToOrderedKeyArray(in, out, n, SHRED_ENDIAN_BIG);
+}
+
+// the truncation with and without the error stats, in the same shape as
+// the shifts
+static void BenchTruncate(const float* in, float* out, size_t n, int bits)
+{
+	ShredFloatTruncateMantissaArray(in, out, n, bits, NULL);
+}
+
+static void BenchTruncateStats(const float* in, float* out, size_t n,
+	int bits)
+{
+	ShredTruncateStats stats;
+	ShredFloatTruncateMantissaArray(in, out, n, bits, &stats);
+	benchmark::DoNotOptimize(stats);
+}
+
+static float LibmRsqrt(float x)
+{
+	return 1.0f / sqrtf(x);
+}
+
+static uint8_t LibmClassify(float x)
+{
+	return (uint8_t)fpclassify(x);
+}
+
+static uint8_t BenchClassify(float x)
+{
+	return (uint8_t)ShredFloatClassify(x);
+}
+
+static void BenchSizes(benchmark::internal::Benchmark* b)
+{
+	for(size_t size : bench_sizes)
+	{
+		b->Arg((int64_t)size);
+	}
+}
+
+static void BenchRegister(const std::string& name,
+	void (*func)(benchmark::State&))
+{
+	benchmark::RegisterBenchmark(name.c_str(), func)->Apply(BenchSizes);
+}
+
+template <typename Func>
+static void BenchRegisterIsas(const std::string& name, Func func)
+{
+	for(ShredIsa isa : bench_isas)
+	{
+		if(ShredDispatchForce(isa))
+		{
+			benchmark::RegisterBenchmark((name + "/" + ShredIsaName(isa))
+				.c_str(), func, isa)->Apply(BenchSizes);
+		}
+	}
+}
+
+template <typename Out, Out (*Scalar)(float),
+	void (*Array)(const float*, Out*, size_t)>
+static void BenchFunction(const char* name)
+{
+	BenchRegister(std::string(name) + "/loop", BenchLoop<float, Out, Scalar>);
+	BenchRegisterIsas(name, BenchArray<float, Out, Array>);
+}
+
+template <float (*Scalar)(float, int),
+	void (*Array)(const float*, float*, size_t, int)>
+static void BenchShiftFunction(const char* name)
+{
+	BenchRegister(std::string(name) + "/loop", BenchShiftLoop<Scalar>);
+	BenchRegisterIsas(name, BenchShiftArray<Array>);
+}
+
+// registers libm, then each accuracy as <name>Fast, <name>Medium and so
+// on, and full accuracy again on input with specials as <name>FullSpecials
+template <float (*Libm)(float), float (*Scalar)(float, ShredApprox),
+	void (*Array)(const float*, float*, size_t, ShredApprox), bool Exp2>
+static void BenchApproxFunction(const std::string& name)
+{
+	BenchRegister(name + "/libm", BenchApproxLibm<Libm, Exp2>);
+	BenchRegister(name + "Fast/loop",
+		BenchApproxLoop<Scalar, SHRED_APPROX_FAST, Exp2>);
+	BenchRegisterIsas(name + "Fast",
+		BenchApproxArray<Array, SHRED_APPROX_FAST, Exp2>);
+	BenchRegister(name + "Medium/loop",
+		BenchApproxLoop<Scalar, SHRED_APPROX_MEDIUM, Exp2>);
+	BenchRegisterIsas(name + "Medium",
+		BenchApproxArray<Array, SHRED_APPROX_MEDIUM, Exp2>);
+	BenchRegister(name + "Full/loop",
+		BenchApproxLoop<Scalar, SHRED_APPROX_FULL, Exp2>);
+	BenchRegisterIsas(name + "Full",
+		BenchApproxArray<Array, SHRED_APPROX_FULL, Exp2>);
+	BenchRegisterIsas(name + "FullSpecials",
+		BenchApproxArray<Array, SHRED_APPROX_FULL, Exp2, true>);
+}
+
+int main(int argc, char** argv)
+{
+	benchmark::Initialize(&argc, argv);
+	if(benchmark::ReportUnrecognizedArguments(argc, argv))
+	{
+		return 1;
+	}
+
+	BenchFunction<uint32_t, ShredFloatExpUnbiased,
+		ShredFloatExpUnbiasedArray>("ShredFloatExpUnbiased");
+	BenchFunction<uint32_t, ShredFloatExpUnbiasedRaw,
+		ShredFloatExpUnbiasedRawArray>("ShredFloatExpUnbiasedRaw");
+	BenchRegister("ShredFloatExp/libm", BenchLoop<float, int32_t, LibmExp>);
+	BenchFunction<int32_t, ShredFloatExp, ShredFloatExpArray>("ShredFloatExp");
+	BenchFunction<int32_t, ShredFloatExpRaw, ShredFloatExpRawArray>(
+		"ShredFloatExpRaw");
+	BenchFunction<uint32_t, ShredFloatMantissaRaw, ShredFloatMantissaRawArray>(
+		"ShredFloatMantissaRaw");
+	BenchRegister("ShredFloatMantissa/libm",
+		BenchLoop<float, float, LibmMantissa>);
+	BenchFunction<float, ShredFloatMantissa, ShredFloatMantissaArray>(
+		"ShredFloatMantissa");
+	BenchRegister("ShredFloatIsNegative/libm",
+		BenchLoop<float, bool, LibmIsNegative>);
+	BenchFunction<bool, ShredFloatIsNegative, ShredFloatIsNegativeArray>(
+		"ShredFloatIsNegative");
+
+	BenchRegister("ShredFloatShiftExpUp/libm", BenchShiftLoop<LibmScaleUp>);
+	BenchShiftFunction<ShredFloatShiftExpUp, ShredFloatShiftExpUpArray>(
+		"ShredFloatShiftExpUp");
+	BenchRegister("ShredFloatShiftExpDown/libm",
+		BenchShiftLoop<LibmScaleDown>);
+	BenchShiftFunction<ShredFloatShiftExpDown, ShredFloatShiftExpDownArray>(
+		"ShredFloatShiftExpDown");
+	BenchShiftFunction<ShredFloatShiftMantUp, ShredFloatShiftMantUpArray>(
+		"ShredFloatShiftMantUp");
+	BenchShiftFunction<ShredFloatShiftMantDown, ShredFloatShiftMantDownArray>(
+		"ShredFloatShiftMantDown");
+	BenchRegister("ShredFloatScalePow2/libm", BenchShiftLoop<LibmScaleUp>);
+	BenchShiftFunction<ShredFloatScalePow2, ShredFloatScalePow2Array>(
+		"ShredFloatScalePow2");
+
+	BenchShiftFunction<ShredFloatStepUlps, ShredFloatStepUlpsArray>(
+		"ShredFloatStepUlps");
+	BenchRegisterIsas("ShredFloatUlpDistance", BenchUlpDistance);
+	BenchFunction<uint32_t, ShredFloatToOrderedKey, BenchOrderedKey>(
+		"ShredFloatToOrderedKey");
+	BenchShiftFunction<ShredFloatTruncateMantissa, BenchTruncate>(
+		"ShredFloatTruncateMantissa");
+	BenchRegisterIsas("ShredFloatTruncateMantissa+stats",
+		BenchShiftArray<BenchTruncateStats>);
+
+	BenchApproxFunction<log2f, ShredFloatLog2Approx,
+		ShredFloatLog2ApproxArray, false>("ShredFloatLog2Approx");
+	BenchApproxFunction<exp2f, ShredFloatExp2Approx,
+		ShredFloatExp2ApproxArray, true>("ShredFloatExp2Approx");
+	BenchApproxFunction<sqrtf, ShredFloatSqrtApprox,
+		ShredFloatSqrtApproxArray, false>("ShredFloatSqrtApprox");
+	BenchApproxFunction<LibmRsqrt, ShredFloatRsqrtApprox,
+		ShredFloatRsqrtApproxArray, false>("ShredFloatRsqrtApprox");
+
+	BenchRegister("ShredFloatClassify/libm",
+		BenchLoop<float, uint8_t, LibmClassify>);
+	BenchFunction<uint8_t, BenchClassify, ShredFloatClassifyArray>(
+		"ShredFloatClassify");
+	BenchRegisterIsas("ShredFloatClassCount", BenchClassCount);
+	BenchRegister("ShredFloatSummarize/loops", BenchSummarizeLoops);
+	BenchRegisterIsas("ShredFloatSummarize", BenchSummarize);
+
+	BenchRegisterIsas("ShredFloatByteSwap",
+		BenchArray<float, float, ShredFloatByteSwapArray>);
+	BenchRegister("ShredFloatExpEndian/swapfirst", BenchExpSwapFirst);
+	BenchRegisterIsas("ShredFloatExpEndian", BenchExpEndian);
+
+	BenchRegisterIsas("ShredFloatSplitPlanes", BenchSplitPlanes);
+	BenchFunction<ShredHalf, ShredFloatToHalf, ShredFloatToHalfArray>(
+		"ShredFloatToHalf");
+	BenchRegister("ShredHalfToFloat/loop",
+		BenchLoop<ShredHalf, float, ShredHalfToFloat>);
+	BenchRegisterIsas("ShredHalfToFloat",
+		BenchArray<ShredHalf, float, ShredHalfToFloatArray>);
+	BenchFunction<ShredBFloat16, ShredFloatToBFloat16,
+		ShredFloatToBFloat16Array>("ShredFloatToBFloat16");
+
+	BenchRegister("ShredFloatByteShuffle/memcpy", BenchMemcpy);
+	BenchRegisterIsas("ShredFloatByteShuffle",
+		BenchShuffle<float, uint8_t, ShredFloatByteShuffle>);
+	BenchRegisterIsas("ShredFloatByteUnshuffle",
+		BenchShuffle<uint8_t, float, ShredFloatByteUnshuffle>);
+	BenchRegisterIsas("ShredFloatBitShuffle",
+		BenchShuffle<float, uint8_t, ShredFloatBitShuffle>);
+	BenchRegisterIsas("ShredFloatBitUnshuffle",
+		BenchShuffle<uint8_t, float, ShredFloatBitUnshuffle>);
+	BenchRegisterIsas("ShredFloatToBlockInt8", BenchBlockEncode);
+	BenchRegisterIsas("ShredBlockInt8ToFloat", BenchBlockDecode);
+
+	BenchRegister("ShredFloatRadixSort/std", BenchStdSort);
+	BenchRegister("ShredFloatRadixSort/loop", BenchRadixSort);
+	BenchRegister("ShredFloatExpPartition/loop", BenchExpPartition);
+	BenchRegister("ShredGorillaEncode/loop", BenchGorillaEncode);
+	BenchRegister("ShredGorillaDecode/loop", BenchGorillaDecode);
+
+	// registering checked every instruction set, put the best one back
+	ShredDispatchForce(ShredBestIsa());
+	benchmark::AddCustomContext("shred_dispatch", ShredDispatchName());
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,1058 @@
+/*
+	Runs every one of the 2^32 floats through float_shredder.h and checks
+	that every kernel gives the same bits as the scalar functions they're
+	meant to match, and that the scalar functions agree with libm wherever
+	they're meant to.
+
+	There are three kinds of check:
+
+	batch		an Array function (or ClassCount, Summarize, a shuffle...)
+			under every instruction set this CPU can run, against a
+			plain loop over the scalar function, or the scalar kernel
+			for the ones that don't work a float at a time. The ones
+			that undo another (JoinPlanes, the unshuffles) have to
+			give back the floats that went in, and the approximations
+			have to match their scalar functions bit for bit too
+	libm		a scalar function against what libm says it should be
+			(ilogbf, frexpf, ldexpf, nextafterf, signbit, fpclassify)
+	approx		the approximations under every instruction set against
+			log2, exp2 and sqrt in double. Infs and NaNs, and zeros and
+			negatives where they're special, have to match libm
+			exactly. For everything else the worst error gets
+			reported, measured the same way as the table in the README.
+
+	The floats go out in blocks of 65536 consecutive bit patterns, spread
+	over every CPU with ShredParallelFor. Each block's reference results
+	are worked out once and compared against every instruction set, and
+	each call is timed, so the report has how long every kernel took per
+	float (CPU time, summed over the threads) alongside its failures. The
+	checks that make their kernel's input first (the unshuffles, the block
+	float decoders...) are timed along with making it.
+
+	float_shredder_exhaustive [--threads n] [--sample k]
+
+	--sample k only runs every k-th block, which covers every sign and
+	exponent and the top 7 bits of every mantissa in 1/k of the time. It
+	exits with 1 if anything failed.
+*/
+#include "float_shredder.h"
+#include "float_shredder_threads.h"
+
+#include <chrono>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static_assert(sizeof(size_t) >= 8, "all 2^32 floats need a 64-bit size_t");
+
+#define EXHAUSTIVE_BLOCK ((size_t)1 << 16)
+#define EXHAUSTIVE_BLOCKS ((size_t)1 << 16)
+#define EXHAUSTIVE_ISAS 5
+
+// every output fits in this many bytes per float, plus a little for totals,
+// along with whatever a check needs to set up its kernel's input
+#define EXHAUSTIVE_OUT_BYTES 16
+#define EXHAUSTIVE_OUT_EXTRA 4096
+
+/*
+	A check's functions write their results to out and return how many
+	bytes that was. If it's a whole number of bytes per float the results
+	get compared float by float, otherwise it's all one result.
+*/
+typedef size_t (*ExhaustiveRun)(const ShredDispatchTable* table,
+	const float* in, void* out, size_t n);
+
+enum ExhaustiveKind
+{
+	EXHAUSTIVE_BATCH,
+	EXHAUSTIVE_LIBM,
+	EXHAUSTIVE_APPROX
+};
+
+struct ExhaustiveCheck
+{
+	std::string name;
+	ExhaustiveKind kind;
+	ExhaustiveRun reference;
+	ExhaustiveRun run;
+	// any NaN matches any other, for libm, which is free to change payloads
+	bool nan_equal;
+	// for the approximations
+	double (*exact)(double);
+	bool log2;
+};
+
+/*
+	What one slice found for one check under one instruction set. A
+	failure's input is kept as its bits, and first is only meaningful when
+	failures isn't 0.
+*/
+struct ExhaustiveResult
+{
+	uint64_t failures;
+	uint32_t first;
+	uint64_t floats;
+	double seconds;
+	double max_error;
+};
+
+static std::vector<ExhaustiveCheck> exhaustive_checks;
+
+// the batch functions, and the loops over the scalar ones they should match
+
+template <typename Out, Out (*Func)(float)>
+static size_t Each(const ShredDispatchTable*, const float* in, void* out,
+	size_t n)
+{
+	Out* results = (Out*)out;
+	for(size_t i = 0; i < n; i++)
+	{
+		results[i] = Func(in[i]);
+	}
+	return n * sizeof(Out);
+}
+
+template <typename Out,
+	void (*ShredDispatchTable::*Field)(const float*, Out*, size_t)>
+static size_t Batch(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	(table->*Field)(in, (Out*)out, n);
+	return n * sizeof(Out);
+}
+
+template <typename Arg, float (*Func)(float, Arg), int Shift>
+static size_t EachShift(const ShredDispatchTable*, const float* in,
+	void* out, size_t n)
+{
+	float* results = (float*)out;
+	for(size_t i = 0; i < n; i++)
+	{
+		results[i] = Func(in[i], (Arg)Shift);
+	}
+	return n * sizeof(float);
+}
+
+template <typename Arg,
+	void (*ShredDispatchTable::*Field)(const float*, float*, size_t, Arg),
+	int Shift>
+static size_t BatchShift(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	(table->*Field)(in, (float*)out, n, (Arg)Shift);
+	return n * sizeof(float);
+}
+
+// without the stats, which get checked by comparing the outputs anyway
+template <int Bits>
+static size_t BatchTruncate(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	table->ShredFloatTruncateMantissaArray(in, (float*)out, n, Bits, NULL);
+	return n * sizeof(float);
+}
+
+template <uint32_t (*Func)(float), bool Swap>
+static size_t EachKey(const ShredDispatchTable*, const float* in, void* out,
+	size_t n)
+{
+	uint32_t* keys = (uint32_t*)out;
+	for(size_t i = 0; i < n; i++)
+	{
+		keys[i] = Swap ? ShredByteSwap32(Func(in[i])) : Func(in[i]);
+	}
+	return n * sizeof(uint32_t);
+}
+
+template <void (*ShredDispatchTable::*Field)(const float*, uint32_t*, size_t,
+	ShredEndian), bool Swap>
+static size_t BatchKey(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	// whichever order isn't this machine's
+	ShredEndian foreign = ShredNativeIsBigEndian() ? SHRED_ENDIAN_LITTLE :
+		SHRED_ENDIAN_BIG;
+	(table->*Field)(in, (uint32_t*)out, n,
+		Swap ? foreign : SHRED_ENDIAN_NATIVE);
+	return n * sizeof(uint32_t);
+}
+
+// the bit patterns read as keys, so every key gets turned back too
+static size_t EachFromKey(const ShredDispatchTable*, const float* in,
+	void* out, size_t n)
+{
+	float* results = (float*)out;
+	for(size_t i = 0; i < n; i++)
+	{
+		results[i] = ShredFloatFromOrderedKey(ShredFloatToData(in[i]));
+	}
+	return n * sizeof(float);
+}
+
+static size_t BatchFromKey(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	table->ShredFloatFromOrderedKeyArray((const uint32_t*)in, (float*)out, n,
+		SHRED_ENDIAN_NATIVE);
+	return n * sizeof(float);
+}
+
+// the rest don't work a float at a time, so they're checked as a whole
+
+static size_t ClassCount(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	table->ShredFloatClassCount(in, n, (size_t*)out);
+	return SHRED_CLASS_COUNT * sizeof(size_t);
+}
+
+static size_t ClassifyMasks(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	uint8_t* masks[SHRED_CLASS_COUNT];
+	for(int k = 0; k < SHRED_CLASS_COUNT; k++)
+	{
+		masks[k] = (uint8_t*)out + k * (n / 8);
+	}
+	table->ShredFloatClassifyMasks(in, n, masks);
+	return SHRED_CLASS_COUNT * (n / 8);
+}
+
+// the sum is left out, since the kernels are allowed to round it differently
+static size_t Summarize(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	ShredFloatSummary summary;
+	table->ShredFloatSummarize(in, n, &summary);
+	summary.sum = 0.0;
+	memset(out, 0, sizeof(summary));
+	ShredFloatSummary* results = (ShredFloatSummary*)out;
+	results->min = summary.min;
+	results->max = summary.max;
+	results->count = summary.count;
+	results->nans = summary.nans;
+	results->infs = summary.infs;
+	results->negatives = summary.negatives;
+	results->negative_zeros = summary.negative_zeros;
+	results->exp_min = summary.exp_min;
+	results->exp_max = summary.exp_max;
+	return sizeof(summary);
+}
+
+static size_t SplitPlanes(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	uint8_t* signs = (uint8_t*)out;
+	uint8_t* exponents = signs + ShredSignPlaneSize(n);
+	uint32_t* mantissas = (uint32_t*)(exponents + n);
+	table->ShredFloatSplitPlanes(in, n, signs, exponents, mantissas);
+	return ShredSignPlaneSize(n) + n + n * sizeof(uint32_t);
+}
+
+static size_t ByteShuffle(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	table->ShredFloatByteShuffle(in, n, (uint8_t*)out);
+	return n * sizeof(float);
+}
+
+static size_t BitShuffle(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	table->ShredFloatBitShuffle(in, n, (uint8_t*)out);
+	return n * sizeof(float);
+}
+
+template <int Bits>
+static size_t BlockInt8(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	uint8_t* exps = (uint8_t*)out;
+	table->ShredFloatToBlockInt8(in, n, 32, Bits, exps,
+		(int8_t*)(exps + n / 32));
+	return n / 32 + n;
+}
+
+template <int Bits>
+static size_t BlockInt16(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	uint8_t* exps = (uint8_t*)out;
+	table->ShredFloatToBlockInt16(in, n, 32, Bits, exps,
+		(int16_t*)(exps + n / 32));
+	return n / 32 + n * sizeof(int16_t);
+}
+
+/*
+	The ones that go back the other way, checked against the floats that
+	went in. Their input gets made by the scalar kernel going forwards,
+	after the output in out, so every instruction set undoes the same bytes.
+*/
+
+static size_t Identity(const ShredDispatchTable*, const float* in, void* out,
+	size_t n)
+{
+	memcpy(out, in, n * sizeof(float));
+	return n * sizeof(float);
+}
+
+static size_t JoinPlanes(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	uint8_t* signs = (uint8_t*)out + n * sizeof(float);
+	uint8_t* exponents = signs + ShredSignPlaneSize(n);
+	uint32_t* mantissas = (uint32_t*)(exponents + n);
+	ShredFloatSplitPlanes_scalar(in, n, signs, exponents, mantissas);
+	table->ShredFloatJoinPlanes(signs, exponents, mantissas, n, (float*)out);
+	return n * sizeof(float);
+}
+
+static size_t ByteUnshuffle(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	uint8_t* shuffled = (uint8_t*)out + n * sizeof(float);
+	ShredFloatByteShuffle_scalar(in, n, shuffled);
+	table->ShredFloatByteUnshuffle(shuffled, n, (float*)out);
+	return n * sizeof(float);
+}
+
+static size_t BitUnshuffle(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	uint8_t* shuffled = (uint8_t*)out + n * sizeof(float);
+	ShredFloatBitShuffle_scalar(in, n, shuffled);
+	table->ShredFloatBitUnshuffle(shuffled, n, (float*)out);
+	return n * sizeof(float);
+}
+
+// these can't give the floats back exactly, so the scalar kernel's the
+// reference
+template <int Bits>
+static size_t BlockInt8ToFloat(const ShredDispatchTable* table,
+	const float* in, void* out, size_t n)
+{
+	uint8_t* exps = (uint8_t*)out + n * sizeof(float);
+	int8_t* ints = (int8_t*)(exps + n / 32);
+	ShredFloatToBlockInt8_scalar(in, n, 32, Bits, exps, ints);
+	table->ShredBlockInt8ToFloat(exps, ints, n, 32, Bits, (float*)out);
+	return n * sizeof(float);
+}
+
+template <int Bits>
+static size_t BlockInt16ToFloat(const ShredDispatchTable* table,
+	const float* in, void* out, size_t n)
+{
+	uint8_t* exps = (uint8_t*)out + n * sizeof(float);
+	int16_t* ints = (int16_t*)(exps + n / 32);
+	ShredFloatToBlockInt16_scalar(in, n, 32, Bits, exps, ints);
+	table->ShredBlockInt16ToFloat(exps, ints, n, 32, Bits, (float*)out);
+	return n * sizeof(float);
+}
+
+/*
+	The 16-bit formats get every one of their bit patterns from the low
+	halves of the floats, and the conversion back to float is checked
+	against the scalar function like the rest.
+*/
+template <typename Half>
+static const Half* LowHalves(const float* in, void* out, size_t n)
+{
+	Half* halves = (Half*)((uint8_t*)out + n * sizeof(float));
+	for(size_t i = 0; i < n; i++)
+	{
+		halves[i] = (Half)ShredFloatToData(in[i]);
+	}
+	return halves;
+}
+
+template <typename Half, float (*Func)(Half)>
+static size_t EachFromHalf(const ShredDispatchTable*, const float* in,
+	void* out, size_t n)
+{
+	const Half* halves = LowHalves<Half>(in, out, n);
+	float* results = (float*)out;
+	for(size_t i = 0; i < n; i++)
+	{
+		results[i] = Func(halves[i]);
+	}
+	return n * sizeof(float);
+}
+
+template <typename Half,
+	void (*ShredDispatchTable::*Field)(const Half*, float*, size_t)>
+static size_t BatchFromHalf(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	const Half* halves = LowHalves<Half>(in, out, n);
+	(table->*Field)(halves, (float*)out, n);
+	return n * sizeof(float);
+}
+
+/*
+	UlpDistanceArray pairs each float with the one at the other end of the
+	block, which gets every sign and a spread of distances. The stats come
+	from a separate pass with out NULL, since that's a path of its own in
+	the kernels.
+*/
+static const float* Reversed(const float* in, void* scratch, size_t n)
+{
+	float* reversed = (float*)scratch;
+	for(size_t i = 0; i < n; i++)
+	{
+		reversed[i] = in[n - 1 - i];
+	}
+	return reversed;
+}
+
+static size_t EachUlpDistance(const ShredDispatchTable*, const float* in,
+	void* out, size_t n)
+{
+	const float* b = Reversed(in, (uint8_t*)out + n * sizeof(uint32_t), n);
+	uint32_t* results = (uint32_t*)out;
+	for(size_t i = 0; i < n; i++)
+	{
+		results[i] = ShredFloatUlpDistance(in[i], b[i]);
+	}
+	return n * sizeof(uint32_t);
+}
+
+static size_t UlpDistance(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	const float* b = Reversed(in, (uint8_t*)out + n * sizeof(uint32_t), n);
+	table->ShredFloatUlpDistanceArray(in, b, (uint32_t*)out, n, NULL);
+	return n * sizeof(uint32_t);
+}
+
+static size_t UlpStats(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	const float* b = Reversed(in, (uint8_t*)out + sizeof(ShredUlpStats), n);
+	ShredUlpStats stats;
+	table->ShredFloatUlpDistanceArray(in, b, NULL, n, &stats);
+	memcpy(out, &stats, sizeof(stats));
+	return sizeof(stats);
+}
+
+// just the stats, the rounded floats are checked on their own above
+template <int Bits>
+static size_t TruncateStats(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	ShredTruncateStats stats;
+	table->ShredFloatTruncateMantissaArray(in,
+		(float*)((uint8_t*)out + sizeof(stats)), n, Bits, &stats);
+	memcpy(out, &stats, sizeof(stats));
+	return sizeof(stats);
+}
+
+/*
+	What libm says, filled in with what the scalar functions are documented
+	to give where libm doesn't have an answer (the exponent of a zero, say).
+*/
+
+static int32_t LibmExp(float x)
+{
+	if(x == 0 || fpclassify(x) == FP_SUBNORMAL)
+	{
+		return -float_exp_bias;
+	}
+	if(!isfinite(x))
+	{
+		return float_exp_bias + 1;
+	}
+	return ilogbf(x);
+}
+
+static float LibmMantissa(float x)
+{
+	if(!isfinite(x))
+	{
+		// 1.mantissa, the same as a normal float's
+		return ShredDataToFloat((ShredFloatToData(x) & float_mantissa_mask) |
+			((uint32_t)float_exp_bias << float_exp_offset));
+	}
+	if(x == 0 || fpclassify(x) == FP_SUBNORMAL)
+	{
+		return ldexpf(fabsf(x), float_exp_bias - 1);
+	}
+	int exp;
+	return 2 * fabsf(frexpf(x, &exp));
+}
+
+static bool LibmIsNegative(float x)
+{
+	return signbit(x) != 0;
+}
+
+static uint8_t LibmClassify(float x)
+{
+	switch(fpclassify(x))
+	{
+	case FP_ZERO:
+		return SHRED_CLASS_ZERO;
+	case FP_SUBNORMAL:
+		return SHRED_CLASS_SUBNORMAL;
+	case FP_NORMAL:
+		return SHRED_CLASS_NORMAL;
+	case FP_INFINITE:
+		return SHRED_CLASS_INFINITE;
+	default:
+		return SHRED_CLASS_NAN;
+	}
+}
+
+static uint8_t ShredClassifyByte(float x)
+{
+	return (uint8_t)ShredFloatClassify(x);
+}
+
+template <int Scale>
+static float LibmScale(float x, int)
+{
+	return ldexpf(x, Scale);
+}
+
+// stepping onto zero gives +0, where nextafterf keeps the sign it came from
+template <int Steps>
+static float LibmStep(float x, int32_t)
+{
+	float stepped = nextafterf(x, Steps > 0 ? INFINITY : -INFINITY);
+	return stepped == 0 ? 0.0f : stepped;
+}
+
+// the approximations, under every instruction set, and libm's answers
+
+static double ExactLog2(double x)
+{
+	return log2(x);
+}
+
+static double ExactExp2(double x)
+{
+	return exp2(x);
+}
+
+static double ExactSqrt(double x)
+{
+	return sqrt(x);
+}
+
+static double ExactRsqrt(double x)
+{
+	return 1.0 / sqrt(x);
+}
+
+template <float (*Libm)(float)>
+static size_t EachLibm(const ShredDispatchTable*, const float* in, void* out,
+	size_t n)
+{
+	float* results = (float*)out;
+	for(size_t i = 0; i < n; i++)
+	{
+		results[i] = Libm(in[i]);
+	}
+	return n * sizeof(float);
+}
+
+static float LibmRsqrt(float x)
+{
+	return 1.0f / sqrtf(x);
+}
+
+template <float (*Func)(float, ShredApprox), ShredApprox Accuracy>
+static size_t EachApprox(const ShredDispatchTable*, const float* in,
+	void* out, size_t n)
+{
+	float* results = (float*)out;
+	for(size_t i = 0; i < n; i++)
+	{
+		results[i] = Func(in[i], Accuracy);
+	}
+	return n * sizeof(float);
+}
+
+template <void (*ShredDispatchTable::*Field)(const float*, float*, size_t,
+	ShredApprox), ShredApprox Accuracy>
+static size_t BatchApprox(const ShredDispatchTable* table, const float* in,
+	void* out, size_t n)
+{
+	(table->*Field)(in, (float*)out, n, Accuracy);
+	return n * sizeof(float);
+}
+
+static void AddCheck(const std::string& name, ExhaustiveKind kind,
+	ExhaustiveRun reference, ExhaustiveRun run, bool nan_equal = false)
+{
+	ExhaustiveCheck check = {name, kind, reference, run, nan_equal, NULL,
+		false};
+	exhaustive_checks.push_back(check);
+}
+
+template <typename Out, Out (*Scalar)(float),
+	void (*ShredDispatchTable::*Field)(const float*, Out*, size_t)>
+static void AddBatch(const char* name)
+{
+	AddCheck(name, EXHAUSTIVE_BATCH, Each<Out, Scalar>, Batch<Out, Field>);
+}
+
+template <typename Arg, float (*Scalar)(float, Arg),
+	void (*ShredDispatchTable::*Field)(const float*, float*, size_t, Arg),
+	int Shift>
+static void AddShift(const char* name)
+{
+	AddCheck(std::string(name) + "(" + std::to_string(Shift) + ")",
+		EXHAUSTIVE_BATCH, EachShift<Arg, Scalar, Shift>,
+		BatchShift<Arg, Field, Shift>);
+}
+
+/*
+	Each approximation gets checked twice at every accuracy: against libm
+	for its error, and bit for bit against the scalar function, which every
+	instruction set has to match exactly.
+*/
+template <void (*ShredDispatchTable::*Field)(const float*, float*, size_t,
+	ShredApprox), float (*Scalar)(float, ShredApprox), float (*Libm)(float)>
+static void AddApprox(const char* name, double (*exact)(double), bool log2)
+{
+	static const char* accuracies[] = {"fast", "medium", "full"};
+	ExhaustiveRun runs[] = {
+		BatchApprox<Field, SHRED_APPROX_FAST>,
+		BatchApprox<Field, SHRED_APPROX_MEDIUM>,
+		BatchApprox<Field, SHRED_APPROX_FULL>
+	};
+	ExhaustiveRun scalars[] = {
+		EachApprox<Scalar, SHRED_APPROX_FAST>,
+		EachApprox<Scalar, SHRED_APPROX_MEDIUM>,
+		EachApprox<Scalar, SHRED_APPROX_FULL>
+	};
+	for(int a = 0; a < 3; a++)
+	{
+		std::string full_name = std::string(name) + "(" + accuracies[a] + ")";
+		ExhaustiveCheck check = {full_name, EXHAUSTIVE_APPROX, EachLibm<Libm>,
+			runs[a], true, exact, log2};
+		exhaustive_checks.push_back(check);
+		AddCheck(full_name + " = scalar", EXHAUSTIVE_BATCH, scalars[a],
+			runs[a]);
+	}
+}
+
+#define EXHAUSTIVE_FIELD(name) &ShredDispatchTable::name
+
+static void AddChecks()
+{
+	AddBatch<uint32_t, ShredFloatExpUnbiased,
+		EXHAUSTIVE_FIELD(ShredFloatExpUnbiasedArray)>("ExpUnbiasedArray");
+	AddBatch<uint32_t, ShredFloatExpUnbiasedRaw,
+		EXHAUSTIVE_FIELD(ShredFloatExpUnbiasedRawArray)>(
+		"ExpUnbiasedRawArray");
+	AddBatch<int32_t, ShredFloatExp,
+		EXHAUSTIVE_FIELD(ShredFloatExpArray)>("ExpArray");
+	AddBatch<int32_t, ShredFloatExpRaw,
+		EXHAUSTIVE_FIELD(ShredFloatExpRawArray)>("ExpRawArray");
+	AddBatch<uint32_t, ShredFloatMantissaRaw,
+		EXHAUSTIVE_FIELD(ShredFloatMantissaRawArray)>("MantissaRawArray");
+	AddBatch<float, ShredFloatMantissa,
+		EXHAUSTIVE_FIELD(ShredFloatMantissaArray)>("MantissaArray");
+	AddBatch<bool, ShredFloatIsNegative,
+		EXHAUSTIVE_FIELD(ShredFloatIsNegativeArray)>("IsNegativeArray");
+	AddBatch<uint8_t, ShredClassifyByte,
+		EXHAUSTIVE_FIELD(ShredFloatClassifyArray)>("ClassifyArray");
+	AddBatch<float, ShredFloatByteSwap,
+		EXHAUSTIVE_FIELD(ShredFloatByteSwapArray)>("ByteSwapArray");
+	AddBatch<ShredHalf, ShredFloatToHalf,
+		EXHAUSTIVE_FIELD(ShredFloatToHalfArray)>("ToHalfArray");
+	AddBatch<ShredBFloat16, ShredFloatToBFloat16,
+		EXHAUSTIVE_FIELD(ShredFloatToBFloat16Array)>("ToBFloat16Array");
+	AddCheck("HalfToFloatArray", EXHAUSTIVE_BATCH,
+		EachFromHalf<ShredHalf, ShredHalfToFloat>,
+		BatchFromHalf<ShredHalf, EXHAUSTIVE_FIELD(ShredHalfToFloatArray)>);
+	AddCheck("BFloat16ToFloatArray", EXHAUSTIVE_BATCH,
+		EachFromHalf<ShredBFloat16, ShredBFloat16ToFloat>,
+		BatchFromHalf<ShredBFloat16,
+		EXHAUSTIVE_FIELD(ShredBFloat16ToFloatArray)>);
+
+	AddShift<int, ShredFloatShiftExpUp,
+		EXHAUSTIVE_FIELD(ShredFloatShiftExpUpArray), 3>("ShiftExpUpArray");
+	AddShift<int, ShredFloatShiftExpDown,
+		EXHAUSTIVE_FIELD(ShredFloatShiftExpDownArray), 3>(
+		"ShiftExpDownArray");
+	AddShift<int, ShredFloatShiftMantUp,
+		EXHAUSTIVE_FIELD(ShredFloatShiftMantUpArray), 5>("ShiftMantUpArray");
+	AddShift<int, ShredFloatShiftMantDown,
+		EXHAUSTIVE_FIELD(ShredFloatShiftMantDownArray), 5>(
+		"ShiftMantDownArray");
+	AddShift<int, ShredFloatScalePow2,
+		EXHAUSTIVE_FIELD(ShredFloatScalePow2Array), -150>("ScalePow2Array");
+	AddShift<int, ShredFloatScalePow2,
+		EXHAUSTIVE_FIELD(ShredFloatScalePow2Array), -20>("ScalePow2Array");
+	AddShift<int, ShredFloatScalePow2,
+		EXHAUSTIVE_FIELD(ShredFloatScalePow2Array), 20>("ScalePow2Array");
+	AddShift<int, ShredFloatScalePow2,
+		EXHAUSTIVE_FIELD(ShredFloatScalePow2Array), 150>("ScalePow2Array");
+	AddShift<int32_t, ShredFloatStepUlps,
+		EXHAUSTIVE_FIELD(ShredFloatStepUlpsArray), 1>("StepUlpsArray");
+	AddShift<int32_t, ShredFloatStepUlps,
+		EXHAUSTIVE_FIELD(ShredFloatStepUlpsArray), -1000>("StepUlpsArray");
+	AddCheck("TruncateMantissaArray(7)", EXHAUSTIVE_BATCH,
+		EachShift<int, ShredFloatTruncateMantissa, 7>, BatchTruncate<7>);
+	AddCheck("TruncateMantissaArray(22)", EXHAUSTIVE_BATCH,
+		EachShift<int, ShredFloatTruncateMantissa, 22>, BatchTruncate<22>);
+	AddCheck("UlpDistanceArray", EXHAUSTIVE_BATCH, EachUlpDistance,
+		UlpDistance);
+	AddCheck("JoinPlanes", EXHAUSTIVE_BATCH, Identity, JoinPlanes);
+	AddCheck("ByteUnshuffle", EXHAUSTIVE_BATCH, Identity, ByteUnshuffle);
+	AddCheck("BitUnshuffle", EXHAUSTIVE_BATCH, Identity, BitUnshuffle);
+
+	AddCheck("ToOrderedKeyArray", EXHAUSTIVE_BATCH,
+		EachKey<ShredFloatToOrderedKey, false>,
+		BatchKey<EXHAUSTIVE_FIELD(ShredFloatToOrderedKeyArray), false>);
+	AddCheck("ToOrderedKeyArray(swapped)", EXHAUSTIVE_BATCH,
+		EachKey<ShredFloatToOrderedKey, true>,
+		BatchKey<EXHAUSTIVE_FIELD(ShredFloatToOrderedKeyArray), true>);
+	AddCheck("ToCanonicalKeyArray", EXHAUSTIVE_BATCH,
+		EachKey<ShredFloatToCanonicalKey, false>,
+		BatchKey<EXHAUSTIVE_FIELD(ShredFloatToCanonicalKeyArray), false>);
+	AddCheck("FromOrderedKeyArray", EXHAUSTIVE_BATCH, EachFromKey,
+		BatchFromKey);
+
+	// these have the scalar kernel as the reference
+	struct Whole
+	{
+		const char* name;
+		ExhaustiveRun run;
+	};
+	static const Whole wholes[] = {
+		{"ClassCount", ClassCount},
+		{"ClassifyMasks", ClassifyMasks},
+		{"Summarize", Summarize},
+		{"SplitPlanes", SplitPlanes},
+		{"ByteShuffle", ByteShuffle},
+		{"BitShuffle", BitShuffle},
+		{"ToBlockInt8(7)", BlockInt8<7>},
+		{"ToBlockInt16(12)", BlockInt16<12>},
+		{"BlockInt8ToFloat(7)", BlockInt8ToFloat<7>},
+		{"BlockInt16ToFloat(12)", BlockInt16ToFloat<12>},
+		{"UlpDistanceArray(stats)", UlpStats},
+		{"TruncateMantissaArray(7, stats)", TruncateStats<7>},
+		{"TruncateMantissaArray(22, stats)", TruncateStats<22>},
+	};
+	for(const Whole& whole : wholes)
+	{
+		ExhaustiveCheck check = {whole.name, EXHAUSTIVE_BATCH, NULL,
+			whole.run, false, NULL, false};
+		exhaustive_checks.push_back(check);
+	}
+
+	AddCheck("ShredFloatExp = ilogbf", EXHAUSTIVE_LIBM, Each<int32_t, LibmExp>,
+		Each<int32_t, ShredFloatExp>);
+	AddCheck("ShredFloatMantissa = frexpf", EXHAUSTIVE_LIBM,
+		Each<float, LibmMantissa>, Each<float, ShredFloatMantissa>);
+	AddCheck("ShredFloatIsNegative = signbit", EXHAUSTIVE_LIBM,
+		Each<bool, LibmIsNegative>, Each<bool, ShredFloatIsNegative>);
+	AddCheck("ShredFloatClassify = fpclassify", EXHAUSTIVE_LIBM,
+		Each<uint8_t, LibmClassify>, Each<uint8_t, ShredClassifyByte>);
+	AddCheck("ShredFloatScalePow2(-150) = ldexpf", EXHAUSTIVE_LIBM,
+		EachShift<int, LibmScale<-150>, 0>,
+		EachShift<int, ShredFloatScalePow2, -150>, true);
+	AddCheck("ShredFloatScalePow2(-20) = ldexpf", EXHAUSTIVE_LIBM,
+		EachShift<int, LibmScale<-20>, 0>,
+		EachShift<int, ShredFloatScalePow2, -20>, true);
+	AddCheck("ShredFloatScalePow2(20) = ldexpf", EXHAUSTIVE_LIBM,
+		EachShift<int, LibmScale<20>, 0>,
+		EachShift<int, ShredFloatScalePow2, 20>, true);
+	AddCheck("ShredFloatScalePow2(150) = ldexpf", EXHAUSTIVE_LIBM,
+		EachShift<int, LibmScale<150>, 0>,
+		EachShift<int, ShredFloatScalePow2, 150>, true);
+	AddCheck("ShredFloatStepUlps(1) = nextafterf", EXHAUSTIVE_LIBM,
+		EachShift<int32_t, LibmStep<1>, 0>,
+		EachShift<int32_t, ShredFloatStepUlps, 1>, true);
+	AddCheck("ShredFloatStepUlps(-1) = nextafterf", EXHAUSTIVE_LIBM,
+		EachShift<int32_t, LibmStep<-1>, 0>,
+		EachShift<int32_t, ShredFloatStepUlps, -1>, true);
+
+	AddApprox<EXHAUSTIVE_FIELD(ShredFloatLog2ApproxArray),
+		ShredFloatLog2Approx, log2f>("Log2ApproxArray", ExactLog2, true);
+	AddApprox<EXHAUSTIVE_FIELD(ShredFloatExp2ApproxArray),
+		ShredFloatExp2Approx, exp2f>("Exp2ApproxArray", ExactExp2, false);
+	AddApprox<EXHAUSTIVE_FIELD(ShredFloatSqrtApproxArray),
+		ShredFloatSqrtApprox, sqrtf>("SqrtApproxArray", ExactSqrt, false);
+	AddApprox<EXHAUSTIVE_FIELD(ShredFloatRsqrtApproxArray),
+		ShredFloatRsqrtApprox, LibmRsqrt>("RsqrtApproxArray", ExactRsqrt,
+		false);
+}
+
+#undef EXHAUSTIVE_FIELD
+
+struct ExhaustiveJob
+{
+	size_t sample;
+	int isa_count;
+	ShredIsa isas[EXHAUSTIVE_ISAS];
+	ShredDispatchTable tables[EXHAUSTIVE_ISAS];
+	// [slice][check][isa]
+	std::vector<ExhaustiveResult> results;
+	std::vector<std::vector<uint8_t> > scratch;
+
+	ExhaustiveResult* Result(int slice, size_t check, int isa)
+	{
+		return &results[((size_t)slice * exhaustive_checks.size() + check) *
+			EXHAUSTIVE_ISAS + isa];
+	}
+};
+
+static bool SameFloat(const uint8_t* a, const uint8_t* b)
+{
+	float x;
+	float y;
+	memcpy(&x, a, sizeof(x));
+	memcpy(&y, b, sizeof(y));
+	return memcmp(a, b, sizeof(float)) == 0 || (isnan(x) && isnan(y));
+}
+
+// counts the results that differ, and notes the first one's input
+static void Compare(const ExhaustiveCheck& check, const float* in, size_t n,
+	const uint8_t* expected, const uint8_t* got, size_t bytes,
+	ExhaustiveResult* result)
+{
+	if(!check.nan_equal && memcmp(expected, got, bytes) == 0)
+	{
+		return;
+	}
+	size_t size = bytes % n == 0 ? bytes / n : bytes;
+	size_t count = bytes / size;
+	for(size_t i = 0; i < count; i++)
+	{
+		const uint8_t* a = expected + i * size;
+		const uint8_t* b = got + i * size;
+		bool same = check.nan_equal ? SameFloat(a, b) :
+			memcmp(a, b, size) == 0;
+		if(!same)
+		{
+			uint32_t bits = ShredFloatToData(in[size == bytes ? 0 : i]);
+			if(result->failures == 0 || bits < result->first)
+			{
+				result->first = bits;
+			}
+			result->failures++;
+		}
+	}
+}
+
+/*
+	The approximations' specials have to match libm exactly, everything
+	else gets its error measured like the README's table: relative, except
+	absolute for log2 results under 1. Results that overflow or come out
+	subnormal are left out, since neither error means much there.
+*/
+static void CompareApprox(const ExhaustiveCheck& check, const float* in,
+	size_t n, const float* libm, const float* got, ExhaustiveResult* result)
+{
+	for(size_t i = 0; i < n; i++)
+	{
+		// exp2 is smooth through zero, the rest have to get it right
+		ShredClass x_class = ShredFloatClassify(in[i]);
+		bool special = x_class >= SHRED_CLASS_INFINITE ||
+			(check.exact != ExactExp2 &&
+			(x_class == SHRED_CLASS_ZERO || ShredFloatIsNegative(in[i])));
+		bool bad;
+		if(special)
+		{
+			bad = !SameFloat((const uint8_t*)&libm[i], (const uint8_t*)&got[i]);
+		} else {
+			double exact = check.exact((double)in[i]);
+			double magnitude = fabs(exact);
+			if(!(magnitude >= (double)FLT_MIN && magnitude <= (double)FLT_MAX))
+			{
+				continue;
+			}
+			double error = fabs((double)got[i] - exact);
+			if(!(check.log2 && magnitude < 1))
+			{
+				error /= magnitude;
+			}
+			bad = isnan(error);
+			if(!bad && error > result->max_error)
+			{
+				result->max_error = error;
+			}
+		}
+		if(bad)
+		{
+			uint32_t bits = ShredFloatToData(in[i]);
+			if(result->failures == 0 || bits < result->first)
+			{
+				result->first = bits;
+			}
+			result->failures++;
+		}
+	}
+}
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+		start).count();
+}
+
+static void ExhaustiveChunk(void* ctx, int slice, size_t begin, size_t end)
+{
+	ExhaustiveJob* job = (ExhaustiveJob*)ctx;
+	std::vector<uint8_t>& scratch = job->scratch[slice];
+	size_t out_bytes = EXHAUSTIVE_BLOCK * EXHAUSTIVE_OUT_BYTES +
+		EXHAUSTIVE_OUT_EXTRA;
+	if(scratch.empty())
+	{
+		scratch.resize(EXHAUSTIVE_BLOCK * sizeof(float) + 2 * out_bytes);
+	}
+	float* in = (float*)scratch.data();
+	uint8_t* expected = scratch.data() + EXHAUSTIVE_BLOCK * sizeof(float);
+	uint8_t* got = expected + out_bytes;
+	for(size_t index = begin; index < end; index += EXHAUSTIVE_BLOCK)
+	{
+		uint32_t first = (uint32_t)((index / EXHAUSTIVE_BLOCK) * job->sample *
+			EXHAUSTIVE_BLOCK);
+		for(size_t i = 0; i < EXHAUSTIVE_BLOCK; i++)
+		{
+			in[i] = ShredDataToFloat(first + (uint32_t)i);
+		}
+		for(size_t c = 0; c < exhaustive_checks.size(); c++)
+		{
+			const ExhaustiveCheck& check = exhaustive_checks[c];
+			ExhaustiveRun reference = check.reference;
+			const ShredDispatchTable* reference_table = NULL;
+			if(!reference)
+			{
+				reference = check.run;
+				reference_table = &job->tables[0];
+			}
+			size_t bytes = reference(reference_table, in, expected,
+				EXHAUSTIVE_BLOCK);
+			// the libm checks only have the one scalar function to run
+			int isas = check.kind == EXHAUSTIVE_LIBM ? 1 : job->isa_count;
+			for(int isa = 0; isa < isas; isa++)
+			{
+				ExhaustiveResult* result = job->Result(slice, c, isa);
+				std::chrono::steady_clock::time_point start =
+					std::chrono::steady_clock::now();
+				check.run(&job->tables[isa], in, got, EXHAUSTIVE_BLOCK);
+				result->seconds += Seconds(start);
+				result->floats += EXHAUSTIVE_BLOCK;
+				if(check.kind == EXHAUSTIVE_APPROX)
+				{
+					CompareApprox(check, in, EXHAUSTIVE_BLOCK,
+						(const float*)expected, (const float*)got, result);
+				} else {
+					Compare(check, in, EXHAUSTIVE_BLOCK, expected, got, bytes,
+						result);
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int threads = 0;
+	size_t sample = 1;
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+		{
+			threads = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "--sample") == 0 && i + 1 < argc) {
+			long k = atol(argv[++i]);
+			sample = k > 0 ? (size_t)k : 1;
+		} else {
+			fprintf(stderr, "usage: %s [--threads n] [--sample k]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	ExhaustiveJob* job = new ExhaustiveJob();
+	job->sample = sample;
+	job->isa_count = 0;
+	static const ShredIsa isas[EXHAUSTIVE_ISAS] = {
+		SHRED_ISA_SCALAR, SHRED_ISA_SSE2, SHRED_ISA_AVX2, SHRED_ISA_AVX512,
+		SHRED_ISA_NEON
+	};
+	for(ShredIsa isa : isas)
+	{
+		if(ShredDispatchForce(isa))
+		{
+			job->isas[job->isa_count] = isa;
+			ShredDispatchFill(&job->tables[job->isa_count], isa);
+			job->isa_count++;
+		}
+	}
+	ShredDispatchInit();
+	AddChecks();
+	job->results.resize((size_t)SHRED_THREADS_MAX * exhaustive_checks.size() *
+		EXHAUSTIVE_ISAS);
+	job->scratch.resize(SHRED_THREADS_MAX);
+
+	size_t blocks = (EXHAUSTIVE_BLOCKS + sample - 1) / sample;
+	size_t n = blocks * EXHAUSTIVE_BLOCK;
+	int used = ShredThreadsFor(n, threads);
+	printf("%zu floats (1 in %zu blocks of %zu) on %d threads\n", n, sample,
+		(size_t)EXHAUSTIVE_BLOCK, used);
+	fflush(stdout);
+	std::chrono::steady_clock::time_point start =
+		std::chrono::steady_clock::now();
+	ShredParallelFor(n, EXHAUSTIVE_BLOCK, threads, ExhaustiveChunk, job);
+	double seconds = Seconds(start);
+
+	printf("\n%-40s %-7s %12s %-10s %10s %10s\n", "check", "isa", "failures",
+		"first", "ns/float", "max error");
+	uint64_t failures = 0;
+	for(size_t c = 0; c < exhaustive_checks.size(); c++)
+	{
+		const ExhaustiveCheck& check = exhaustive_checks[c];
+		int isas = check.kind == EXHAUSTIVE_LIBM ? 1 : job->isa_count;
+		for(int isa = 0; isa < isas; isa++)
+		{
+			ExhaustiveResult total = {0, 0, 0, 0.0, 0.0};
+			for(int slice = 0; slice < SHRED_THREADS_MAX; slice++)
+			{
+				const ExhaustiveResult* result = job->Result(slice, c, isa);
+				if(result->failures &&
+					(total.failures == 0 || result->first < total.first))
+				{
+					total.first = result->first;
+				}
+				total.failures += result->failures;
+				total.floats += result->floats;
+				total.seconds += result->seconds;
+				total.max_error = result->max_error > total.max_error ?
+					result->max_error : total.max_error;
+			}
+			failures += total.failures;
+			char first[16] = "";
+			if(total.failures)
+			{
+				snprintf(first, sizeof(first), "0x%08x", total.first);
+			}
+			char error[16] = "";
+			if(check.kind == EXHAUSTIVE_APPROX)
+			{
+				snprintf(error, sizeof(error), "%.3g", total.max_error);
+			}
+			printf("%-40s %-7s %12llu %-10s %10.3f %10s\n", check.name.c_str(),
+				check.kind == EXHAUSTIVE_LIBM ? "libm" :
+				ShredIsaName(job->isas[isa]),
+				(unsigned long long)total.failures, first,
+				total.floats ? total.seconds * 1e9 / (double)total.floats : 0.0,
+				error);
+		}
+	}
+	printf("\n%s: %llu failures in %.1f s, %.1f M floats/s through every "
+		"check\n", failures ? "FAILED" : "passed",
+		(unsigned long long)failures, seconds, (double)n / seconds / 1e6);
+	delete job;
+	return failures ? 1 : 0;
+}
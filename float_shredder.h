@@ -2,8 +2,15 @@
 #define float_shredder
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+
 /*
 	The float shredder library is a header only library to destroy
 	your floats in novel and grotesque ways.
@@ -43,13 +50,30 @@
 
 // tabbing the values of these so I can make sure they're all the
 // same width
-const uint32_t float_exp_mask =			0x7F800000;
-const uint32_t float_sign_mask =		0x80000000;
-const uint32_t float_mantissa_mask =		0x007FFFFF;
-const int float_exp_offset = 23;
-const int float_sign_offset = 31;
-const int float_exp_bias = 127;
-const int double_exp_bias = 1023;
+static const uint32_t float_exp_mask =			0x7F800000;
+static const uint32_t float_sign_mask =			0x80000000;
+static const uint32_t float_mantissa_mask =		0x007FFFFF;
+static const int float_bit_width = 32;
+static const int float_exp_bits = 8;
+static const int float_mantissa_bits = 23;
+static const int float_exp_offset = 23;
+static const int float_sign_offset = 31;
+static const int float_exp_bias = 127;
+
+/*
+	A 64-bit IEEE 754 double is laid out the same way, just wider:
+	Sign	Exponent	Mantissa
+	1-bit |	11-bits	   |	52-bits			= 64-bits
+*/
+static const uint64_t double_exp_mask =			0x7FF0000000000000;
+static const uint64_t double_sign_mask =		0x8000000000000000;
+static const uint64_t double_mantissa_mask =		0x000FFFFFFFFFFFFF;
+static const int double_bit_width = 64;
+static const int double_exp_bits = 11;
+static const int double_mantissa_bits = 52;
+static const int double_exp_offset = 52;
+static const int double_sign_offset = 63;
+static const int double_exp_bias = 1023;
 
 /*
 	(Almost) Everything from here on will be composed with the raw float memory
@@ -67,131 +91,4800 @@ const int double_exp_bias = 1023;
 	leave memory layout completely unaltered, which allows us to do our
 	magic.
 */
-uint32_t ShredFloatToData(float input_float) 
+
+/*
+	Everything here gets its raw bits by copying the float into an integer
+	of the same size. Pointer casting between the two is what this used to
+	do, but that breaks strict aliasing and the optimizer is allowed to make
+	a mess of it. A fixed size memcpy compiles down to a single register move
+	(or nothing at all), so it costs nothing.
+
+	Under C++20 std::bit_cast does the same thing and is constexpr, so the
+	whole family can be evaluated at compile time there, and SHRED_CONSTEXPR
+	turns into constexpr. Everywhere else it's empty and the functions are
+	plain static inline (apart from the GPU attributes below).
+*/
+#if defined(__cplusplus) && defined(__has_include)
+#if __has_include(<bit>) && \
+	(__cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L))
+#include <bit>
+#endif
+#endif
+
+/*
+	Built with nvcc or hipcc, SHRED_CONSTEXPR (and so every scalar function)
+	is __host__ __device__ as well, so kernels can call them, and
+	float_shredder_gpu.cuh has device versions of the batch functions.
+	memcpy and std::bit_cast both work on the device, and so do the
+	constants, being const integers.
+*/
+#if defined(__CUDACC__) || defined(__HIPCC__)
+#define SHRED_HOST_DEVICE __host__ __device__
+#else
+#define SHRED_HOST_DEVICE
+#endif
+
+#if defined(__cpp_lib_bit_cast) && __cpp_lib_bit_cast >= 201806L
+#define SHRED_HAVE_BIT_CAST 1
+#define SHRED_CONSTEXPR SHRED_HOST_DEVICE constexpr
+#define SHRED_CONSTEXPR_DATA constexpr
+#define SHRED_BIT_CAST(to_t, value) return std::bit_cast<to_t>(value);
+#else
+#define SHRED_CONSTEXPR SHRED_HOST_DEVICE
+#define SHRED_CONSTEXPR_DATA
+#define SHRED_BIT_CAST(to_t, value) \
+	to_t shred_cast_out; \
+	memcpy(&shred_cast_out, &(value), sizeof(shred_cast_out)); \
+	return shred_cast_out;
+#endif
+
+/*
+	Counters for the paths you'd want to know about in production: how
+	often the shift and scale functions have to clamp what they're given,
+	and what the batch functions are being fed. Define SHRED_STATS before
+	including this header to turn them on. Without it every SHRED_STATS_ADD
+	is empty, so there's nothing left of them in the functions at all, and
+	ShredStatsGet just hands back zeros.
+
+	The clamp counts are per float, so a batch call with a shift that's too
+	big adds n, the same as calling the scalar version n times would. Each
+	batch call that takes floats also runs ShredFloatClassCount over its
+	input for the subnormal, inf and NaN counts, which is an extra pass
+	over the data, so this is for finding out what's going on rather than
+	for leaving on.
+
+	Every thread counts into its own block, with plain relaxed loads and
+	stores since it's the only one writing to it, so the threads never
+	fight over a cache line. The first count a thread makes allocates its
+	block and pushes it onto a list, and ShredStatsGet adds up everything
+	on the list. Blocks aren't freed when their thread exits, which keeps
+	what it counted in the totals (and costs one small allocation per
+	thread that ever counted anything).
+
+	Like the dispatch table the list is per translation unit in C (and C++
+	before 17). From C++17 on it's an inline variable, so there's one for
+	the whole program.
+*/
+typedef struct ShredStats
+{
+	// calls to the ShiftExp and ShiftMant functions that clamped the shift
+	uint64_t shift_exp_clamps;
+	uint64_t shift_mant_clamps;
+	// calls to ScalePow2 that clamped to SHRED_SCALE_POW2_LIMIT
+	uint64_t scale_clamps;
+	// batch calls, how many floats they were given and what those were
+	uint64_t batch_calls;
+	uint64_t batch_floats;
+	uint64_t subnormals;
+	uint64_t infs;
+	uint64_t nans;
+} ShredStats;
+
+#if defined(SHRED_STATS)
+#if defined(__cplusplus) && defined(SHRED_HAVE_BIT_CAST)
+#include <type_traits>
+// counting isn't something constexpr functions can do at compile time
+#define SHRED_STATS_RUNTIME (!std::is_constant_evaluated())
+#else
+#define SHRED_STATS_RUNTIME 1
+#endif
+
+#if defined(__cplusplus) && (__cplusplus >= 201703L || \
+	(defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#define SHRED_STATS_SHARED inline
+#else
+#define SHRED_STATS_SHARED static
+#endif
+
+#if defined(__cplusplus)
+#define SHRED_THREAD_LOCAL thread_local
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define SHRED_THREAD_LOCAL _Thread_local
+#elif defined(_MSC_VER)
+#define SHRED_THREAD_LOCAL __declspec(thread)
+#else
+#define SHRED_THREAD_LOCAL __thread
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+typedef struct ShredStatsBlock
+{
+	ShredStats stats;
+	struct ShredStatsBlock* next;
+} ShredStatsBlock;
+
+SHRED_STATS_SHARED ShredStatsBlock* shred_stats_blocks = NULL;
+SHRED_STATS_SHARED SHRED_THREAD_LOCAL ShredStatsBlock* shred_stats_block =
+	NULL;
+
+static inline uint64_t ShredStatsLoad(const uint64_t* counter)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	// aligned 64-bit loads and stores are atomic on everything MSVC targets
+	return *(const volatile uint64_t*)counter;
+#else
+	return __atomic_load_n(counter, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline void ShredStatsStore(uint64_t* counter, uint64_t value)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	*(volatile uint64_t*)counter = value;
+#else
+	__atomic_store_n(counter, value, __ATOMIC_RELAXED);
+#endif
+}
+
+static inline ShredStatsBlock* ShredStatsLoadBlocks(void)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	return (ShredStatsBlock*)_InterlockedCompareExchangePointer(
+		(void* volatile*)&shred_stats_blocks, NULL, NULL);
+#else
+	return __atomic_load_n(&shred_stats_blocks, __ATOMIC_ACQUIRE);
+#endif
+}
+
+// this thread's block, or NULL if there wasn't the memory for one
+static inline ShredStatsBlock* ShredStatsThread(void)
+{
+	ShredStatsBlock* block = shred_stats_block;
+	if(block)
+	{
+		return block;
+	}
+	block = (ShredStatsBlock*)calloc(1, sizeof(ShredStatsBlock));
+	if(!block)
+	{
+		return NULL;
+	}
+#if defined(_MSC_VER) && !defined(__clang__)
+	void* head;
+	do
+	{
+		head = ShredStatsLoadBlocks();
+		block->next = (ShredStatsBlock*)head;
+	} while(_InterlockedCompareExchangePointer(
+		(void* volatile*)&shred_stats_blocks, block, head) != head);
+#else
+	block->next = __atomic_load_n(&shred_stats_blocks, __ATOMIC_RELAXED);
+	while(!__atomic_compare_exchange_n(&shred_stats_blocks, &block->next,
+		block, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+	{
+	}
+#endif
+	shred_stats_block = block;
+	return block;
+}
+
+#define SHRED_STATS_ADD(field, count) \
+	do \
+	{ \
+		if(SHRED_STATS_RUNTIME) \
+		{ \
+			ShredStatsBlock* shred_stats_thread = ShredStatsThread(); \
+			if(shred_stats_thread) \
+			{ \
+				ShredStatsStore(&shred_stats_thread->stats.field, \
+					ShredStatsLoad(&shred_stats_thread->stats.field) + \
+					(uint64_t)(count)); \
+			} \
+		} \
+	} while(0)
+#else
+#define SHRED_STATS_ADD(field, count)
+#endif
+
+// the counters live on the host, so device code doesn't count anything
+#if defined(__CUDA_ARCH__) || defined(__HIP_DEVICE_COMPILE__)
+#undef SHRED_STATS_ADD
+#define SHRED_STATS_ADD(field, count)
+#endif
+
+// adds up the counts from every thread so far
+static inline void ShredStatsGet(ShredStats* stats)
+{
+	memset(stats, 0, sizeof(ShredStats));
+#if defined(SHRED_STATS)
+	for(ShredStatsBlock* block = ShredStatsLoadBlocks(); block;
+		block = block->next)
+	{
+		stats->shift_exp_clamps +=
+			ShredStatsLoad(&block->stats.shift_exp_clamps);
+		stats->shift_mant_clamps +=
+			ShredStatsLoad(&block->stats.shift_mant_clamps);
+		stats->scale_clamps += ShredStatsLoad(&block->stats.scale_clamps);
+		stats->batch_calls += ShredStatsLoad(&block->stats.batch_calls);
+		stats->batch_floats += ShredStatsLoad(&block->stats.batch_floats);
+		stats->subnormals += ShredStatsLoad(&block->stats.subnormals);
+		stats->infs += ShredStatsLoad(&block->stats.infs);
+		stats->nans += ShredStatsLoad(&block->stats.nans);
+	}
+#endif
+}
+
+/*
+	Zeroes every thread's counts. A thread that's counting while this runs
+	can write back what it had before, so only reset when things are quiet
+	if you need it exact.
+*/
+static inline void ShredStatsReset(void)
+{
+#if defined(SHRED_STATS)
+	for(ShredStatsBlock* block = ShredStatsLoadBlocks(); block;
+		block = block->next)
+	{
+		uint64_t* counters = (uint64_t*)&block->stats;
+		for(size_t i = 0; i < sizeof(ShredStats) / sizeof(uint64_t); i++)
+		{
+			ShredStatsStore(&counters[i], 0);
+		}
+	}
+#endif
+}
+
+/*
+	Floats and doubles only differ in their widths and their constants, so
+	rather than writing everything out twice, the whole family of functions
+	is written once here and stamped out for each type below. This is the
+	closest thing C has to a template.
+
+	Name		goes in the function names (ShredFloatExp, ShredDoubleExp)
+	real_t		the floating point type
+	bits_t		the unsigned integer the same size as it
+	sbits_t		the signed integer the same size as it
+	prefix		the prefix of its constants (float_exp_mask, double_exp_mask)
+
+	Every mask, shift and bias comes from the constants, so each copy ends up
+	with its own values folded in as immediates and there's nothing checking
+	widths at runtime.
+
+	SHRED_DEFINE_FIELD_FAMILY is the part that only ever looks at the raw
+	bits, so it also works for formats C has no type for (see the 16-bit
+	formats further down), where real_t is just the raw bits too.
+*/
+#define SHRED_DEFINE_FAMILY(Name, real_t, bits_t, sbits_t, prefix) \
+\
+static inline SHRED_CONSTEXPR bits_t Shred##Name##ToData(real_t input_float) \
+{ \
+	SHRED_BIT_CAST(bits_t, input_float) \
+} \
+\
+/* \
+	This is to get the raw data back into a float without dealing with \
+	C/C++ implicit conversion. \
+*/ \
+static inline SHRED_CONSTEXPR real_t ShredDataTo##Name(bits_t input_int) \
+{ \
+	SHRED_BIT_CAST(real_t, input_int) \
+} \
+\
+SHRED_DEFINE_FIELD_FAMILY(Name, real_t, bits_t, sbits_t, prefix) \
+\
+/* \
+	The significand as a number: 1.mantissa in [1, 2) for normal numbers \
+	(and infs and NaNs), 0.mantissa in [0, 1) for subnormals and zero. The \
+	sign is dropped. \
+\
+	The mantissa bits under an exponent of 0 (the bias) already read as \
+	1.mantissa, so that's all normal numbers need. For subnormals -1 gets \
+	added on top, which is exact. Which of -1 or +0 to add comes from a mask \
+	rather than a branch, so mixed normal and subnormal data doesn't cost \
+	any mispredicts. \
+*/ \
+static inline SHRED_CONSTEXPR real_t Shred##Name##Mantissa(real_t input_float) \
+{ \
+	bits_t one = (bits_t)prefix##_exp_bias << prefix##_exp_offset; \
+	bits_t data = Shred##Name##ToData(input_float); \
+	bits_t is_sub = (bits_t)0 - (bits_t)((data & prefix##_exp_mask) == 0); \
+	return ShredDataTo##Name((data & prefix##_mantissa_mask) | one) + \
+		ShredDataTo##Name((prefix##_sign_mask | one) & is_sub); \
+}
+
+#define SHRED_DEFINE_FIELD_FAMILY(Name, real_t, bits_t, sbits_t, prefix) \
+\
+static inline SHRED_CONSTEXPR bits_t Shred##Name##ExpUnbiased( \
+	real_t input_float) \
+{ \
+	return (Shred##Name##ToData(input_float) & \
+		prefix##_exp_mask) >> prefix##_exp_offset; \
+} \
+\
+static inline SHRED_CONSTEXPR bits_t Shred##Name##ExpUnbiasedRaw( \
+	real_t input_float) \
+{ \
+	return Shred##Name##ToData(input_float) & prefix##_exp_mask; \
+} \
+\
+static inline SHRED_CONSTEXPR sbits_t Shred##Name##Exp(real_t input_float) \
+{ \
+	return (sbits_t)Shred##Name##ExpUnbiased(input_float) - \
+		prefix##_exp_bias; \
+} \
+\
+/* \
+	I can't yet foresee a use for this function, but it didn't make sense \
+	to leave it out. \
+*/ \
+static inline SHRED_CONSTEXPR sbits_t Shred##Name##ExpRaw(real_t input_float) \
+{ \
+	return (sbits_t)((bits_t)Shred##Name##Exp(input_float) << \
+		prefix##_exp_offset); \
+} \
+\
+static inline SHRED_CONSTEXPR bits_t Shred##Name##MantissaRaw( \
+	real_t input_float) \
+{ \
+	return Shred##Name##ToData(input_float) & prefix##_mantissa_mask; \
+} \
+\
+static inline SHRED_CONSTEXPR bool Shred##Name##IsNegative(real_t input_float) \
+{ \
+	return (Shred##Name##ToData(input_float) & prefix##_sign_mask) >> \
+		prefix##_sign_offset; \
+} \
+\
+static inline SHRED_CONSTEXPR real_t Shred##Name##ShiftExpUp( \
+	real_t input_float, \
+	int shift) \
+{ \
+	/* this isn't enough to prevent overflows but it'll do for now */ \
+	if(shift > prefix##_exp_bits) \
+	{ \
+		shift -= (shift-prefix##_exp_bits); \
+		SHRED_STATS_ADD(shift_exp_clamps, 1); \
+	} \
+	bits_t float_exp = Shred##Name##ToData(input_float) & prefix##_exp_mask; \
+	bits_t float_no_exp = \
+		Shred##Name##ToData(input_float) & ~prefix##_exp_mask; \
+	return ShredDataTo##Name \
+		(((float_exp << shift) & prefix##_exp_mask) | float_no_exp); \
+} \
+\
+static inline SHRED_CONSTEXPR real_t Shred##Name##ShiftExpDown( \
+	real_t input_float, \
+	int shift) \
+{ \
+	/* this isn't enough to prevent overflows but it'll do for now */ \
+	if(shift > prefix##_exp_bits) \
+	{ \
+		shift -= (shift-prefix##_exp_bits); \
+		SHRED_STATS_ADD(shift_exp_clamps, 1); \
+	} \
+	bits_t float_exp = Shred##Name##ToData(input_float) & prefix##_exp_mask; \
+	bits_t float_no_exp = \
+		Shred##Name##ToData(input_float) & ~prefix##_exp_mask; \
+	return ShredDataTo##Name \
+		(((float_exp >> shift) & prefix##_exp_mask) | float_no_exp); \
+} \
+\
+static inline SHRED_CONSTEXPR real_t Shred##Name##ShiftMantUp( \
+	real_t input_float, \
+	int shift) \
+{ \
+	/* this isn't enough to prevent overflows but it'll do for now */ \
+	if(shift > prefix##_mantissa_bits) \
+	{ \
+		shift -= (shift-prefix##_mantissa_bits); \
+		SHRED_STATS_ADD(shift_mant_clamps, 1); \
+	} \
+	bits_t float_mant = \
+		Shred##Name##ToData(input_float) & prefix##_mantissa_mask; \
+	bits_t float_no_mant = \
+		Shred##Name##ToData(input_float) & ~prefix##_mantissa_mask; \
+\
+	return ShredDataTo##Name \
+		(((float_mant << shift) & prefix##_mantissa_mask) | float_no_mant); \
+} \
+\
+static inline SHRED_CONSTEXPR real_t Shred##Name##ShiftMantDown( \
+	real_t input_float, \
+	int shift) \
+{ \
+	/* this isn't enough to prevent overflows but it'll do for now */ \
+	if(shift > prefix##_mantissa_bits) \
+	{ \
+		shift -= (shift-prefix##_mantissa_bits); \
+		SHRED_STATS_ADD(shift_mant_clamps, 1); \
+	} \
+	bits_t float_mant = \
+		Shred##Name##ToData(input_float) & prefix##_mantissa_mask; \
+	bits_t float_no_mant = \
+		Shred##Name##ToData(input_float) & ~prefix##_mantissa_mask; \
+\
+	return ShredDataTo##Name \
+		(((float_mant >> shift) & prefix##_mantissa_mask) | float_no_mant); \
+}
+
+SHRED_DEFINE_FAMILY(Float, float, uint32_t, int32_t, float)
+SHRED_DEFINE_FAMILY(Double, double, uint64_t, int64_t, double)
+
+/*
+	ShredFloatScalePow2(x, scale) is x * 2^scale, the same as ldexpf, but
+	when x is a normal float and the result is still normal (which is
+	nearly always) it's just an integer add on the exponent field.
+
+	Unlike the ShiftExp functions this gets every case right. Results too
+	big for the type become infinity, results too small to round to the
+	smallest subnormal become zero (both keeping the sign), and zeros, infs
+	and NaNs come back exactly as they went in. Only the awkward cases, where
+	x is subnormal or the result ends up subnormal and has to be rounded,
+	get handed to ldexp.
+
+	Scales beyond SHRED_SCALE_POW2_LIMIT are clamped to it, which is already
+	far enough to take the smallest double to infinity or the biggest to 0.
+*/
+#define SHRED_SCALE_POW2_LIMIT 4096
+
+#define SHRED_DEFINE_SCALE_POW2(Name, real_t, bits_t, sbits_t, prefix, \
+	ldexp_func) \
+static inline SHRED_HOST_DEVICE real_t Shred##Name##ScalePow2( \
+	real_t input_float, int scale) \
+{ \
+	bits_t data = Shred##Name##ToData(input_float); \
+	bits_t sign = data & prefix##_sign_mask; \
+	sbits_t exp_max = (sbits_t)(prefix##_exp_mask >> prefix##_exp_offset); \
+	sbits_t exp = (sbits_t)Shred##Name##ExpUnbiased(input_float); \
+	if(scale > SHRED_SCALE_POW2_LIMIT) \
+	{ \
+		scale = SHRED_SCALE_POW2_LIMIT; \
+		SHRED_STATS_ADD(scale_clamps, 1); \
+	} else if(scale < -SHRED_SCALE_POW2_LIMIT) { \
+		scale = -SHRED_SCALE_POW2_LIMIT; \
+		SHRED_STATS_ADD(scale_clamps, 1); \
+	} \
+	if(exp == exp_max || (data & ~prefix##_sign_mask) == 0) \
+	{ \
+		return input_float; \
+	} \
+	if(exp == 0) \
+	{ \
+		return ldexp_func(input_float, scale); \
+	} \
+	sbits_t new_exp = exp + scale; \
+	if(new_exp >= exp_max) \
+	{ \
+		return ShredDataTo##Name(sign | prefix##_exp_mask); \
+	} \
+	/* below half the smallest subnormal, which rounds to zero */ \
+	if(new_exp < -prefix##_mantissa_bits) \
+	{ \
+		return ShredDataTo##Name(sign); \
+	} \
+	if(new_exp <= 0) \
+	{ \
+		return ldexp_func(input_float, scale); \
+	} \
+	return ShredDataTo##Name(data + ((bits_t)scale << prefix##_exp_offset)); \
+}
+
+SHRED_DEFINE_SCALE_POW2(Float, float, uint32_t, int32_t, float, ldexpf)
+SHRED_DEFINE_SCALE_POW2(Double, double, uint64_t, int64_t, double, ldexp)
+
+/*
+	Sorting floats into the same classes fpclassify does, but from the raw
+	bits. With the sign masked off, the classes are just ranges of the
+	remaining integer (zero, then subnormals up to the mantissa mask, normals
+	up to the exponent mask, infinity exactly at it and NaNs above), so the
+	class is the number of those boundaries the value is past. No branches,
+	and it doesn't care about the FPU's denormal mode either.
+
+	The classes are numbered in that order, so SHRED_CLASS_NORMAL and up are
+	"not zero or subnormal" and SHRED_CLASS_INFINITE and up are "not finite".
+*/
+typedef enum ShredClass
 {
-	void* input_float_mem = &input_float;
-	return *(uint32_t*)input_float_mem;
+	SHRED_CLASS_ZERO = 0,
+	SHRED_CLASS_SUBNORMAL,
+	SHRED_CLASS_NORMAL,
+	SHRED_CLASS_INFINITE,
+	SHRED_CLASS_NAN,
+	SHRED_CLASS_COUNT
+} ShredClass;
+
+#define SHRED_DEFINE_CLASSIFY(Name, real_t, bits_t, prefix) \
+static inline SHRED_CONSTEXPR ShredClass Shred##Name##Classify( \
+	real_t input_float) \
+{ \
+	bits_t abs = Shred##Name##ToData(input_float) & ~prefix##_sign_mask; \
+	return (ShredClass)((abs > 0) + (abs > prefix##_mantissa_mask) + \
+		(abs >= prefix##_exp_mask) + (abs > prefix##_exp_mask)); \
 }
 
+SHRED_DEFINE_CLASSIFY(Float, float, uint32_t, float)
+SHRED_DEFINE_CLASSIFY(Double, double, uint64_t, double)
+
 /*
-	This is to get the raw data back into a float without dealing with C/C++
-	implicit conversion.
+	Byte order. Floats written out by a machine with the other byte order
+	come back with their bytes reversed, and ShredFloatByteSwap puts them
+	back (or does it to yours before they go out). The shifts compile down
+	to a single bswap or rev.
+
+	ShredEndian is the byte order some data is in. SHRED_ENDIAN_NATIVE is
+	whatever this machine uses, so it never needs swapping.
 */
-float ShredDataToFloat(uint32_t input_int)
+typedef enum ShredEndian
+{
+	SHRED_ENDIAN_NATIVE = 0,
+	SHRED_ENDIAN_LITTLE,
+	SHRED_ENDIAN_BIG
+} ShredEndian;
+
+static inline bool ShredNativeIsBigEndian(void)
+{
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__)
+	return __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+#else
+	const uint16_t probe = 1;
+	uint8_t first;
+	memcpy(&first, &probe, 1);
+	return first == 0;
+#endif
+}
+
+static inline bool ShredEndianIsNative(ShredEndian endian)
+{
+	return endian == SHRED_ENDIAN_NATIVE ||
+		(endian == SHRED_ENDIAN_BIG) == ShredNativeIsBigEndian();
+}
+
+static inline SHRED_CONSTEXPR uint32_t ShredByteSwap32(uint32_t x)
 {
-	void* input_int_mem = &input_int;
-	return *(float*)input_int_mem;
+	return (x >> 24) | ((x >> 8) & 0x0000FF00) | ((x << 8) & 0x00FF0000) |
+		(x << 24);
 }
 
-uint32_t ShredFloatExpUnbiased(float input_float)
+static inline SHRED_CONSTEXPR uint64_t ShredByteSwap64(uint64_t x)
 {
-	return (ShredFloatToData(input_float) & 
-		float_exp_mask) >> float_exp_offset;
+	return ((uint64_t)ShredByteSwap32((uint32_t)x) << 32) |
+		ShredByteSwap32((uint32_t)(x >> 32));
 }
 
-uint32_t ShredFloatExpUnbiasedRaw(float input_float)
+static inline SHRED_CONSTEXPR float ShredFloatByteSwap(float input_float)
 {
-	return ShredFloatToData(input_float) & float_exp_mask;
+	return ShredDataToFloat(ShredByteSwap32(ShredFloatToData(input_float)));
 }
 
-int32_t ShredFloatExp(float input_float)
+static inline SHRED_CONSTEXPR double ShredDoubleByteSwap(double input_float)
 {
-	return (int32_t)ShredFloatExpUnbiased(input_float) - 127;
+	return ShredDataToDouble(ShredByteSwap64(ShredDoubleToData(input_float)));
+}
+
+/*
+	Units in the last place, for measuring how many representable values
+	apart two floats are.
+
+	With the sign masked off, the raw data of a float counts up one
+	representable value at a time from zero through the subnormals and
+	normals to infinity. ShredFloatUlpIndex puts the negative floats on the
+	same line by negating theirs, so it's the signed position of a float
+	counting from zero (+0 and -0 are both 0) and neighbouring floats always
+	have neighbouring indexes. NaNs don't have a meaningful index.
+
+	ShredFloatUlpDistance(a, b) is how far apart their indexes are. If only
+	one of them is NaN that's the biggest bits_t there is, but two NaNs are
+	0 apart, since a NaN where one was expected isn't an error.
+
+	ShredFloatStepUlps(x, n) is nextafter n times over, towards +infinity
+	for positive n and -infinity for negative n. It stops at infinity rather
+	than going past, stepping onto zero gives +0, and NaNs (or 0 steps) come
+	back unchanged.
+*/
+#define SHRED_DEFINE_ULP(Name, real_t, bits_t, sbits_t, prefix) \
+static inline SHRED_CONSTEXPR sbits_t Shred##Name##UlpIndex( \
+	real_t input_float) \
+{ \
+	bits_t data = Shred##Name##ToData(input_float); \
+	bits_t neg = (bits_t)0 - (data >> prefix##_sign_offset); \
+	bits_t abs = data & ~prefix##_sign_mask; \
+	return (sbits_t)((abs ^ neg) - neg); \
+} \
+\
+static inline SHRED_CONSTEXPR bits_t Shred##Name##UlpDistance(real_t a, \
+	real_t b) \
+{ \
+	bool nan_a = Shred##Name##Classify(a) == SHRED_CLASS_NAN; \
+	bool nan_b = Shred##Name##Classify(b) == SHRED_CLASS_NAN; \
+	if(nan_a || nan_b) \
+	{ \
+		return nan_a && nan_b ? 0 : ~(bits_t)0; \
+	} \
+	sbits_t index_a = Shred##Name##UlpIndex(a); \
+	sbits_t index_b = Shred##Name##UlpIndex(b); \
+	return index_a > index_b ? (bits_t)index_a - (bits_t)index_b : \
+		(bits_t)index_b - (bits_t)index_a; \
+} \
+\
+/* \
+	The stepping is done on the index moved up by the index of infinity, \
+	so it runs from 0 at -infinity to 2 * limit at +infinity and clamping \
+	to either end can't overflow. \
+*/ \
+static inline SHRED_CONSTEXPR real_t Shred##Name##StepUlps( \
+	real_t input_float, sbits_t steps) \
+{ \
+	if(steps == 0 || Shred##Name##Classify(input_float) == SHRED_CLASS_NAN) \
+	{ \
+		return input_float; \
+	} \
+	bits_t limit = prefix##_exp_mask; \
+	bits_t pos = (bits_t)Shred##Name##UlpIndex(input_float) + limit; \
+	if(steps > 0) \
+	{ \
+		bits_t room = 2 * limit - pos; \
+		pos = (bits_t)steps > room ? 2 * limit : pos + (bits_t)steps; \
+	} else { \
+		bits_t back = (bits_t)0 - (bits_t)steps; \
+		pos = back > pos ? 0 : pos - back; \
+	} \
+	return ShredDataTo##Name(pos >= limit ? pos - limit : \
+		prefix##_sign_mask | (limit - pos)); \
+}
+
+SHRED_DEFINE_ULP(Float, float, uint32_t, int32_t, float)
+SHRED_DEFINE_ULP(Double, double, uint64_t, int64_t, double)
+
+/*
+	Unsigned keys that sort the same way the floats do, for B-trees and
+	other indexes that would rather compare integers. Stored big-endian
+	they sort right with memcmp too.
+
+	This is the radix sort key: positive floats get their sign bit flipped,
+	which puts them above all the negative ones, and negative floats get
+	every bit flipped, which turns their order around. The order is IEEE
+	754's totalOrder, -NaN < -infinity < ... < -0 < +0 < ... < +infinity <
+	+NaN, NaNs going to whichever end their sign bit says and ordered by
+	payload within it. It's one to one, so ShredFloatFromOrderedKey gives
+	back exactly the bits that went in, -0s and NaN payloads included.
+
+	ShredFloatToCanonicalKey is for when the keys should compare the way
+	the floats do instead. -0 gets the same key as +0, and every NaN,
+	whatever its sign and payload, gets the key of the default quiet NaN,
+	so they all land together above +infinity. Its keys turn back into
+	floats with ShredFloatFromOrderedKey as well, as +0 and that NaN.
+*/
+#define SHRED_DEFINE_ORDERED_KEY(Name, real_t, bits_t, prefix) \
+static inline SHRED_CONSTEXPR bits_t Shred##Name##ToOrderedKey( \
+	real_t input_float) \
+{ \
+	bits_t data = Shred##Name##ToData(input_float); \
+	return data ^ (((bits_t)0 - (data >> prefix##_sign_offset)) | \
+		prefix##_sign_mask); \
+} \
+\
+static inline SHRED_CONSTEXPR real_t Shred##Name##FromOrderedKey(bits_t key) \
+{ \
+	/* the sign bit of a key is set for the positive floats */ \
+	return ShredDataTo##Name(key ^ (((key >> prefix##_sign_offset) - 1) | \
+		prefix##_sign_mask)); \
+} \
+\
+static inline SHRED_CONSTEXPR bits_t Shred##Name##ToCanonicalKey( \
+	real_t input_float) \
+{ \
+	bits_t abs = Shred##Name##ToData(input_float) & ~prefix##_sign_mask; \
+	if(abs == 0) \
+	{ \
+		return prefix##_sign_mask; \
+	} \
+	if(abs > prefix##_exp_mask) \
+	{ \
+		return prefix##_sign_mask | prefix##_exp_mask | \
+			((bits_t)1 << (prefix##_mantissa_bits - 1)); \
+	} \
+	return Shred##Name##ToOrderedKey(input_float); \
+}
+
+SHRED_DEFINE_ORDERED_KEY(Float, float, uint32_t, float)
+SHRED_DEFINE_ORDERED_KEY(Double, double, uint64_t, double)
+
+/*
+	Things that only depend on the exponent, indexed by the biased exponent
+	ShredFloatExpUnbiased gives you (0 to 255 for floats, 0 to 2047 for
+	doubles).
+
+	BinadeBase	the smallest value with that exponent, 2^(exp - bias), so
+			the binade is [base, 2 * base). Exponent 0 is zero and the
+			subnormals, which start at 0, and the top one is infinity.
+	BinadeWidth	how far the binade reaches: the same as the base, except
+			exponent 0 goes up to the smallest normal number
+	BinadeUlp	the gap between neighbouring values in the binade, which
+			is the same for exponents 0 and 1. Infinity for the top one.
+	DecimalExp	floor(log10(width)), the power of ten at or below where
+			the binade starts (below the smallest normal for exponent
+			0). Everything in the binade has that decimal exponent or
+			the next one up.
+
+	None of them touch libm. The powers of two are just the exponent put
+	back where it goes, which is cheaper than looking it up. The decimal
+	exponent is p * log10(2) in fixed point: 78913 / 2^18 is close enough
+	to log10(2) that the floor comes out exact for every p a double can
+	have, and that's about as fast as a load from L1 too. The ULP has to
+	tell normal gaps from subnormal ones and the top binade from the rest,
+	which takes over a dozen instructions, so that one comes out of a table
+	(256 entries for floats, 2048 for doubles) that's filled in at compile
+	time from the same sums. The table holds the raw bits, since C++ before
+	17 can't write the values down as float literals. It lives on the host,
+	so device code works the ULP out from the same sums instead.
+
+	Under C++20 they're all constexpr.
+*/
+#define SHRED_LUT_4(F, e) F(e), F(e + 1), F(e + 2), F(e + 3)
+#define SHRED_LUT_16(F, e) SHRED_LUT_4(F, e), SHRED_LUT_4(F, e + 4), \
+	SHRED_LUT_4(F, e + 8), SHRED_LUT_4(F, e + 12)
+#define SHRED_LUT_64(F, e) SHRED_LUT_16(F, e), SHRED_LUT_16(F, e + 16), \
+	SHRED_LUT_16(F, e + 32), SHRED_LUT_16(F, e + 48)
+#define SHRED_LUT_256(F, e) SHRED_LUT_64(F, e), SHRED_LUT_64(F, e + 64), \
+	SHRED_LUT_64(F, e + 128), SHRED_LUT_64(F, e + 192)
+#define SHRED_LUT_2048(F, e) SHRED_LUT_256(F, e), SHRED_LUT_256(F, e + 256), \
+	SHRED_LUT_256(F, e + 512), SHRED_LUT_256(F, e + 768), \
+	SHRED_LUT_256(F, e + 1024), SHRED_LUT_256(F, e + 1280), \
+	SHRED_LUT_256(F, e + 1536), SHRED_LUT_256(F, e + 1792)
+
+/*
+	The raw bits of the ULP for biased exponent e, as a constant expression.
+	Up to mantissa_bits the gap is a subnormal, a single mantissa bit.
+*/
+#define SHRED_ULP_NORMAL(e) ((uint64_t)(e) + ((e) == 0))
+#define SHRED_ULP_BITS(e, top, exp_mask, mant_bits) \
+	((e) == (top) ? (exp_mask) : \
+	SHRED_ULP_NORMAL(e) > (mant_bits) ? \
+	(SHRED_ULP_NORMAL(e) - (mant_bits)) << (mant_bits) : \
+	(uint64_t)1 << ((SHRED_ULP_NORMAL(e) - 1) & 63))
+#define SHRED_FLOAT_ULP_BITS(e) \
+	(uint32_t)SHRED_ULP_BITS(e, 255, 0x7F800000, 23)
+#define SHRED_DOUBLE_ULP_BITS(e) \
+	SHRED_ULP_BITS(e, 2047, 0x7FF0000000000000, 52)
+
+static SHRED_CONSTEXPR_DATA const uint32_t shred_float_binade_ulp[256] = {
+	SHRED_LUT_256(SHRED_FLOAT_ULP_BITS, 0)
+};
+static SHRED_CONSTEXPR_DATA const uint64_t shred_double_binade_ulp[2048] = {
+	SHRED_LUT_2048(SHRED_DOUBLE_ULP_BITS, 0)
+};
+
+#if defined(__CUDA_ARCH__) || defined(__HIP_DEVICE_COMPILE__)
+#define SHRED_BINADE_ULP(Name, bits_t, prefix, exp) \
+	return ShredDataTo##Name((bits_t)SHRED_ULP_BITS(exp, \
+		prefix##_exp_mask >> prefix##_exp_offset, prefix##_exp_mask, \
+		prefix##_mantissa_bits));
+#else
+#define SHRED_BINADE_ULP(Name, bits_t, prefix, exp) \
+	return ShredDataTo##Name(shred_##prefix##_binade_ulp[exp]);
+#endif
+
+#define SHRED_DEFINE_BINADE(Name, real_t, bits_t, sbits_t, prefix) \
+static inline SHRED_CONSTEXPR real_t Shred##Name##BinadeBase(bits_t exp) \
+{ \
+	return ShredDataTo##Name(exp << prefix##_exp_offset); \
+} \
+\
+static inline SHRED_CONSTEXPR real_t Shred##Name##BinadeWidth(bits_t exp) \
+{ \
+	return ShredDataTo##Name((exp + (exp == 0)) << prefix##_exp_offset); \
+} \
+\
+static inline SHRED_CONSTEXPR real_t Shred##Name##BinadeUlp(bits_t exp) \
+{ \
+	SHRED_BINADE_ULP(Name, bits_t, prefix, exp) \
+} \
+\
+/* \
+	Shifting right only floors for positive numbers, so p gets moved up by \
+	2^18 first, which moves the result up by exactly 78913. \
+*/ \
+static inline SHRED_CONSTEXPR sbits_t Shred##Name##DecimalExp(bits_t exp) \
+{ \
+	uint64_t p = (uint64_t)(exp + (exp == 0)) - prefix##_exp_bias + \
+		((uint64_t)1 << 18); \
+	return (sbits_t)((p * 78913) >> 18) - 78913; \
+}
+
+SHRED_DEFINE_BINADE(Float, float, uint32_t, int32_t, float)
+SHRED_DEFINE_BINADE(Double, double, uint64_t, int64_t, double)
+
+/*
+	TruncateMantissa(x, bits) rounds away the low `bits` bits of x's
+	mantissa, to nearest even, leaving them zero. Unlike ShiftMantDown the
+	value stays (nearly) the same, it just needs fewer bits to store, which
+	is what makes it worth doing before handing the data to a compressor.
+
+	Rounding up can carry into the exponent, which is still the right
+	answer, and the biggest finite numbers can round up to infinity. NaNs
+	stay NaN (quieted, since dropping the bits could otherwise turn them
+	into infinities) and bits gets clamped to [0, mantissa_bits].
+*/
+#define SHRED_DEFINE_TRUNCATE(Name, real_t, bits_t, sbits_t, prefix) \
+static inline SHRED_CONSTEXPR real_t Shred##Name##TruncateMantissa( \
+	real_t input_float, int bits) \
+{ \
+	bits = bits < 0 ? 0 : bits > prefix##_mantissa_bits ? \
+		prefix##_mantissa_bits : bits; \
+	bits_t data = Shred##Name##ToData(input_float); \
+	bits_t keep = ~(bits_t)0 << bits; \
+	/* half a step less one, plus one more if what's kept is odd */ \
+	bits_t round = (~keep >> 1) + ((data >> bits) & (bits_t)(bits > 0)); \
+	bits_t quiet = (bits_t)1 << (prefix##_mantissa_bits - 1); \
+	bits_t is_nan = (bits_t)0 - \
+		(bits_t)((data & ~prefix##_sign_mask) > prefix##_exp_mask); \
+	return ShredDataTo##Name((((data & keep) | quiet) & is_nan) | \
+		((data + round) & keep & ~is_nan)); \
 }
 
-// I can't yet foresee a use for this function, but it didn't make sense to leave
-// it out.
-int32_t ShredFloatExpRaw(float input_float)
+SHRED_DEFINE_TRUNCATE(Float, float, uint32_t, int32_t, float)
+SHRED_DEFINE_TRUNCATE(Double, double, uint64_t, int64_t, double)
+
+/*
+	Approximate log2, exp2, sqrt and 1 / sqrt for floats, for when libm is
+	the bottleneck and you don't need every bit. Each one takes how
+	accurate it has to be:
+
+	SHRED_APPROX_FAST	error under 1e-3
+	SHRED_APPROX_MEDIUM	error under 1e-5
+	SHRED_APPROX_FULL	within a couple of ULPs of the true result
+
+	The error is absolute for log2 (it's relative to the result's size
+	too, away from 1), relative for the rest. The exact worst cases, all
+	found by trying every float, are in the README.
+
+	Log2 splits x into 2^k * m with m in [sqrt(1/2), sqrt(2)), which is a
+	few integer operations on the exponent and mantissa bits, and then it's
+	k + log2(m) with a polynomial for log2(m). Exp2 goes the other way
+	round: the nearest integer to x goes straight into the exponent and a
+	polynomial does 2^x for what's left, in [-1/2, 1/2]. The polynomials
+	are minimax fits, so the error is spread evenly across the range. Rsqrt
+	starts from the bit trick guess (with Moroz et al.'s tuned constants)
+	and takes one Newton step per tier, and sqrt is x * rsqrt(x) with a
+	Heron's method step at full accuracy.
+
+	Zeros, subnormals, negatives, infs and NaNs all give the same answers
+	libm does (NaN for negatives), but they go down a slower path, as do
+	exp2's of anything outside (-126, 126).
+*/
+/*
+	The approximations come out the same bits on every instruction set,
+	which only holds if every multiply and add rounds on its own. Compilers
+	will fuse them into FMAs wherever the target has them (GCC does by
+	default, even across intrinsics, and so does any compiler for scalar
+	code under -march=native), so everything that does their arithmetic,
+	the scalar functions and the kernels alike, goes between
+	SHRED_NO_CONTRACT_BEGIN and SHRED_NO_CONTRACT_END. MSVC only fuses under
+	/fp:contract or /fp:fast, so there they're empty.
+*/
+#if defined(__clang__)
+#define SHRED_NO_CONTRACT_BEGIN _Pragma("float_control(push)") \
+	_Pragma("clang fp contract(off)")
+#define SHRED_NO_CONTRACT_END _Pragma("float_control(pop)")
+#elif defined(__GNUC__)
+#define SHRED_NO_CONTRACT_BEGIN _Pragma("GCC push_options") \
+	_Pragma("GCC optimize(\"fp-contract=off\")")
+#define SHRED_NO_CONTRACT_END _Pragma("GCC pop_options")
+#else
+#define SHRED_NO_CONTRACT_BEGIN
+#define SHRED_NO_CONTRACT_END
+#endif
+
+typedef enum ShredApprox
+{
+	SHRED_APPROX_FAST = 0,
+	SHRED_APPROX_MEDIUM,
+	SHRED_APPROX_FULL
+} ShredApprox;
+
+/*
+	The polynomials, written out in Horner form once for both the scalar
+	and the vector versions. mad(a, t, c) is a * t + c and k(c) turns a
+	constant into whatever mad takes.
+*/
+#define SHRED_LOG2_FAST(mad, k, t) \
+	mad(mad(k(0.445070326f), t, k(-0.754081368f)), t, k(1.44515204f))
+#define SHRED_LOG2_MEDIUM(mad, k, t) \
+	mad(mad(mad(mad(mad(k(-0.206591815f), t, k(0.32215482f)), t, \
+	k(-0.367489964f)), t, k(0.479348004f)), t, k(-0.721131861f)), t, \
+	k(1.4427135f))
+#define SHRED_LOG2_FULL(mad, k, t) \
+	mad(mad(mad(mad(mad(mad(mad(mad(k(0.125837058f), t, \
+	k(-0.207269758f)), t, k(0.215715602f)), t, k(-0.238944814f)), t, \
+	k(0.287916243f)), t, k(-0.360703677f)), t, k(0.480910629f)), t, \
+	k(-0.721347332f)), t, k(1.44269502f))
+#define SHRED_EXP2_FAST(mad, k, f) \
+	mad(mad(mad(k(0.0551716685f), f, k(0.242611125f)), f, \
+	k(0.693260968f)), f, k(0.999928057f))
+#define SHRED_EXP2_MEDIUM(mad, k, f) \
+	mad(mad(mad(mad(k(0.00957010221f), f, k(0.0559178591f)), f, \
+	k(0.240247443f)), f, k(0.693121791f)), f, k(0.999999285f))
+#define SHRED_EXP2_FULL(mad, k, f) \
+	mad(mad(mad(mad(mad(mad(k(0.000153458124f), f, \
+	k(0.00133999309f)), f, k(0.00961848907f)), f, k(0.0555032864f)), f, \
+	k(0.240226462f)), f, k(0.693147182f)), f, k(1.0f))
+
+// log2's reduction moves the mantissa's range down to start at sqrt(1/2)
+#define SHRED_LOG2_SQRT_HALF 0x3F3504F3
+// 1.5 * 2^23, the same rounding trick as the block quantization
+#define SHRED_EXP2_ROUND 12582912.0f
+#define SHRED_EXP2_LIMIT 126.0f
+#define SHRED_RSQRT_MAGIC 0x5F1FFFF9
+#define SHRED_RSQRT_SCALE 0.703952253f
+#define SHRED_RSQRT_OFFSET 2.38924456f
+
+#define SHRED_APPROX_MAD(a, t, c) ((a) * (t) + (c))
+#define SHRED_APPROX_K(c) (c)
+
+SHRED_NO_CONTRACT_BEGIN
+
+static inline SHRED_CONSTEXPR float ShredFloatLog2Approx(float input_float,
+	ShredApprox accuracy)
 {
-	return ShredFloatExp(input_float) << float_exp_offset;
+	uint32_t data = ShredFloatToData(input_float);
+	// taken off the end for a subnormal that's been scaled up
+	float scaled = 0.0f;
+	// anything that isn't a positive normal number
+	if(data - (float_mantissa_mask + 1) >=
+		float_exp_mask - (float_mantissa_mask + 1))
+	{
+		if((data & ~float_sign_mask) == 0)
+		{
+			return ShredDataToFloat(float_sign_mask | float_exp_mask);
+		}
+		if(data >= float_exp_mask)
+		{
+			// infinity stays, NaNs and negatives get a quiet NaN
+			return data == float_exp_mask ? input_float :
+				ShredDataToFloat(data | 0x7FC00000);
+		}
+		// subnormal, times 2^23 is normal. It's worked out as data *
+		// 2^-126 so the multiply doesn't take a subnormal, which can cost
+		// a microcode assist, and it carries on below rather than calling
+		// itself so the whole thing can be inlined
+		data = ShredFloatToData((float)data * 1.17549435e-38f);
+		scaled = 23.0f;
+	}
+	uint32_t shifted = data + (float_exp_bias << float_exp_offset) -
+		SHRED_LOG2_SQRT_HALF;
+	float k = (float)((int32_t)(shifted >> float_exp_offset) -
+		float_exp_bias);
+	float t = ShredDataToFloat((shifted & float_mantissa_mask) +
+		SHRED_LOG2_SQRT_HALF) - 1.0f;
+	float p = accuracy == SHRED_APPROX_FAST ?
+		SHRED_LOG2_FAST(SHRED_APPROX_MAD, SHRED_APPROX_K, t) :
+		accuracy == SHRED_APPROX_MEDIUM ?
+		SHRED_LOG2_MEDIUM(SHRED_APPROX_MAD, SHRED_APPROX_K, t) :
+		SHRED_LOG2_FULL(SHRED_APPROX_MAD, SHRED_APPROX_K, t);
+	return k + t * p - scaled;
 }
 
-uint32_t ShredFloatMantissaRaw(float input_float)
+static inline SHRED_CONSTEXPR float ShredFloatExp2Approx(float input_float,
+	ShredApprox accuracy)
 {
-	return ShredFloatToData(input_float) & float_mantissa_mask;
+	float x = input_float;
+	// a subnormal comes out the same as 0 would, without the slow
+	// arithmetic on it
+	if(x > -1.17549435e-38f && x < 1.17549435e-38f)
+	{
+		x = 0.0f;
+	}
+	if(!(x > -SHRED_EXP2_LIMIT && x < SHRED_EXP2_LIMIT))
+	{
+		if(x != x)
+		{
+			return x + x;
+		}
+		if(x >= 128.0f)
+		{
+			return ShredDataToFloat(float_exp_mask);
+		}
+		if(x <= -150.0f)
+		{
+			return 0.0f;
+		}
+		// close enough to either end that the result needs rescaling
+		return x > 0 ? ShredFloatExp2Approx(x - 2.0f, accuracy) * 4.0f :
+			ShredFloatExp2Approx(x + 64.0f, accuracy) * 5.42101086e-20f;
+	}
+	float rounded = x + SHRED_EXP2_ROUND;
+	uint32_t i = ShredFloatToData(rounded) -
+		ShredFloatToData(SHRED_EXP2_ROUND);
+	float f = x - (rounded - SHRED_EXP2_ROUND);
+	float p = accuracy == SHRED_APPROX_FAST ?
+		SHRED_EXP2_FAST(SHRED_APPROX_MAD, SHRED_APPROX_K, f) :
+		accuracy == SHRED_APPROX_MEDIUM ?
+		SHRED_EXP2_MEDIUM(SHRED_APPROX_MAD, SHRED_APPROX_K, f) :
+		SHRED_EXP2_FULL(SHRED_APPROX_MAD, SHRED_APPROX_K, f);
+	return ShredDataToFloat(ShredFloatToData(p) + (i << float_exp_offset));
 }
 
-// TODO: test
-float ShredFloatMantissa(float input_float)
+// the rsqrt of a positive normal x
+static inline SHRED_CONSTEXPR float ShredFloatRsqrtNormal(float x,
+	ShredApprox accuracy)
 {
-	if(ShredFloatExpUnbiased(input_float) > 0)
+	float y = ShredDataToFloat(SHRED_RSQRT_MAGIC -
+		(ShredFloatToData(x) >> 1));
+	y = SHRED_RSQRT_SCALE * y * (SHRED_RSQRT_OFFSET - x * y * y);
+	float half = 0.5f * x;
+	if(accuracy >= SHRED_APPROX_MEDIUM)
+	{
+		y = y * (1.5f - half * y * y);
+	}
+	if(accuracy >= SHRED_APPROX_FULL)
 	{
-		return ShredDataToFloat
-			(ShredFloatMantissaRaw(input_float)) + 1;
-	} else {
-		return ShredDataToFloat
-			(ShredFloatMantissaRaw(input_float));
+		// the same step, but adding on a small correction rounds better
+		y = y + y * (0.5f - half * y * y);
 	}
+	return y;
 }
 
-// TODO: test
-bool ShredFloatIsNegative(float input_float)
+/*
+	The sqrt of a positive normal x. At full accuracy, rather than another
+	step on the rsqrt, there's one Heron's method step on the sqrt itself,
+	which gets it to within an ULP.
+*/
+static inline SHRED_CONSTEXPR float ShredFloatSqrtNormal(float x,
+	ShredApprox accuracy)
 {
-	return (ShredFloatToData(input_float) & float_sign_mask) >> 31;
+	if(accuracy >= SHRED_APPROX_FULL)
+	{
+		float y = ShredFloatRsqrtNormal(x, SHRED_APPROX_MEDIUM);
+		float s = x * y;
+		return s + (0.5f * y) * (x - s * s);
+	}
+	return x * ShredFloatRsqrtNormal(x, accuracy);
 }
 
-// TODO: test
-float ShredFloatShiftExpUp(float input_float, int shift)
+static inline SHRED_CONSTEXPR float ShredFloatRsqrtApprox(float input_float,
+	ShredApprox accuracy)
 {
-	// this isn't enough to prevent overflows but it'll do for now
-	if(shift > 8)
+	uint32_t data = ShredFloatToData(input_float);
+	if(data - (float_mantissa_mask + 1) >=
+		float_exp_mask - (float_mantissa_mask + 1))
 	{
-		shift -= (shift-8);
+		if((data & ~float_sign_mask) == 0)
+		{
+			// +-0 gives +-infinity
+			return ShredDataToFloat(data | float_exp_mask);
+		}
+		if(data < float_exp_mask)
+		{
+			// subnormal, times 2^24, worked out as data * 2^-125 like log2
+			return ShredFloatRsqrtNormal((float)data * 2.35098870e-38f,
+				accuracy) * 4096.0f;
+		}
+		return data == float_exp_mask ? 0.0f :
+			ShredDataToFloat(data | 0x7FC00000);
 	}
-	uint32_t float_exp = ShredFloatToData(input_float) & float_exp_mask;
-	uint32_t float_no_exp = ShredFloatToData(input_float) & ~float_exp_mask;
-	return ShredDataToFloat
-		(((float_exp << shift) & float_exp_mask) | float_no_exp);
+	return ShredFloatRsqrtNormal(input_float, accuracy);
 }
 
-// TODO: test
-float ShredFloatShiftExpDown(float input_float, int shift)
+static inline SHRED_CONSTEXPR float ShredFloatSqrtApprox(float input_float,
+	ShredApprox accuracy)
 {
-	// this isn't enough to prevent overflows but it'll do for now
-	if(shift > 8)
+	uint32_t data = ShredFloatToData(input_float);
+	if(data - (float_mantissa_mask + 1) >=
+		float_exp_mask - (float_mantissa_mask + 1))
 	{
-		shift -= (shift-8);
+		if((data & ~float_sign_mask) == 0 || data == float_exp_mask)
+		{
+			return input_float;
+		}
+		if(data < float_exp_mask)
+		{
+			// subnormal, times 2^48 (as data * 2^-101), which is far
+			// enough up that x - s * s in the Heron step isn't subnormal
+			// either
+			return ShredFloatSqrtNormal((float)data * 3.94430453e-31f,
+				accuracy) * 5.96046448e-08f;
+		}
+		return ShredDataToFloat(data | 0x7FC00000);
 	}
-	uint32_t float_exp = ShredFloatToData(input_float) & float_exp_mask;
-	uint32_t float_no_exp = ShredFloatToData(input_float) & ~float_exp_mask; 
-	return ShredDataToFloat
-		(((float_exp >> shift) & float_exp_mask) | float_no_exp);
+	return ShredFloatSqrtNormal(input_float, accuracy);
+}
+
+SHRED_NO_CONTRACT_END
+
+/*
+	Half precision (IEEE 754 binary16) and bfloat16.
+
+	C doesn't have a type for either of these, so they're passed around as
+	their raw 16 bits in a ShredHalf or ShredBFloat16. Both are laid out like
+	a float, just shorter:
+
+	half		1 sign bit | 5 exponent bits | 10 mantissa bits
+	bfloat16	1 sign bit | 8 exponent bits |  7 mantissa bits
+
+	bfloat16 is literally the top half of a float, which makes converting to
+	and from it mostly a shift.
+*/
+typedef uint16_t ShredHalf;
+typedef uint16_t ShredBFloat16;
+
+static const uint16_t half_exp_mask =			0x7C00;
+static const uint16_t half_sign_mask =			0x8000;
+static const uint16_t half_mantissa_mask =		0x03FF;
+static const int half_bit_width = 16;
+static const int half_exp_bits = 5;
+static const int half_mantissa_bits = 10;
+static const int half_exp_offset = 10;
+static const int half_sign_offset = 15;
+static const int half_exp_bias = 15;
+
+static const uint16_t bfloat16_exp_mask =		0x7F80;
+static const uint16_t bfloat16_sign_mask =		0x8000;
+static const uint16_t bfloat16_mantissa_mask =		0x007F;
+static const int bfloat16_bit_width = 16;
+static const int bfloat16_exp_bits = 8;
+static const int bfloat16_mantissa_bits = 7;
+static const int bfloat16_exp_offset = 7;
+static const int bfloat16_sign_offset = 15;
+static const int bfloat16_exp_bias = 127;
+
+// they're already their raw data, these are just here so the field family
+// has something to call
+static inline SHRED_CONSTEXPR uint16_t ShredHalfToData(ShredHalf input_half)
+{
+	return input_half;
+}
+
+static inline SHRED_CONSTEXPR ShredHalf ShredDataToHalf(uint16_t input_int)
+{
+	return input_int;
+}
+
+static inline SHRED_CONSTEXPR uint16_t ShredBFloat16ToData(
+	ShredBFloat16 input_bfloat16)
+{
+	return input_bfloat16;
+}
+
+static inline SHRED_CONSTEXPR ShredBFloat16 ShredDataToBFloat16(
+	uint16_t input_int)
+{
+	return input_int;
 }
 
-// TODO: test
-float ShredFloatShiftMantUp(float input_float, int shift)
+SHRED_DEFINE_FIELD_FAMILY(Half, ShredHalf, uint16_t, int16_t, half)
+SHRED_DEFINE_FIELD_FAMILY(BFloat16, ShredBFloat16, uint16_t, int16_t, bfloat16)
+
+/*
+	Converting to and from float.
+
+	Going to float is always exact (apart from signaling NaNs coming out
+	quiet). Coming from float rounds to nearest, ties to even, values too
+	big for the format become infinity and NaNs stay NaNs (quieted, keeping
+	as much of the payload as fits). These are done with integer operations
+	only, so they give the same answer whatever the FPU's denormal and
+	rounding modes are, and they match what the hardware conversion
+	instructions used by the batch versions produce.
+*/
+static inline SHRED_CONSTEXPR float ShredHalfToFloat(ShredHalf input_half)
 {
-	// this isn't enough to prevent overflows but it'll do for now
-	if(shift > 23)
+	uint32_t sign = (uint32_t)(input_half & half_sign_mask) << 16;
+	uint32_t exp = (input_half & half_exp_mask) >> half_exp_offset;
+	uint32_t mant = input_half & half_mantissa_mask;
+	if(exp == 0x1F)
+	{
+		// infinity, or a NaN which gets quieted like the hardware does
+		uint32_t quiet = mant ? 0x400000 : 0;
+		return ShredDataToFloat(sign | float_exp_mask | quiet | (mant << 13));
+	}
+	if(exp == 0)
 	{
-		shift -= (shift-23);
+		if(mant == 0)
+		{
+			return ShredDataToFloat(sign);
+		}
+		// subnormal, shift it up until it's a normal number
+		exp = 1;
+		while(!(mant & 0x400))
+		{
+			mant <<= 1;
+			exp--;
+		}
+		mant &= half_mantissa_mask;
 	}
-	uint32_t float_mant = ShredFloatToData(input_float) & float_mantissa_mask;
-	uint32_t float_no_mant = 
-		ShredFloatToData(input_float) & ~float_mantissa_mask;
+	exp += float_exp_bias - half_exp_bias;
+	return ShredDataToFloat(sign | (exp << float_exp_offset) | (mant << 13));
+}
 
-	return ShredDataToFloat
-		(((float_mant << shift) & float_mantissa_mask) | float_no_mant);
+static inline SHRED_CONSTEXPR ShredHalf ShredFloatToHalf(float input_float)
+{
+	uint32_t data = ShredFloatToData(input_float);
+	uint16_t sign = (uint16_t)((data & float_sign_mask) >> 16);
+	uint32_t abs = data & ~float_sign_mask;
+	// NaN, keep the top of the payload and make sure it stays quiet
+	if(abs > float_exp_mask)
+	{
+		return (ShredHalf)(sign | half_exp_mask | 0x200 |
+			((abs >> 13) & half_mantissa_mask));
+	}
+	// anything from 65520 up rounds to infinity
+	if(abs >= 0x477FF000)
+	{
+		return (ShredHalf)(sign | half_exp_mask);
+	}
+	// below 2^-14 the result is subnormal (or zero)
+	if(abs < 0x38800000)
+	{
+		uint32_t exp = abs >> float_exp_offset;
+		if(exp < 102)
+		{
+			return sign;
+		}
+		uint32_t mant = (abs & float_mantissa_mask) | 0x800000;
+		uint32_t shift = 126 - exp;
+		uint32_t result = mant >> shift;
+		uint32_t rest = mant & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if(rest > halfway || (rest == halfway && (result & 1)))
+		{
+			result++;
+		}
+		return (ShredHalf)(sign | result);
+	}
+	// normal, rebias the exponent and round off the bottom 13 bits
+	abs += ((uint32_t)(half_exp_bias - float_exp_bias) << float_exp_offset) +
+		0xFFF + ((abs >> 13) & 1);
+	return (ShredHalf)(sign | (abs >> 13));
+}
 
+static inline SHRED_CONSTEXPR float ShredBFloat16ToFloat(
+	ShredBFloat16 input_bfloat16)
+{
+	return ShredDataToFloat((uint32_t)input_bfloat16 << 16);
 }
 
-// TODO: test
-float ShredFloatShiftMantDown(float input_float, int shift)
+static inline SHRED_CONSTEXPR ShredBFloat16 ShredFloatToBFloat16(
+	float input_float)
 {
-	// this isn't enough to prevent overflows but it'll do for now
-	if(shift > 23)
+	uint32_t data = ShredFloatToData(input_float);
+	// NaN, rounding could carry it into infinity so just quiet it
+	if((data & ~float_sign_mask) > float_exp_mask)
 	{
-		shift -= (shift-23);
+		return (ShredBFloat16)((data >> 16) | 0x40);
 	}
-	uint32_t float_mant = ShredFloatToData(input_float) & float_mantissa_mask;
-	uint32_t float_no_mant = 
-		ShredFloatToData(input_float) & ~float_mantissa_mask;
+	data += 0x7FFF + ((data >> 16) & 1);
+	return (ShredBFloat16)(data >> 16);
+}
+
+// the significand as a float, 1.mantissa for normal numbers and
+// 0.mantissa for subnormals
+static inline SHRED_CONSTEXPR float ShredHalfMantissa(ShredHalf input_half)
+{
+	float frac = (float)ShredHalfMantissaRaw(input_half) / 1024.0f;
+	return ShredHalfExpUnbiased(input_half) > 0 ? frac + 1.0f : frac;
+}
+
+static inline SHRED_CONSTEXPR float ShredBFloat16Mantissa(
+	ShredBFloat16 input_bfloat16)
+{
+	float frac = (float)ShredBFloat16MantissaRaw(input_bfloat16) / 128.0f;
+	return ShredBFloat16ExpUnbiased(input_bfloat16) > 0 ? frac + 1.0f : frac;
+}
+
+/*
+	For C++ code that wants to be generic over the width, ShredTraits<T>
+	has the same constants as compile time values, plus the functions above
+	as static members, so ShredTraits<T>::Exp(x) works for either type.
+*/
+#ifdef __cplusplus
+extern "C++" {
+template <typename T> struct ShredTraits;
+
+#define SHRED_DEFINE_TRAITS(Name, real_t, bits_t, sbits_t, \
+	width, exp_b, mant_b, bias) \
+template <> struct ShredTraits<real_t> \
+{ \
+	typedef real_t real_type; \
+	typedef bits_t bits_type; \
+	typedef sbits_t signed_bits_type; \
+	static constexpr int bit_width = width; \
+	static constexpr int exp_bits = exp_b; \
+	static constexpr int mantissa_bits = mant_b; \
+	static constexpr int exp_offset = mant_b; \
+	static constexpr int sign_offset = width - 1; \
+	static constexpr int exp_bias = bias; \
+	static constexpr bits_type sign_mask = (bits_type)1 << (width - 1); \
+	static constexpr bits_type mantissa_mask = \
+		((bits_type)1 << mant_b) - 1; \
+	static constexpr bits_type exp_mask = \
+		~(sign_mask | mantissa_mask); \
+\
+	static SHRED_CONSTEXPR bits_type ToData(real_type x) \
+		{ return Shred##Name##ToData(x); } \
+	static SHRED_CONSTEXPR real_type FromData(bits_type x) \
+		{ return ShredDataTo##Name(x); } \
+	static SHRED_CONSTEXPR bits_type ExpUnbiased(real_type x) \
+		{ return Shred##Name##ExpUnbiased(x); } \
+	static SHRED_CONSTEXPR bits_type ExpUnbiasedRaw(real_type x) \
+		{ return Shred##Name##ExpUnbiasedRaw(x); } \
+	static SHRED_CONSTEXPR signed_bits_type Exp(real_type x) \
+		{ return Shred##Name##Exp(x); } \
+	static SHRED_CONSTEXPR signed_bits_type ExpRaw(real_type x) \
+		{ return Shred##Name##ExpRaw(x); } \
+	static SHRED_CONSTEXPR bits_type MantissaRaw(real_type x) \
+		{ return Shred##Name##MantissaRaw(x); } \
+	static SHRED_CONSTEXPR real_type Mantissa(real_type x) \
+		{ return Shred##Name##Mantissa(x); } \
+	static SHRED_CONSTEXPR bool IsNegative(real_type x) \
+		{ return Shred##Name##IsNegative(x); } \
+	static SHRED_CONSTEXPR real_type ShiftExpUp(real_type x, int shift) \
+		{ return Shred##Name##ShiftExpUp(x, shift); } \
+	static SHRED_CONSTEXPR real_type ShiftExpDown(real_type x, int shift) \
+		{ return Shred##Name##ShiftExpDown(x, shift); } \
+	static SHRED_CONSTEXPR real_type ShiftMantUp(real_type x, int shift) \
+		{ return Shred##Name##ShiftMantUp(x, shift); } \
+	static SHRED_CONSTEXPR real_type ShiftMantDown(real_type x, int shift) \
+		{ return Shred##Name##ShiftMantDown(x, shift); } \
+};
 
-	return ShredDataToFloat
-		(((float_mant >> shift) & float_mantissa_mask) | float_no_mant);
+SHRED_DEFINE_TRAITS(Float, float, uint32_t, int32_t, 32, 8, 23, 127)
+SHRED_DEFINE_TRAITS(Double, double, uint64_t, int64_t, 64, 11, 52, 1023)
+#undef SHRED_DEFINE_TRAITS
+}
+#endif
+
+/*
+	Batch versions of the accessors above.
+
+	Each ShredFloat*Array function does exactly what its scalar counterpart
+	does, once for every element of `in`, and writes the results to `out`.
+	They're meant for when you've got millions of floats to get through and
+	calling the scalar functions in a loop is the bottleneck.
+
+	The work is done by SIMD kernels that do the same mask-and-shift on a
+	whole register of floats at a time. The kernels themselves live in
+	float_shredder_kernels.h, which gets included once per instruction set
+	below with a different set of vector primitives each time, and the best
+	one the CPU supports gets picked at runtime (see "Runtime dispatch").
+
+	Defining SHRED_NO_SIMD before including this header turns all of this
+	off and leaves you with the plain loops.
+*/
+
+/*
+	The scalar kernels. These are just loops over the functions above, and
+	they're what everything falls back to when there's no SIMD available.
+	Like the functions themselves they're stamped out once per type.
+*/
+#define SHRED_DEFINE_ARRAY_LOOP(func, in_t, out_t) \
+static inline void func##Array_scalar(const in_t* in, out_t* out, size_t n) \
+{ \
+	for(size_t i = 0; i < n; i++) \
+	{ \
+		out[i] = func(in[i]); \
+	} \
+}
+
+#define SHRED_DEFINE_SHIFT_LOOP(func, real_t) \
+static inline void func##Array_scalar(const real_t* in, real_t* out, \
+	size_t n, int shift) \
+{ \
+	for(size_t i = 0; i < n; i++) \
+	{ \
+		out[i] = func(in[i], shift); \
+	} \
+}
+
+/*
+	The two other ways of getting classes out in bulk. ClassifyMasks writes
+	a bitmask per class, packed the same way as the sign plane below (float
+	i is bit i % 8 of byte i / 8), to each of the SHRED_CLASS_COUNT pointers
+	in `masks` that isn't NULL. ClassCount doesn't write anything per float,
+	it just counts how many floats fall in each class.
+*/
+#define SHRED_DEFINE_CLASS_LOOPS(Name, real_t) \
+static inline void Shred##Name##ClassifyMasks_scalar(const real_t* in, \
+	size_t n, uint8_t* const* masks) \
+{ \
+	for(size_t i = 0; i < n; i += 8) \
+	{ \
+		size_t end = n - i < 8 ? n : i + 8; \
+		uint8_t bytes[SHRED_CLASS_COUNT] = {0}; \
+		for(size_t j = i; j < end; j++) \
+		{ \
+			bytes[Shred##Name##Classify(in[j])] |= (uint8_t)(1 << (j - i)); \
+		} \
+		for(int k = 0; k < SHRED_CLASS_COUNT; k++) \
+		{ \
+			if(masks[k]) \
+			{ \
+				masks[k][i / 8] = bytes[k]; \
+			} \
+		} \
+	} \
+} \
+\
+static inline void Shred##Name##ClassCount_scalar(const real_t* in, \
+	size_t n, size_t* counts) \
+{ \
+	for(int k = 0; k < SHRED_CLASS_COUNT; k++) \
+	{ \
+		counts[k] = 0; \
+	} \
+	for(size_t i = 0; i < n; i++) \
+	{ \
+		counts[Shred##Name##Classify(in[i])]++; \
+	} \
+}
+
+#define SHRED_DEFINE_ARRAY_LOOPS(Name, real_t, bits_t, sbits_t) \
+	SHRED_DEFINE_ARRAY_LOOP(Shred##Name##ExpUnbiased, real_t, bits_t) \
+	SHRED_DEFINE_ARRAY_LOOP(Shred##Name##ExpUnbiasedRaw, real_t, bits_t) \
+	SHRED_DEFINE_ARRAY_LOOP(Shred##Name##Exp, real_t, sbits_t) \
+	SHRED_DEFINE_ARRAY_LOOP(Shred##Name##ExpRaw, real_t, sbits_t) \
+	SHRED_DEFINE_ARRAY_LOOP(Shred##Name##MantissaRaw, real_t, bits_t) \
+	SHRED_DEFINE_ARRAY_LOOP(Shred##Name##Mantissa, real_t, real_t) \
+	SHRED_DEFINE_ARRAY_LOOP(Shred##Name##IsNegative, real_t, bool) \
+	SHRED_DEFINE_SHIFT_LOOP(Shred##Name##ShiftExpUp, real_t) \
+	SHRED_DEFINE_SHIFT_LOOP(Shred##Name##ShiftExpDown, real_t) \
+	SHRED_DEFINE_SHIFT_LOOP(Shred##Name##ShiftMantUp, real_t) \
+	SHRED_DEFINE_SHIFT_LOOP(Shred##Name##ShiftMantDown, real_t) \
+	SHRED_DEFINE_SHIFT_LOOP(Shred##Name##ScalePow2, real_t) \
+	SHRED_DEFINE_ARRAY_LOOP(Shred##Name##Classify, real_t, uint8_t) \
+	SHRED_DEFINE_ARRAY_LOOP(Shred##Name##ByteSwap, real_t, real_t) \
+	SHRED_DEFINE_CLASS_LOOPS(Name, real_t)
+
+SHRED_DEFINE_ARRAY_LOOPS(Float, float, uint32_t, int32_t)
+SHRED_DEFINE_ARRAY_LOOPS(Double, double, uint64_t, int64_t)
+SHRED_DEFINE_ARRAY_LOOP(ShredFloatToHalf, float, ShredHalf)
+SHRED_DEFINE_ARRAY_LOOP(ShredHalfToFloat, ShredHalf, float)
+SHRED_DEFINE_ARRAY_LOOP(ShredFloatToBFloat16, float, ShredBFloat16)
+SHRED_DEFINE_ARRAY_LOOP(ShredBFloat16ToFloat, ShredBFloat16, float)
+
+/*
+	Comparing whole arrays a ULP at a time. UlpDistanceArray writes
+	UlpDistance(a[i], b[i]) to out[i] (if out isn't NULL) and fills in a
+	ShredUlpStats (if stats isn't NULL) in the same pass. Pairs where only
+	one side is NaN are counted in nan_mismatches and left out of everything
+	else, so one stray NaN doesn't swamp the max and the mean.
+*/
+typedef struct ShredUlpStats
+{
+	uint64_t max;
+	double mean;
+	// how many pairs max and mean are over
+	size_t count;
+	size_t nan_mismatches;
+} ShredUlpStats;
 
+static inline void ShredUlpStatsFinish(ShredUlpStats* stats, size_t n,
+	uint64_t max, double sum, size_t nan_mismatches)
+{
+	if(stats)
+	{
+		stats->max = max;
+		stats->count = n - nan_mismatches;
+		stats->mean = stats->count ? sum / (double)stats->count : 0.0;
+		stats->nan_mismatches = nan_mismatches;
+	}
+}
+
+#define SHRED_DEFINE_ULP_LOOPS(Name, real_t, bits_t, sbits_t) \
+static inline void Shred##Name##UlpDistanceAdd(const real_t* a, \
+	const real_t* b, bits_t* out, size_t n, uint64_t* max, double* sum, \
+	size_t* nan_mismatches) \
+{ \
+	for(size_t i = 0; i < n; i++) \
+	{ \
+		bits_t distance = Shred##Name##UlpDistance(a[i], b[i]); \
+		if(out) \
+		{ \
+			out[i] = distance; \
+		} \
+		if(distance == ~(bits_t)0) \
+		{ \
+			(*nan_mismatches)++; \
+			continue; \
+		} \
+		*max = distance > *max ? distance : *max; \
+		*sum += (double)distance; \
+	} \
+} \
+\
+static inline void Shred##Name##UlpDistanceArray_scalar(const real_t* a, \
+	const real_t* b, bits_t* out, size_t n, ShredUlpStats* stats) \
+{ \
+	uint64_t max = 0; \
+	double sum = 0.0; \
+	size_t nan_mismatches = 0; \
+	Shred##Name##UlpDistanceAdd(a, b, out, n, &max, &sum, &nan_mismatches); \
+	ShredUlpStatsFinish(stats, n, max, sum, nan_mismatches); \
+} \
+\
+static inline void Shred##Name##StepUlpsArray_scalar(const real_t* in, \
+	real_t* out, size_t n, sbits_t steps) \
+{ \
+	for(size_t i = 0; i < n; i++) \
+	{ \
+		out[i] = Shred##Name##StepUlps(in[i], steps); \
+	} \
 }
 
+SHRED_DEFINE_ULP_LOOPS(Float, float, uint32_t, int32_t)
+SHRED_DEFINE_ULP_LOOPS(Double, double, uint64_t, int64_t)
+
+/*
+	The ordered keys in bulk. endian is the byte order the keys are written
+	in, or read in for FromOrderedKeyArray, so SHRED_ENDIAN_BIG gives keys
+	that are ready to memcmp. The swap happens in the same pass.
+*/
+#define SHRED_DEFINE_ORDERED_KEY_LOOP(Name, func, real_t, bits_t, width) \
+static inline void Shred##Name##func##Array_scalar(const real_t* in, \
+	bits_t* out, size_t n, ShredEndian endian) \
+{ \
+	bool swap = !ShredEndianIsNative(endian); \
+	for(size_t i = 0; i < n; i++) \
+	{ \
+		bits_t key = Shred##Name##func(in[i]); \
+		out[i] = swap ? ShredByteSwap##width(key) : key; \
+	} \
+}
+
+#define SHRED_DEFINE_ORDERED_KEY_LOOPS(Name, real_t, bits_t, width) \
+	SHRED_DEFINE_ORDERED_KEY_LOOP(Name, ToOrderedKey, real_t, bits_t, width) \
+	SHRED_DEFINE_ORDERED_KEY_LOOP(Name, ToCanonicalKey, real_t, bits_t, \
+		width) \
+\
+static inline void Shred##Name##FromOrderedKeyArray_scalar(const bits_t* in, \
+	real_t* out, size_t n, ShredEndian endian) \
+{ \
+	bool swap = !ShredEndianIsNative(endian); \
+	for(size_t i = 0; i < n; i++) \
+	{ \
+		out[i] = Shred##Name##FromOrderedKey(swap ? \
+			ShredByteSwap##width(in[i]) : in[i]); \
+	} \
+}
+
+SHRED_DEFINE_ORDERED_KEY_LOOPS(Float, float, uint32_t, 32)
+SHRED_DEFINE_ORDERED_KEY_LOOPS(Double, double, uint64_t, 64)
+
+/*
+	TruncateMantissaArray runs TruncateMantissa over a whole array and, if
+	stats isn't NULL, works out how much precision that cost in the same
+	pass: the largest |out[i] - in[i]| and the largest |out[i] - in[i]| /
+	|in[i]|. Infs and NaNs are left out of both, zeros out of the relative
+	one. A finite value that rounded up to infinity makes both infinite.
+	in and out can be the same array.
+*/
+typedef struct ShredTruncateStats
+{
+	double max_abs;
+	double max_rel;
+} ShredTruncateStats;
+
+#define SHRED_DEFINE_TRUNCATE_LOOPS(Name, real_t, bits_t, prefix) \
+static inline void Shred##Name##TruncateMantissaAdd(const real_t* in, \
+	real_t* out, size_t n, int bits, real_t* max_abs, real_t* max_rel) \
+{ \
+	for(size_t i = 0; i < n; i++) \
+	{ \
+		bits_t data = Shred##Name##ToData(in[i]); \
+		real_t rounded = Shred##Name##TruncateMantissa(in[i], bits); \
+		out[i] = rounded; \
+		if((data & prefix##_exp_mask) == prefix##_exp_mask) \
+		{ \
+			continue; \
+		} \
+		/* \
+			Rounding never changes the sign, so this works on magnitudes, \
+			which keeps the signs of the data out of the branches. The two \
+			are within a factor of two of each other, so it's exact. \
+		*/ \
+		real_t size = ShredDataTo##Name(data & ~prefix##_sign_mask); \
+		real_t up = ShredDataTo##Name(Shred##Name##ToData(rounded) & \
+			~prefix##_sign_mask) - size; \
+		real_t error = up > -up ? up : -up; \
+		*max_abs = error > *max_abs ? error : *max_abs; \
+		if(size > 0 && error / size > *max_rel) \
+		{ \
+			*max_rel = error / size; \
+		} \
+	} \
+} \
+\
+static inline void Shred##Name##TruncateMantissaArray_scalar( \
+	const real_t* in, real_t* out, size_t n, int bits, \
+	ShredTruncateStats* stats) \
+{ \
+	if(!stats) \
+	{ \
+		for(size_t i = 0; i < n; i++) \
+		{ \
+			out[i] = Shred##Name##TruncateMantissa(in[i], bits); \
+		} \
+		return; \
+	} \
+	real_t max_abs = 0; \
+	real_t max_rel = 0; \
+	Shred##Name##TruncateMantissaAdd(in, out, n, bits, &max_abs, &max_rel); \
+	stats->max_abs = (double)max_abs; \
+	stats->max_rel = (double)max_rel; \
+}
+
+SHRED_DEFINE_TRUNCATE_LOOPS(Float, float, uint32_t, float)
+SHRED_DEFINE_TRUNCATE_LOOPS(Double, double, uint64_t, double)
+
+#define SHRED_DEFINE_APPROX_LOOP(func) \
+static inline void func##Array_scalar(const float* in, float* out, \
+	size_t n, ShredApprox accuracy) \
+{ \
+	for(size_t i = 0; i < n; i++) \
+	{ \
+		out[i] = func(in[i], accuracy); \
+	} \
+}
+
+SHRED_NO_CONTRACT_BEGIN
+SHRED_DEFINE_APPROX_LOOP(ShredFloatLog2Approx)
+SHRED_DEFINE_APPROX_LOOP(ShredFloatExp2Approx)
+SHRED_DEFINE_APPROX_LOOP(ShredFloatSqrtApprox)
+SHRED_DEFINE_APPROX_LOOP(ShredFloatRsqrtApprox)
+SHRED_NO_CONTRACT_END
+
+/*
+	Everything you'd usually want to know about a buffer before doing
+	anything with it, in one pass: ShredFloatSummarize(in, n, &summary)
+	fills in a ShredFloatSummary.
+
+	min and max ignore NaNs and put -0 below +0, and they're both NaN if
+	there's nothing but NaNs. sum is over the finite floats only, so one
+	inf doesn't wipe it out (infs has how many there were), and it's added
+	up in double with Neumaier's version of Kahan summation, which keeps the
+	bits every add rounds off and adds them back at the end. negatives is
+	the floats ShredFloatIsNegative would say yes to, so it includes -0 and
+	NaNs with the sign bit set. exp_min and exp_max are the range of
+	ShredFloatExp over the finite floats, -127 for zeros and subnormals,
+	and exp_min ends up above exp_max when there aren't any.
+
+	The SIMD kernels keep a sum per lane in pairs of floats, the rounded
+	sum and the exact error of each add, and fold them into the double sum
+	every few dozen vectors. That's good to about 1e-11 of the sum of the
+	magnitudes, where the scalar version does all of it in double, so sums
+	can differ between instruction sets in their low bits. Everything else
+	comes out exactly the same.
+
+	ShredFloatSummaryMerge combines the summaries of two buffers into the
+	summary of both, which is how the threaded version puts its chunks
+	together. ShredFloatSummaryClear sets one up as the summary of nothing,
+	to merge into.
+*/
+static inline void ShredKahanAdd(double* sum, double* comp, double x)
+{
+	double t = *sum + x;
+	// whichever of the two is smaller is the one that lost bits
+	*comp += fabs(*sum) >= fabs(x) ? (*sum - t) + x : (x - t) + *sum;
+	*sum = t;
+}
+
+#define SHRED_DEFINE_SUMMARY(Name, real_t, bits_t, sbits_t, prefix) \
+typedef struct Shred##Name##Summary \
+{ \
+	real_t min; \
+	real_t max; \
+	double sum; \
+	size_t count; \
+	size_t nans; \
+	size_t infs; \
+	size_t negatives; \
+	size_t negative_zeros; \
+	sbits_t exp_min; \
+	sbits_t exp_max; \
+} Shred##Name##Summary; \
+\
+/* \
+	The running totals, with min and max as signed keys that compare the \
+	same way the floats do (the negatives have their magnitude flipped), \
+	and the exponents still biased. \
+*/ \
+typedef struct Shred##Name##SummaryAcc \
+{ \
+	sbits_t key_min; \
+	sbits_t key_max; \
+	double sum; \
+	double comp; \
+	size_t count; \
+	size_t nans; \
+	size_t infs; \
+	size_t negatives; \
+	size_t negative_zeros; \
+	bits_t exp_min; \
+	bits_t exp_max; \
+} Shred##Name##SummaryAcc; \
+\
+static inline SHRED_CONSTEXPR sbits_t Shred##Name##SummaryKey(bits_t data) \
+{ \
+	bits_t neg = (bits_t)0 - (data >> prefix##_sign_offset); \
+	return (sbits_t)((data & ~prefix##_sign_mask) ^ neg); \
+} \
+\
+static inline SHRED_CONSTEXPR real_t Shred##Name##SummaryUnkey(sbits_t key) \
+{ \
+	bits_t neg = key < 0 ? ~(bits_t)0 : 0; \
+	return ShredDataTo##Name(((bits_t)key ^ neg) | \
+		(neg & prefix##_sign_mask)); \
+} \
+\
+static inline void Shred##Name##SummaryStart(Shred##Name##SummaryAcc* acc) \
+{ \
+	memset(acc, 0, sizeof(*acc)); \
+	acc->key_min = (sbits_t)(~(bits_t)0 >> 1); \
+	acc->key_max = -acc->key_min - 1; \
+	acc->exp_min = prefix##_exp_mask >> prefix##_exp_offset; \
+} \
+\
+static inline void Shred##Name##SummaryAdd(Shred##Name##SummaryAcc* acc, \
+	const real_t* in, size_t n) \
+{ \
+	acc->count += n; \
+	for(size_t i = 0; i < n; i++) \
+	{ \
+		bits_t data = Shred##Name##ToData(in[i]); \
+		bits_t abs = data & ~prefix##_sign_mask; \
+		acc->negatives += data >> prefix##_sign_offset; \
+		acc->negative_zeros += data == prefix##_sign_mask; \
+		if(abs > prefix##_exp_mask) \
+		{ \
+			acc->nans++; \
+			continue; \
+		} \
+		sbits_t key = Shred##Name##SummaryKey(data); \
+		acc->key_min = key < acc->key_min ? key : acc->key_min; \
+		acc->key_max = key > acc->key_max ? key : acc->key_max; \
+		if(abs == prefix##_exp_mask) \
+		{ \
+			acc->infs++; \
+			continue; \
+		} \
+		bits_t exp = abs >> prefix##_exp_offset; \
+		acc->exp_min = exp < acc->exp_min ? exp : acc->exp_min; \
+		acc->exp_max = exp > acc->exp_max ? exp : acc->exp_max; \
+		ShredKahanAdd(&acc->sum, &acc->comp, (double)in[i]); \
+	} \
+} \
+\
+static inline void Shred##Name##SummaryFinish( \
+	const Shred##Name##SummaryAcc* acc, Shred##Name##Summary* summary) \
+{ \
+	if(acc->key_min > acc->key_max) \
+	{ \
+		summary->min = summary->max = ShredDataTo##Name(prefix##_exp_mask | \
+			((bits_t)1 << (prefix##_mantissa_bits - 1))); \
+	} else { \
+		summary->min = Shred##Name##SummaryUnkey(acc->key_min); \
+		summary->max = Shred##Name##SummaryUnkey(acc->key_max); \
+	} \
+	/* past the biggest double the compensation is just NaN */ \
+	summary->sum = isinf(acc->sum) ? acc->sum : acc->sum + acc->comp; \
+	summary->count = acc->count; \
+	summary->nans = acc->nans; \
+	summary->infs = acc->infs; \
+	summary->negatives = acc->negatives; \
+	summary->negative_zeros = acc->negative_zeros; \
+	summary->exp_min = (sbits_t)acc->exp_min - prefix##_exp_bias; \
+	summary->exp_max = (sbits_t)acc->exp_max - prefix##_exp_bias; \
+} \
+\
+static inline void Shred##Name##Summarize_scalar(const real_t* in, size_t n, \
+	Shred##Name##Summary* summary) \
+{ \
+	Shred##Name##SummaryAcc acc; \
+	Shred##Name##SummaryStart(&acc); \
+	Shred##Name##SummaryAdd(&acc, in, n); \
+	Shred##Name##SummaryFinish(&acc, summary); \
+} \
+\
+static inline void Shred##Name##SummaryClear(Shred##Name##Summary* summary) \
+{ \
+	Shred##Name##SummaryAcc acc; \
+	Shred##Name##SummaryStart(&acc); \
+	Shred##Name##SummaryFinish(&acc, summary); \
+} \
+\
+static inline void Shred##Name##SummaryMerge(Shred##Name##Summary* dst, \
+	const Shred##Name##Summary* src) \
+{ \
+	/* a NaN min means there's no min, and then there's no max either */ \
+	if(Shred##Name##Classify(src->min) != SHRED_CLASS_NAN) \
+	{ \
+		sbits_t src_min = Shred##Name##SummaryKey( \
+			Shred##Name##ToData(src->min)); \
+		sbits_t src_max = Shred##Name##SummaryKey( \
+			Shred##Name##ToData(src->max)); \
+		sbits_t dst_min = Shred##Name##SummaryKey( \
+			Shred##Name##ToData(dst->min)); \
+		sbits_t dst_max = Shred##Name##SummaryKey( \
+			Shred##Name##ToData(dst->max)); \
+		bool empty = Shred##Name##Classify(dst->min) == SHRED_CLASS_NAN; \
+		if(empty || src_min < dst_min) \
+		{ \
+			dst->min = src->min; \
+		} \
+		if(empty || src_max > dst_max) \
+		{ \
+			dst->max = src->max; \
+		} \
+	} \
+	dst->sum += src->sum; \
+	dst->count += src->count; \
+	dst->nans += src->nans; \
+	dst->infs += src->infs; \
+	dst->negatives += src->negatives; \
+	dst->negative_zeros += src->negative_zeros; \
+	dst->exp_min = src->exp_min < dst->exp_min ? src->exp_min : dst->exp_min; \
+	dst->exp_max = src->exp_max > dst->exp_max ? src->exp_max : dst->exp_max; \
+}
+
+SHRED_DEFINE_SUMMARY(Float, float, uint32_t, int32_t, float)
+SHRED_DEFINE_SUMMARY(Double, double, uint64_t, int64_t, double)
+
+// how many bytes a plane of n packed bits takes
+static inline size_t ShredSignPlaneSize(size_t n)
+{
+	return (n + 7) / 8;
+}
+
+/*
+	Splits floats into three separate planes: the sign bits packed eight to
+	a byte (float i is bit i % 8 of byte i / 8), the biased exponents one
+	byte each, and the raw mantissa bits. ShredFloatJoinPlanes puts them
+	back together.
+*/
+static inline void ShredFloatSplitPlanes_scalar(const float* in, size_t n,
+	uint8_t* signs, uint8_t* exponents, uint32_t* mantissas)
+{
+	for(size_t i = 0; i < n; i += 8)
+	{
+		size_t end = n - i < 8 ? n : i + 8;
+		uint8_t sign_byte = 0;
+		for(size_t j = i; j < end; j++)
+		{
+			uint32_t data = ShredFloatToData(in[j]);
+			sign_byte |= (uint8_t)(((data & float_sign_mask) >>
+				float_sign_offset) << (j - i));
+			exponents[j] = (uint8_t)((data & float_exp_mask) >>
+				float_exp_offset);
+			mantissas[j] = data & float_mantissa_mask;
+		}
+		signs[i / 8] = sign_byte;
+	}
+}
+
+static inline void ShredFloatJoinPlanes_scalar(const uint8_t* signs,
+	const uint8_t* exponents, const uint32_t* mantissas, size_t n,
+	float* out)
+{
+	for(size_t i = 0; i < n; i++)
+	{
+		uint32_t sign = (uint32_t)((signs[i / 8] >> (i % 8)) & 1);
+		out[i] = ShredDataToFloat((sign << float_sign_offset) |
+			((uint32_t)exponents[i] << float_exp_offset) |
+			(mantissas[i] & float_mantissa_mask));
+	}
+}
+
+/*
+	Shuffles for handing floats to a general purpose compressor (zstd, lz4
+	and so on), the same idea as Blosc's shuffle and bitshuffle filters.
+	The bytes that change slowly end up next to each other instead of
+	interleaved with the noisy bottom of the mantissa, which usually
+	compresses a lot better.
+
+	ByteShuffle writes as many planes of n bytes as the type has bytes, one
+	after the other in `out`. Plane k holds byte k of every float counting
+	from the most significant, so plane 0 is the sign and the top of the
+	exponent, and the mantissa bytes come after it.
+
+	BitShuffle does the same one bit at a time: plane b holds bit
+	(bit_width - 1 - b) of every float, packed eight to a byte like the sign
+	plane (float i is bit i % 8 of byte i / 8), and every plane is
+	ShredSignPlaneSize(n) bytes. Plane 0 is the sign plane, the exponent
+	bits come next and the mantissa bits last.
+
+	The _tail versions only do floats [first, n) of the whole array, for the
+	kernels to finish off with. For the bit planes `first` has to be a
+	multiple of 8.
+*/
+#define SHRED_DEFINE_SHUFFLE_LOOPS(Name, real_t, bits_t, prefix) \
+static inline void Shred##Name##ByteShuffle_tail(const real_t* in, \
+	size_t first, size_t n, uint8_t* out) \
+{ \
+	for(size_t i = first; i < n; i++) \
+	{ \
+		bits_t data = Shred##Name##ToData(in[i]); \
+		for(int k = 0; k < prefix##_bit_width / 8; k++) \
+		{ \
+			out[k * n + i] = (uint8_t)(data >> \
+				(prefix##_bit_width - 8 - 8 * k)); \
+		} \
+	} \
+} \
+\
+static inline void Shred##Name##ByteUnshuffle_tail(const uint8_t* in, \
+	size_t first, size_t n, real_t* out) \
+{ \
+	for(size_t i = first; i < n; i++) \
+	{ \
+		bits_t data = 0; \
+		for(int k = 0; k < prefix##_bit_width / 8; k++) \
+		{ \
+			data |= (bits_t)in[k * n + i] << \
+				(prefix##_bit_width - 8 - 8 * k); \
+		} \
+		out[i] = ShredDataTo##Name(data); \
+	} \
+} \
+\
+static inline void Shred##Name##BitShuffle_tail(const real_t* in, \
+	size_t first, size_t n, uint8_t* out) \
+{ \
+	size_t plane = ShredSignPlaneSize(n); \
+	for(size_t i = first; i < n; i += 8) \
+	{ \
+		size_t end = n - i < 8 ? n : i + 8; \
+		uint8_t bytes[64] = {0}; \
+		for(size_t j = i; j < end; j++) \
+		{ \
+			bits_t data = Shred##Name##ToData(in[j]); \
+			for(int b = 0; b < prefix##_bit_width; b++) \
+			{ \
+				bytes[b] |= (uint8_t)(((data >> \
+					(prefix##_bit_width - 1 - b)) & 1) << (j - i)); \
+			} \
+		} \
+		for(int b = 0; b < prefix##_bit_width; b++) \
+		{ \
+			out[b * plane + i / 8] = bytes[b]; \
+		} \
+	} \
+} \
+\
+static inline void Shred##Name##BitUnshuffle_tail(const uint8_t* in, \
+	size_t first, size_t n, real_t* out) \
+{ \
+	size_t plane = ShredSignPlaneSize(n); \
+	for(size_t i = first; i < n; i++) \
+	{ \
+		bits_t data = 0; \
+		for(int b = 0; b < prefix##_bit_width; b++) \
+		{ \
+			data |= (bits_t)((in[b * plane + i / 8] >> (i % 8)) & 1) << \
+				(prefix##_bit_width - 1 - b); \
+		} \
+		out[i] = ShredDataTo##Name(data); \
+	} \
+} \
+\
+static inline void Shred##Name##ByteShuffle_scalar(const real_t* in, \
+	size_t n, uint8_t* out) \
+{ \
+	Shred##Name##ByteShuffle_tail(in, 0, n, out); \
+} \
+\
+static inline void Shred##Name##ByteUnshuffle_scalar(const uint8_t* in, \
+	size_t n, real_t* out) \
+{ \
+	Shred##Name##ByteUnshuffle_tail(in, 0, n, out); \
+} \
+\
+static inline void Shred##Name##BitShuffle_scalar(const real_t* in, \
+	size_t n, uint8_t* out) \
+{ \
+	Shred##Name##BitShuffle_tail(in, 0, n, out); \
+} \
+\
+static inline void Shred##Name##BitUnshuffle_scalar(const uint8_t* in, \
+	size_t n, real_t* out) \
+{ \
+	Shred##Name##BitUnshuffle_tail(in, 0, n, out); \
+}
+
+SHRED_DEFINE_SHUFFLE_LOOPS(Float, float, uint32_t, float)
+SHRED_DEFINE_SHUFFLE_LOOPS(Double, double, uint64_t, double)
+
+/*
+	Block floating point (the public versions are further down, with the
+	other batch functions).
+
+	The floats get split into blocks of block_size, and every block is
+	stored as one shared exponent byte plus a `bits`-bit signed integer per
+	float:
+
+	exps[b]		the biased exponent (ShredFloatExpUnbiased) of the
+			largest magnitude in block b, but at least bits - 1
+	out[i]		in[i] * 2^(bits - 2 + 127 - exps[b]), rounded to nearest
+			even. The largest magnitude comes out somewhere in
+			[2^(bits - 2), 2^(bits - 1)), so it uses all of the bits,
+			and one that rounds up past the top gets clamped to
+			2^(bits - 1) - 1 (or its negative).
+
+	Decoding is out[i] * 2^(exps[b] - 127 - (bits - 2)). Both scalings are
+	by a power of two, so they're exact, and all the error is in the
+	rounding: at most half a step, 2^(exps[b] - 127 - (bits - 1)).
+
+	With bits = 8 and blocks of 32 this is the OCP Microscaling spec's
+	MXINT8, the exponent byte being its E8M0 scale and the int8s its
+	elements with 6 fraction bits. The one difference is that MX lets the
+	scale go down to 2^-127 where this stops at bits - 1, which only
+	matters for blocks where everything is below about 2^-120. Like MX, a
+	block with an infinity or NaN in it gets exponent SHRED_BLOCK_NAN and
+	decodes as all NaN.
+
+	bits is 3 to 8 for the Int8 versions and 3 to 16 for the Int16 ones,
+	and block_size 0 means SHRED_BLOCK_DEFAULT. exps needs
+	ShredBlockCount(n, block_size) bytes. The last block can be shorter.
+*/
+#define SHRED_BLOCK_NAN 255
+#define SHRED_BLOCK_DEFAULT 32
+// 1.5 * 2^23: adding it rounds anything under 2^22 to an integer, which
+// is then sitting in the low bits of the result
+#define SHRED_BLOCK_ROUND 0x4B400000
+
+static inline size_t ShredBlockCount(size_t n, size_t block_size)
+{
+	if(block_size == 0)
+	{
+		block_size = SHRED_BLOCK_DEFAULT;
+	}
+	return (n + block_size - 1) / block_size;
+}
+
+// the shared exponent of a block whose biggest magnitude has raw data top
+static inline SHRED_HOST_DEVICE uint32_t ShredBlockExp(uint32_t top, int bits)
+{
+	uint32_t exp = top >> float_exp_offset;
+	uint32_t least = (uint32_t)bits - 1;
+	return exp > least ? exp : least;
+}
+
+// 2^(bits - 2 + 127 - exp), for every exp but SHRED_BLOCK_NAN
+static inline SHRED_HOST_DEVICE float ShredBlockScale(uint32_t exp, int bits)
+{
+	return ShredDataToFloat(((uint32_t)bits - 2 + 2 * float_exp_bias - exp) <<
+		float_exp_offset);
+}
+
+// 2^(exp - 127 - (bits - 2)), for every exp but SHRED_BLOCK_NAN
+static inline SHRED_HOST_DEVICE float ShredBlockStep(uint32_t exp, int bits)
+{
+	uint32_t least = (uint32_t)bits - 1;
+	exp = exp > least ? exp : least;
+	return ShredDataToFloat((exp - ((uint32_t)bits - 2)) << float_exp_offset);
+}
+
+/*
+	Raw magnitudes below this come out as 0 anyway, 2^(exp - 127 - bits).
+	They get zeroed before the multiply, since scaling them could make a
+	subnormal, and x86 takes a slow microcode path for every one of those.
+*/
+static inline SHRED_HOST_DEVICE uint32_t ShredBlockFloor(uint32_t exp, int bits)
+{
+	return exp > (uint32_t)bits ? (exp - (uint32_t)bits) << float_exp_offset :
+		0;
+}
+
+/*
+	most is 2^(bits - 1) - 1, which the result gets clamped to either way.
+	Leaving out -2^(bits - 1) keeps the range symmetric, and it could turn
+	into an infinity in the top binade.
+*/
+static inline SHRED_HOST_DEVICE int32_t ShredBlockQuantize(float x,
+	float scale, uint32_t floor, int32_t most)
+{
+	if((ShredFloatToData(x) & ~float_sign_mask) < floor)
+	{
+		return 0;
+	}
+	int32_t q = (int32_t)(ShredFloatToData(x * scale +
+		ShredDataToFloat(SHRED_BLOCK_ROUND)) - SHRED_BLOCK_ROUND);
+	q = q > most ? most : q;
+	return q < -most ? -most : q;
+}
+
+#define SHRED_DEFINE_BLOCK_LOOPS(Width, int_t) \
+static inline uint8_t ShredFloatToBlockInt##Width##_block(const float* in, \
+	size_t len, int bits, int_t* out) \
+{ \
+	uint32_t top = 0; \
+	for(size_t i = 0; i < len; i++) \
+	{ \
+		uint32_t data = ShredFloatToData(in[i]) & ~float_sign_mask; \
+		top = data > top ? data : top; \
+	} \
+	uint32_t exp = ShredBlockExp(top, bits); \
+	if(exp == SHRED_BLOCK_NAN) \
+	{ \
+		memset(out, 0, len * sizeof(int_t)); \
+		return SHRED_BLOCK_NAN; \
+	} \
+	float scale = ShredBlockScale(exp, bits); \
+	uint32_t floor = ShredBlockFloor(exp, bits); \
+	int32_t most = ((int32_t)1 << (bits - 1)) - 1; \
+	for(size_t i = 0; i < len; i++) \
+	{ \
+		out[i] = (int_t)ShredBlockQuantize(in[i], scale, floor, most); \
+	} \
+	return (uint8_t)exp; \
+} \
+\
+static inline void ShredBlockInt##Width##ToFloat_block(uint8_t exp, \
+	const int_t* in, size_t len, int bits, float* out) \
+{ \
+	if(exp == SHRED_BLOCK_NAN) \
+	{ \
+		for(size_t i = 0; i < len; i++) \
+		{ \
+			out[i] = ShredDataToFloat(float_exp_mask | (float_exp_mask >> 1)); \
+		} \
+		return; \
+	} \
+	float step = ShredBlockStep(exp, bits); \
+	for(size_t i = 0; i < len; i++) \
+	{ \
+		out[i] = (float)in[i] * step; \
+	} \
+} \
+\
+static inline void ShredFloatToBlockInt##Width##_scalar(const float* in, \
+	size_t n, size_t block_size, int bits, uint8_t* exps, int_t* out) \
+{ \
+	for(size_t first = 0; first < n; first += block_size) \
+	{ \
+		size_t len = n - first < block_size ? n - first : block_size; \
+		*exps++ = ShredFloatToBlockInt##Width##_block(in + first, len, bits, \
+			out + first); \
+	} \
+} \
+\
+static inline void ShredBlockInt##Width##ToFloat_scalar(const uint8_t* exps, \
+	const int_t* in, size_t n, size_t block_size, int bits, float* out) \
+{ \
+	for(size_t first = 0; first < n; first += block_size) \
+	{ \
+		size_t len = n - first < block_size ? n - first : block_size; \
+		ShredBlockInt##Width##ToFloat_block(*exps++, in + first, len, bits, \
+			out + first); \
+	} \
+}
+
+SHRED_DEFINE_BLOCK_LOOPS(8, int8_t)
+SHRED_DEFINE_BLOCK_LOOPS(16, int16_t)
+
+/*
+	Figure out which instruction sets we can build kernels for.
+
+	On x86 with GCC, Clang or MSVC every kernel gets built no matter what
+	flags you compile with, since each one is marked with the instruction set
+	it needs (SHRED_TARGET below) and nothing calls it unless the CPU the
+	program is running on actually supports it. That means one binary can
+	pick the best kernels at startup, see the dispatch table further down.
+
+	Other x86 compilers only get the kernels their flags allow. NEON is
+	part of every AArch64 CPU, so on ARM it just follows the compiler flags.
+*/
+#if !defined(SHRED_NO_SIMD)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+	defined(_M_IX86)
+#define SHRED_X86 1
+#if defined(__GNUC__) || defined(__clang__)
+#define SHRED_X86_TARGETS 1
+#define SHRED_TARGET_SSE2 __attribute__((target("sse2")))
+#define SHRED_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#define SHRED_TARGET_AVX512 \
+	__attribute__((target("avx512f,avx512bw,avx512dq,avx512vl")))
+#elif defined(_MSC_VER)
+// MSVC lets you use any intrinsic anywhere, so there's nothing to mark
+#define SHRED_X86_TARGETS 1
+#define SHRED_TARGET_SSE2
+#define SHRED_TARGET_AVX2
+#define SHRED_TARGET_AVX512
+#endif
+#endif
+
+#if defined(SHRED_X86_TARGETS)
+#define SHRED_HAVE_SSE2 1
+#define SHRED_HAVE_AVX2 1
+#define SHRED_HAVE_AVX512 1
+#elif defined(SHRED_X86)
+#if defined(__AVX512F__) && defined(__AVX512BW__) && \
+	defined(__AVX512DQ__) && defined(__AVX512VL__)
+#define SHRED_HAVE_AVX512 1
+#endif
+#if defined(__AVX2__)
+#define SHRED_HAVE_AVX2 1
+#endif
+#if defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHRED_HAVE_SSE2 1
+#endif
+#define SHRED_TARGET_SSE2
+#define SHRED_TARGET_AVX2
+#define SHRED_TARGET_AVX512
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SHRED_HAVE_NEON 1
+#endif
+#endif
+
+#if defined(SHRED_HAVE_SSE2)
+#include <immintrin.h>
+#endif
+#if defined(SHRED_HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+// pastes the instruction set name onto the end of a kernel name, so
+// SHRED_KERNEL(ShredFloatExpArray) becomes ShredFloatExpArray_avx2 and so on
+#define SHRED_CAT_(a, b) a##_##b
+#define SHRED_CAT(a, b) SHRED_CAT_(a, b)
+#define SHRED_KERNEL(name) SHRED_CAT(name, SHRED_ISA)
+
+static inline int ShredClz32(uint32_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return x ? __builtin_clz(x) : 32;
+#else
+	int n = 0;
+	if(!x)
+	{
+		return 32;
+	}
+	while(!(x & 0x80000000))
+	{
+		x <<= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+static inline int ShredCtz32(uint32_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return x ? __builtin_ctz(x) : 32;
+#else
+	int n = 0;
+	if(!x)
+	{
+		return 32;
+	}
+	while(!(x & 1))
+	{
+		x >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/*
+	The vector primitives each instruction set has to provide before
+	float_shredder_kernels.h gets included. Everything works on vectors of
+	32-bit lanes holding the raw float data:
+
+	shred_v_t		the vector type
+	SHRED_V_LANES		how many floats fit in one
+	shred_v_load(p)		unaligned load from p
+	shred_v_store(p, v)	unaligned store to p
+	shred_v_store_u8(p, v)	store the low byte of each lane to p
+	shred_v_set1(x)		every lane set to x
+	shred_v_and/or(a, b)	bitwise and/or
+	shred_v_andnot(a, b)	~a & b
+	shred_v_add/sub(a, b)	lane-wise integer add/subtract
+	shred_v_slli/srli(a, n)	logical shift of every lane by n
+	shred_v_cmpeq(a, b)	all ones where a == b, zero elsewhere
+	shred_v_cmpgt(a, b)	all ones where a > b as signed ints
+	shred_v_addf(a, b)	lane-wise float add of the raw data
+	shred_v_subf(a, b)	lane-wise float subtract of the raw data
+	shred_v_mulf(a, b)	lane-wise float multiply of the raw data
+	shred_v_hmax(v)		the biggest lane as a signed int
+	shred_v_bswap(v)	the bytes of each lane reversed
+	shred_v_load_u8(p)	load one byte per lane from p, zero extended
+	shred_v_signbits(v)	the top bit of each lane packed into an int,
+				lane 0 in bit 0
+	shred_v_select_bits(b, v)	lanes of v where bit (lane) of b is set,
+				zero elsewhere
+	shred_v_load_u16(p)	load 16 bits per lane from p, zero extended
+	shred_v_store_u16(p, v)	store the low 16 bits of each lane to p
+	shred_v_zeroupper()	get ready to call scalar code, vzeroupper
+				where the vectors are wider than SSE's and
+				nothing elsewhere
+
+	and optionally, where the hardware can convert to and from half
+	precision itself:
+
+	shred_v_load_half(p)	load halves from p as floats
+	shred_v_store_half(p, v)	store floats to p as halves, rounded to
+				nearest even
+
+	and optionally, where there's a vector float divide (everywhere but
+	32-bit ARM):
+
+	shred_v_divf(a, b)	lane-wise float divide of the raw data
+
+	and optionally, where there's a quick way to move single bytes around
+	(the shuffle kernels use the lane primitives above without them):
+
+	shred_v_byte_shuffle(in, out, stride)	split 4 * SHRED_V_LANES floats
+				from in into their four bytes, most significant
+				first, writing one vector to each of out,
+				out + stride, out + 2 * stride and out + 3 * stride
+	shred_v_byte_unshuffle(in, stride, out)	the other way round
+	shred_v_store_bytesigns(p, v)	store the top bit of each byte to p,
+				packed eight to a byte like the sign plane
+	shred_v_load_bytemask(p)	the other way round, all ones in each
+				byte whose bit at p is set and zero elsewhere
+*/
+
+#if defined(SHRED_HAVE_SSE2)
+SHRED_TARGET_SSE2 static inline void shred_sse2_store_u8(void* p, __m128i v)
+{
+	__m128i h = _mm_packs_epi32(v, v);
+	__m128i b = _mm_packus_epi16(h, h);
+	int32_t w = _mm_cvtsi128_si32(b);
+	memcpy(p, &w, sizeof(w));
+}
+
+SHRED_TARGET_SSE2 static inline __m128i shred_sse2_load_u8(const void* p)
+{
+	int32_t w;
+	memcpy(&w, p, sizeof(w));
+	__m128i zero = _mm_setzero_si128();
+	__m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128(w), zero);
+	return _mm_unpacklo_epi16(b, zero);
+}
+
+SHRED_TARGET_SSE2 static inline __m128i shred_sse2_select_bits(uint32_t bits,
+	__m128i v)
+{
+	const __m128i lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+	__m128i m = _mm_and_si128(_mm_set1_epi32((int)bits), lane_bits);
+	return _mm_and_si128(_mm_cmpeq_epi32(m, lane_bits), v);
+}
+
+// no max_epi32 before SSE4.1, so fold the halves together with a compare
+SHRED_TARGET_SSE2 static inline int32_t shred_sse2_hmax(__m128i v)
+{
+	__m128i w = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+	__m128i gt = _mm_cmpgt_epi32(v, w);
+	v = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, w));
+	w = _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+	gt = _mm_cmpgt_epi32(v, w);
+	v = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, w));
+	return _mm_cvtsi128_si32(v);
+}
+
+// no byte shuffle before SSSE3, so swap the bytes in each half and then
+// the halves
+SHRED_TARGET_SSE2 static inline __m128i shred_sse2_bswap(__m128i v)
+{
+	v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+	return _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
+}
+
+// SSE2 can only pack with signed saturation, so sign extend the low 16 bits
+// first and the pack won't change them
+SHRED_TARGET_SSE2 static inline void shred_sse2_store_u16(void* p, __m128i v)
+{
+	v = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+	_mm_storel_epi64((__m128i*)p, _mm_packs_epi32(v, v));
+}
+
+/*
+	SSE2 has no byte shuffle, but interleaving the bytes of two vectors
+	with unpacklo/hi moves one bit of the byte's position within the
+	vectors into the vector it ends up in. Four rounds of that turn four
+	vectors of floats into four vectors of bytes, and two rounds undo it.
+*/
+SHRED_TARGET_SSE2 static inline void shred_sse2_unpack_round(__m128i* v,
+	int a, int b)
+{
+	__m128i lo = _mm_unpacklo_epi8(v[a], v[b]);
+	v[b] = _mm_unpackhi_epi8(v[a], v[b]);
+	v[a] = lo;
+}
+
+SHRED_TARGET_SSE2 static inline void shred_sse2_byte_shuffle(const void* in,
+	uint8_t* out, size_t stride)
+{
+	__m128i v[4];
+	for(int k = 0; k < 4; k++)
+	{
+		v[k] = _mm_loadu_si128((const __m128i*)in + k);
+	}
+	for(int round = 0; round < 4; round++)
+	{
+		if(round % 2 == 0)
+		{
+			shred_sse2_unpack_round(v, 0, 2);
+			shred_sse2_unpack_round(v, 1, 3);
+		} else {
+			shred_sse2_unpack_round(v, 0, 1);
+			shred_sse2_unpack_round(v, 2, 3);
+		}
+	}
+	// v[k] is byte k counting from the least significant
+	for(int k = 0; k < 4; k++)
+	{
+		_mm_storeu_si128((__m128i*)(out + (3 - k) * stride), v[k]);
+	}
+}
+
+SHRED_TARGET_SSE2 static inline void shred_sse2_byte_unshuffle(
+	const uint8_t* in, size_t stride, void* out)
+{
+	__m128i v[4];
+	for(int k = 0; k < 4; k++)
+	{
+		v[k] = _mm_loadu_si128((const __m128i*)(in + (3 - k) * stride));
+	}
+	shred_sse2_unpack_round(v, 0, 2);
+	shred_sse2_unpack_round(v, 1, 3);
+	shred_sse2_unpack_round(v, 0, 1);
+	shred_sse2_unpack_round(v, 2, 3);
+	for(int k = 0; k < 4; k++)
+	{
+		_mm_storeu_si128((__m128i*)out + k, v[k]);
+	}
+}
+
+SHRED_TARGET_SSE2 static inline void shred_sse2_store_bytesigns(void* p,
+	__m128i v)
+{
+	uint16_t bits = (uint16_t)_mm_movemask_epi8(v);
+	memcpy(p, &bits, sizeof(bits));
+}
+
+SHRED_TARGET_SSE2 static inline __m128i shred_sse2_load_bytemask(
+	const void* p)
+{
+	const __m128i byte_bits = _mm_set1_epi64x((long long)0x8040201008040201ull);
+	uint16_t bits;
+	memcpy(&bits, p, sizeof(bits));
+	// copy the low byte of the mask over the first eight bytes and the high
+	// byte over the last eight
+	__m128i m = _mm_set1_epi16((short)bits);
+	m = _mm_unpacklo_epi8(m, m);
+	m = _mm_unpacklo_epi16(m, m);
+	m = _mm_unpacklo_epi32(m, m);
+	return _mm_cmpeq_epi8(_mm_and_si128(m, byte_bits), byte_bits);
+}
+
+#define SHRED_ISA sse2
+#define SHRED_TARGET SHRED_TARGET_SSE2
+#define SHRED_V_LANES 4
+#define shred_v_t __m128i
+#define shred_v_load(p) _mm_loadu_si128((const __m128i*)(p))
+#define shred_v_store(p, v) _mm_storeu_si128((__m128i*)(p), (v))
+#define shred_v_store_u8(p, v) shred_sse2_store_u8((p), (v))
+#define shred_v_set1(x) _mm_set1_epi32((int)(x))
+#define shred_v_and(a, b) _mm_and_si128((a), (b))
+#define shred_v_or(a, b) _mm_or_si128((a), (b))
+#define shred_v_andnot(a, b) _mm_andnot_si128((a), (b))
+#define shred_v_add(a, b) _mm_add_epi32((a), (b))
+#define shred_v_sub(a, b) _mm_sub_epi32((a), (b))
+#define shred_v_slli(a, n) _mm_slli_epi32((a), (n))
+#define shred_v_srli(a, n) _mm_srli_epi32((a), (n))
+#define shred_v_cmpeq(a, b) _mm_cmpeq_epi32((a), (b))
+#define shred_v_addf(a, b) _mm_castps_si128(_mm_add_ps( \
+	_mm_castsi128_ps(a), _mm_castsi128_ps(b)))
+#define shred_v_subf(a, b) _mm_castps_si128(_mm_sub_ps( \
+	_mm_castsi128_ps(a), _mm_castsi128_ps(b)))
+#define shred_v_mulf(a, b) _mm_castps_si128(_mm_mul_ps( \
+	_mm_castsi128_ps(a), _mm_castsi128_ps(b)))
+#define shred_v_divf(a, b) _mm_castps_si128(_mm_div_ps( \
+	_mm_castsi128_ps(a), _mm_castsi128_ps(b)))
+#define shred_v_hmax(v) shred_sse2_hmax(v)
+#define shred_v_bswap(v) shred_sse2_bswap(v)
+#define shred_v_load_u8(p) shred_sse2_load_u8(p)
+#define shred_v_signbits(v) \
+	((uint32_t)_mm_movemask_ps(_mm_castsi128_ps(v)))
+#define shred_v_select_bits(b, v) shred_sse2_select_bits((b), (v))
+#define shred_v_cmpgt(a, b) _mm_cmpgt_epi32((a), (b))
+#define shred_v_load_u16(p) _mm_unpacklo_epi16( \
+	_mm_loadl_epi64((const __m128i*)(p)), _mm_setzero_si128())
+#define shred_v_store_u16(p, v) shred_sse2_store_u16((p), (v))
+#define shred_v_byte_shuffle(in, out, stride) \
+	shred_sse2_byte_shuffle((in), (out), (stride))
+#define shred_v_byte_unshuffle(in, stride, out) \
+	shred_sse2_byte_unshuffle((in), (stride), (out))
+#define shred_v_store_bytesigns(p, v) shred_sse2_store_bytesigns((p), (v))
+#define shred_v_load_bytemask(p) shred_sse2_load_bytemask(p)
+#define shred_v_zeroupper() ((void)0)
+#include "float_shredder_kernels.h"
+#endif
+
+#if defined(SHRED_HAVE_AVX2)
+SHRED_TARGET_AVX2 static inline void shred_avx2_store_u8(void* p, __m256i v)
+{
+	__m256i h = _mm256_packs_epi32(v, v);
+	__m256i b = _mm256_packus_epi16(h, h);
+	__m128i lo = _mm256_castsi256_si128(b);
+	__m128i hi = _mm256_extracti128_si256(b, 1);
+	_mm_storel_epi64((__m128i*)p, _mm_unpacklo_epi32(lo, hi));
+}
+
+SHRED_TARGET_AVX2 static inline __m256i shred_avx2_select_bits(uint32_t bits,
+	__m256i v)
+{
+	const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	__m256i m = _mm256_and_si256(_mm256_set1_epi32((int)bits), lane_bits);
+	return _mm256_and_si256(_mm256_cmpeq_epi32(m, lane_bits), v);
+}
+
+SHRED_TARGET_AVX2 static inline void shred_avx2_store_u16(void* p, __m256i v)
+{
+	v = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+	v = _mm256_permute4x64_epi64(_mm256_packs_epi32(v, v), 0x08);
+	_mm_storeu_si128((__m128i*)p, _mm256_castsi256_si128(v));
+}
+
+/*
+	Each vector gets its bytes grouped within every 128-bit half, then its
+	dwords put in order so it's four 8-byte runs, one per byte. The 64-bit
+	unpacks and the lane permutes then gather each run from the four
+	vectors into one.
+*/
+SHRED_TARGET_AVX2 static inline __m256i shred_avx2_group_bytes(void)
+{
+	return _mm256_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14,
+		3, 7, 11, 15, 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+}
+
+SHRED_TARGET_AVX2 static inline void shred_avx2_byte_shuffle(const void* in,
+	uint8_t* out, size_t stride)
+{
+	const __m256i group = shred_avx2_group_bytes();
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	__m256i v[4];
+	for(int k = 0; k < 4; k++)
+	{
+		v[k] = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(
+			_mm256_loadu_si256((const __m256i*)in + k), group), order);
+	}
+	__m256i t0 = _mm256_unpacklo_epi64(v[0], v[1]);
+	__m256i t1 = _mm256_unpackhi_epi64(v[0], v[1]);
+	__m256i t2 = _mm256_unpacklo_epi64(v[2], v[3]);
+	__m256i t3 = _mm256_unpackhi_epi64(v[2], v[3]);
+	_mm256_storeu_si256((__m256i*)(out + 3 * stride),
+		_mm256_permute2x128_si256(t0, t2, 0x20));
+	_mm256_storeu_si256((__m256i*)(out + 2 * stride),
+		_mm256_permute2x128_si256(t1, t3, 0x20));
+	_mm256_storeu_si256((__m256i*)(out + stride),
+		_mm256_permute2x128_si256(t0, t2, 0x31));
+	_mm256_storeu_si256((__m256i*)out,
+		_mm256_permute2x128_si256(t1, t3, 0x31));
+}
+
+SHRED_TARGET_AVX2 static inline void shred_avx2_byte_unshuffle(
+	const uint8_t* in, size_t stride, void* out)
+{
+	const __m256i group = shred_avx2_group_bytes();
+	const __m256i order = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	__m256i p0 = _mm256_loadu_si256((const __m256i*)(in + 3 * stride));
+	__m256i p1 = _mm256_loadu_si256((const __m256i*)(in + 2 * stride));
+	__m256i p2 = _mm256_loadu_si256((const __m256i*)(in + stride));
+	__m256i p3 = _mm256_loadu_si256((const __m256i*)in);
+	__m256i t0 = _mm256_permute2x128_si256(p0, p2, 0x20);
+	__m256i t2 = _mm256_permute2x128_si256(p0, p2, 0x31);
+	__m256i t1 = _mm256_permute2x128_si256(p1, p3, 0x20);
+	__m256i t3 = _mm256_permute2x128_si256(p1, p3, 0x31);
+	__m256i v[4];
+	v[0] = _mm256_unpacklo_epi64(t0, t1);
+	v[1] = _mm256_unpackhi_epi64(t0, t1);
+	v[2] = _mm256_unpacklo_epi64(t2, t3);
+	v[3] = _mm256_unpackhi_epi64(t2, t3);
+	for(int k = 0; k < 4; k++)
+	{
+		_mm256_storeu_si256((__m256i*)out + k, _mm256_shuffle_epi8(
+			_mm256_permutevar8x32_epi32(v[k], order), group));
+	}
+}
+
+SHRED_TARGET_AVX2 static inline void shred_avx2_store_bytesigns(void* p,
+	__m256i v)
+{
+	uint32_t bits = (uint32_t)_mm256_movemask_epi8(v);
+	memcpy(p, &bits, sizeof(bits));
+}
+
+SHRED_TARGET_AVX2 static inline int32_t shred_avx2_hmax(__m256i v)
+{
+	__m128i m = _mm_max_epi32(_mm256_castsi256_si128(v),
+		_mm256_extracti128_si256(v, 1));
+	m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+	m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(m);
+}
+
+SHRED_TARGET_AVX2 static inline __m256i shred_avx2_bswap(__m256i v)
+{
+	const __m256i order = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+		11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4,
+		11, 10, 9, 8, 15, 14, 13, 12);
+	return _mm256_shuffle_epi8(v, order);
+}
+
+SHRED_TARGET_AVX2 static inline __m256i shred_avx2_load_bytemask(
+	const void* p)
+{
+	const __m256i byte_bits =
+		_mm256_set1_epi64x((long long)0x8040201008040201ull);
+	const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0,
+		1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+	uint32_t bits;
+	memcpy(&bits, p, sizeof(bits));
+	__m256i m = _mm256_shuffle_epi8(_mm256_set1_epi32((int)bits), spread);
+	return _mm256_cmpeq_epi8(_mm256_and_si256(m, byte_bits), byte_bits);
+}
+
+#define SHRED_ISA avx2
+#define SHRED_TARGET SHRED_TARGET_AVX2
+#define SHRED_V_LANES 8
+#define shred_v_t __m256i
+#define shred_v_load(p) _mm256_loadu_si256((const __m256i*)(p))
+#define shred_v_store(p, v) _mm256_storeu_si256((__m256i*)(p), (v))
+#define shred_v_store_u8(p, v) shred_avx2_store_u8((p), (v))
+#define shred_v_set1(x) _mm256_set1_epi32((int)(x))
+#define shred_v_and(a, b) _mm256_and_si256((a), (b))
+#define shred_v_or(a, b) _mm256_or_si256((a), (b))
+#define shred_v_andnot(a, b) _mm256_andnot_si256((a), (b))
+#define shred_v_add(a, b) _mm256_add_epi32((a), (b))
+#define shred_v_sub(a, b) _mm256_sub_epi32((a), (b))
+#define shred_v_slli(a, n) _mm256_slli_epi32((a), (n))
+#define shred_v_srli(a, n) _mm256_srli_epi32((a), (n))
+#define shred_v_cmpeq(a, b) _mm256_cmpeq_epi32((a), (b))
+#define shred_v_addf(a, b) _mm256_castps_si256(_mm256_add_ps( \
+	_mm256_castsi256_ps(a), _mm256_castsi256_ps(b)))
+#define shred_v_subf(a, b) _mm256_castps_si256(_mm256_sub_ps( \
+	_mm256_castsi256_ps(a), _mm256_castsi256_ps(b)))
+#define shred_v_mulf(a, b) _mm256_castps_si256(_mm256_mul_ps( \
+	_mm256_castsi256_ps(a), _mm256_castsi256_ps(b)))
+#define shred_v_divf(a, b) _mm256_castps_si256(_mm256_div_ps( \
+	_mm256_castsi256_ps(a), _mm256_castsi256_ps(b)))
+#define shred_v_hmax(v) shred_avx2_hmax(v)
+#define shred_v_bswap(v) shred_avx2_bswap(v)
+#define shred_v_load_u8(p) \
+	_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(p)))
+#define shred_v_signbits(v) \
+	((uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(v)))
+#define shred_v_select_bits(b, v) shred_avx2_select_bits((b), (v))
+#define shred_v_cmpgt(a, b) _mm256_cmpgt_epi32((a), (b))
+#define shred_v_load_u16(p) \
+	_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(p)))
+#define shred_v_store_u16(p, v) shred_avx2_store_u16((p), (v))
+#define shred_v_load_half(p) _mm256_castps_si256( \
+	_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(p))))
+#define shred_v_store_half(p, v) _mm_storeu_si128((__m128i*)(p), \
+	_mm256_cvtps_ph(_mm256_castsi256_ps(v), \
+	_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC))
+#define shred_v_byte_shuffle(in, out, stride) \
+	shred_avx2_byte_shuffle((in), (out), (stride))
+#define shred_v_byte_unshuffle(in, stride, out) \
+	shred_avx2_byte_unshuffle((in), (stride), (out))
+#define shred_v_store_bytesigns(p, v) shred_avx2_store_bytesigns((p), (v))
+#define shred_v_load_bytemask(p) shred_avx2_load_bytemask(p)
+#define shred_v_zeroupper() _mm256_zeroupper()
+#include "float_shredder_kernels.h"
+#endif
+
+#if defined(SHRED_HAVE_AVX512)
+// a lot of GCC's AVX-512 intrinsics trip its own -Wmaybe-uninitialized
+// (they start from a deliberately uninitialized vector), so shut that up
+// for just these kernels
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+/*
+	Same idea as AVX2: group the bytes within each 128-bit lane, put the
+	dwords in order so each byte's 16 values fill one lane, then transpose
+	the lanes of the four vectors.
+*/
+SHRED_TARGET_AVX512 static inline __m512i shred_avx512_bswap(__m512i v)
+{
+	const __m512i order = _mm512_broadcast_i32x4(_mm_setr_epi8(3, 2, 1, 0,
+		7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+	return _mm512_shuffle_epi8(v, order);
+}
+
+SHRED_TARGET_AVX512 static inline void shred_avx512_lane_transpose(
+	__m512i* v)
+{
+	__m512i t0 = _mm512_shuffle_i64x2(v[0], v[1], 0x44);
+	__m512i t1 = _mm512_shuffle_i64x2(v[0], v[1], 0xEE);
+	__m512i t2 = _mm512_shuffle_i64x2(v[2], v[3], 0x44);
+	__m512i t3 = _mm512_shuffle_i64x2(v[2], v[3], 0xEE);
+	v[0] = _mm512_shuffle_i64x2(t0, t2, 0x88);
+	v[1] = _mm512_shuffle_i64x2(t0, t2, 0xDD);
+	v[2] = _mm512_shuffle_i64x2(t1, t3, 0x88);
+	v[3] = _mm512_shuffle_i64x2(t1, t3, 0xDD);
+}
+
+// grouping the bytes and ordering the dwords are both their own inverse,
+// so ungrouping is the same two steps the other way round
+SHRED_TARGET_AVX512 static inline __m512i shred_avx512_group(__m512i v,
+	bool undo)
+{
+	const __m512i group = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 4, 8,
+		12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+	const __m512i order = _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13,
+		2, 6, 10, 14, 3, 7, 11, 15);
+	if(undo)
+	{
+		return _mm512_shuffle_epi8(_mm512_permutexvar_epi32(order, v), group);
+	}
+	return _mm512_permutexvar_epi32(order, _mm512_shuffle_epi8(v, group));
+}
+
+SHRED_TARGET_AVX512 static inline void shred_avx512_byte_shuffle(
+	const void* in, uint8_t* out, size_t stride)
+{
+	__m512i v[4];
+	for(int k = 0; k < 4; k++)
+	{
+		v[k] = shred_avx512_group(_mm512_loadu_si512(
+			(const void*)((const uint8_t*)in + 64 * k)), false);
+	}
+	shred_avx512_lane_transpose(v);
+	for(int k = 0; k < 4; k++)
+	{
+		_mm512_storeu_si512((void*)(out + (3 - k) * stride), v[k]);
+	}
+}
+
+SHRED_TARGET_AVX512 static inline void shred_avx512_byte_unshuffle(
+	const uint8_t* in, size_t stride, void* out)
+{
+	__m512i v[4];
+	for(int k = 0; k < 4; k++)
+	{
+		v[k] = _mm512_loadu_si512((const void*)(in + (3 - k) * stride));
+	}
+	shred_avx512_lane_transpose(v);
+	for(int k = 0; k < 4; k++)
+	{
+		_mm512_storeu_si512((void*)((uint8_t*)out + 64 * k),
+			shred_avx512_group(v[k], true));
+	}
+}
+
+SHRED_TARGET_AVX512 static inline void shred_avx512_store_bytesigns(void* p,
+	__m512i v)
+{
+	uint64_t bits = (uint64_t)_mm512_movepi8_mask(v);
+	memcpy(p, &bits, sizeof(bits));
+}
+
+SHRED_TARGET_AVX512 static inline __m512i shred_avx512_load_bytemask(
+	const void* p)
+{
+	uint64_t bits;
+	memcpy(&bits, p, sizeof(bits));
+	return _mm512_movm_epi8((__mmask64)bits);
+}
+
+#define SHRED_ISA avx512
+#define SHRED_TARGET SHRED_TARGET_AVX512
+#define SHRED_V_LANES 16
+#define shred_v_t __m512i
+#define shred_v_load(p) _mm512_loadu_si512((const void*)(p))
+#define shred_v_store(p, v) _mm512_storeu_si512((void*)(p), (v))
+#define shred_v_store_u8(p, v) \
+	_mm_storeu_si128((__m128i*)(p), _mm512_cvtepi32_epi8(v))
+#define shred_v_set1(x) _mm512_set1_epi32((int)(x))
+#define shred_v_and(a, b) _mm512_and_si512((a), (b))
+#define shred_v_or(a, b) _mm512_or_si512((a), (b))
+#define shred_v_andnot(a, b) _mm512_andnot_si512((a), (b))
+#define shred_v_add(a, b) _mm512_add_epi32((a), (b))
+#define shred_v_sub(a, b) _mm512_sub_epi32((a), (b))
+#define shred_v_slli(a, n) _mm512_slli_epi32((a), (unsigned int)(n))
+#define shred_v_srli(a, n) _mm512_srli_epi32((a), (unsigned int)(n))
+#define shred_v_cmpeq(a, b) _mm512_movm_epi32(_mm512_cmpeq_epi32_mask((a), (b)))
+#define shred_v_addf(a, b) _mm512_castps_si512(_mm512_add_ps( \
+	_mm512_castsi512_ps(a), _mm512_castsi512_ps(b)))
+#define shred_v_subf(a, b) _mm512_castps_si512(_mm512_sub_ps( \
+	_mm512_castsi512_ps(a), _mm512_castsi512_ps(b)))
+#define shred_v_mulf(a, b) _mm512_castps_si512(_mm512_mul_ps( \
+	_mm512_castsi512_ps(a), _mm512_castsi512_ps(b)))
+#define shred_v_divf(a, b) _mm512_castps_si512(_mm512_div_ps( \
+	_mm512_castsi512_ps(a), _mm512_castsi512_ps(b)))
+#define shred_v_hmax(v) ((int32_t)_mm512_reduce_max_epi32(v))
+#define shred_v_bswap(v) shred_avx512_bswap(v)
+#define shred_v_load_u8(p) \
+	_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(p)))
+#define shred_v_signbits(v) ((uint32_t)_mm512_movepi32_mask(v))
+#define shred_v_select_bits(b, v) _mm512_maskz_mov_epi32((__mmask16)(b), (v))
+#define shred_v_cmpgt(a, b) _mm512_movm_epi32(_mm512_cmpgt_epi32_mask((a), (b)))
+#define shred_v_load_u16(p) \
+	_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(p)))
+#define shred_v_store_u16(p, v) \
+	_mm256_storeu_si256((__m256i*)(p), _mm512_cvtepi32_epi16(v))
+#define shred_v_load_half(p) _mm512_castps_si512( \
+	_mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(p))))
+#define shred_v_store_half(p, v) _mm256_storeu_si256((__m256i*)(p), \
+	_mm512_cvtps_ph(_mm512_castsi512_ps(v), \
+	_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC))
+#define shred_v_byte_shuffle(in, out, stride) \
+	shred_avx512_byte_shuffle((in), (out), (stride))
+#define shred_v_byte_unshuffle(in, stride, out) \
+	shred_avx512_byte_unshuffle((in), (stride), (out))
+#define shred_v_store_bytesigns(p, v) shred_avx512_store_bytesigns((p), (v))
+#define shred_v_load_bytemask(p) shred_avx512_load_bytemask(p)
+#define shred_v_zeroupper() _mm256_zeroupper()
+#include "float_shredder_kernels.h"
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+#if defined(SHRED_HAVE_NEON)
+static inline void shred_neon_store_u8(void* p, uint32x4_t v)
+{
+	uint16x4_t h = vmovn_u32(v);
+	uint8x8_t b = vmovn_u16(vcombine_u16(h, h));
+	uint32_t w = vget_lane_u32(vreinterpret_u32_u8(b), 0);
+	memcpy(p, &w, sizeof(w));
+}
+
+static inline uint32x4_t shred_neon_load_u8(const void* p)
+{
+	uint32_t w;
+	memcpy(&w, p, sizeof(w));
+	uint8x8_t b = vreinterpret_u8_u32(vdup_n_u32(w));
+	return vmovl_u16(vget_low_u16(vmovl_u8(b)));
+}
+
+static inline int32_t shred_neon_hmax(uint32x4_t v)
+{
+	int32x4_t s = vreinterpretq_s32_u32(v);
+#if defined(__aarch64__)
+	return vmaxvq_s32(s);
+#else
+	int32x2_t half = vmax_s32(vget_low_s32(s), vget_high_s32(s));
+	return vget_lane_s32(vpmax_s32(half, half), 0);
+#endif
+}
+
+// NEON doesn't have a movemask, so shift each lane's top bit into its own
+// position and add the lanes up
+static inline uint32_t shred_neon_signbits(uint32x4_t v)
+{
+	static const int32_t lane_shifts[4] = {0, 1, 2, 3};
+	uint32x4_t bits = vshlq_u32(vshrq_n_u32(v, 31), vld1q_s32(lane_shifts));
+#if defined(__aarch64__)
+	return vaddvq_u32(bits);
+#else
+	uint32x2_t half = vadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+	return vget_lane_u32(vpadd_u32(half, half), 0);
+#endif
+}
+
+static inline uint32x4_t shred_neon_select_bits(uint32_t bits, uint32x4_t v)
+{
+	static const uint32_t lane_bits[4] = {1, 2, 4, 8};
+	uint32x4_t m = vtstq_u32(vdupq_n_u32(bits), vld1q_u32(lane_bits));
+	return vandq_u32(m, v);
+}
+
+// vld4/vst4 split interleaved bytes apart and back for free
+static inline void shred_neon_byte_shuffle(const void* in, uint8_t* out,
+	size_t stride)
+{
+	uint8x16x4_t v = vld4q_u8((const uint8_t*)in);
+	for(int k = 0; k < 4; k++)
+	{
+		vst1q_u8(out + (3 - k) * stride, v.val[k]);
+	}
+}
+
+static inline void shred_neon_byte_unshuffle(const uint8_t* in,
+	size_t stride, void* out)
+{
+	uint8x16x4_t v;
+	for(int k = 0; k < 4; k++)
+	{
+		v.val[k] = vld1q_u8(in + (3 - k) * stride);
+	}
+	vst4q_u8((uint8_t*)out, v);
+}
+
+#define SHRED_ISA neon
+#define SHRED_TARGET
+#define SHRED_V_LANES 4
+#define shred_v_t uint32x4_t
+#define shred_v_load(p) vld1q_u32((const uint32_t*)(const void*)(p))
+#define shred_v_store(p, v) vst1q_u32((uint32_t*)(void*)(p), (v))
+#define shred_v_store_u8(p, v) shred_neon_store_u8((p), (v))
+#define shred_v_set1(x) vdupq_n_u32((uint32_t)(x))
+#define shred_v_and(a, b) vandq_u32((a), (b))
+#define shred_v_or(a, b) vorrq_u32((a), (b))
+#define shred_v_andnot(a, b) vbicq_u32((b), (a))
+#define shred_v_add(a, b) vaddq_u32((a), (b))
+#define shred_v_sub(a, b) vsubq_u32((a), (b))
+// NEON only has immediate shifts, so go through the register form to allow
+// shift counts that aren't known until runtime
+#define shred_v_slli(a, n) vshlq_u32((a), vdupq_n_s32((int32_t)(n)))
+#define shred_v_srli(a, n) vshlq_u32((a), vdupq_n_s32(-(int32_t)(n)))
+#define shred_v_cmpeq(a, b) vceqq_u32((a), (b))
+#define shred_v_addf(a, b) vreinterpretq_u32_f32(vaddq_f32( \
+	vreinterpretq_f32_u32(a), vreinterpretq_f32_u32(b)))
+#define shred_v_subf(a, b) vreinterpretq_u32_f32(vsubq_f32( \
+	vreinterpretq_f32_u32(a), vreinterpretq_f32_u32(b)))
+#define shred_v_mulf(a, b) vreinterpretq_u32_f32(vmulq_f32( \
+	vreinterpretq_f32_u32(a), vreinterpretq_f32_u32(b)))
+#define shred_v_hmax(v) shred_neon_hmax(v)
+#define shred_v_bswap(v) vreinterpretq_u32_u8(vrev32q_u8( \
+	vreinterpretq_u8_u32(v)))
+#define shred_v_load_u8(p) shred_neon_load_u8(p)
+#define shred_v_signbits(v) shred_neon_signbits(v)
+#define shred_v_select_bits(b, v) shred_neon_select_bits((b), (v))
+#define shred_v_cmpgt(a, b) vcgtq_s32(vreinterpretq_s32_u32(a), \
+	vreinterpretq_s32_u32(b))
+#define shred_v_load_u16(p) \
+	vmovl_u16(vld1_u16((const uint16_t*)(const void*)(p)))
+#define shred_v_store_u16(p, v) vst1_u16((uint16_t*)(void*)(p), vmovn_u32(v))
+// the float <-> half conversions are only guaranteed on AArch64
+#if defined(__aarch64__)
+#define shred_v_load_half(p) vreinterpretq_u32_f32(vcvt_f32_f16( \
+	vreinterpret_f16_u16(vld1_u16((const uint16_t*)(const void*)(p)))))
+#define shred_v_store_half(p, v) vst1_u16((uint16_t*)(void*)(p), \
+	vreinterpret_u16_f16(vcvt_f16_f32(vreinterpretq_f32_u32(v))))
+#define shred_v_divf(a, b) vreinterpretq_u32_f32(vdivq_f32( \
+	vreinterpretq_f32_u32(a), vreinterpretq_f32_u32(b)))
+#endif
+#define shred_v_byte_shuffle(in, out, stride) \
+	shred_neon_byte_shuffle((in), (out), (stride))
+#define shred_v_byte_unshuffle(in, stride, out) \
+	shred_neon_byte_unshuffle((in), (stride), (out))
+#define shred_v_zeroupper() ((void)0)
+#include "float_shredder_kernels.h"
+#endif
+
+/*
+	Runtime dispatch.
+
+	Every batch function goes through a table of function pointers, one per
+	kernel, which gets pointed at the best kernels for the CPU we're running
+	on the first time any of them is called (or when you call
+	ShredDispatchInit() yourself). Until then each entry points at a little
+	stub that does the detection and then forwards the call, so there's no
+	"have we picked yet?" check on every call, it's just an indirect call
+	through the table from then on.
+
+	The tables are static, so each translation unit that includes this header
+	gets its own and does its own (very cheap) detection.
+*/
+typedef enum ShredIsa
+{
+	SHRED_ISA_SCALAR = 0,
+	SHRED_ISA_SSE2,
+	SHRED_ISA_AVX2,
+	SHRED_ISA_AVX512,
+	SHRED_ISA_NEON
+} ShredIsa;
+
+// bits in the value ShredCpuFeatures() returns
+#define SHRED_CPU_SSE2		(1u << 0)
+#define SHRED_CPU_AVX2		(1u << 1)
+#define SHRED_CPU_AVX512	(1u << 2)
+#define SHRED_CPU_NEON		(1u << 3)
+
+#if defined(SHRED_X86) && (defined(__GNUC__) || defined(__clang__))
+#include <cpuid.h>
+#elif defined(SHRED_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__linux__) && (defined(__aarch64__) || defined(__arm__))
+#include <sys/auxv.h>
+#endif
+
+#if defined(SHRED_X86)
+static inline void ShredCpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int r[4];
+	__cpuidex(r, (int)leaf, (int)subleaf);
+	for(int i = 0; i < 4; i++)
+	{
+		regs[i] = (uint32_t)r[i];
+	}
+#elif defined(__GNUC__) || defined(__clang__)
+	if(!__get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2],
+		&regs[3]))
+	{
+		regs[0] = regs[1] = regs[2] = regs[3] = 0;
+	}
+#else
+	(void)leaf;
+	(void)subleaf;
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#endif
+}
+
+// which register states the OS saves on a context switch, without this the
+// CPU might support AVX but the OS won't let us use it
+static inline uint64_t ShredXgetbv(void)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	return _xgetbv(0);
+#elif defined(__GNUC__) || defined(__clang__)
+	uint32_t lo, hi;
+	__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((uint64_t)hi << 32) | lo;
+#else
+	return 0;
+#endif
+}
+#endif
+
+/*
+	Works out what the CPU we're running on can do, as a mask of the
+	SHRED_CPU_* bits. This only reports things there are kernels for.
+*/
+static inline uint32_t ShredCpuFeatures(void)
+{
+	uint32_t features = 0;
+#if defined(SHRED_X86)
+	uint32_t regs[4];
+	ShredCpuid(0, 0, regs);
+	uint32_t max_leaf = regs[0];
+	ShredCpuid(1, 0, regs);
+	uint32_t leaf1_ecx = regs[2];
+	uint32_t leaf1_edx = regs[3];
+	if(leaf1_edx & (1u << 26))
+	{
+		features |= SHRED_CPU_SSE2;
+	}
+	// OSXSAVE and AVX, then check the OS saves the xmm and ymm registers
+	if((leaf1_ecx & (1u << 27)) && (leaf1_ecx & (1u << 28)) &&
+		max_leaf >= 7)
+	{
+		uint64_t xcr0 = ShredXgetbv();
+		ShredCpuid(7, 0, regs);
+		uint32_t leaf7_ebx = regs[1];
+		// the AVX2 kernels also use F16C, which every AVX2 CPU has
+		if((xcr0 & 0x6) == 0x6 && (leaf7_ebx & (1u << 5)) &&
+			(leaf1_ecx & (1u << 29)))
+		{
+			features |= SHRED_CPU_AVX2;
+		}
+		// AVX-512 F, DQ, BW and VL, plus the opmask and zmm state
+		uint32_t avx512_bits = (1u << 16) | (1u << 17) | (1u << 30) |
+			(1u << 31);
+		if((xcr0 & 0xE6) == 0xE6 &&
+			(leaf7_ebx & avx512_bits) == avx512_bits)
+		{
+			features |= SHRED_CPU_AVX512;
+		}
+	}
+#elif defined(__aarch64__) || defined(__arm__)
+#if defined(__linux__) && defined(__aarch64__)
+	// HWCAP_ASIMD
+	if(getauxval(AT_HWCAP) & (1ul << 1))
+	{
+		features |= SHRED_CPU_NEON;
+	}
+#elif defined(__linux__)
+	// HWCAP_NEON
+	if(getauxval(AT_HWCAP) & (1ul << 12))
+	{
+		features |= SHRED_CPU_NEON;
+	}
+#elif defined(SHRED_HAVE_NEON)
+	// if we were compiled for NEON the CPU has to have it anyway
+	features |= SHRED_CPU_NEON;
+#endif
+#endif
+	return features;
+}
+
+/*
+	Every kernel that goes through the dispatch table, as
+	X(name, parameters, arguments). Adding a kernel to this list adds a table
+	entry and a stub for it, each instruction set then needs a
+	name_<isa> version of it (or it just keeps the scalar one).
+*/
+#define SHRED_DISPATCH_LIST(X) \
+	X(ShredFloatExpUnbiasedArray, \
+		(const float* in, uint32_t* out, size_t n), (in, out, n)) \
+	X(ShredFloatExpUnbiasedRawArray, \
+		(const float* in, uint32_t* out, size_t n), (in, out, n)) \
+	X(ShredFloatExpArray, \
+		(const float* in, int32_t* out, size_t n), (in, out, n)) \
+	X(ShredFloatExpRawArray, \
+		(const float* in, int32_t* out, size_t n), (in, out, n)) \
+	X(ShredFloatMantissaRawArray, \
+		(const float* in, uint32_t* out, size_t n), (in, out, n)) \
+	X(ShredFloatMantissaArray, \
+		(const float* in, float* out, size_t n), (in, out, n)) \
+	X(ShredFloatIsNegativeArray, \
+		(const float* in, bool* out, size_t n), (in, out, n)) \
+	X(ShredFloatShiftExpUpArray, \
+		(const float* in, float* out, size_t n, int shift), \
+		(in, out, n, shift)) \
+	X(ShredFloatShiftExpDownArray, \
+		(const float* in, float* out, size_t n, int shift), \
+		(in, out, n, shift)) \
+	X(ShredFloatShiftMantUpArray, \
+		(const float* in, float* out, size_t n, int shift), \
+		(in, out, n, shift)) \
+	X(ShredFloatShiftMantDownArray, \
+		(const float* in, float* out, size_t n, int shift), \
+		(in, out, n, shift)) \
+	X(ShredFloatScalePow2Array, \
+		(const float* in, float* out, size_t n, int scale), \
+		(in, out, n, scale)) \
+	X(ShredFloatClassifyArray, \
+		(const float* in, uint8_t* out, size_t n), (in, out, n)) \
+	X(ShredFloatClassifyMasks, \
+		(const float* in, size_t n, uint8_t* const* masks), \
+		(in, n, masks)) \
+	X(ShredFloatClassCount, \
+		(const float* in, size_t n, size_t* counts), (in, n, counts)) \
+	X(ShredFloatByteSwapArray, \
+		(const float* in, float* out, size_t n), (in, out, n)) \
+	X(ShredFloatSummarize, \
+		(const float* in, size_t n, ShredFloatSummary* summary), \
+		(in, n, summary)) \
+	X(ShredFloatUlpDistanceArray, \
+		(const float* a, const float* b, uint32_t* out, size_t n, \
+		ShredUlpStats* stats), (a, b, out, n, stats)) \
+	X(ShredFloatStepUlpsArray, \
+		(const float* in, float* out, size_t n, int32_t steps), \
+		(in, out, n, steps)) \
+	X(ShredFloatToOrderedKeyArray, \
+		(const float* in, uint32_t* out, size_t n, ShredEndian endian), \
+		(in, out, n, endian)) \
+	X(ShredFloatToCanonicalKeyArray, \
+		(const float* in, uint32_t* out, size_t n, ShredEndian endian), \
+		(in, out, n, endian)) \
+	X(ShredFloatFromOrderedKeyArray, \
+		(const uint32_t* in, float* out, size_t n, ShredEndian endian), \
+		(in, out, n, endian)) \
+	X(ShredFloatTruncateMantissaArray, \
+		(const float* in, float* out, size_t n, int bits, \
+		ShredTruncateStats* stats), (in, out, n, bits, stats)) \
+	X(ShredFloatLog2ApproxArray, \
+		(const float* in, float* out, size_t n, ShredApprox accuracy), \
+		(in, out, n, accuracy)) \
+	X(ShredFloatExp2ApproxArray, \
+		(const float* in, float* out, size_t n, ShredApprox accuracy), \
+		(in, out, n, accuracy)) \
+	X(ShredFloatSqrtApproxArray, \
+		(const float* in, float* out, size_t n, ShredApprox accuracy), \
+		(in, out, n, accuracy)) \
+	X(ShredFloatRsqrtApproxArray, \
+		(const float* in, float* out, size_t n, ShredApprox accuracy), \
+		(in, out, n, accuracy)) \
+	X(ShredFloatSplitPlanes, \
+		(const float* in, size_t n, uint8_t* signs, uint8_t* exponents, \
+		uint32_t* mantissas), (in, n, signs, exponents, mantissas)) \
+	X(ShredFloatJoinPlanes, \
+		(const uint8_t* signs, const uint8_t* exponents, \
+		const uint32_t* mantissas, size_t n, float* out), \
+		(signs, exponents, mantissas, n, out)) \
+	X(ShredFloatByteShuffle, \
+		(const float* in, size_t n, uint8_t* out), (in, n, out)) \
+	X(ShredFloatByteUnshuffle, \
+		(const uint8_t* in, size_t n, float* out), (in, n, out)) \
+	X(ShredFloatBitShuffle, \
+		(const float* in, size_t n, uint8_t* out), (in, n, out)) \
+	X(ShredFloatBitUnshuffle, \
+		(const uint8_t* in, size_t n, float* out), (in, n, out)) \
+	X(ShredFloatToHalfArray, \
+		(const float* in, ShredHalf* out, size_t n), (in, out, n)) \
+	X(ShredHalfToFloatArray, \
+		(const ShredHalf* in, float* out, size_t n), (in, out, n)) \
+	X(ShredFloatToBFloat16Array, \
+		(const float* in, ShredBFloat16* out, size_t n), (in, out, n)) \
+	X(ShredBFloat16ToFloatArray, \
+		(const ShredBFloat16* in, float* out, size_t n), (in, out, n)) \
+	X(ShredFloatToBlockInt8, \
+		(const float* in, size_t n, size_t block_size, int bits, \
+		uint8_t* exps, int8_t* out), (in, n, block_size, bits, exps, out)) \
+	X(ShredBlockInt8ToFloat, \
+		(const uint8_t* exps, const int8_t* in, size_t n, size_t block_size, \
+		int bits, float* out), (exps, in, n, block_size, bits, out)) \
+	X(ShredFloatToBlockInt16, \
+		(const float* in, size_t n, size_t block_size, int bits, \
+		uint8_t* exps, int16_t* out), (in, n, block_size, bits, exps, out)) \
+	X(ShredBlockInt16ToFloat, \
+		(const uint8_t* exps, const int16_t* in, size_t n, size_t block_size, \
+		int bits, float* out), (exps, in, n, block_size, bits, out))
+
+typedef struct ShredDispatchTable
+{
+	bool ready;
+	ShredIsa isa;
+#define SHRED_DISPATCH_FIELD(name, params, args) void (*name) params;
+	SHRED_DISPATCH_LIST(SHRED_DISPATCH_FIELD)
+#undef SHRED_DISPATCH_FIELD
+} ShredDispatchTable;
+
+#define SHRED_DISPATCH_STUB_DECL(name, params, args) \
+	static inline void name##_resolve params;
+SHRED_DISPATCH_LIST(SHRED_DISPATCH_STUB_DECL)
+#undef SHRED_DISPATCH_STUB_DECL
+
+/*
+	One constant table per instruction set, and the stubs in one more.
+	They're all filled in at compile time, so the only thing that ever gets
+	written at runtime is shred_dispatch_current, the pointer to whichever
+	one is in use.
+*/
+#define SHRED_DISPATCH_RESOLVE(name, params, args) name##_resolve,
+static const ShredDispatchTable shred_dispatch_stubs = {
+	false,
+	SHRED_ISA_SCALAR,
+	SHRED_DISPATCH_LIST(SHRED_DISPATCH_RESOLVE)
+};
+#undef SHRED_DISPATCH_RESOLVE
+
+#define SHRED_DISPATCH_ENTRY(name, params, args) SHRED_CAT(name, SHRED_ISA),
+#define SHRED_ISA scalar
+static const ShredDispatchTable shred_dispatch_scalar = {
+	true,
+	SHRED_ISA_SCALAR,
+	SHRED_DISPATCH_LIST(SHRED_DISPATCH_ENTRY)
+};
+#undef SHRED_ISA
+#if defined(SHRED_HAVE_SSE2)
+#define SHRED_ISA sse2
+static const ShredDispatchTable shred_dispatch_sse2 = {
+	true,
+	SHRED_ISA_SSE2,
+	SHRED_DISPATCH_LIST(SHRED_DISPATCH_ENTRY)
+};
+#undef SHRED_ISA
+#endif
+#if defined(SHRED_HAVE_AVX2)
+#define SHRED_ISA avx2
+static const ShredDispatchTable shred_dispatch_avx2 = {
+	true,
+	SHRED_ISA_AVX2,
+	SHRED_DISPATCH_LIST(SHRED_DISPATCH_ENTRY)
+};
+#undef SHRED_ISA
+#endif
+#if defined(SHRED_HAVE_AVX512)
+#define SHRED_ISA avx512
+static const ShredDispatchTable shred_dispatch_avx512 = {
+	true,
+	SHRED_ISA_AVX512,
+	SHRED_DISPATCH_LIST(SHRED_DISPATCH_ENTRY)
+};
+#undef SHRED_ISA
+#endif
+#if defined(SHRED_HAVE_NEON)
+#define SHRED_ISA neon
+static const ShredDispatchTable shred_dispatch_neon = {
+	true,
+	SHRED_ISA_NEON,
+	SHRED_DISPATCH_LIST(SHRED_DISPATCH_ENTRY)
+};
+#undef SHRED_ISA
+#endif
+#undef SHRED_DISPATCH_ENTRY
+
+static const ShredDispatchTable* shred_dispatch_current =
+	&shred_dispatch_stubs;
+
+/*
+	The table the batch functions call through. Threads can be swapping it
+	while others read it, so the pointer is always loaded and stored
+	atomically, and since every table it can point at is constant, seeing
+	the pointer is all it takes to see the whole table.
+*/
+static inline const ShredDispatchTable* ShredDispatch(void)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	// aligned pointer loads and stores are atomic on everything MSVC targets
+	return *(const ShredDispatchTable* const volatile*)&shred_dispatch_current;
+#else
+	return __atomic_load_n(&shred_dispatch_current, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void ShredDispatchPublish(const ShredDispatchTable* table)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	*(const ShredDispatchTable* volatile*)&shred_dispatch_current = table;
+#else
+	__atomic_store_n(&shred_dispatch_current, table, __ATOMIC_RELEASE);
+#endif
+}
+
+// the table for isa, or the scalar one if that isn't compiled in
+static inline const ShredDispatchTable* ShredDispatchTableFor(ShredIsa isa)
+{
+	switch(isa)
+	{
+#if defined(SHRED_HAVE_AVX512)
+	case SHRED_ISA_AVX512:
+		return &shred_dispatch_avx512;
+#endif
+#if defined(SHRED_HAVE_AVX2)
+	case SHRED_ISA_AVX2:
+		return &shred_dispatch_avx2;
+#endif
+#if defined(SHRED_HAVE_SSE2)
+	case SHRED_ISA_SSE2:
+		return &shred_dispatch_sse2;
+#endif
+#if defined(SHRED_HAVE_NEON)
+	case SHRED_ISA_NEON:
+		return &shred_dispatch_neon;
+#endif
+	default:
+		return &shred_dispatch_scalar;
+	}
+}
+
+static inline void ShredDispatchInit(void);
+
+#define SHRED_DISPATCH_STUB(name, params, args) \
+	static inline void name##_resolve params \
+	{ \
+		ShredDispatchInit(); \
+		ShredDispatch()->name args; \
+	}
+SHRED_DISPATCH_LIST(SHRED_DISPATCH_STUB)
+#undef SHRED_DISPATCH_STUB
+
+/*
+	Copies isa's kernels into a table of your own, for running them without
+	touching what the batch functions use (the benchmarks and the exhaustive
+	checker do this).
+*/
+static inline void ShredDispatchFill(ShredDispatchTable* table, ShredIsa isa)
+{
+	*table = *ShredDispatchTableFor(isa);
+}
+
+/*
+	The best instruction set that's both compiled in and supported by the
+	CPU we're running on.
+*/
+static inline ShredIsa ShredBestIsa(void)
+{
+	uint32_t features = ShredCpuFeatures();
+	(void)features;
+#if defined(SHRED_HAVE_AVX512)
+	if(features & SHRED_CPU_AVX512)
+	{
+		return SHRED_ISA_AVX512;
+	}
+#endif
+#if defined(SHRED_HAVE_AVX2)
+	if(features & SHRED_CPU_AVX2)
+	{
+		return SHRED_ISA_AVX2;
+	}
+#endif
+#if defined(SHRED_HAVE_SSE2)
+	if(features & SHRED_CPU_SSE2)
+	{
+		return SHRED_ISA_SSE2;
+	}
+#endif
+#if defined(SHRED_HAVE_NEON)
+	if(features & SHRED_CPU_NEON)
+	{
+		return SHRED_ISA_NEON;
+	}
+#endif
+	return SHRED_ISA_SCALAR;
+}
+
+/*
+	Points the dispatch table at the best kernels for this CPU. You don't
+	have to call this, the first batch call does it for you, but calling it
+	at startup keeps the detection out of your first batch.
+
+	If several threads hit their first batch call at once they'll all do the
+	detection, and all publish the same table.
+*/
+static inline void ShredDispatchInit(void)
+{
+	ShredDispatchPublish(ShredDispatchTableFor(ShredBestIsa()));
+}
+
+/*
+	Forces the dispatch table onto a particular instruction set, for
+	benchmarking or for testing the kernels against each other. Returns false
+	(and leaves the table alone) if that instruction set isn't compiled in
+	or the CPU can't run it. SHRED_ISA_SCALAR always works.
+*/
+static inline bool ShredDispatchForce(ShredIsa isa)
+{
+	uint32_t features = ShredCpuFeatures();
+	(void)features;
+	bool ok = false;
+	switch(isa)
+	{
+	case SHRED_ISA_SCALAR:
+		ok = true;
+		break;
+#if defined(SHRED_HAVE_SSE2)
+	case SHRED_ISA_SSE2:
+		ok = (features & SHRED_CPU_SSE2) != 0;
+		break;
+#endif
+#if defined(SHRED_HAVE_AVX2)
+	case SHRED_ISA_AVX2:
+		ok = (features & SHRED_CPU_AVX2) != 0;
+		break;
+#endif
+#if defined(SHRED_HAVE_AVX512)
+	case SHRED_ISA_AVX512:
+		ok = (features & SHRED_CPU_AVX512) != 0;
+		break;
+#endif
+#if defined(SHRED_HAVE_NEON)
+	case SHRED_ISA_NEON:
+		ok = (features & SHRED_CPU_NEON) != 0;
+		break;
+#endif
+	default:
+		break;
+	}
+	if(ok)
+	{
+		ShredDispatchPublish(ShredDispatchTableFor(isa));
+	}
+	return ok;
+}
+
+static inline const char* ShredIsaName(ShredIsa isa)
+{
+	switch(isa)
+	{
+	case SHRED_ISA_SSE2:
+		return "sse2";
+	case SHRED_ISA_AVX2:
+		return "avx2";
+	case SHRED_ISA_AVX512:
+		return "avx512";
+	case SHRED_ISA_NEON:
+		return "neon";
+	default:
+		return "scalar";
+	}
+}
+
+/*
+	Which kernels the batch functions are using, so you can log it. This
+	does the detection if nothing has yet.
+*/
+static inline ShredIsa ShredDispatchIsa(void)
+{
+	if(!ShredDispatch()->ready)
+	{
+		ShredDispatchInit();
+	}
+	return ShredDispatch()->isa;
+}
+
+static inline const char* ShredDispatchName(void)
+{
+	return ShredIsaName(ShredDispatchIsa());
+}
+
+/*
+	What each batch function counts towards ShredStats when SHRED_STATS is
+	on. The class counts come straight from the ClassCount kernels, not the
+	public ClassCount functions, so they don't count themselves as batches.
+*/
+#if defined(SHRED_STATS)
+#define SHRED_DEFINE_STATS_BATCH(Name, real_t, class_count) \
+static inline void Shred##Name##StatsBatch(const real_t* in, size_t n, \
+	uint64_t calls) \
+{ \
+	size_t counts[SHRED_CLASS_COUNT]; \
+	class_count(in, n, counts); \
+	SHRED_STATS_ADD(batch_calls, calls); \
+	SHRED_STATS_ADD(batch_floats, n); \
+	SHRED_STATS_ADD(subnormals, counts[SHRED_CLASS_SUBNORMAL]); \
+	SHRED_STATS_ADD(infs, counts[SHRED_CLASS_INFINITE]); \
+	SHRED_STATS_ADD(nans, counts[SHRED_CLASS_NAN]); \
+}
+
+SHRED_DEFINE_STATS_BATCH(Float, float, ShredDispatch()->ShredFloatClassCount)
+SHRED_DEFINE_STATS_BATCH(Double, double, ShredDoubleClassCount_scalar)
+
+#define SHRED_STATS_BATCH(Name, in, n) Shred##Name##StatsBatch(in, n, 1)
+// for counting a batch call's floats a piece at a time
+#define SHRED_STATS_FLOATS(Name, in, n) Shred##Name##StatsBatch(in, n, 0)
+#else
+#define SHRED_STATS_BATCH(Name, in, n)
+#define SHRED_STATS_FLOATS(Name, in, n)
+#endif
+
+/*
+	The public batch functions. `in` and `out` can point anywhere, they
+	don't need any particular alignment, but they shouldn't overlap unless
+	they're exactly the same pointer.
+*/
+static inline void ShredFloatToDataArray(const float* in, uint32_t* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	memmove(out, in, n * sizeof(float));
+}
+
+static inline void ShredDataToFloatArray(const uint32_t* in, float* out,
+	size_t n)
+{
+	memmove(out, in, n * sizeof(float));
+}
+
+static inline void ShredFloatExpUnbiasedArray(const float* in, uint32_t* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatExpUnbiasedArray(in, out, n);
+}
+
+static inline void ShredFloatExpUnbiasedRawArray(const float* in,
+	uint32_t* out, size_t n)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatExpUnbiasedRawArray(in, out, n);
+}
+
+static inline void ShredFloatExpArray(const float* in, int32_t* out, size_t n)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatExpArray(in, out, n);
+}
+
+static inline void ShredFloatExpRawArray(const float* in, int32_t* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatExpRawArray(in, out, n);
+}
+
+static inline void ShredFloatMantissaRawArray(const float* in, uint32_t* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatMantissaRawArray(in, out, n);
+}
+
+static inline void ShredFloatMantissaArray(const float* in, float* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatMantissaArray(in, out, n);
+}
+
+// bool is assumed to be one byte holding 0 or 1, which is the case on every
+// compiler this has been used with
+static inline void ShredFloatIsNegativeArray(const float* in, bool* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatIsNegativeArray(in, out, n);
+}
+
+static inline void ShredFloatShiftExpUpArray(const float* in, float* out,
+	size_t n, int shift)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatShiftExpUpArray(in, out, n, shift);
+}
+
+static inline void ShredFloatShiftExpDownArray(const float* in, float* out,
+	size_t n, int shift)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatShiftExpDownArray(in, out, n, shift);
+}
+
+static inline void ShredFloatShiftMantUpArray(const float* in, float* out,
+	size_t n, int shift)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatShiftMantUpArray(in, out, n, shift);
+}
+
+static inline void ShredFloatShiftMantDownArray(const float* in, float* out,
+	size_t n, int shift)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatShiftMantDownArray(in, out, n, shift);
+}
+
+static inline void ShredFloatScalePow2Array(const float* in, float* out,
+	size_t n, int scale)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatScalePow2Array(in, out, n, scale);
+}
+
+// one ShredClass per float, as a byte
+static inline void ShredFloatClassifyArray(const float* in, uint8_t* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatClassifyArray(in, out, n);
+}
+
+/*
+	`masks` is SHRED_CLASS_COUNT pointers, indexed by ShredClass, each
+	either NULL or room for ShredSignPlaneSize(n) bytes.
+*/
+static inline void ShredFloatClassifyMasks(const float* in, size_t n,
+	uint8_t* const* masks)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatClassifyMasks(in, n, masks);
+}
+
+// `counts` is SHRED_CLASS_COUNT totals, indexed by ShredClass
+static inline void ShredFloatClassCount(const float* in, size_t n,
+	size_t* counts)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatClassCount(in, n, counts);
+}
+
+/*
+	ShredFloatByteSwap on every float. This doesn't count towards
+	SHRED_STATS, since until they're swapped the floats don't mean anything.
+*/
+static inline void ShredFloatByteSwapArray(const float* in, float* out,
+	size_t n)
+{
+	ShredDispatch()->ShredFloatByteSwapArray(in, out, n);
+}
+
+// see ShredFloatSummary
+static inline void ShredFloatSummarize(const float* in, size_t n,
+	ShredFloatSummary* summary)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatSummarize(in, n, summary);
+}
+
+/*
+	`out` can be NULL to only get the stats, or `stats` to only get the
+	distances. See ShredUlpStats.
+*/
+static inline void ShredFloatUlpDistanceArray(const float* a, const float* b,
+	uint32_t* out, size_t n, ShredUlpStats* stats)
+{
+	SHRED_STATS_BATCH(Float, a, n);
+	ShredDispatch()->ShredFloatUlpDistanceArray(a, b, out, n, stats);
+}
+
+static inline void ShredFloatStepUlpsArray(const float* in, float* out,
+	size_t n, int32_t steps)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatStepUlpsArray(in, out, n, steps);
+}
+
+// endian is the byte order of the keys, see ShredFloatToOrderedKey
+static inline void ShredFloatToOrderedKeyArray(const float* in, uint32_t* out,
+	size_t n, ShredEndian endian)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatToOrderedKeyArray(in, out, n, endian);
+}
+
+static inline void ShredFloatToCanonicalKeyArray(const float* in,
+	uint32_t* out, size_t n, ShredEndian endian)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatToCanonicalKeyArray(in, out, n, endian);
+}
+
+static inline void ShredFloatFromOrderedKeyArray(const uint32_t* in,
+	float* out, size_t n, ShredEndian endian)
+{
+	ShredDispatch()->ShredFloatFromOrderedKeyArray(in, out, n, endian);
+}
+
+// see ShredTruncateStats, stats can be NULL
+static inline void ShredFloatTruncateMantissaArray(const float* in,
+	float* out, size_t n, int bits, ShredTruncateStats* stats)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatTruncateMantissaArray(in, out, n, bits, stats);
+}
+
+// see ShredApprox for the accuracies
+static inline void ShredFloatLog2ApproxArray(const float* in, float* out,
+	size_t n, ShredApprox accuracy)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatLog2ApproxArray(in, out, n, accuracy);
+}
+
+static inline void ShredFloatExp2ApproxArray(const float* in, float* out,
+	size_t n, ShredApprox accuracy)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatExp2ApproxArray(in, out, n, accuracy);
+}
+
+static inline void ShredFloatSqrtApproxArray(const float* in, float* out,
+	size_t n, ShredApprox accuracy)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatSqrtApproxArray(in, out, n, accuracy);
+}
+
+static inline void ShredFloatRsqrtApproxArray(const float* in, float* out,
+	size_t n, ShredApprox accuracy)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatRsqrtApproxArray(in, out, n, accuracy);
+}
+
+/*
+	The double versions of the batch functions. These don't have their own
+	SIMD kernels, they're just the plain loops, but the loops are simple
+	enough that compilers vectorize them by themselves at -O3.
+*/
+static inline void ShredDoubleToDataArray(const double* in, uint64_t* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	memmove(out, in, n * sizeof(double));
+}
+
+static inline void ShredDataToDoubleArray(const uint64_t* in, double* out,
+	size_t n)
+{
+	memmove(out, in, n * sizeof(double));
+}
+
+static inline void ShredDoubleExpUnbiasedArray(const double* in,
+	uint64_t* out, size_t n)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleExpUnbiasedArray_scalar(in, out, n);
+}
+
+static inline void ShredDoubleExpUnbiasedRawArray(const double* in,
+	uint64_t* out, size_t n)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleExpUnbiasedRawArray_scalar(in, out, n);
+}
+
+static inline void ShredDoubleExpArray(const double* in, int64_t* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleExpArray_scalar(in, out, n);
+}
+
+static inline void ShredDoubleExpRawArray(const double* in, int64_t* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleExpRawArray_scalar(in, out, n);
+}
+
+static inline void ShredDoubleMantissaRawArray(const double* in,
+	uint64_t* out, size_t n)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleMantissaRawArray_scalar(in, out, n);
+}
+
+static inline void ShredDoubleMantissaArray(const double* in, double* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleMantissaArray_scalar(in, out, n);
+}
+
+static inline void ShredDoubleIsNegativeArray(const double* in, bool* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleIsNegativeArray_scalar(in, out, n);
+}
+
+static inline void ShredDoubleShiftExpUpArray(const double* in, double* out,
+	size_t n, int shift)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleShiftExpUpArray_scalar(in, out, n, shift);
+}
+
+static inline void ShredDoubleShiftExpDownArray(const double* in,
+	double* out, size_t n, int shift)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleShiftExpDownArray_scalar(in, out, n, shift);
+}
+
+static inline void ShredDoubleShiftMantUpArray(const double* in, double* out,
+	size_t n, int shift)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleShiftMantUpArray_scalar(in, out, n, shift);
+}
+
+static inline void ShredDoubleShiftMantDownArray(const double* in,
+	double* out, size_t n, int shift)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleShiftMantDownArray_scalar(in, out, n, shift);
+}
+
+static inline void ShredDoubleScalePow2Array(const double* in, double* out,
+	size_t n, int scale)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleScalePow2Array_scalar(in, out, n, scale);
+}
+
+static inline void ShredDoubleClassifyArray(const double* in, uint8_t* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleClassifyArray_scalar(in, out, n);
+}
+
+static inline void ShredDoubleClassifyMasks(const double* in, size_t n,
+	uint8_t* const* masks)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleClassifyMasks_scalar(in, n, masks);
+}
+
+static inline void ShredDoubleClassCount(const double* in, size_t n,
+	size_t* counts)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleClassCount_scalar(in, n, counts);
+}
+
+static inline void ShredDoubleByteSwapArray(const double* in, double* out,
+	size_t n)
+{
+	ShredDoubleByteSwapArray_scalar(in, out, n);
+}
+
+static inline void ShredDoubleSummarize(const double* in, size_t n,
+	ShredDoubleSummary* summary)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleSummarize_scalar(in, n, summary);
+}
+
+static inline void ShredDoubleUlpDistanceArray(const double* a,
+	const double* b, uint64_t* out, size_t n, ShredUlpStats* stats)
+{
+	SHRED_STATS_BATCH(Double, a, n);
+	ShredDoubleUlpDistanceArray_scalar(a, b, out, n, stats);
+}
+
+static inline void ShredDoubleStepUlpsArray(const double* in, double* out,
+	size_t n, int64_t steps)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleStepUlpsArray_scalar(in, out, n, steps);
+}
+
+static inline void ShredDoubleToOrderedKeyArray(const double* in,
+	uint64_t* out, size_t n, ShredEndian endian)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleToOrderedKeyArray_scalar(in, out, n, endian);
+}
+
+static inline void ShredDoubleToCanonicalKeyArray(const double* in,
+	uint64_t* out, size_t n, ShredEndian endian)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleToCanonicalKeyArray_scalar(in, out, n, endian);
+}
+
+static inline void ShredDoubleFromOrderedKeyArray(const uint64_t* in,
+	double* out, size_t n, ShredEndian endian)
+{
+	ShredDoubleFromOrderedKeyArray_scalar(in, out, n, endian);
+}
+
+static inline void ShredDoubleTruncateMantissaArray(const double* in,
+	double* out, size_t n, int bits, ShredTruncateStats* stats)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleTruncateMantissaArray_scalar(in, out, n, bits, stats);
+}
+
+/*
+	Bulk conversions between float and the 16-bit formats, with the same
+	rounding as the scalar versions. Where the CPU can convert halves itself
+	(F16C, AVX-512, AArch64) that gets used, bfloat16 is handled with
+	integer SIMD everywhere since it's only a rounding and a shift.
+*/
+static inline void ShredFloatToHalfArray(const float* in, ShredHalf* out,
+	size_t n)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatToHalfArray(in, out, n);
+}
+
+static inline void ShredHalfToFloatArray(const ShredHalf* in, float* out,
+	size_t n)
+{
+	ShredDispatch()->ShredHalfToFloatArray(in, out, n);
+}
+
+static inline void ShredFloatToBFloat16Array(const float* in,
+	ShredBFloat16* out, size_t n)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatToBFloat16Array(in, out, n);
+}
+
+static inline void ShredBFloat16ToFloatArray(const ShredBFloat16* in,
+	float* out, size_t n)
+{
+	ShredDispatch()->ShredBFloat16ToFloatArray(in, out, n);
+}
+
+/*
+	See ShredFloatSplitPlanes_scalar for the layout. `signs` needs room for
+	ShredSignPlaneSize(n) bytes.
+*/
+static inline void ShredFloatSplitPlanes(const float* in, size_t n,
+	uint8_t* signs, uint8_t* exponents, uint32_t* mantissas)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatSplitPlanes(in, n, signs, exponents, mantissas);
+}
+
+static inline void ShredFloatJoinPlanes(const uint8_t* signs,
+	const uint8_t* exponents, const uint32_t* mantissas, size_t n,
+	float* out)
+{
+	ShredDispatch()->ShredFloatJoinPlanes(signs, exponents, mantissas, n, out);
+}
+
+/*
+	See SHRED_DEFINE_SHUFFLE_LOOPS for the layouts. The byte shuffled
+	buffer is n * sizeof(float) bytes, the bit shuffled one is
+	ShredBitShuffleSize(n, float_bit_width), which is a little more when n
+	isn't a multiple of 8. Shuffling and unshuffling again always gives back
+	exactly the same bits.
+*/
+static inline size_t ShredBitShuffleSize(size_t n, int bit_width)
+{
+	return ShredSignPlaneSize(n) * (size_t)bit_width;
+}
+
+static inline void ShredFloatByteShuffle(const float* in, size_t n,
+	uint8_t* out)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatByteShuffle(in, n, out);
+}
+
+static inline void ShredFloatByteUnshuffle(const uint8_t* in, size_t n,
+	float* out)
+{
+	ShredDispatch()->ShredFloatByteUnshuffle(in, n, out);
+}
+
+static inline void ShredFloatBitShuffle(const float* in, size_t n,
+	uint8_t* out)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatBitShuffle(in, n, out);
+}
+
+static inline void ShredFloatBitUnshuffle(const uint8_t* in, size_t n,
+	float* out)
+{
+	ShredDispatch()->ShredFloatBitUnshuffle(in, n, out);
+}
+
+static inline void ShredDoubleByteShuffle(const double* in, size_t n,
+	uint8_t* out)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleByteShuffle_scalar(in, n, out);
+}
+
+static inline void ShredDoubleByteUnshuffle(const uint8_t* in, size_t n,
+	double* out)
+{
+	ShredDoubleByteUnshuffle_scalar(in, n, out);
+}
+
+static inline void ShredDoubleBitShuffle(const double* in, size_t n,
+	uint8_t* out)
+{
+	SHRED_STATS_BATCH(Double, in, n);
+	ShredDoubleBitShuffle_scalar(in, n, out);
+}
+
+static inline void ShredDoubleBitUnshuffle(const uint8_t* in, size_t n,
+	double* out)
+{
+	ShredDoubleBitUnshuffle_scalar(in, n, out);
+}
+
+/*
+	Batch functions for floats in a foreign byte order, such as a dump from
+	a big-endian instrument read on a little-endian machine. Each takes the
+	byte order `in` is in and does the same as the function it's named
+	after, so ShredFloatExpArrayEndian(in, out, n, SHRED_ENDIAN_BIG) is the
+	exponents of big-endian floats.
+
+	In the native byte order it's just the normal function. Otherwise the
+	floats get swapped SHRED_SWAP_BLOCK at a time into a buffer on the
+	stack, which is small enough to stay in L1, and the normal kernel runs
+	on that. So there's still only the one pass over the data in memory,
+	instead of one to swap it all and another to look at it.
+*/
+#ifndef SHRED_SWAP_BLOCK
+#define SHRED_SWAP_BLOCK 1024
+#endif
+#if SHRED_SWAP_BLOCK % 8 != 0
+#error SHRED_SWAP_BLOCK has to be a multiple of 8
+#endif
+
+// ToData doesn't have a kernel of its own, it's only a copy
+static inline void ShredFloatToDataArray_scalar(const float* in,
+	uint32_t* out, size_t n)
+{
+	memcpy(out, in, n * sizeof(float));
+}
+
+static inline void ShredDoubleToDataArray_scalar(const double* in,
+	uint64_t* out, size_t n)
+{
+	memcpy(out, in, n * sizeof(double));
+}
+
+#define SHRED_DEFINE_ENDIAN_ARRAY(Name, real_t, func, out_t, swap, kernel) \
+static inline void Shred##Name##func##Endian(const real_t* in, out_t* out, \
+	size_t n, ShredEndian endian) \
+{ \
+	if(ShredEndianIsNative(endian)) \
+	{ \
+		Shred##Name##func(in, out, n); \
+		return; \
+	} \
+	SHRED_STATS_ADD(batch_calls, 1); \
+	real_t block[SHRED_SWAP_BLOCK]; \
+	for(size_t i = 0; i < n; i += SHRED_SWAP_BLOCK) \
+	{ \
+		size_t count = n - i < SHRED_SWAP_BLOCK ? n - i : SHRED_SWAP_BLOCK; \
+		swap(in + i, block, count); \
+		SHRED_STATS_FLOATS(Name, block, count); \
+		kernel(block, out + i, count); \
+	} \
+}
+
+/*
+	kernel turns a function's name into whatever runs its kernel, which is
+	the dispatch table for floats and the plain loops for doubles.
+*/
+#define SHRED_DEFINE_ENDIAN_ARRAYS(Name, real_t, bits_t, sbits_t, kernel) \
+	SHRED_DEFINE_ENDIAN_ARRAY(Name, real_t, ToDataArray, bits_t, \
+		kernel(Shred##Name##ByteSwapArray), \
+		Shred##Name##ToDataArray_scalar) \
+	SHRED_DEFINE_ENDIAN_ARRAY(Name, real_t, ExpUnbiasedArray, bits_t, \
+		kernel(Shred##Name##ByteSwapArray), \
+		kernel(Shred##Name##ExpUnbiasedArray)) \
+	SHRED_DEFINE_ENDIAN_ARRAY(Name, real_t, ExpUnbiasedRawArray, bits_t, \
+		kernel(Shred##Name##ByteSwapArray), \
+		kernel(Shred##Name##ExpUnbiasedRawArray)) \
+	SHRED_DEFINE_ENDIAN_ARRAY(Name, real_t, ExpArray, sbits_t, \
+		kernel(Shred##Name##ByteSwapArray), kernel(Shred##Name##ExpArray)) \
+	SHRED_DEFINE_ENDIAN_ARRAY(Name, real_t, ExpRawArray, sbits_t, \
+		kernel(Shred##Name##ByteSwapArray), \
+		kernel(Shred##Name##ExpRawArray)) \
+	SHRED_DEFINE_ENDIAN_ARRAY(Name, real_t, MantissaRawArray, bits_t, \
+		kernel(Shred##Name##ByteSwapArray), \
+		kernel(Shred##Name##MantissaRawArray)) \
+	SHRED_DEFINE_ENDIAN_ARRAY(Name, real_t, MantissaArray, real_t, \
+		kernel(Shred##Name##ByteSwapArray), \
+		kernel(Shred##Name##MantissaArray)) \
+	SHRED_DEFINE_ENDIAN_ARRAY(Name, real_t, IsNegativeArray, bool, \
+		kernel(Shred##Name##ByteSwapArray), \
+		kernel(Shred##Name##IsNegativeArray)) \
+	SHRED_DEFINE_ENDIAN_ARRAY(Name, real_t, ClassifyArray, uint8_t, \
+		kernel(Shred##Name##ByteSwapArray), \
+		kernel(Shred##Name##ClassifyArray)) \
+\
+static inline void Shred##Name##ClassCountEndian(const real_t* in, size_t n, \
+	size_t* counts, ShredEndian endian) \
+{ \
+	if(ShredEndianIsNative(endian)) \
+	{ \
+		Shred##Name##ClassCount(in, n, counts); \
+		return; \
+	} \
+	SHRED_STATS_ADD(batch_calls, 1); \
+	for(int k = 0; k < SHRED_CLASS_COUNT; k++) \
+	{ \
+		counts[k] = 0; \
+	} \
+	real_t block[SHRED_SWAP_BLOCK]; \
+	for(size_t i = 0; i < n; i += SHRED_SWAP_BLOCK) \
+	{ \
+		size_t count = n - i < SHRED_SWAP_BLOCK ? n - i : SHRED_SWAP_BLOCK; \
+		size_t block_counts[SHRED_CLASS_COUNT]; \
+		kernel(Shred##Name##ByteSwapArray)(in + i, block, count); \
+		SHRED_STATS_FLOATS(Name, block, count); \
+		kernel(Shred##Name##ClassCount)(block, count, block_counts); \
+		for(int k = 0; k < SHRED_CLASS_COUNT; k++) \
+		{ \
+			counts[k] += block_counts[k]; \
+		} \
+	} \
+}
+
+#define SHRED_ENDIAN_FLOAT_KERNEL(func) ShredDispatch()->func
+#define SHRED_ENDIAN_DOUBLE_KERNEL(func) func##_scalar
+
+SHRED_DEFINE_ENDIAN_ARRAYS(Float, float, uint32_t, int32_t,
+	SHRED_ENDIAN_FLOAT_KERNEL)
+SHRED_DEFINE_ENDIAN_ARRAYS(Double, double, uint64_t, int64_t,
+	SHRED_ENDIAN_DOUBLE_KERNEL)
+
+/*
+	SplitPlanes straight from foreign floats, which is what a ShredBuffer
+	gets filled with. SHRED_SWAP_BLOCK is a multiple of 8, so every block
+	starts on a whole byte of the sign plane.
+*/
+static inline void ShredFloatSplitPlanesEndian(const float* in, size_t n,
+	uint8_t* signs, uint8_t* exponents, uint32_t* mantissas,
+	ShredEndian endian)
+{
+	if(ShredEndianIsNative(endian))
+	{
+		ShredFloatSplitPlanes(in, n, signs, exponents, mantissas);
+		return;
+	}
+	SHRED_STATS_ADD(batch_calls, 1);
+	float block[SHRED_SWAP_BLOCK];
+	for(size_t i = 0; i < n; i += SHRED_SWAP_BLOCK)
+	{
+		size_t count = n - i < SHRED_SWAP_BLOCK ? n - i : SHRED_SWAP_BLOCK;
+		ShredDispatch()->ShredFloatByteSwapArray(in + i, block, count);
+		SHRED_STATS_FLOATS(Float, block, count);
+		ShredDispatch()->ShredFloatSplitPlanes(block, count, signs + i / 8,
+			exponents + i, mantissas + i);
+	}
+}
+
+/*
+	Block floating point, see SHRED_DEFINE_BLOCK_LOOPS for the format.
+	bits out of range gets clamped to it.
+*/
+static inline int ShredBlockBits(int bits, int most)
+{
+	return bits < 3 ? 3 : bits > most ? most : bits;
+}
+
+static inline void ShredFloatToBlockInt8(const float* in, size_t n,
+	size_t block_size, int bits, uint8_t* exps, int8_t* out)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatToBlockInt8(in, n,
+		block_size ? block_size : SHRED_BLOCK_DEFAULT, ShredBlockBits(bits, 8),
+		exps, out);
+}
+
+static inline void ShredBlockInt8ToFloat(const uint8_t* exps,
+	const int8_t* in, size_t n, size_t block_size, int bits, float* out)
+{
+	ShredDispatch()->ShredBlockInt8ToFloat(exps, in, n,
+		block_size ? block_size : SHRED_BLOCK_DEFAULT, ShredBlockBits(bits, 8),
+		out);
+}
+
+static inline void ShredFloatToBlockInt16(const float* in, size_t n,
+	size_t block_size, int bits, uint8_t* exps, int16_t* out)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	ShredDispatch()->ShredFloatToBlockInt16(in, n,
+		block_size ? block_size : SHRED_BLOCK_DEFAULT,
+		ShredBlockBits(bits, 16), exps, out);
+}
+
+static inline void ShredBlockInt16ToFloat(const uint8_t* exps,
+	const int16_t* in, size_t n, size_t block_size, int bits, float* out)
+{
+	ShredDispatch()->ShredBlockInt16ToFloat(exps, in, n,
+		block_size ? block_size : SHRED_BLOCK_DEFAULT,
+		ShredBlockBits(bits, 16), out);
+}
+
+/*
+	A ShredBuffer holds a batch of floats already shredded into separate
+	sign, exponent and mantissa planes (structure of arrays), so a pass that
+	only cares about one of the fields only has to read that one plane.
+
+	ShredBufferInit allocates room for `capacity` floats, ShredBufferShred
+	fills it in one pass over the input and ShredBufferReassemble turns it
+	back into floats. A buffer can be shredded into over and over as long as
+	each batch fits.
+*/
+typedef struct ShredBuffer
+{
+	size_t count;
+	size_t capacity;
+	uint8_t* signs;
+	uint8_t* exponents;
+	uint32_t* mantissas;
+} ShredBuffer;
+
+static inline void ShredBufferFree(ShredBuffer* buffer)
+{
+	free(buffer->signs);
+	free(buffer->exponents);
+	free(buffer->mantissas);
+	buffer->signs = NULL;
+	buffer->exponents = NULL;
+	buffer->mantissas = NULL;
+	buffer->count = 0;
+	buffer->capacity = 0;
+}
+
+// returns false (with the buffer left empty) if the allocation fails
+static inline bool ShredBufferInit(ShredBuffer* buffer, size_t capacity)
+{
+	buffer->count = 0;
+	buffer->capacity = capacity;
+	// malloc(0) is allowed to return NULL, so always ask for something
+	buffer->signs = (uint8_t*)malloc(ShredSignPlaneSize(capacity) + 1);
+	buffer->exponents = (uint8_t*)malloc(capacity + 1);
+	buffer->mantissas = (uint32_t*)malloc((capacity + 1) * sizeof(uint32_t));
+	if(!buffer->signs || !buffer->exponents || !buffer->mantissas)
+	{
+		ShredBufferFree(buffer);
+		return false;
+	}
+	return true;
+}
+
+// returns false if n floats won't fit in the buffer
+static inline bool ShredBufferShred(ShredBuffer* buffer, const float* in,
+	size_t n)
+{
+	if(n > buffer->capacity)
+	{
+		return false;
+	}
+	ShredFloatSplitPlanes(in, n, buffer->signs, buffer->exponents,
+		buffer->mantissas);
+	buffer->count = n;
+	return true;
+}
+
+// `out` needs room for buffer->count floats
+static inline void ShredBufferReassemble(const ShredBuffer* buffer, float* out)
+{
+	ShredFloatJoinPlanes(buffer->signs, buffer->exponents, buffer->mantissas,
+		buffer->count, out);
+}
+
+static inline bool ShredBufferIsNegative(const ShredBuffer* buffer, size_t i)
+{
+	return (buffer->signs[i / 8] >> (i % 8)) & 1;
+}
+
+/*
+	Exponent and mantissa histograms.
+
+	A ShredHistogram counts how many floats it has seen with each biased
+	exponent (the 256 values of ShredFloatExpUnbiased, so bin 0 is zeros and
+	subnormals and bin 255 is infs and NaNs), and optionally how many had
+	each value of the top `mantissa_bits` bits of the mantissa.
+
+	Counting is the slow part of a histogram, not pulling the fields out.
+	Real data tends to sit in a handful of binades, so a naive loop spends
+	most of its time incrementing the same counter over and over, and every
+	increment has to wait for the store of the previous one. To get around
+	that the counting goes into 4 separate sets of 32-bit sub-counters, with
+	neighbouring floats going to different sets, and the sets get folded
+	into the 64-bit totals at the end of every ShredHistogramAdd (or every
+	SHRED_HISTOGRAM_BLOCK floats, so the sub-counters can never overflow).
+	Folding has to go over every bin, though, which is 2^18 of them with
+	16 mantissa bits, so batches smaller than the sub-counters go straight
+	into the totals instead. Adding or removing a few floats then costs
+	those few floats, whatever mantissa_bits is.
+
+	Histograms with the same mantissa_bits can be added together with
+	ShredHistogramMerge, which is how the multithreaded version in
+	float_shredder_threads.h puts its per-thread histograms back together.
+*/
+#define SHRED_HISTOGRAM_SETS 4
+#define SHRED_HISTOGRAM_EXP_BINS 256
+#define SHRED_HISTOGRAM_MAX_MANTISSA_BITS 16
+#define SHRED_HISTOGRAM_BLOCK ((size_t)1 << 30)
+
+typedef struct ShredHistogram
+{
+	uint64_t count;
+	uint64_t exponents[SHRED_HISTOGRAM_EXP_BINS];
+	int mantissa_bits;
+	// 1 << mantissa_bits bins, indexed by the top bits of the mantissa
+	uint64_t* mantissas;
+	// the sub-counters, SHRED_HISTOGRAM_SETS of each of the above
+	uint32_t* scratch;
+} ShredHistogram;
+
+static inline size_t ShredHistogramMantissaBins(const ShredHistogram* hist)
+{
+	return (size_t)1 << hist->mantissa_bits;
+}
+
+static inline void ShredHistogramFree(ShredHistogram* hist)
+{
+	free(hist->mantissas);
+	free(hist->scratch);
+	hist->mantissas = NULL;
+	hist->scratch = NULL;
+	hist->count = 0;
+}
+
+static inline void ShredHistogramClear(ShredHistogram* hist)
+{
+	hist->count = 0;
+	memset(hist->exponents, 0, sizeof(hist->exponents));
+	memset(hist->mantissas, 0,
+		ShredHistogramMantissaBins(hist) * sizeof(uint64_t));
+}
+
+/*
+	mantissa_bits can be anywhere from 0 (no mantissa histogram, which still
+	leaves you with one bin holding the total) to
+	SHRED_HISTOGRAM_MAX_MANTISSA_BITS. Returns false (with the histogram left
+	empty) if it's out of range or the allocation fails.
+*/
+static inline bool ShredHistogramInit(ShredHistogram* hist, int mantissa_bits)
+{
+	hist->mantissas = NULL;
+	hist->scratch = NULL;
+	hist->mantissa_bits = mantissa_bits;
+	if(mantissa_bits < 0 || mantissa_bits > SHRED_HISTOGRAM_MAX_MANTISSA_BITS)
+	{
+		hist->mantissa_bits = 0;
+		ShredHistogramFree(hist);
+		return false;
+	}
+	size_t bins = ShredHistogramMantissaBins(hist);
+	hist->mantissas = (uint64_t*)malloc(bins * sizeof(uint64_t));
+	hist->scratch = (uint32_t*)calloc(SHRED_HISTOGRAM_SETS *
+		(SHRED_HISTOGRAM_EXP_BINS + bins), sizeof(uint32_t));
+	if(!hist->mantissas || !hist->scratch)
+	{
+		ShredHistogramFree(hist);
+		return false;
+	}
+	ShredHistogramClear(hist);
+	return true;
+}
+
+/*
+	adds the sub-counters into the totals and zeroes them again, or takes
+	them off the totals when they counted floats being removed
+*/
+static inline void ShredHistogramFold(ShredHistogram* hist, bool remove)
+{
+	size_t bins = ShredHistogramMantissaBins(hist);
+	uint32_t* exps = hist->scratch;
+	uint32_t* mants = hist->scratch +
+		SHRED_HISTOGRAM_SETS * SHRED_HISTOGRAM_EXP_BINS;
+	for(int set = 0; set < SHRED_HISTOGRAM_SETS; set++)
+	{
+		// adding the two's complement takes the counts off instead
+		uint64_t sign = remove ? ~(uint64_t)0 : 0;
+		for(size_t bin = 0; bin < SHRED_HISTOGRAM_EXP_BINS; bin++)
+		{
+			hist->exponents[bin] += ((uint64_t)exps[bin] ^ sign) - sign;
+		}
+		for(size_t bin = 0; bin < bins; bin++)
+		{
+			hist->mantissas[bin] += ((uint64_t)mants[bin] ^ sign) - sign;
+		}
+		exps += SHRED_HISTOGRAM_EXP_BINS;
+		mants += bins;
+	}
+	memset(hist->scratch, 0, SHRED_HISTOGRAM_SETS *
+		(SHRED_HISTOGRAM_EXP_BINS + bins) * sizeof(uint32_t));
+}
+
+static inline void ShredHistogramCount(ShredHistogram* hist, const float* in,
+	size_t n)
+{
+	size_t bins = ShredHistogramMantissaBins(hist);
+	int mant_shift = float_mantissa_bits - hist->mantissa_bits;
+	uint32_t* exps0 = hist->scratch;
+	uint32_t* exps1 = exps0 + SHRED_HISTOGRAM_EXP_BINS;
+	uint32_t* exps2 = exps1 + SHRED_HISTOGRAM_EXP_BINS;
+	uint32_t* exps3 = exps2 + SHRED_HISTOGRAM_EXP_BINS;
+	uint32_t* mants0 = exps3 + SHRED_HISTOGRAM_EXP_BINS;
+	uint32_t* mants1 = mants0 + bins;
+	uint32_t* mants2 = mants1 + bins;
+	uint32_t* mants3 = mants2 + bins;
+
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+	{
+		uint32_t a = ShredFloatToData(in[i]);
+		uint32_t b = ShredFloatToData(in[i + 1]);
+		uint32_t c = ShredFloatToData(in[i + 2]);
+		uint32_t d = ShredFloatToData(in[i + 3]);
+		exps0[(a & float_exp_mask) >> float_exp_offset]++;
+		exps1[(b & float_exp_mask) >> float_exp_offset]++;
+		exps2[(c & float_exp_mask) >> float_exp_offset]++;
+		exps3[(d & float_exp_mask) >> float_exp_offset]++;
+		mants0[(a & float_mantissa_mask) >> mant_shift]++;
+		mants1[(b & float_mantissa_mask) >> mant_shift]++;
+		mants2[(c & float_mantissa_mask) >> mant_shift]++;
+		mants3[(d & float_mantissa_mask) >> mant_shift]++;
+	}
+	for(; i < n; i++)
+	{
+		uint32_t a = ShredFloatToData(in[i]);
+		exps0[(a & float_exp_mask) >> float_exp_offset]++;
+		mants0[(a & float_mantissa_mask) >> mant_shift]++;
+	}
+}
+
+// one float at a time into the totals, for batches too small to fold
+static inline void ShredHistogramCountDirect(ShredHistogram* hist,
+	const float* in, size_t n, bool remove)
+{
+	int mant_shift = float_mantissa_bits - hist->mantissa_bits;
+	uint64_t add = remove ? ~(uint64_t)0 : 1;
+	for(size_t i = 0; i < n; i++)
+	{
+		uint32_t a = ShredFloatToData(in[i]);
+		hist->exponents[(a & float_exp_mask) >> float_exp_offset] += add;
+		hist->mantissas[(a & float_mantissa_mask) >> mant_shift] += add;
+	}
+}
+
+static inline void ShredHistogramUpdate(ShredHistogram* hist,
+	const float* in, size_t n, bool remove)
+{
+	SHRED_STATS_BATCH(Float, in, n);
+	hist->count = remove ? hist->count - n : hist->count + n;
+	if(n < SHRED_HISTOGRAM_SETS * (SHRED_HISTOGRAM_EXP_BINS +
+		ShredHistogramMantissaBins(hist)))
+	{
+		ShredHistogramCountDirect(hist, in, n, remove);
+		return;
+	}
+	while(n > 0)
+	{
+		size_t block = n < SHRED_HISTOGRAM_BLOCK ? n : SHRED_HISTOGRAM_BLOCK;
+		ShredHistogramCount(hist, in, block);
+		ShredHistogramFold(hist, remove);
+		in += block;
+		n -= block;
+	}
+}
+
+// counts n more floats into the histogram
+static inline void ShredHistogramAdd(ShredHistogram* hist, const float* in,
+	size_t n)
+{
+	ShredHistogramUpdate(hist, in, n, false);
+}
+
+/*
+	takes n floats that were added before back out, for sliding windows:
+	add what came in and remove what fell off the end, and the histogram is
+	always of the window without going over it again. Removing floats that
+	were never added leaves the counts wrapped around.
+*/
+static inline void ShredHistogramRemove(ShredHistogram* hist,
+	const float* in, size_t n)
+{
+	ShredHistogramUpdate(hist, in, n, true);
+}
+
+// adds src's counts to dst, returns false if their mantissa_bits differ
+static inline bool ShredHistogramMerge(ShredHistogram* dst,
+	const ShredHistogram* src)
+{
+	if(dst->mantissa_bits != src->mantissa_bits)
+	{
+		return false;
+	}
+	size_t bins = ShredHistogramMantissaBins(dst);
+	dst->count += src->count;
+	for(size_t bin = 0; bin < SHRED_HISTOGRAM_EXP_BINS; bin++)
+	{
+		dst->exponents[bin] += src->exponents[bin];
+	}
+	for(size_t bin = 0; bin < bins; bin++)
+	{
+		dst->mantissas[bin] += src->mantissas[bin];
+	}
+	return true;
+}
+
+// takes src's counts back off dst, returns false if their mantissa_bits differ
+static inline bool ShredHistogramSubtract(ShredHistogram* dst,
+	const ShredHistogram* src)
+{
+	if(dst->mantissa_bits != src->mantissa_bits)
+	{
+		return false;
+	}
+	size_t bins = ShredHistogramMantissaBins(dst);
+	dst->count -= src->count;
+	for(size_t bin = 0; bin < SHRED_HISTOGRAM_EXP_BINS; bin++)
+	{
+		dst->exponents[bin] -= src->exponents[bin];
+	}
+	for(size_t bin = 0; bin < bins; bin++)
+	{
+		dst->mantissas[bin] -= src->mantissas[bin];
+	}
+	return true;
+}
+
+/*
+	A running ShredFloatSummary of a window that floats get added to and
+	removed from, so a growing or sliding buffer doesn't have to be
+	summarized all over again on every update. ShredFloatTallyAdd takes the
+	floats that came in and ShredFloatTallyRemove the ones that fell out,
+	each costing one pass over just those floats, and ShredFloatTallySummary
+	fills in the summary of whatever's in the window now.
+
+	The counts and the sum come off again exactly the way they went on,
+	but a min or max can't be taken back off, since there's no telling
+	what the next smallest one was. So the tally also counts floats by sign
+	and exponent, which keeps exp_min and exp_max exact, and a min that
+	gets removed is replaced by the bottom of the lowest binade that still
+	has anything in it (the same for max). It's a bound then rather than a
+	value in the window, and ShredFloatTallySummary returns false, until
+	something at least as small gets added again. Summarizing the window
+	from scratch gets the exact one. The sum of a window that's had a lot
+	go through it can drift a little from a fresh one, since every add
+	and remove rounds, but it goes back to exactly 0 whenever the window
+	has no finite floats left.
+
+	Tallies are plain structs (4 KiB for floats, 32 KiB for doubles) with
+	nothing to free. Set one up with ShredFloatTallyClear, and only remove
+	floats that were added, or the counts wrap around.
+*/
+// floats summarized and binned at a time, small enough to stay in L1
+#ifndef SHRED_TALLY_BLOCK
+#define SHRED_TALLY_BLOCK 2048
+#endif
+
+#define SHRED_DEFINE_TALLY(Name, real_t, bits_t, sbits_t, prefix, exp_bins) \
+typedef struct Shred##Name##Tally \
+{ \
+	Shred##Name##SummaryAcc acc; \
+	bool min_exact; \
+	bool max_exact; \
+	/* the floats that aren't NaN, by sign and biased exponent */ \
+	uint64_t bins[2 * (exp_bins)]; \
+} Shred##Name##Tally; \
+\
+static inline void Shred##Name##TallyClear(Shred##Name##Tally* tally) \
+{ \
+	memset(tally, 0, sizeof(*tally)); \
+	Shred##Name##SummaryStart(&tally->acc); \
+	tally->min_exact = true; \
+	tally->max_exact = true; \
+} \
+\
+/* \
+	Summarizes in a block at a time into total, and counts each block into \
+	the bins (or takes it off them) while it's still in L1, so the floats \
+	only come in from memory once. The sum goes straight into the tally's, \
+	block by block, so total's isn't used. \
+*/ \
+static inline void Shred##Name##TallyCount(Shred##Name##Tally* tally, \
+	const real_t* in, size_t n, bool remove, Shred##Name##Summary* total) \
+{ \
+	uint64_t add = remove ? ~(uint64_t)0 : 1; \
+	Shred##Name##SummaryClear(total); \
+	for(size_t first = 0; first < n; first += SHRED_TALLY_BLOCK) \
+	{ \
+		const real_t* block = in + first; \
+		size_t len = n - first < SHRED_TALLY_BLOCK ? n - first : \
+			SHRED_TALLY_BLOCK; \
+		Shred##Name##Summary summary; \
+		Shred##Name##Summarize(block, len, &summary); \
+		for(size_t i = 0; i < len; i++) \
+		{ \
+			bits_t data = Shred##Name##ToData(block[i]); \
+			if((data & ~prefix##_sign_mask) <= prefix##_exp_mask) \
+			{ \
+				tally->bins[data >> prefix##_exp_offset] += add; \
+			} \
+		} \
+		ShredKahanAdd(&tally->acc.sum, &tally->acc.comp, \
+			remove ? -summary.sum : summary.sum); \
+		Shred##Name##SummaryMerge(total, &summary); \
+	} \
+} \
+\
+static inline void Shred##Name##TallyAdd(Shred##Name##Tally* tally, \
+	const real_t* in, size_t n) \
+{ \
+	Shred##Name##SummaryAcc* acc = &tally->acc; \
+	Shred##Name##Summary summary; \
+	Shred##Name##TallyCount(tally, in, n, false, &summary); \
+	acc->count += summary.count; \
+	acc->nans += summary.nans; \
+	acc->infs += summary.infs; \
+	acc->negatives += summary.negatives; \
+	acc->negative_zeros += summary.negative_zeros; \
+	if(Shred##Name##Classify(summary.min) == SHRED_CLASS_NAN) \
+	{ \
+		return; \
+	} \
+	/* \
+		anything at or below the old min, removed or not, is below \
+		everything still in the window, so it's the exact min again \
+	*/ \
+	sbits_t key_min = Shred##Name##SummaryKey( \
+		Shred##Name##ToData(summary.min)); \
+	sbits_t key_max = Shred##Name##SummaryKey( \
+		Shred##Name##ToData(summary.max)); \
+	if(key_min <= acc->key_min) \
+	{ \
+		acc->key_min = key_min; \
+		tally->min_exact = true; \
+	} \
+	if(key_max >= acc->key_max) \
+	{ \
+		acc->key_max = key_max; \
+		tally->max_exact = true; \
+	} \
+} \
+\
+static inline void Shred##Name##TallyRemove(Shred##Name##Tally* tally, \
+	const real_t* in, size_t n) \
+{ \
+	Shred##Name##SummaryAcc* acc = &tally->acc; \
+	Shred##Name##Summary summary; \
+	Shred##Name##TallyCount(tally, in, n, true, &summary); \
+	acc->count -= summary.count; \
+	acc->nans -= summary.nans; \
+	acc->infs -= summary.infs; \
+	acc->negatives -= summary.negatives; \
+	acc->negative_zeros -= summary.negative_zeros; \
+	if(acc->count == acc->nans + acc->infs) \
+	{ \
+		/* no finite floats left, so whatever the sum drifted to goes */ \
+		acc->sum = 0.0; \
+		acc->comp = 0.0; \
+	} \
+	if(acc->count == acc->nans) \
+	{ \
+		/* nothing left to have a min or max, so they start over */ \
+		acc->key_min = (sbits_t)(~(bits_t)0 >> 1); \
+		acc->key_max = -acc->key_min - 1; \
+		tally->min_exact = true; \
+		tally->max_exact = true; \
+		return; \
+	} \
+	if(Shred##Name##Classify(summary.min) == SHRED_CLASS_NAN) \
+	{ \
+		return; \
+	} \
+	if(Shred##Name##SummaryKey(Shred##Name##ToData(summary.min)) <= \
+		acc->key_min) \
+	{ \
+		tally->min_exact = false; \
+	} \
+	if(Shred##Name##SummaryKey(Shred##Name##ToData(summary.max)) >= \
+		acc->key_max) \
+	{ \
+		tally->max_exact = false; \
+	} \
+} \
+\
+/* \
+	Returns whether min and max are exact, rather than bounds. Bin b is \
+	sign b / exp_bins and biased exponent b % exp_bins, and the bins \
+	between the negative infinities at the top and the positive ones at \
+	exp_bins - 1 are in order of the floats in them, tops first for the \
+	negatives. \
+*/ \
+static inline bool Shred##Name##TallySummary(const Shred##Name##Tally* tally, \
+	Shred##Name##Summary* summary) \
+{ \
+	Shred##Name##SummaryAcc acc = tally->acc; \
+	const uint64_t* bins = tally->bins; \
+	const uint64_t* negative_bins = tally->bins + (exp_bins); \
+	bits_t top = (bits_t)(exp_bins) - 1; \
+	acc.exp_min = top; \
+	acc.exp_max = 0; \
+	for(bits_t exp = 0; exp < top; exp++) \
+	{ \
+		if(bins[exp] || negative_bins[exp]) \
+		{ \
+			acc.exp_min = exp < acc.exp_min ? exp : acc.exp_min; \
+			acc.exp_max = exp; \
+		} \
+	} \
+	bits_t low = 0; \
+	bits_t high = 0; \
+	bool any = false; \
+	for(bits_t b = 0; b < 2 * (bits_t)(exp_bins); b++) \
+	{ \
+		/* walk the bins from -infinity up */ \
+		bits_t bin = b < (exp_bins) ? 2 * (exp_bins) - 1 - b : \
+			b - (exp_bins); \
+		if(tally->bins[bin]) \
+		{ \
+			low = any ? low : bin; \
+			high = bin; \
+			any = true; \
+		} \
+	} \
+	if(!any) \
+	{ \
+		Shred##Name##SummaryStart(&acc); \
+		acc.count = tally->acc.count; \
+		acc.nans = tally->acc.nans; \
+		acc.negatives = tally->acc.negatives; \
+		Shred##Name##SummaryFinish(&acc, summary); \
+		return true; \
+	} \
+	bits_t mantissas = prefix##_mantissa_mask; \
+	if(!tally->min_exact) \
+	{ \
+		/* a negative bin's biggest magnitude, a positive one's smallest */ \
+		bits_t data = (low << prefix##_exp_offset) | \
+			(low >= (exp_bins) && (low & top) != top ? mantissas : 0); \
+		sbits_t key = Shred##Name##SummaryKey(data); \
+		acc.key_min = key > acc.key_min ? key : acc.key_min; \
+	} \
+	if(!tally->max_exact) \
+	{ \
+		bits_t data = (high << prefix##_exp_offset) | \
+			(high < (exp_bins) && high != top ? mantissas : 0); \
+		sbits_t key = Shred##Name##SummaryKey(data); \
+		acc.key_max = key < acc.key_max ? key : acc.key_max; \
+	} \
+	Shred##Name##SummaryFinish(&acc, summary); \
+	return tally->min_exact && tally->max_exact; \
+}
 
+SHRED_DEFINE_TALLY(Float, float, uint32_t, int32_t, float, 256)
+SHRED_DEFINE_TALLY(Double, double, uint64_t, int64_t, double, 2048)
 
 #endif
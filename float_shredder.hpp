@@ -0,0 +1,624 @@
+#ifndef float_shredder_hpp
+#define float_shredder_hpp
+
+/*
+	C++20 on top of float_shredder.h: the batch functions over std::span,
+	and lazy pipelines that chain them without going over memory more than
+	once.
+
+		std::vector<int32_t> exps(data.size());
+		shred::store(shred::view(data) | shred::truncate(8) |
+			shred::scale_pow2(-3) | shred::exponent(), exps);
+
+	shred::view(data) doesn't copy anything, it's a view of the floats
+	like a std::span, and every | adds a step to it and gives back another
+	view. Nothing runs until something reads from the end of it, and then
+	there are two ways it can.
+
+	Used as a range (a range-for, std::ranges::copy, indexing it), each
+	element gets read from the data and pushed through every step with the
+	scalar functions, one element at a time. That's a single loop with
+	nothing stored in between, and the steps get inlined into it, bar the
+	approximations under GCC, which won't inline them into code that's
+	allowed to fuse multiplies and adds.
+
+	shred::store(pipeline, out) goes through the data SHRED_PIPELINE_BLOCK
+	elements at a time instead, running each step's SIMD batch kernel on
+	the block. The blocks stay in L1 on their way from one step to the next,
+	so it's still one pass over memory, and the last step writes straight
+	into out. That's the one to use for big arrays.
+
+	Both give the same results, which are the same bits the C functions
+	give, whatever the instruction set. That includes the approximations,
+	since they're built without FP contraction everywhere (see
+	SHRED_NO_CONTRACT_BEGIN).
+
+	The steps that turn floats into something else (exponent, mantissa_raw,
+	classify...) have to go last, since the others only take floats or
+	doubles. Doubles only ever use the scalar loops, like the C versions.
+	The span functions have the same names as the steps, with the input and
+	output spans first: shred::truncate(in, out, 8). Each one writes
+	min(in.size(), out.size()) results and returns how many that was.
+*/
+#include "float_shredder.h"
+
+#if __cplusplus < 202002L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)
+#error "float_shredder.hpp needs C++20, float_shredder.h works with any C++"
+#endif
+
+#include <algorithm>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <type_traits>
+
+#ifndef SHRED_PIPELINE_BLOCK
+#define SHRED_PIPELINE_BLOCK 1024
+#endif
+
+namespace shred
+{
+
+template <typename T>
+concept real = std::same_as<T, float> || std::same_as<T, double>;
+
+template <real T> using bits_t = typename ShredTraits<T>::bits_type;
+template <real T> using sbits_t = typename ShredTraits<T>::signed_bits_type;
+
+/*
+	A step is a struct with the type it turns a T into as result_type<T>,
+	the scalar version as operator(), and the batch version as batch. They
+	get made by the functions of the same name below rather than directly.
+*/
+template <typename Op, typename T>
+concept step = requires(const Op op, T x, const T* in, std::size_t n)
+{
+	typename Op::template result_type<T>;
+	{ op(x) } -> std::same_as<typename Op::template result_type<T>>;
+	op.batch(in, (typename Op::template result_type<T>*)nullptr, n);
+};
+
+/*
+	The steps that are just a C function and its Array version, with
+	`result` being what they turn a T into. The span functions that go with
+	them are stamped out here too, since those can't be templates if
+	they're going to take vectors and arrays.
+*/
+#define SHRED_HPP_SPANS(name, args, params) \
+inline std::size_t name(std::span<const float> in, \
+	std::span<typename name##_step::template result_type<float>> out \
+	params) \
+{ \
+	std::size_t n = std::min(in.size(), out.size()); \
+	name(args).batch(in.data(), out.data(), n); \
+	return n; \
+} \
+\
+inline std::size_t name(std::span<const double> in, \
+	std::span<typename name##_step::template result_type<double>> out \
+	params) \
+{ \
+	std::size_t n = std::min(in.size(), out.size()); \
+	name(args).batch(in.data(), out.data(), n); \
+	return n; \
+}
+
+#define SHRED_HPP_COMMA ,
+
+#define SHRED_HPP_MAP(name, Func, result) \
+struct name##_step \
+{ \
+	template <real T> using result_type = result; \
+\
+	template <real T> constexpr result_type<T> operator()(T x) const \
+	{ \
+		if constexpr(std::same_as<T, float>) \
+		{ \
+			return (result_type<T>)ShredFloat##Func(x); \
+		} else { \
+			return (result_type<T>)ShredDouble##Func(x); \
+		} \
+	} \
+\
+	template <real T> void batch(const T* in, result_type<T>* out, \
+		std::size_t n) const \
+	{ \
+		if constexpr(std::same_as<T, float>) \
+		{ \
+			ShredFloat##Func##Array(in, out, n); \
+		} else { \
+			ShredDouble##Func##Array(in, out, n); \
+		} \
+	} \
+}; \
+\
+constexpr name##_step name() \
+{ \
+	return {}; \
+} \
+\
+SHRED_HPP_SPANS(name, , )
+
+// the same, for the ones that take an int (a shift, a scale, some bits)
+#define SHRED_HPP_MAP_ARG(name, Func, arg_t) \
+struct name##_step \
+{ \
+	arg_t arg; \
+\
+	template <real T> using result_type = T; \
+\
+	template <real T> constexpr T operator()(T x) const \
+	{ \
+		if constexpr(std::same_as<T, float>) \
+		{ \
+			return ShredFloat##Func(x, arg); \
+		} else { \
+			return ShredDouble##Func(x, arg); \
+		} \
+	} \
+\
+	template <real T> void batch(const T* in, T* out, std::size_t n) const \
+	{ \
+		if constexpr(std::same_as<T, float>) \
+		{ \
+			ShredFloat##Func##Array(in, out, n, arg); \
+		} else { \
+			ShredDouble##Func##Array(in, out, n, arg); \
+		} \
+	} \
+}; \
+\
+constexpr name##_step name(arg_t arg) \
+{ \
+	return {arg}; \
+} \
+\
+SHRED_HPP_SPANS(name, arg, SHRED_HPP_COMMA arg_t arg)
+
+SHRED_HPP_MAP(exponent, Exp, sbits_t<T>)
+SHRED_HPP_MAP(exponent_raw, ExpRaw, sbits_t<T>)
+SHRED_HPP_MAP(exponent_unbiased, ExpUnbiased, bits_t<T>)
+SHRED_HPP_MAP(exponent_unbiased_raw, ExpUnbiasedRaw, bits_t<T>)
+SHRED_HPP_MAP(mantissa, Mantissa, T)
+SHRED_HPP_MAP(mantissa_raw, MantissaRaw, bits_t<T>)
+SHRED_HPP_MAP(is_negative, IsNegative, bool)
+// uint8_t rather than ShredClass, so it's the same as the arrays
+SHRED_HPP_MAP(classify, Classify, uint8_t)
+SHRED_HPP_MAP(byte_swap, ByteSwap, T)
+
+SHRED_HPP_MAP_ARG(scale_pow2, ScalePow2, int)
+SHRED_HPP_MAP_ARG(shift_exp_up, ShiftExpUp, int)
+SHRED_HPP_MAP_ARG(shift_exp_down, ShiftExpDown, int)
+SHRED_HPP_MAP_ARG(shift_mant_up, ShiftMantUp, int)
+SHRED_HPP_MAP_ARG(shift_mant_down, ShiftMantDown, int)
+
+#undef SHRED_HPP_MAP
+#undef SHRED_HPP_MAP_ARG
+
+// these don't quite fit the pattern, so they're written out
+
+// ShredFloatTruncateMantissa, rounding away the low `bits` mantissa bits
+struct truncate_step
+{
+	int bits;
+
+	template <real T> using result_type = T;
+
+	template <real T> constexpr T operator()(T x) const
+	{
+		if constexpr(std::same_as<T, float>)
+		{
+			return ShredFloatTruncateMantissa(x, bits);
+		} else {
+			return ShredDoubleTruncateMantissa(x, bits);
+		}
+	}
+
+	template <real T> void batch(const T* in, T* out, std::size_t n) const
+	{
+		if constexpr(std::same_as<T, float>)
+		{
+			ShredFloatTruncateMantissaArray(in, out, n, bits, NULL);
+		} else {
+			ShredDoubleTruncateMantissaArray(in, out, n, bits, NULL);
+		}
+	}
+};
+
+constexpr truncate_step truncate(int bits)
+{
+	return {bits};
+}
+
+SHRED_HPP_SPANS(truncate, bits, SHRED_HPP_COMMA int bits)
+
+// ShredFloatStepUlps, which takes an int64_t for doubles
+struct step_ulps_step
+{
+	int64_t steps;
+
+	template <real T> using result_type = T;
+
+	// the float versions take an int32_t, and clamping keeps a step too
+	// big for it from wrapping round to a small or backwards one
+	constexpr int32_t float_steps() const
+	{
+		return (int32_t)std::clamp<int64_t>(steps, INT32_MIN, INT32_MAX);
+	}
+
+	template <real T> constexpr T operator()(T x) const
+	{
+		if constexpr(std::same_as<T, float>)
+		{
+			return ShredFloatStepUlps(x, float_steps());
+		} else {
+			return ShredDoubleStepUlps(x, steps);
+		}
+	}
+
+	template <real T> void batch(const T* in, T* out, std::size_t n) const
+	{
+		if constexpr(std::same_as<T, float>)
+		{
+			ShredFloatStepUlpsArray(in, out, n, float_steps());
+		} else {
+			ShredDoubleStepUlpsArray(in, out, n, steps);
+		}
+	}
+};
+
+constexpr step_ulps_step step_ulps(int64_t steps)
+{
+	return {steps};
+}
+
+SHRED_HPP_SPANS(step_ulps, steps, SHRED_HPP_COMMA int64_t steps)
+
+// ShredFloatToOrderedKey, or ToCanonicalKey if canonical is true
+struct ordered_key_step
+{
+	bool canonical;
+
+	template <real T> using result_type = bits_t<T>;
+
+	template <real T> constexpr bits_t<T> operator()(T x) const
+	{
+		if constexpr(std::same_as<T, float>)
+		{
+			return canonical ? ShredFloatToCanonicalKey(x) :
+				ShredFloatToOrderedKey(x);
+		} else {
+			return canonical ? ShredDoubleToCanonicalKey(x) :
+				ShredDoubleToOrderedKey(x);
+		}
+	}
+
+	template <real T> void batch(const T* in, bits_t<T>* out,
+		std::size_t n) const
+	{
+		if constexpr(std::same_as<T, float>)
+		{
+			(canonical ? ShredFloatToCanonicalKeyArray :
+				ShredFloatToOrderedKeyArray)(in, out, n, SHRED_ENDIAN_NATIVE);
+		} else {
+			(canonical ? ShredDoubleToCanonicalKeyArray :
+				ShredDoubleToOrderedKeyArray)(in, out, n, SHRED_ENDIAN_NATIVE);
+		}
+	}
+};
+
+constexpr ordered_key_step ordered_key(bool canonical = false)
+{
+	return {canonical};
+}
+
+SHRED_HPP_SPANS(ordered_key, canonical, SHRED_HPP_COMMA bool canonical = false)
+
+// the approximations, which only come in float
+#define SHRED_HPP_APPROX(name, Func) \
+struct name##_step \
+{ \
+	ShredApprox accuracy; \
+\
+	template <std::same_as<float> T> using result_type = float; \
+\
+	template <std::same_as<float> T> constexpr float operator()(T x) const \
+	{ \
+		return ShredFloat##Func(x, accuracy); \
+	} \
+\
+	template <std::same_as<float> T> void batch(const T* in, float* out, \
+		std::size_t n) const \
+	{ \
+		ShredFloat##Func##Array(in, out, n, accuracy); \
+	} \
+}; \
+\
+constexpr name##_step name(ShredApprox accuracy = SHRED_APPROX_FULL) \
+{ \
+	return {accuracy}; \
+} \
+\
+inline std::size_t name(std::span<const float> in, std::span<float> out, \
+	ShredApprox accuracy = SHRED_APPROX_FULL) \
+{ \
+	std::size_t n = std::min(in.size(), out.size()); \
+	name(accuracy).batch(in.data(), out.data(), n); \
+	return n; \
+}
+
+SHRED_HPP_APPROX(log2_approx, Log2Approx)
+SHRED_HPP_APPROX(exp2_approx, Exp2Approx)
+SHRED_HPP_APPROX(sqrt_approx, SqrtApprox)
+SHRED_HPP_APPROX(rsqrt_approx, RsqrtApprox)
+
+#undef SHRED_HPP_APPROX
+#undef SHRED_HPP_SPANS
+#undef SHRED_HPP_COMMA
+
+// ShredFloatSummarize over a span
+inline ShredFloatSummary summarize(std::span<const float> in)
+{
+	ShredFloatSummary summary;
+	ShredFloatSummarize(in.data(), in.size(), &summary);
+	return summary;
+}
+
+inline ShredDoubleSummary summarize(std::span<const double> in)
+{
+	ShredDoubleSummary summary;
+	ShredDoubleSummarize(in.data(), in.size(), &summary);
+	return summary;
+}
+
+/*
+	The pipelines. Every stage has element(i), its i-th result worked out
+	with the scalar functions, and fill(first, n, buffer), which puts
+	results first to first + n into buffer (n is never more than
+	SHRED_PIPELINE_BLOCK) and returns where they ended up. For the source
+	that's the data itself, so nothing gets copied.
+*/
+template <typename Stage>
+class iterator
+{
+public:
+	using iterator_concept = std::random_access_iterator_tag;
+	using iterator_category = std::input_iterator_tag;
+	using value_type = typename Stage::value_type;
+	using difference_type = std::ptrdiff_t;
+
+	constexpr iterator() = default;
+	constexpr iterator(const Stage* stage, std::size_t index) :
+		stage_(stage), index_(index) {}
+
+	constexpr value_type operator*() const
+	{
+		return stage_->element(index_);
+	}
+
+	constexpr value_type operator[](difference_type offset) const
+	{
+		return stage_->element(index_ + offset);
+	}
+
+	constexpr iterator& operator++()
+	{
+		index_++;
+		return *this;
+	}
+
+	constexpr iterator operator++(int)
+	{
+		iterator old = *this;
+		index_++;
+		return old;
+	}
+
+	constexpr iterator& operator--()
+	{
+		index_--;
+		return *this;
+	}
+
+	constexpr iterator operator--(int)
+	{
+		iterator old = *this;
+		index_--;
+		return old;
+	}
+
+	constexpr iterator& operator+=(difference_type offset)
+	{
+		index_ += offset;
+		return *this;
+	}
+
+	constexpr iterator& operator-=(difference_type offset)
+	{
+		index_ -= offset;
+		return *this;
+	}
+
+	friend constexpr iterator operator+(iterator it, difference_type offset)
+	{
+		return it += offset;
+	}
+
+	friend constexpr iterator operator+(difference_type offset, iterator it)
+	{
+		return it += offset;
+	}
+
+	friend constexpr iterator operator-(iterator it, difference_type offset)
+	{
+		return it -= offset;
+	}
+
+	friend constexpr difference_type operator-(const iterator& a,
+		const iterator& b)
+	{
+		return (difference_type)a.index_ - (difference_type)b.index_;
+	}
+
+	friend constexpr bool operator==(const iterator& a, const iterator& b)
+	{
+		return a.index_ == b.index_;
+	}
+
+	friend constexpr auto operator<=>(const iterator& a, const iterator& b)
+	{
+		return a.index_ <=> b.index_;
+	}
+
+private:
+	const Stage* stage_ = nullptr;
+	std::size_t index_ = 0;
+};
+
+template <real T>
+class source : public std::ranges::view_interface<source<T>>
+{
+public:
+	using value_type = T;
+
+	constexpr source() = default;
+	constexpr explicit source(std::span<const T> data) : data_(data) {}
+
+	// the span's own iterators, so they don't depend on the view staying
+	// around (which is what makes it a borrowed range, like std::span)
+	constexpr typename std::span<const T>::iterator begin() const
+	{
+		return data_.begin();
+	}
+
+	constexpr typename std::span<const T>::iterator end() const
+	{
+		return data_.end();
+	}
+
+	constexpr std::size_t size() const
+	{
+		return data_.size();
+	}
+
+	constexpr T element(std::size_t i) const
+	{
+		return data_[i];
+	}
+
+	const T* fill(std::size_t first, std::size_t, T*) const
+	{
+		return data_.data() + first;
+	}
+
+private:
+	std::span<const T> data_;
+};
+
+template <typename Source, typename Step>
+class pipeline : public std::ranges::view_interface<pipeline<Source, Step>>
+{
+public:
+	using input_type = typename Source::value_type;
+	using value_type = typename Step::template result_type<input_type>;
+
+	constexpr pipeline() = default;
+	constexpr pipeline(const Source& source, const Step& step) :
+		source_(source), step_(step) {}
+
+	constexpr iterator<pipeline> begin() const
+	{
+		return {this, 0};
+	}
+
+	constexpr iterator<pipeline> end() const
+	{
+		return {this, source_.size()};
+	}
+
+	constexpr std::size_t size() const
+	{
+		return source_.size();
+	}
+
+	constexpr value_type element(std::size_t i) const
+	{
+		return step_(source_.element(i));
+	}
+
+	const value_type* fill(std::size_t first, std::size_t n,
+		value_type* buffer) const
+	{
+		input_type block[SHRED_PIPELINE_BLOCK];
+		step_.batch(source_.fill(first, n, block), buffer, n);
+		return buffer;
+	}
+
+private:
+	Source source_;
+	Step step_;
+};
+
+template <typename T> struct is_stage : std::false_type {};
+template <real T> struct is_stage<source<T>> : std::true_type {};
+template <typename Source, typename Step>
+struct is_stage<pipeline<Source, Step>> : std::true_type {};
+
+template <typename Stage>
+concept stage = is_stage<Stage>::value;
+
+inline source<float> view(std::span<const float> data)
+{
+	return source<float>(data);
+}
+
+inline source<double> view(std::span<const double> data)
+{
+	return source<double>(data);
+}
+
+template <stage Source, step<typename Source::value_type> Step>
+constexpr pipeline<Source, Step> operator|(const Source& source,
+	const Step& step)
+{
+	return pipeline<Source, Step>(source, step);
+}
+
+/*
+	Runs the whole pipeline a block at a time with the batch kernels and
+	writes its results to out. Returns how many that was, which is the
+	smaller of the two sizes.
+*/
+template <stage Stage>
+std::size_t store(const Stage& stage,
+	std::span<typename Stage::value_type> out)
+{
+	using value_type = typename Stage::value_type;
+	std::size_t n = std::min(stage.size(), out.size());
+	for(std::size_t first = 0; first < n; first += SHRED_PIPELINE_BLOCK)
+	{
+		std::size_t count = std::min(n - first,
+			(std::size_t)SHRED_PIPELINE_BLOCK);
+		value_type* dst = out.data() + first;
+		const value_type* results = stage.fill(first, count, dst);
+		// only a bare view gives back its own data
+		if(results != dst)
+		{
+			std::copy(results, results + count, dst);
+		}
+	}
+	return n;
+}
+
+}
+
+// a source only holds a span, so its iterators outlive it just the same
+template <typename T>
+inline constexpr bool std::ranges::enable_borrowed_range<shred::source<T>> =
+	true;
+
+#endif
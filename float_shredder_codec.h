@@ -0,0 +1,361 @@
+#ifndef float_shredder_codec
+#define float_shredder_codec
+
+#include "float_shredder.h"
+
+/*
+	Lossless compression for float time series, Gorilla style.
+
+	Neighbouring values in a time series tend to share their sign, exponent
+	and the top of their mantissa, so XORing each float's raw data with the
+	previous one's leaves mostly zeros with a short run of meaningful bits
+	in the middle. Each value is stored as just that run:
+
+	0				same as the previous value
+	10 <bits>			the meaningful bits fit in the same window
+					(leading and trailing zero counts) as the
+					last value that had its own window, so only
+					the bits inside that window get stored
+	11 <lead:5> <len-1:5> <bits>	a new window, `lead` leading zeros and
+					`len` meaningful bits after them
+
+	Bits go most significant first.
+
+	The stream is cut into blocks of block_size floats that each start over
+	from a raw first value, and there's an index of where each block starts
+	at the front, so blocks can be decoded on their own and in any order
+	(see ShredGorillaDecodeParallel in float_shredder_threads.h). Bigger
+	blocks compress a little better, smaller ones split across more threads.
+
+	The layout, all integers little endian:
+
+	"SHG1"			magic
+	uint32_t		block_size
+	uint64_t		count, the number of floats
+	uint64_t[blocks + 1]	byte offset of each block from the start of the
+				stream, followed by the offset of the end
+	blocks
+	8 zero bytes		so the decoder can always read a whole 64-bit
+				word at a time without running off the end
+*/
+#define SHRED_GORILLA_MAGIC "SHG1"
+#define SHRED_GORILLA_HEADER 16
+#define SHRED_GORILLA_PADDING 8
+#define SHRED_GORILLA_DEFAULT_BLOCK 4096
+
+static inline void ShredPutLE32(uint8_t* p, uint32_t x)
+{
+	for(int i = 0; i < 4; i++)
+	{
+		p[i] = (uint8_t)(x >> (8 * i));
+	}
+}
+
+static inline void ShredPutLE64(uint8_t* p, uint64_t x)
+{
+	for(int i = 0; i < 8; i++)
+	{
+		p[i] = (uint8_t)(x >> (8 * i));
+	}
+}
+
+static inline uint32_t ShredGetLE32(const uint8_t* p)
+{
+	uint32_t x = 0;
+	for(int i = 0; i < 4; i++)
+	{
+		x |= (uint32_t)p[i] << (8 * i);
+	}
+	return x;
+}
+
+static inline uint64_t ShredGetLE64(const uint8_t* p)
+{
+	uint64_t x = 0;
+	for(int i = 0; i < 8; i++)
+	{
+		x |= (uint64_t)p[i] << (8 * i);
+	}
+	return x;
+}
+
+static inline size_t ShredGorillaBlockCount(size_t n, size_t block_size)
+{
+	return n / block_size + (n % block_size != 0);
+}
+
+/*
+	The most bytes ShredGorillaEncode can write for n floats, which is what
+	`out` needs room for. The worst case is 44 bits a value.
+*/
+static inline size_t ShredGorillaBound(size_t n, size_t block_size)
+{
+	if(block_size == 0)
+	{
+		block_size = SHRED_GORILLA_DEFAULT_BLOCK;
+	}
+	size_t blocks = ShredGorillaBlockCount(n, block_size);
+	return SHRED_GORILLA_HEADER + (blocks + 1) * 8 + n * 6 + blocks +
+		SHRED_GORILLA_PADDING;
+}
+
+// most significant bit first bit writer
+typedef struct ShredBitWriter
+{
+	uint8_t* out;
+	uint64_t acc;
+	int bits;
+} ShredBitWriter;
+
+// n is at most 32
+static inline void ShredBitPut(ShredBitWriter* writer, uint32_t value, int n)
+{
+	writer->acc = (writer->acc << n) | value;
+	writer->bits += n;
+	while(writer->bits >= 8)
+	{
+		writer->bits -= 8;
+		*writer->out++ = (uint8_t)(writer->acc >> writer->bits);
+	}
+}
+
+static inline void ShredBitFlush(ShredBitWriter* writer)
+{
+	if(writer->bits > 0)
+	{
+		*writer->out++ = (uint8_t)(writer->acc << (8 - writer->bits));
+		writer->bits = 0;
+	}
+}
+
+// encodes one block, returns where it ended
+static inline uint8_t* ShredGorillaEncodeBlock(const float* in, size_t n,
+	uint8_t* out)
+{
+	ShredBitWriter writer;
+	writer.out = out;
+	writer.acc = 0;
+	writer.bits = 0;
+
+	uint32_t prev = ShredFloatToData(in[0]);
+	ShredBitPut(&writer, prev, 32);
+	int window_lead = 0;
+	int window_len = 0;
+	for(size_t i = 1; i < n; i++)
+	{
+		uint32_t data = ShredFloatToData(in[i]);
+		uint32_t x = data ^ prev;
+		prev = data;
+		if(!x)
+		{
+			ShredBitPut(&writer, 0, 1);
+			continue;
+		}
+		int lead = ShredClz32(x);
+		int trail = ShredCtz32(x);
+		int window_trail = 32 - window_lead - window_len;
+		if(window_len && lead >= window_lead && trail >= window_trail)
+		{
+			ShredBitPut(&writer, 2, 2);
+			ShredBitPut(&writer, x >> window_trail, window_len);
+			continue;
+		}
+		window_lead = lead;
+		window_len = 32 - lead - trail;
+		ShredBitPut(&writer, (3 << 10) | ((uint32_t)lead << 5) |
+			(uint32_t)(window_len - 1), 12);
+		ShredBitPut(&writer, x >> trail, window_len);
+	}
+	ShredBitFlush(&writer);
+	return writer.out;
+}
+
+/*
+	Compresses n floats into `out`, which needs ShredGorillaBound(n,
+	block_size) bytes, and returns how many bytes it actually used.
+	block_size 0 means SHRED_GORILLA_DEFAULT_BLOCK.
+*/
+static inline size_t ShredGorillaEncode(const float* in, size_t n,
+	size_t block_size, uint8_t* out)
+{
+	if(block_size == 0)
+	{
+		block_size = SHRED_GORILLA_DEFAULT_BLOCK;
+	}
+	size_t blocks = ShredGorillaBlockCount(n, block_size);
+	memcpy(out, SHRED_GORILLA_MAGIC, 4);
+	ShredPutLE32(out + 4, (uint32_t)block_size);
+	ShredPutLE64(out + 8, (uint64_t)n);
+	uint8_t* index = out + SHRED_GORILLA_HEADER;
+	uint8_t* pos = index + (blocks + 1) * 8;
+	for(size_t b = 0; b < blocks; b++)
+	{
+		size_t first = b * block_size;
+		size_t count = n - first < block_size ? n - first : block_size;
+		ShredPutLE64(index + b * 8, (uint64_t)(pos - out));
+		pos = ShredGorillaEncodeBlock(in + first, count, pos);
+	}
+	ShredPutLE64(index + blocks * 8, (uint64_t)(pos - out));
+	memset(pos, 0, SHRED_GORILLA_PADDING);
+	return (size_t)(pos - out) + SHRED_GORILLA_PADDING;
+}
+
+/*
+	What's in a stream, as read from its header. ShredGorillaOpen returns
+	false if `in` doesn't look like a whole stream, which includes a count
+	that doesn't come to as many blocks as the index has: the first block
+	has to start right where the index ends, and the last one has to end
+	before the padding.
+*/
+typedef struct ShredGorillaInfo
+{
+	size_t count;
+	size_t block_size;
+	size_t blocks;
+} ShredGorillaInfo;
+
+static inline bool ShredGorillaOpen(const uint8_t* in, size_t size,
+	ShredGorillaInfo* info)
+{
+	if(size < SHRED_GORILLA_HEADER + 8 + SHRED_GORILLA_PADDING ||
+		memcmp(in, SHRED_GORILLA_MAGIC, 4) != 0)
+	{
+		return false;
+	}
+	uint64_t block_size = ShredGetLE32(in + 4);
+	uint64_t count = ShredGetLE64(in + 8);
+	if(block_size == 0 || count > SIZE_MAX)
+	{
+		return false;
+	}
+	uint64_t blocks = count / block_size + (count % block_size != 0);
+	if(blocks > (size - SHRED_GORILLA_HEADER) / 8 - 1)
+	{
+		return false;
+	}
+	const uint8_t* index = in + SHRED_GORILLA_HEADER;
+	if(ShredGetLE64(index) != SHRED_GORILLA_HEADER + (blocks + 1) * 8 ||
+		ShredGetLE64(index + blocks * 8) > size - SHRED_GORILLA_PADDING)
+	{
+		return false;
+	}
+	info->count = (size_t)count;
+	info->block_size = (size_t)block_size;
+	info->blocks = (size_t)blocks;
+	return true;
+}
+
+static inline uint64_t ShredGorillaPeek(const uint8_t* in, uint64_t bit)
+{
+	const uint8_t* p = in + (bit >> 3);
+	uint64_t word;
+#if (defined(__GNUC__) || defined(__clang__)) && \
+	defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	memcpy(&word, p, 8);
+	word = __builtin_bswap64(word);
+#else
+	word = 0;
+	for(int i = 0; i < 8; i++)
+	{
+		word = (word << 8) | p[i];
+	}
+#endif
+	return word << (bit & 7);
+}
+
+/*
+	Decodes block `block` of the stream into `out`, which is where float
+	block * block_size of the whole array goes. Returns false if the block
+	is corrupt, but never reads outside of `in` either way.
+*/
+static inline bool ShredGorillaDecodeBlock(const uint8_t* in, size_t size,
+	const ShredGorillaInfo* info, size_t block, float* out)
+{
+	if(block >= info->blocks)
+	{
+		return false;
+	}
+	const uint8_t* index = in + SHRED_GORILLA_HEADER + block * 8;
+	uint64_t start = ShredGetLE64(index);
+	uint64_t end = ShredGetLE64(index + 8);
+	size_t first = block * info->block_size;
+	size_t n = info->count - first < info->block_size ?
+		info->count - first : info->block_size;
+	// the last peek can go up to 8 bytes past the end of the block, into
+	// the next one or the padding
+	if(start > end || end > size - SHRED_GORILLA_PADDING ||
+		end - start < 4)
+	{
+		return false;
+	}
+	uint64_t bit = start * 8;
+	uint64_t end_bit = end * 8;
+
+	uint32_t prev = (uint32_t)(ShredGorillaPeek(in, bit) >> 32);
+	bit += 32;
+	out[0] = ShredDataToFloat(prev);
+	int window_lead = 0;
+	int window_len = 0;
+	for(size_t i = 1; i < n; i++)
+	{
+		if(bit >= end_bit)
+		{
+			return false;
+		}
+		uint64_t word = ShredGorillaPeek(in, bit);
+		if(!(word >> 63))
+		{
+			bit += 1;
+			out[i] = ShredDataToFloat(prev);
+			continue;
+		}
+		uint32_t bits;
+		if(!((word >> 62) & 1))
+		{
+			if(!window_len)
+			{
+				return false;
+			}
+			bits = (uint32_t)((word << 2) >> (64 - window_len));
+			bit += 2 + window_len;
+		} else {
+			window_lead = (int)((word >> 57) & 31);
+			window_len = (int)((word >> 52) & 31) + 1;
+			if(window_lead + window_len > 32)
+			{
+				return false;
+			}
+			bits = (uint32_t)((word << 12) >> (64 - window_len));
+			bit += 12 + window_len;
+		}
+		prev ^= bits << (32 - window_lead - window_len);
+		out[i] = ShredDataToFloat(prev);
+	}
+	return bit <= end_bit;
+}
+
+/*
+	Decodes a whole stream into `out`, which needs room for info.count
+	floats (ShredGorillaOpen tells you how many that is). Returns false if
+	the stream is corrupt.
+*/
+static inline bool ShredGorillaDecode(const uint8_t* in, size_t size,
+	float* out)
+{
+	ShredGorillaInfo info;
+	if(!ShredGorillaOpen(in, size, &info))
+	{
+		return false;
+	}
+	for(size_t b = 0; b < info.blocks; b++)
+	{
+		if(!ShredGorillaDecodeBlock(in, size, &info, b,
+			out + b * info.block_size))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,459 @@
+#ifndef float_shredder_gpu
+#define float_shredder_gpu
+
+#include "float_shredder.h"
+
+/*
+	Device versions of the batch functions, for data that's already on a
+	GPU. It works with CUDA (nvcc) and HIP (hipcc), and has to be included
+	from code they're compiling, since it's made of kernels.
+
+	Everything here is named after the host function it copies with Async on
+	the end, takes a stream as its last argument, and returns the error from
+	launching the kernel. As with any other launch, that's only whether it
+	got queued. Errors from running it turn up at the next synchronization.
+	Nothing here synchronizes except ShredGpuHistogramMerge, which has to
+	wait for the counts before it can read them. So these overlap with
+	anything else on other streams, and run in order with everything on
+	their own.
+
+	Every pointer is device memory and the results are the same bits the
+	host versions give. The scalar functions in float_shredder.h are all
+	__host__ __device__ when built this way, so kernels of your own can call
+	ShredFloatExp and the rest directly too.
+
+	The kernels loop over the array with a stride of the whole grid, which
+	is at most SHRED_GPU_MAX_BLOCKS blocks of SHRED_GPU_THREADS threads.
+*/
+#if !defined(__CUDACC__) && !defined(__HIPCC__)
+#error "float_shredder_gpu.cuh needs to be compiled with nvcc or hipcc"
+#endif
+
+#if defined(__HIPCC__)
+#include <hip/hip_runtime.h>
+typedef hipStream_t ShredGpuStream;
+typedef hipError_t ShredGpuError;
+#define SHRED_GPU_SUCCESS hipSuccess
+#define SHRED_GPU_LAST_ERROR() hipGetLastError()
+#define SHRED_GPU_MALLOC(ptr, size) hipMalloc((void**)(ptr), size)
+#define SHRED_GPU_FREE(ptr) hipFree(ptr)
+#define SHRED_GPU_MEMSET_ASYNC(ptr, size, stream) \
+	hipMemsetAsync(ptr, 0, size, stream)
+#define SHRED_GPU_COPY_TO_HOST_ASYNC(dst, src, size, stream) \
+	hipMemcpyAsync(dst, src, size, hipMemcpyDeviceToHost, stream)
+#define SHRED_GPU_SYNC(stream) hipStreamSynchronize(stream)
+// AMD wavefronts can be 64 wide, but xors under 32 stay within each half
+#define SHRED_GPU_SHUFFLE_XOR(value, lanes) __shfl_xor(value, lanes)
+#else
+#include <cuda_runtime.h>
+typedef cudaStream_t ShredGpuStream;
+typedef cudaError_t ShredGpuError;
+#define SHRED_GPU_SUCCESS cudaSuccess
+#define SHRED_GPU_LAST_ERROR() cudaGetLastError()
+#define SHRED_GPU_MALLOC(ptr, size) cudaMalloc((void**)(ptr), size)
+#define SHRED_GPU_FREE(ptr) cudaFree(ptr)
+#define SHRED_GPU_MEMSET_ASYNC(ptr, size, stream) \
+	cudaMemsetAsync(ptr, 0, size, stream)
+#define SHRED_GPU_COPY_TO_HOST_ASYNC(dst, src, size, stream) \
+	cudaMemcpyAsync(dst, src, size, cudaMemcpyDeviceToHost, stream)
+#define SHRED_GPU_SYNC(stream) cudaStreamSynchronize(stream)
+#define SHRED_GPU_SHUFFLE_XOR(value, lanes) \
+	__shfl_xor_sync(0xFFFFFFFFu, value, lanes)
+#endif
+
+#ifndef SHRED_GPU_THREADS
+#define SHRED_GPU_THREADS 256
+#endif
+#ifndef SHRED_GPU_MAX_BLOCKS
+#define SHRED_GPU_MAX_BLOCKS 4096
+#endif
+// the threads that work on one block of block floats together
+#define SHRED_GPU_GROUP 32
+#if SHRED_GPU_THREADS % SHRED_GPU_GROUP != 0
+#error "SHRED_GPU_THREADS has to be a multiple of SHRED_GPU_GROUP"
+#endif
+
+#define SHRED_GPU_INDEX ((size_t)blockIdx.x * blockDim.x + threadIdx.x)
+#define SHRED_GPU_STRIDE ((size_t)gridDim.x * blockDim.x)
+
+// enough blocks to give every thread one item, up to SHRED_GPU_MAX_BLOCKS
+static inline unsigned int ShredGpuBlocks(size_t items)
+{
+	size_t blocks = (items + SHRED_GPU_THREADS - 1) / SHRED_GPU_THREADS;
+	return (unsigned int)(blocks < SHRED_GPU_MAX_BLOCKS ? blocks :
+		SHRED_GPU_MAX_BLOCKS);
+}
+
+/*
+	The element-wise functions, one element per thread. Func is the scalar
+	function each element goes through and out_t what it hands back (the
+	same as the host Array version's output).
+*/
+#define SHRED_DEFINE_GPU_MAP(Name, real_t, Func, out_t) \
+static __global__ void shred_gpu_##Name##Func(const real_t* in, out_t* out, \
+	size_t n) \
+{ \
+	for(size_t i = SHRED_GPU_INDEX; i < n; i += SHRED_GPU_STRIDE) \
+	{ \
+		out[i] = (out_t)Shred##Name##Func(in[i]); \
+	} \
+} \
+\
+static inline ShredGpuError Shred##Name##Func##ArrayAsync(const real_t* in, \
+	out_t* out, size_t n, ShredGpuStream stream) \
+{ \
+	if(n == 0) \
+	{ \
+		return SHRED_GPU_SUCCESS; \
+	} \
+	shred_gpu_##Name##Func<<<ShredGpuBlocks(n), SHRED_GPU_THREADS, 0, \
+		stream>>>(in, out, n); \
+	return SHRED_GPU_LAST_ERROR(); \
+}
+
+// the same, for the ones with a second argument (a shift, some bits...)
+#define SHRED_DEFINE_GPU_MAP_ARG(Name, real_t, Func, arg_t) \
+static __global__ void shred_gpu_##Name##Func(const real_t* in, real_t* out, \
+	size_t n, arg_t arg) \
+{ \
+	for(size_t i = SHRED_GPU_INDEX; i < n; i += SHRED_GPU_STRIDE) \
+	{ \
+		out[i] = Shred##Name##Func(in[i], arg); \
+	} \
+} \
+\
+static inline ShredGpuError Shred##Name##Func##ArrayAsync(const real_t* in, \
+	real_t* out, size_t n, arg_t arg, ShredGpuStream stream) \
+{ \
+	if(n == 0) \
+	{ \
+		return SHRED_GPU_SUCCESS; \
+	} \
+	shred_gpu_##Name##Func<<<ShredGpuBlocks(n), SHRED_GPU_THREADS, 0, \
+		stream>>>(in, out, n, arg); \
+	return SHRED_GPU_LAST_ERROR(); \
+}
+
+#define SHRED_DEFINE_GPU_MAPS(Name, real_t, bits_t, sbits_t) \
+SHRED_DEFINE_GPU_MAP(Name, real_t, ExpUnbiased, bits_t) \
+SHRED_DEFINE_GPU_MAP(Name, real_t, ExpUnbiasedRaw, bits_t) \
+SHRED_DEFINE_GPU_MAP(Name, real_t, Exp, sbits_t) \
+SHRED_DEFINE_GPU_MAP(Name, real_t, ExpRaw, sbits_t) \
+SHRED_DEFINE_GPU_MAP(Name, real_t, MantissaRaw, bits_t) \
+SHRED_DEFINE_GPU_MAP(Name, real_t, Mantissa, real_t) \
+SHRED_DEFINE_GPU_MAP(Name, real_t, IsNegative, bool) \
+SHRED_DEFINE_GPU_MAP(Name, real_t, Classify, uint8_t) \
+SHRED_DEFINE_GPU_MAP(Name, real_t, ByteSwap, real_t) \
+SHRED_DEFINE_GPU_MAP(Name, real_t, ToOrderedKey, bits_t) \
+SHRED_DEFINE_GPU_MAP(Name, real_t, ToCanonicalKey, bits_t) \
+SHRED_DEFINE_GPU_MAP_ARG(Name, real_t, ShiftExpUp, int) \
+SHRED_DEFINE_GPU_MAP_ARG(Name, real_t, ShiftExpDown, int) \
+SHRED_DEFINE_GPU_MAP_ARG(Name, real_t, ShiftMantUp, int) \
+SHRED_DEFINE_GPU_MAP_ARG(Name, real_t, ShiftMantDown, int) \
+SHRED_DEFINE_GPU_MAP_ARG(Name, real_t, ScalePow2, int) \
+SHRED_DEFINE_GPU_MAP_ARG(Name, real_t, TruncateMantissa, int) \
+SHRED_DEFINE_GPU_MAP_ARG(Name, real_t, StepUlps, sbits_t)
+
+SHRED_DEFINE_GPU_MAPS(Float, float, uint32_t, int32_t)
+SHRED_DEFINE_GPU_MAPS(Double, double, uint64_t, int64_t)
+
+#undef SHRED_DEFINE_GPU_MAPS
+#undef SHRED_DEFINE_GPU_MAP_ARG
+#undef SHRED_DEFINE_GPU_MAP
+
+/*
+	Histograms, with the same bins as ShredHistogram: the biased exponent
+	and the top mantissa_bits bits of the mantissa.
+
+	The counts live on the device, SHRED_HISTOGRAM_EXP_BINS exponent bins
+	and then the mantissa ones, so the same histogram can keep counting
+	batch after batch (or take batches back off again for a sliding
+	window, like ShredHistogramRemove) without coming back to the host.
+	ShredGpuHistogramMerge adds them into a host ShredHistogram when you
+	want to look at them.
+
+	Every thread block counts into 32-bit counters in shared memory first,
+	so the atomics mostly stay on the SM, and then adds those to the 64-bit
+	totals. Mantissa histograms over SHRED_GPU_HISTOGRAM_SHARED_BITS bits
+	don't fit and get counted in the totals directly.
+*/
+#define SHRED_GPU_HISTOGRAM_SHARED_BITS 12
+
+typedef struct ShredGpuHistogram
+{
+	int mantissa_bits;
+	// device memory, SHRED_HISTOGRAM_EXP_BINS + (1 << mantissa_bits) counts
+	unsigned long long* bins;
+} ShredGpuHistogram;
+
+static inline size_t ShredGpuHistogramBins(const ShredGpuHistogram* hist)
+{
+	return SHRED_HISTOGRAM_EXP_BINS + ((size_t)1 << hist->mantissa_bits);
+}
+
+static inline void ShredGpuHistogramFree(ShredGpuHistogram* hist)
+{
+	SHRED_GPU_FREE(hist->bins);
+	hist->bins = NULL;
+}
+
+static inline ShredGpuError ShredGpuHistogramClearAsync(
+	ShredGpuHistogram* hist, ShredGpuStream stream)
+{
+	return SHRED_GPU_MEMSET_ASYNC(hist->bins,
+		ShredGpuHistogramBins(hist) * sizeof(unsigned long long), stream);
+}
+
+/*
+	The same mantissa_bits as ShredHistogramInit. Returns false (with the
+	histogram left empty) if it's out of range or the allocation fails.
+	The clearing is queued on stream.
+*/
+static inline bool ShredGpuHistogramInit(ShredGpuHistogram* hist,
+	int mantissa_bits, ShredGpuStream stream)
+{
+	hist->bins = NULL;
+	hist->mantissa_bits = 0;
+	if(mantissa_bits < 0 || mantissa_bits > SHRED_HISTOGRAM_MAX_MANTISSA_BITS)
+	{
+		return false;
+	}
+	hist->mantissa_bits = mantissa_bits;
+	if(SHRED_GPU_MALLOC(&hist->bins, ShredGpuHistogramBins(hist) *
+		sizeof(unsigned long long)) != SHRED_GPU_SUCCESS)
+	{
+		hist->bins = NULL;
+		return false;
+	}
+	if(ShredGpuHistogramClearAsync(hist, stream) != SHRED_GPU_SUCCESS)
+	{
+		ShredGpuHistogramFree(hist);
+		return false;
+	}
+	return true;
+}
+
+static __global__ void shred_gpu_HistogramCount(const float* in, size_t n,
+	unsigned long long* bins, int mantissa_bits, bool remove)
+{
+	extern __shared__ uint32_t shred_gpu_counts[];
+	size_t mant_bins = (size_t)1 << mantissa_bits;
+	int mant_shift = float_mantissa_bits - mantissa_bits;
+	bool shared_mants = mantissa_bits <= SHRED_GPU_HISTOGRAM_SHARED_BITS;
+	size_t shared_bins = SHRED_HISTOGRAM_EXP_BINS +
+		(shared_mants ? mant_bins : 0);
+	for(size_t bin = threadIdx.x; bin < shared_bins; bin += blockDim.x)
+	{
+		shred_gpu_counts[bin] = 0;
+	}
+	__syncthreads();
+
+	uint32_t* mants = shred_gpu_counts + SHRED_HISTOGRAM_EXP_BINS;
+	// adding the two's complement takes the counts off instead
+	unsigned long long one = remove ? ~0ull : 1ull;
+	for(size_t i = SHRED_GPU_INDEX; i < n; i += SHRED_GPU_STRIDE)
+	{
+		uint32_t data = ShredFloatToData(in[i]);
+		atomicAdd(&shred_gpu_counts[(data & float_exp_mask) >>
+			float_exp_offset], 1u);
+		uint32_t mant = (data & float_mantissa_mask) >> mant_shift;
+		if(shared_mants)
+		{
+			atomicAdd(&mants[mant], 1u);
+		} else {
+			atomicAdd(&bins[SHRED_HISTOGRAM_EXP_BINS + mant], one);
+		}
+	}
+	__syncthreads();
+
+	for(size_t bin = threadIdx.x; bin < shared_bins; bin += blockDim.x)
+	{
+		unsigned long long count = shred_gpu_counts[bin];
+		if(count)
+		{
+			atomicAdd(&bins[bin], remove ? 0ull - count : count);
+		}
+	}
+}
+
+/*
+	Counts the floats in in, or takes them back off when remove is true,
+	the same as ShredHistogramUpdate.
+*/
+static inline ShredGpuError ShredGpuHistogramUpdateAsync(
+	ShredGpuHistogram* hist, const float* in, size_t n, bool remove,
+	ShredGpuStream stream)
+{
+	if(n == 0)
+	{
+		return SHRED_GPU_SUCCESS;
+	}
+	bool shared_mants = hist->mantissa_bits <= SHRED_GPU_HISTOGRAM_SHARED_BITS;
+	size_t shared = (SHRED_HISTOGRAM_EXP_BINS +
+		(shared_mants ? (size_t)1 << hist->mantissa_bits : 0)) *
+		sizeof(uint32_t);
+	shred_gpu_HistogramCount<<<ShredGpuBlocks(n), SHRED_GPU_THREADS, shared,
+		stream>>>(in, n, hist->bins, hist->mantissa_bits, remove);
+	return SHRED_GPU_LAST_ERROR();
+}
+
+static inline ShredGpuError ShredGpuHistogramAddAsync(ShredGpuHistogram* hist,
+	const float* in, size_t n, ShredGpuStream stream)
+{
+	return ShredGpuHistogramUpdateAsync(hist, in, n, false, stream);
+}
+
+static inline ShredGpuError ShredGpuHistogramRemoveAsync(
+	ShredGpuHistogram* hist, const float* in, size_t n, ShredGpuStream stream)
+{
+	return ShredGpuHistogramUpdateAsync(hist, in, n, true, stream);
+}
+
+/*
+	Waits for stream and adds src's counts to dst, like ShredHistogramMerge.
+	Returns false if their mantissa_bits differ or the copy fails, leaving
+	dst as it was.
+*/
+static inline bool ShredGpuHistogramMerge(ShredHistogram* dst,
+	const ShredGpuHistogram* src, ShredGpuStream stream)
+{
+	if(dst->mantissa_bits != src->mantissa_bits)
+	{
+		return false;
+	}
+	size_t bins = ShredGpuHistogramBins(src);
+	unsigned long long* counts =
+		(unsigned long long*)malloc(bins * sizeof(unsigned long long));
+	if(!counts)
+	{
+		return false;
+	}
+	if(SHRED_GPU_COPY_TO_HOST_ASYNC(counts, src->bins,
+		bins * sizeof(unsigned long long), stream) != SHRED_GPU_SUCCESS ||
+		SHRED_GPU_SYNC(stream) != SHRED_GPU_SUCCESS)
+	{
+		free(counts);
+		return false;
+	}
+	for(size_t bin = 0; bin < SHRED_HISTOGRAM_EXP_BINS; bin++)
+	{
+		// every float lands in exactly one exponent bin
+		dst->count += counts[bin];
+		dst->exponents[bin] += counts[bin];
+	}
+	for(size_t bin = SHRED_HISTOGRAM_EXP_BINS; bin < bins; bin++)
+	{
+		dst->mantissas[bin - SHRED_HISTOGRAM_EXP_BINS] += counts[bin];
+	}
+	free(counts);
+	return true;
+}
+
+/*
+	Block floating point, the same format as ShredFloatToBlockInt8 (see
+	SHRED_DEFINE_BLOCK_LOOPS), with the same clamping of bits and 0 meaning
+	SHRED_BLOCK_DEFAULT for block_size.
+
+	Encoding takes SHRED_GPU_GROUP threads (a warp on NVIDIA) per block.
+	They find its largest magnitude between them with shuffles, one of them
+	writes its exponent, and then they quantize its elements side by side,
+	so the loads and stores are coalesced for blocks of 32 or more. Decoding
+	is just one element per thread.
+*/
+#define SHRED_DEFINE_GPU_BLOCK(Width, int_t, most_bits) \
+static __global__ void shred_gpu_ToBlockInt##Width(const float* in, size_t n, \
+	size_t block_size, int bits, uint8_t* exps, int_t* out) \
+{ \
+	size_t lane = threadIdx.x % SHRED_GPU_GROUP; \
+	size_t groups = SHRED_GPU_STRIDE / SHRED_GPU_GROUP; \
+	size_t blocks = (n + block_size - 1) / block_size; \
+	int32_t most = ((int32_t)1 << (bits - 1)) - 1; \
+	for(size_t b = SHRED_GPU_INDEX / SHRED_GPU_GROUP; b < blocks; b += groups) \
+	{ \
+		const float* src = in + b * block_size; \
+		int_t* dst = out + b * block_size; \
+		size_t len = n - b * block_size; \
+		len = len < block_size ? len : block_size; \
+		uint32_t top = 0; \
+		for(size_t i = lane; i < len; i += SHRED_GPU_GROUP) \
+		{ \
+			uint32_t data = ShredFloatToData(src[i]) & ~float_sign_mask; \
+			top = data > top ? data : top; \
+		} \
+		for(int lanes = SHRED_GPU_GROUP / 2; lanes > 0; lanes /= 2) \
+		{ \
+			uint32_t other = SHRED_GPU_SHUFFLE_XOR(top, lanes); \
+			top = other > top ? other : top; \
+		} \
+		uint32_t exp = ShredBlockExp(top, bits); \
+		if(lane == 0) \
+		{ \
+			exps[b] = (uint8_t)exp; \
+		} \
+		if(exp == SHRED_BLOCK_NAN) \
+		{ \
+			for(size_t i = lane; i < len; i += SHRED_GPU_GROUP) \
+			{ \
+				dst[i] = 0; \
+			} \
+			continue; \
+		} \
+		float scale = ShredBlockScale(exp, bits); \
+		uint32_t floor = ShredBlockFloor(exp, bits); \
+		for(size_t i = lane; i < len; i += SHRED_GPU_GROUP) \
+		{ \
+			dst[i] = (int_t)ShredBlockQuantize(src[i], scale, floor, most); \
+		} \
+	} \
+} \
+\
+static __global__ void shred_gpu_BlockInt##Width##ToFloat( \
+	const uint8_t* exps, const int_t* in, size_t n, size_t block_size, \
+	int bits, float* out) \
+{ \
+	for(size_t i = SHRED_GPU_INDEX; i < n; i += SHRED_GPU_STRIDE) \
+	{ \
+		uint8_t exp = exps[i / block_size]; \
+		out[i] = exp == SHRED_BLOCK_NAN ? \
+			ShredDataToFloat(float_exp_mask | (float_exp_mask >> 1)) : \
+			(float)in[i] * ShredBlockStep(exp, bits); \
+	} \
+} \
+\
+static inline ShredGpuError ShredFloatToBlockInt##Width##Async( \
+	const float* in, size_t n, size_t block_size, int bits, uint8_t* exps, \
+	int_t* out, ShredGpuStream stream) \
+{ \
+	if(n == 0) \
+	{ \
+		return SHRED_GPU_SUCCESS; \
+	} \
+	block_size = block_size ? block_size : SHRED_BLOCK_DEFAULT; \
+	size_t blocks = ShredBlockCount(n, block_size); \
+	shred_gpu_ToBlockInt##Width<<<ShredGpuBlocks(blocks * SHRED_GPU_GROUP), \
+		SHRED_GPU_THREADS, 0, stream>>>(in, n, block_size, \
+		ShredBlockBits(bits, most_bits), exps, out); \
+	return SHRED_GPU_LAST_ERROR(); \
+} \
+\
+static inline ShredGpuError ShredBlockInt##Width##ToFloatAsync( \
+	const uint8_t* exps, const int_t* in, size_t n, size_t block_size, \
+	int bits, float* out, ShredGpuStream stream) \
+{ \
+	if(n == 0) \
+	{ \
+		return SHRED_GPU_SUCCESS; \
+	} \
+	shred_gpu_BlockInt##Width##ToFloat<<<ShredGpuBlocks(n), \
+		SHRED_GPU_THREADS, 0, stream>>>(exps, in, n, \
+		block_size ? block_size : SHRED_BLOCK_DEFAULT, \
+		ShredBlockBits(bits, most_bits), out); \
+	return SHRED_GPU_LAST_ERROR(); \
+}
+
+SHRED_DEFINE_GPU_BLOCK(8, int8_t, 8)
+SHRED_DEFINE_GPU_BLOCK(16, int16_t, 16)
+
+#undef SHRED_DEFINE_GPU_BLOCK
+
+#endif
@@ -0,0 +1,1618 @@
+/*
+	The SIMD kernels behind the ShredFloat*Array functions.
+
+	Don't include this file yourself, float_shredder.h includes it once for
+	every instruction set it's building kernels for. Before each include it
+	defines SHRED_ISA, SHRED_TARGET, SHRED_V_LANES and the shred_v_*
+	primitives (see the list in float_shredder.h), and everything in here is
+	written only in terms of those, so the same source turns into an SSE2,
+	AVX2, AVX-512 or NEON kernel depending on what they expand to.
+
+	That's also why there's no include guard. The primitives get undefined
+	again at the bottom so the next instruction set can define its own.
+
+	Every kernel runs whole vectors through the main loop and then finishes
+	whatever's left over with the scalar function, so the results are always
+	exactly what the scalar version would've given you.
+*/
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatExpUnbiasedArray)
+	(const float* in, uint32_t* out, size_t n)
+{
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_store(out + i,
+			shred_v_srli(shred_v_and(v, exp_mask), float_exp_offset));
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatExpUnbiased(in[i]);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatExpUnbiasedRawArray)
+	(const float* in, uint32_t* out, size_t n)
+{
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_store(out + i, shred_v_and(v, exp_mask));
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatExpUnbiasedRaw(in[i]);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatExpArray)
+	(const float* in, int32_t* out, size_t n)
+{
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	const shred_v_t bias = shred_v_set1(float_exp_bias);
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		v = shred_v_srli(shred_v_and(v, exp_mask), float_exp_offset);
+		shred_v_store(out + i, shred_v_sub(v, bias));
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatExp(in[i]);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatExpRawArray)
+	(const float* in, int32_t* out, size_t n)
+{
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	const shred_v_t bias = shred_v_set1(float_exp_bias);
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		v = shred_v_srli(shred_v_and(v, exp_mask), float_exp_offset);
+		v = shred_v_sub(v, bias);
+		shred_v_store(out + i, shred_v_slli(v, float_exp_offset));
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatExpRaw(in[i]);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatMantissaRawArray)
+	(const float* in, uint32_t* out, size_t n)
+{
+	const shred_v_t mantissa_mask = shred_v_set1(float_mantissa_mask);
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_store(out + i, shred_v_and(v, mantissa_mask));
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatMantissaRaw(in[i]);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatMantissaArray)
+	(const float* in, float* out, size_t n)
+{
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	const shred_v_t mantissa_mask = shred_v_set1(float_mantissa_mask);
+	const shred_v_t one = shred_v_set1(ShredFloatToData(1.0f));
+	const shred_v_t minus_one = shred_v_set1(ShredFloatToData(-1.0f));
+	const shred_v_t zero = shred_v_set1(0);
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_t is_sub = shred_v_cmpeq(shred_v_and(v, exp_mask), zero);
+		// same as the scalar version: 1.mantissa, minus one for subnormals
+		shred_v_t sig = shred_v_or(shred_v_and(v, mantissa_mask), one);
+		shred_v_store(out + i, shred_v_addf(sig,
+			shred_v_and(is_sub, minus_one)));
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatMantissa(in[i]);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatIsNegativeArray)
+	(const float* in, bool* out, size_t n)
+{
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_store_u8(out + i, shred_v_srli(v, float_sign_offset));
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatIsNegative(in[i]);
+	}
+}
+
+/*
+	The shift kernels clamp the shift the same way the scalar versions do,
+	just once up front instead of once per float (and count the clamps for
+	SHRED_STATS once too).
+*/
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatShiftExpUpArray)
+	(const float* in, float* out, size_t n, int shift)
+{
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	int vshift = shift > 8 ? 8 : shift;
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_t exp = shred_v_and(v, exp_mask);
+		shred_v_t no_exp = shred_v_andnot(exp_mask, v);
+		exp = shred_v_and(shred_v_slli(exp, vshift), exp_mask);
+		shred_v_store(out + i, shred_v_or(exp, no_exp));
+	}
+	// the scalar tail counts its own clamps
+	SHRED_STATS_ADD(shift_exp_clamps, vshift != shift ? i : 0);
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatShiftExpUp(in[i], shift);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatShiftExpDownArray)
+	(const float* in, float* out, size_t n, int shift)
+{
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	int vshift = shift > 8 ? 8 : shift;
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_t exp = shred_v_and(v, exp_mask);
+		shred_v_t no_exp = shred_v_andnot(exp_mask, v);
+		exp = shred_v_and(shred_v_srli(exp, vshift), exp_mask);
+		shred_v_store(out + i, shred_v_or(exp, no_exp));
+	}
+	// the scalar tail counts its own clamps
+	SHRED_STATS_ADD(shift_exp_clamps, vshift != shift ? i : 0);
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatShiftExpDown(in[i], shift);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatShiftMantUpArray)
+	(const float* in, float* out, size_t n, int shift)
+{
+	const shred_v_t mantissa_mask = shred_v_set1(float_mantissa_mask);
+	int vshift = shift > 23 ? 23 : shift;
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_t mant = shred_v_and(v, mantissa_mask);
+		shred_v_t no_mant = shred_v_andnot(mantissa_mask, v);
+		mant = shred_v_and(shred_v_slli(mant, vshift), mantissa_mask);
+		shred_v_store(out + i, shred_v_or(mant, no_mant));
+	}
+	// the scalar tail counts its own clamps
+	SHRED_STATS_ADD(shift_mant_clamps, vshift != shift ? i : 0);
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatShiftMantUp(in[i], shift);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatShiftMantDownArray)
+	(const float* in, float* out, size_t n, int shift)
+{
+	const shred_v_t mantissa_mask = shred_v_set1(float_mantissa_mask);
+	int vshift = shift > 23 ? 23 : shift;
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_t mant = shred_v_and(v, mantissa_mask);
+		shred_v_t no_mant = shred_v_andnot(mantissa_mask, v);
+		mant = shred_v_and(shred_v_srli(mant, vshift), mantissa_mask);
+		shred_v_store(out + i, shred_v_or(mant, no_mant));
+	}
+	// the scalar tail counts its own clamps
+	SHRED_STATS_ADD(shift_mant_clamps, vshift != shift ? i : 0);
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatShiftMantDown(in[i], shift);
+	}
+}
+
+/*
+	The common case is a single add on the exponent field, with results that
+	overflow turned into infinity and results that underflow past the
+	smallest subnormal turned into zero. Subnormal lanes (and lanes whose
+	result would be subnormal) are rare enough that when a vector has any,
+	those lanes just get redone with the scalar version.
+*/
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatScalePow2Array)
+	(const float* in, float* out, size_t n, int scale)
+{
+	if(scale > SHRED_SCALE_POW2_LIMIT)
+	{
+		scale = SHRED_SCALE_POW2_LIMIT;
+		SHRED_STATS_ADD(scale_clamps, n);
+	} else if(scale < -SHRED_SCALE_POW2_LIMIT) {
+		scale = -SHRED_SCALE_POW2_LIMIT;
+		SHRED_STATS_ADD(scale_clamps, n);
+	}
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	const shred_v_t sign_mask = shred_v_set1(float_sign_mask);
+	const shred_v_t zero = shred_v_set1(0);
+	const shred_v_t exp_max = shred_v_set1(0xFF);
+	const shred_v_t vscale = shred_v_set1(scale);
+	const shred_v_t step = shred_v_set1((uint32_t)scale << float_exp_offset);
+	const shred_v_t over_limit = shred_v_set1(0xFE);
+	const shred_v_t zero_limit = shred_v_set1(-float_mantissa_bits);
+	const shred_v_t one = shred_v_set1(1);
+	uint32_t slow_lanes[SHRED_V_LANES];
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_t sign = shred_v_and(v, sign_mask);
+		shred_v_t exp = shred_v_srli(shred_v_and(v, exp_mask),
+			float_exp_offset);
+		shred_v_t new_exp = shred_v_add(exp, vscale);
+		// zeros, infs and NaNs stay as they are
+		shred_v_t keep = shred_v_or(shred_v_cmpeq(exp, exp_max),
+			shred_v_cmpeq(shred_v_andnot(sign_mask, v), zero));
+		shred_v_t over = shred_v_cmpgt(new_exp, over_limit);
+		shred_v_t under = shred_v_cmpgt(zero_limit, new_exp);
+		shred_v_t slow = shred_v_andnot(keep, shred_v_or(
+			shred_v_cmpeq(exp, zero), shred_v_andnot(under,
+			shred_v_cmpgt(one, new_exp))));
+
+		shred_v_t res = shred_v_add(v, step);
+		res = shred_v_or(shred_v_and(over, shred_v_or(sign, exp_mask)),
+			shred_v_andnot(over, res));
+		res = shred_v_or(shred_v_and(under, sign), shred_v_andnot(under, res));
+		res = shred_v_or(shred_v_and(keep, v), shred_v_andnot(keep, res));
+
+		uint32_t slow_bits = shred_v_signbits(slow);
+		if(!slow_bits)
+		{
+			shred_v_store(out + i, res);
+			continue;
+		}
+		// in and out can be the same buffer, so fix the lanes up before
+		// anything gets written back
+		shred_v_store(slow_lanes, res);
+		for(int j = 0; j < SHRED_V_LANES; j++)
+		{
+			if((slow_bits >> j) & 1)
+			{
+				float fixed = ShredFloatScalePow2(in[i + j], scale);
+				slow_lanes[j] = ShredFloatToData(fixed);
+			}
+		}
+		memcpy(out + i, slow_lanes, sizeof(slow_lanes));
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatScalePow2(in[i], scale);
+	}
+}
+
+/*
+	The classify kernels compare the float with its sign masked off against
+	the four class boundaries. Each compare is all ones past its boundary,
+	so the class is minus their sum, and the class masks are where one
+	compare is set and the next one isn't.
+*/
+#define SHRED_V_CLASS_BOUNDS(v) \
+	shred_v_t abs = shred_v_andnot(sign_mask, (v)); \
+	shred_v_t past_zero = shred_v_cmpgt(abs, zero); \
+	shred_v_t past_sub = shred_v_cmpgt(abs, mantissa_mask); \
+	shred_v_t past_normal = shred_v_cmpgt(abs, max_normal); \
+	shred_v_t past_inf = shred_v_cmpgt(abs, exp_mask);
+
+#define SHRED_V_CLASS_CONSTS \
+	const shred_v_t sign_mask = shred_v_set1(float_sign_mask); \
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask); \
+	const shred_v_t mantissa_mask = shred_v_set1(float_mantissa_mask); \
+	const shred_v_t max_normal = shred_v_set1(float_exp_mask - 1); \
+	const shred_v_t zero = shred_v_set1(0);
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatClassifyArray)
+	(const float* in, uint8_t* out, size_t n)
+{
+	SHRED_V_CLASS_CONSTS
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		SHRED_V_CLASS_BOUNDS(shred_v_load(in + i))
+		shred_v_t sum = shred_v_add(shred_v_add(past_zero, past_sub),
+			shred_v_add(past_normal, past_inf));
+		shred_v_store_u8(out + i, shred_v_sub(zero, sum));
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatClassify(in[i]);
+	}
+}
+
+/*
+	The counts are kept per lane (subtracting an all ones compare adds one)
+	and added up every SHRED_V_CLASS_RUN vectors, long before a 32-bit lane
+	could overflow.
+*/
+#define SHRED_V_CLASS_RUN ((size_t)1 << 24)
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatClassCount)
+	(const float* in, size_t n, size_t* counts)
+{
+	SHRED_V_CLASS_CONSTS
+	size_t past[4] = {0, 0, 0, 0};
+	uint32_t lanes[4][SHRED_V_LANES];
+	size_t i = 0;
+	while(i + SHRED_V_LANES <= n)
+	{
+		shred_v_t sum_zero = zero;
+		shred_v_t sum_sub = zero;
+		shred_v_t sum_normal = zero;
+		shred_v_t sum_inf = zero;
+		size_t run = (n - i) / SHRED_V_LANES;
+		run = run < SHRED_V_CLASS_RUN ? run : SHRED_V_CLASS_RUN;
+		for(size_t r = 0; r < run; r++, i += SHRED_V_LANES)
+		{
+			SHRED_V_CLASS_BOUNDS(shred_v_load(in + i))
+			sum_zero = shred_v_sub(sum_zero, past_zero);
+			sum_sub = shred_v_sub(sum_sub, past_sub);
+			sum_normal = shred_v_sub(sum_normal, past_normal);
+			sum_inf = shred_v_sub(sum_inf, past_inf);
+		}
+		shred_v_store(lanes[0], sum_zero);
+		shred_v_store(lanes[1], sum_sub);
+		shred_v_store(lanes[2], sum_normal);
+		shred_v_store(lanes[3], sum_inf);
+		for(int k = 0; k < 4; k++)
+		{
+			for(int j = 0; j < SHRED_V_LANES; j++)
+			{
+				past[k] += lanes[k][j];
+			}
+		}
+	}
+	ShredFloatClassCount_scalar(in + i, n - i, counts);
+	// every float is past the boundaries below its class and none above
+	counts[SHRED_CLASS_ZERO] += i - past[0];
+	counts[SHRED_CLASS_SUBNORMAL] += past[0] - past[1];
+	counts[SHRED_CLASS_NORMAL] += past[1] - past[2];
+	counts[SHRED_CLASS_INFINITE] += past[2] - past[3];
+	counts[SHRED_CLASS_NAN] += past[3];
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatByteSwapArray)
+	(const float* in, float* out, size_t n)
+{
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_store(out + i, shred_v_bswap(shred_v_load(in + i)));
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatByteSwap(in[i]);
+	}
+}
+
+/*
+	The ULP index of every lane (see ShredFloatUlpIndex), picking between
+	the magnitude and its negation with the sign, plus which lanes are NaN.
+	Needs zero, abs_mask and exp_mask.
+*/
+#define SHRED_V_ULP_INDEX(v, index, nan) \
+	shred_v_t index; \
+	shred_v_t nan; \
+	{ \
+		shred_v_t abs_ = shred_v_and(v, abs_mask); \
+		shred_v_t neg_ = shred_v_cmpgt(zero, v); \
+		nan = shred_v_cmpgt(abs_, exp_mask); \
+		index = shred_v_or(shred_v_and(neg_, shred_v_sub(zero, abs_)), \
+			shred_v_andnot(neg_, abs_)); \
+	}
+
+// unsigned a > b, there's only a signed compare
+#define SHRED_V_CMPGT_U(a, b) \
+	shred_v_cmpgt(shred_v_add((a), bias), shred_v_add((b), bias))
+#define SHRED_V_SELECT(mask, a, b) \
+	shred_v_or(shred_v_and((mask), (a)), shred_v_andnot((mask), (b)))
+
+/*
+	The distances get summed per lane in two halves, the low and high 16
+	bits, so a lane can take SHRED_V_ULP_RUN of them before it could
+	overflow. The max is kept per lane too, and everything is added up
+	between runs.
+*/
+#define SHRED_V_ULP_RUN ((size_t)1 << 16)
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatUlpDistanceArray)
+	(const float* a, const float* b, uint32_t* out, size_t n,
+	ShredUlpStats* stats)
+{
+	const shred_v_t zero = shred_v_set1(0);
+	const shred_v_t abs_mask = shred_v_set1(~float_sign_mask);
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	const shred_v_t low_mask = shred_v_set1(0xFFFF);
+	const shred_v_t bias = shred_v_set1(float_sign_mask);
+	uint64_t max = 0;
+	double sum = 0.0;
+	size_t nan_mismatches = 0;
+	uint32_t lanes[4][SHRED_V_LANES];
+	size_t i = 0;
+	while(i + SHRED_V_LANES <= n)
+	{
+		shred_v_t sum_low = zero;
+		shred_v_t sum_high = zero;
+		shred_v_t top = zero;
+		shred_v_t mismatches = zero;
+		size_t run = (n - i) / SHRED_V_LANES;
+		run = run < SHRED_V_ULP_RUN ? run : SHRED_V_ULP_RUN;
+		for(size_t r = 0; r < run; r++, i += SHRED_V_LANES)
+		{
+			shred_v_t va = shred_v_load(a + i);
+			shred_v_t vb = shred_v_load(b + i);
+			SHRED_V_ULP_INDEX(va, index_a, nan_a)
+			SHRED_V_ULP_INDEX(vb, index_b, nan_b)
+			shred_v_t a_below = shred_v_cmpgt(index_b, index_a);
+			shred_v_t distance = SHRED_V_SELECT(a_below,
+				shred_v_sub(index_b, index_a), shred_v_sub(index_a, index_b));
+			shred_v_t any_nan = shred_v_or(nan_a, nan_b);
+			shred_v_t mismatch = shred_v_andnot(shred_v_and(nan_a, nan_b),
+				any_nan);
+			distance = shred_v_andnot(any_nan, distance);
+			if(out)
+			{
+				shred_v_store(out + i, shred_v_or(distance, mismatch));
+			}
+			mismatches = shred_v_sub(mismatches, mismatch);
+			sum_low = shred_v_add(sum_low, shred_v_and(distance, low_mask));
+			sum_high = shred_v_add(sum_high, shred_v_srli(distance, 16));
+			top = SHRED_V_SELECT(SHRED_V_CMPGT_U(distance, top), distance,
+				top);
+		}
+		shred_v_store(lanes[0], sum_low);
+		shred_v_store(lanes[1], sum_high);
+		shred_v_store(lanes[2], top);
+		shred_v_store(lanes[3], mismatches);
+		uint64_t run_sum = 0;
+		for(int j = 0; j < SHRED_V_LANES; j++)
+		{
+			run_sum += lanes[0][j] + ((uint64_t)lanes[1][j] << 16);
+			max = lanes[2][j] > max ? lanes[2][j] : max;
+			nan_mismatches += lanes[3][j];
+		}
+		sum += (double)run_sum;
+	}
+	ShredFloatUlpDistanceAdd(a + i, b + i, out ? out + i : NULL, n - i, &max,
+		&sum, &nan_mismatches);
+	ShredUlpStatsFinish(stats, n, max, sum, nan_mismatches);
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatStepUlpsArray)
+	(const float* in, float* out, size_t n, int32_t steps)
+{
+	if(steps == 0)
+	{
+		memmove(out, in, n * sizeof(float));
+		return;
+	}
+	const shred_v_t zero = shred_v_set1(0);
+	const shred_v_t abs_mask = shred_v_set1(~float_sign_mask);
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	const shred_v_t sign_mask = shred_v_set1(float_sign_mask);
+	const shred_v_t bias = sign_mask;
+	const shred_v_t top = shred_v_set1(2 * float_exp_mask);
+	// how far to step, as a magnitude, same as the scalar version
+	const shred_v_t step = shred_v_set1(steps > 0 ? (uint32_t)steps :
+		(uint32_t)0 - (uint32_t)steps);
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		SHRED_V_ULP_INDEX(v, index, nan)
+		shred_v_t pos = shred_v_add(index, exp_mask);
+		if(steps > 0)
+		{
+			shred_v_t past = SHRED_V_CMPGT_U(step, shred_v_sub(top, pos));
+			pos = SHRED_V_SELECT(past, top, shred_v_add(pos, step));
+		} else {
+			shred_v_t past = SHRED_V_CMPGT_U(step, pos);
+			pos = shred_v_andnot(past, shred_v_sub(pos, step));
+		}
+		shred_v_t negative = SHRED_V_CMPGT_U(exp_mask, pos);
+		shred_v_t data = SHRED_V_SELECT(negative,
+			shred_v_or(sign_mask, shred_v_sub(exp_mask, pos)),
+			shred_v_sub(pos, exp_mask));
+		shred_v_store(out + i, SHRED_V_SELECT(nan, v, data));
+	}
+	ShredFloatStepUlpsArray_scalar(in + i, out + i, n - i, steps);
+}
+
+/*
+	The ordered keys without an xor: flipping every bit is -1 - v, and
+	flipping just the sign bit is the same as adding it. Going back, a key
+	with its top bit set (negative as a signed int) was a positive float.
+*/
+#define SHRED_V_ORDERED_KEY(v) SHRED_V_SELECT(shred_v_cmpgt(zero, (v)), \
+	shred_v_sub(minus_one, (v)), shred_v_add((v), sign_mask))
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatToOrderedKeyArray)
+	(const float* in, uint32_t* out, size_t n, ShredEndian endian)
+{
+	const shred_v_t zero = shred_v_set1(0);
+	const shred_v_t minus_one = shred_v_set1(-1);
+	const shred_v_t sign_mask = shred_v_set1(float_sign_mask);
+	bool swap = !ShredEndianIsNative(endian);
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_t key = SHRED_V_ORDERED_KEY(v);
+		shred_v_store(out + i, swap ? shred_v_bswap(key) : key);
+	}
+	ShredFloatToOrderedKeyArray_scalar(in + i, out + i, n - i, endian);
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatToCanonicalKeyArray)
+	(const float* in, uint32_t* out, size_t n, ShredEndian endian)
+{
+	const shred_v_t zero = shred_v_set1(0);
+	const shred_v_t minus_one = shred_v_set1(-1);
+	const shred_v_t sign_mask = shred_v_set1(float_sign_mask);
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	const shred_v_t quiet_nan = shred_v_set1(float_exp_mask |
+		((uint32_t)1 << (float_mantissa_bits - 1)));
+	bool swap = !ShredEndianIsNative(endian);
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_t abs = shred_v_andnot(sign_mask, v);
+		// -0 becomes +0 and every NaN the default one, then it's the same
+		v = SHRED_V_SELECT(shred_v_cmpgt(abs, exp_mask), quiet_nan,
+			shred_v_andnot(shred_v_cmpeq(abs, zero), v));
+		shred_v_t key = SHRED_V_ORDERED_KEY(v);
+		shred_v_store(out + i, swap ? shred_v_bswap(key) : key);
+	}
+	ShredFloatToCanonicalKeyArray_scalar(in + i, out + i, n - i, endian);
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatFromOrderedKeyArray)
+	(const uint32_t* in, float* out, size_t n, ShredEndian endian)
+{
+	const shred_v_t zero = shred_v_set1(0);
+	const shred_v_t minus_one = shred_v_set1(-1);
+	const shred_v_t sign_mask = shred_v_set1(float_sign_mask);
+	bool swap = !ShredEndianIsNative(endian);
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t key = shred_v_load(in + i);
+		key = swap ? shred_v_bswap(key) : key;
+		shred_v_store(out + i, SHRED_V_SELECT(shred_v_cmpgt(zero, key),
+			shred_v_add(key, sign_mask), shred_v_sub(minus_one, key)));
+	}
+	ShredFloatFromOrderedKeyArray_scalar(in + i, out + i, n - i, endian);
+}
+
+#undef SHRED_V_ORDERED_KEY
+
+/*
+	Everything the summary needs is kept per lane. min and max are kept as
+	the same signed keys the scalar version uses, and the sums as a float
+	sum plus the exact error of every add into it (Knuth's two-sum), which
+	gets folded into the double total every SHRED_V_SUM_RUN vectors, before
+	the errors themselves have lost much. A run that overflows a lane gets
+	added up again in double instead. The counts are added up every
+	SHRED_V_CLASS_RUN vectors like ClassCount's.
+*/
+#define SHRED_V_SUM_RUN 64
+
+#define SHRED_V_MIN(a, b) SHRED_V_SELECT(shred_v_cmpgt((a), (b)), (b), (a))
+#define SHRED_V_MAX(a, b) SHRED_V_SELECT(shred_v_cmpgt((a), (b)), (a), (b))
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatSummarize)
+	(const float* in, size_t n, ShredFloatSummary* summary)
+{
+	const shred_v_t zero = shred_v_set1(0);
+	const shred_v_t minus_one = shred_v_set1(-1);
+	const shred_v_t sign_mask = shred_v_set1(float_sign_mask);
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	const shred_v_t key_top = shred_v_set1(INT32_MAX);
+	const shred_v_t key_bottom = shred_v_set1(INT32_MIN);
+	const shred_v_t exp_top = shred_v_set1(float_exp_mask >> float_exp_offset);
+	shred_v_t key_min = key_top;
+	shred_v_t key_max = key_bottom;
+	shred_v_t exp_min = exp_top;
+	shred_v_t exp_max = zero;
+	float sum_lanes[2][SHRED_V_LANES];
+	uint32_t count_lanes[4][SHRED_V_LANES];
+	ShredFloatSummaryAcc acc;
+	ShredFloatSummaryStart(&acc);
+	size_t i = 0;
+	while(i + SHRED_V_LANES <= n)
+	{
+		shred_v_t nans = zero;
+		shred_v_t infs = zero;
+		shred_v_t negatives = zero;
+		shred_v_t negative_zeros = zero;
+		size_t run = (n - i) / SHRED_V_LANES;
+		run = run < SHRED_V_CLASS_RUN ? run : SHRED_V_CLASS_RUN;
+		while(run > 0)
+		{
+			shred_v_t sum = zero;
+			shred_v_t comp = zero;
+			size_t sum_run = run < SHRED_V_SUM_RUN ? run : SHRED_V_SUM_RUN;
+			size_t sum_start = i;
+			run -= sum_run;
+			for(size_t r = 0; r < sum_run; r++, i += SHRED_V_LANES)
+			{
+				shred_v_t v = shred_v_load(in + i);
+				shred_v_t abs = shred_v_andnot(sign_mask, v);
+				shred_v_t nan = shred_v_cmpgt(abs, exp_mask);
+				shred_v_t finite = shred_v_cmpgt(exp_mask, abs);
+				shred_v_t neg = shred_v_cmpgt(zero, v);
+				nans = shred_v_sub(nans, nan);
+				infs = shred_v_sub(infs, shred_v_cmpeq(abs, exp_mask));
+				negatives = shred_v_sub(negatives, neg);
+				negative_zeros = shred_v_sub(negative_zeros,
+					shred_v_cmpeq(v, sign_mask));
+
+				// -1 - abs is ~abs, the magnitude flipped
+				shred_v_t key = SHRED_V_SELECT(neg,
+					shred_v_sub(minus_one, abs), abs);
+				key_min = SHRED_V_MIN(key_min,
+					SHRED_V_SELECT(nan, key_top, key));
+				key_max = SHRED_V_MAX(key_max,
+					SHRED_V_SELECT(nan, key_bottom, key));
+				shred_v_t exp = shred_v_srli(abs, float_exp_offset);
+				exp_min = SHRED_V_MIN(exp_min,
+					SHRED_V_SELECT(finite, exp, exp_top));
+				exp_max = SHRED_V_MAX(exp_max, shred_v_and(finite, exp));
+
+				shred_v_t x = shred_v_and(finite, v);
+				shred_v_t t = shred_v_addf(sum, x);
+				shred_v_t x_part = shred_v_subf(t, sum);
+				comp = shred_v_addf(comp, shred_v_addf(
+					shred_v_subf(sum, shred_v_subf(t, x_part)),
+					shred_v_subf(x, x_part)));
+				sum = t;
+			}
+			shred_v_store(sum_lanes[0], sum);
+			shred_v_store(sum_lanes[1], comp);
+			bool overflow = false;
+			for(int j = 0; j < SHRED_V_LANES; j++)
+			{
+				overflow |= ShredFloatClassify(sum_lanes[0][j]) >=
+					SHRED_CLASS_INFINITE;
+				overflow |= ShredFloatClassify(sum_lanes[1][j]) >=
+					SHRED_CLASS_INFINITE;
+			}
+			if(overflow)
+			{
+				// floats near FLT_MAX overflowed a lane, so redo it in double
+				for(size_t k = sum_start; k < i; k++)
+				{
+					if(ShredFloatClassify(in[k]) < SHRED_CLASS_INFINITE)
+					{
+						ShredKahanAdd(&acc.sum, &acc.comp, (double)in[k]);
+					}
+				}
+				continue;
+			}
+			for(int j = 0; j < SHRED_V_LANES; j++)
+			{
+				ShredKahanAdd(&acc.sum, &acc.comp, (double)sum_lanes[0][j]);
+				ShredKahanAdd(&acc.sum, &acc.comp, (double)sum_lanes[1][j]);
+			}
+		}
+		shred_v_store(count_lanes[0], nans);
+		shred_v_store(count_lanes[1], infs);
+		shred_v_store(count_lanes[2], negatives);
+		shred_v_store(count_lanes[3], negative_zeros);
+		for(int j = 0; j < SHRED_V_LANES; j++)
+		{
+			acc.nans += count_lanes[0][j];
+			acc.infs += count_lanes[1][j];
+			acc.negatives += count_lanes[2][j];
+			acc.negative_zeros += count_lanes[3][j];
+		}
+	}
+	// there's only a max, so the mins are the max of the negations
+	int32_t lane_key_min = -shred_v_hmax(shred_v_sub(zero, key_min));
+	int32_t lane_key_max = shred_v_hmax(key_max);
+	uint32_t lane_exp_min = (uint32_t)-shred_v_hmax(shred_v_sub(zero, exp_min));
+	uint32_t lane_exp_max = (uint32_t)shred_v_hmax(exp_max);
+	acc.key_min = lane_key_min < acc.key_min ? lane_key_min : acc.key_min;
+	acc.key_max = lane_key_max > acc.key_max ? lane_key_max : acc.key_max;
+	acc.exp_min = lane_exp_min < acc.exp_min ? lane_exp_min : acc.exp_min;
+	acc.exp_max = lane_exp_max > acc.exp_max ? lane_exp_max : acc.exp_max;
+	acc.count = i;
+	ShredFloatSummaryAdd(&acc, in + i, n - i);
+	ShredFloatSummaryFinish(&acc, summary);
+}
+
+#undef SHRED_V_CLASS_RUN
+#undef SHRED_V_SUM_RUN
+#undef SHRED_V_MIN
+#undef SHRED_V_MAX
+
+/*
+	The same rounding as ShredFloatTruncateMantissa, and for the stats the
+	same error and division as the scalar version, so they come out the
+	same to the bit. Signed compares are fine for the maxes since nothing
+	negative gets near them, and infs and NaNs are masked out to 0.
+*/
+#define SHRED_V_TRUNCATE(v, name) \
+	shred_v_t name = shred_v_and(shred_v_add(shred_v_add((v), round), \
+		shred_v_and(shred_v_srli((v), bits), odd)), keep); \
+	name = SHRED_V_SELECT(shred_v_cmpgt(shred_v_and((v), abs_mask), \
+		exp_mask), shred_v_or(shred_v_and((v), keep), quiet), name);
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatTruncateMantissaArray)
+	(const float* in, float* out, size_t n, int bits, ShredTruncateStats* stats)
+{
+#if !defined(shred_v_divf)
+	if(stats)
+	{
+		ShredFloatTruncateMantissaArray_scalar(in, out, n, bits, stats);
+		return;
+	}
+#endif
+	bits = bits < 0 ? 0 : bits > float_mantissa_bits ? float_mantissa_bits :
+		bits;
+	const shred_v_t abs_mask = shred_v_set1(~float_sign_mask);
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	const shred_v_t keep = shred_v_set1(~(uint32_t)0 << bits);
+	const shred_v_t round = shred_v_set1(~(~(uint32_t)0 << bits) >> 1);
+	const shred_v_t odd = shred_v_set1(bits > 0);
+	const shred_v_t quiet = shred_v_set1((uint32_t)1 <<
+		(float_mantissa_bits - 1));
+	size_t i = 0;
+	if(!stats)
+	{
+		for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+		{
+			shred_v_t v = shred_v_load(in + i);
+			SHRED_V_TRUNCATE(v, rounded)
+			shred_v_store(out + i, rounded);
+		}
+		ShredFloatTruncateMantissaArray_scalar(in + i, out + i, n - i, bits,
+			NULL);
+		return;
+	}
+#if defined(shred_v_divf)
+	const shred_v_t zero = shred_v_set1(0);
+	const shred_v_t sign_mask = shred_v_set1(float_sign_mask);
+	shred_v_t top_abs = zero;
+	shred_v_t top_rel = zero;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		SHRED_V_TRUNCATE(v, rounded)
+		shred_v_store(out + i, rounded);
+		shred_v_t size = shred_v_and(v, abs_mask);
+		shred_v_t finite = shred_v_cmpgt(exp_mask, size);
+		// the sign doesn't change, so this is |rounded| - |v|
+		shred_v_t error = shred_v_and(shred_v_and(shred_v_addf(
+			shred_v_and(rounded, abs_mask), shred_v_or(size, sign_mask)),
+			abs_mask), finite);
+		shred_v_t rel = shred_v_and(shred_v_divf(error, size),
+			shred_v_and(finite, shred_v_cmpgt(size, zero)));
+		top_abs = SHRED_V_SELECT(shred_v_cmpgt(error, top_abs), error,
+			top_abs);
+		top_rel = SHRED_V_SELECT(shred_v_cmpgt(rel, top_rel), rel, top_rel);
+	}
+	float max_abs = ShredDataToFloat((uint32_t)shred_v_hmax(top_abs));
+	float max_rel = ShredDataToFloat((uint32_t)shred_v_hmax(top_rel));
+	ShredFloatTruncateMantissaAdd(in + i, out + i, n - i, bits, &max_abs,
+		&max_rel);
+	stats->max_abs = (double)max_abs;
+	stats->max_rel = (double)max_rel;
+#endif
+}
+
+#undef SHRED_V_TRUNCATE
+
+/*
+	The approximations, op for op what the scalar versions do. Every lane
+	goes through the vector code, and then any lane the scalar version
+	would've sent down its slow path gets redone by the scalar version on
+	its own, which keeps special cases out of the main loop without
+	throwing away the rest of the vector. They're built without FP
+	contraction like the scalar versions, so AVX-512's FMA doesn't get used
+	and the bits are the same.
+*/
+SHRED_NO_CONTRACT_BEGIN
+
+#define SHRED_V_F(c) shred_v_set1(ShredFloatToData(c))
+#define SHRED_V_MAD(a, t, c) shred_v_addf(shred_v_mulf((a), (t)), (c))
+// -a for a float that's known to be positive
+#define SHRED_V_NEG(a) shred_v_or((a), sign_mask)
+
+// all ones in each lane of v that isn't a positive normal float
+#define SHRED_V_APPROX_SPECIALS(v) \
+	shred_v_or(shred_v_cmpgt(zero, shred_v_sub((v), low)), \
+		shred_v_cmpgt(shred_v_sub((v), low), range))
+
+/*
+	The lanes set in special go through the vector code as 1.0, so they
+	can't slow it down with subnormals, and then get redone one at a time
+	by the scalar func once the vector's done. The scalar functions don't
+	always get inlined (exp2 calls itself near the ends of its range), so
+	the upper halves of the registers are cleared before calling them, or
+	every call pays for going between AVX and SSE code.
+*/
+#define SHRED_V_APPROX_SKIP(v, special, slow) \
+	uint32_t slow = shred_v_signbits(special); \
+	if(slow) \
+	{ \
+		v = SHRED_V_SELECT(special, one, v); \
+	}
+
+#define SHRED_V_APPROX_STORE(result, slow, func) \
+	if(slow) \
+	{ \
+		float lanes[SHRED_V_LANES]; \
+		shred_v_store(lanes, (result)); \
+		shred_v_zeroupper(); \
+		for(uint32_t bits = (slow); bits; bits &= bits - 1) \
+		{ \
+			int j = ShredCtz32(bits); \
+			lanes[j] = func(in[i + j], accuracy); \
+		} \
+		memcpy(out + i, lanes, sizeof(lanes)); \
+	} \
+	else \
+	{ \
+		shred_v_store(out + i, (result)); \
+	}
+
+#define SHRED_V_APPROX_NORMALS \
+	const shred_v_t zero = shred_v_set1(0); \
+	const shred_v_t one = SHRED_V_F(1.0f); \
+	const shred_v_t low = shred_v_set1(float_mantissa_mask + 1); \
+	const shred_v_t range = shred_v_set1(float_exp_mask - \
+		(float_mantissa_mask + 1) - 1);
+
+#define SHRED_V_LOG2_LOOP(poly) \
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES) \
+	{ \
+		shred_v_t v = shred_v_load(in + i); \
+		SHRED_V_APPROX_SKIP(v, SHRED_V_APPROX_SPECIALS(v), slow) \
+		shred_v_t shifted = shred_v_add(v, offset); \
+		shred_v_t k = shred_v_addf(shred_v_add(shred_v_srli(shifted, \
+			float_exp_offset), unbias), unround); \
+		shred_v_t t = shred_v_addf(shred_v_add(shred_v_and(shifted, \
+			mantissa_mask), sqrt_half), minus_one); \
+		shred_v_t result = shred_v_addf(k, shred_v_mulf(t, \
+			poly(SHRED_V_MAD, SHRED_V_F, t))); \
+		SHRED_V_APPROX_STORE(result, slow, ShredFloatLog2Approx) \
+	}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatLog2ApproxArray)
+	(const float* in, float* out, size_t n, ShredApprox accuracy)
+{
+	SHRED_V_APPROX_NORMALS
+	const shred_v_t offset = shred_v_set1((float_exp_bias <<
+		float_exp_offset) - SHRED_LOG2_SQRT_HALF);
+	const shred_v_t mantissa_mask = shred_v_set1(float_mantissa_mask);
+	const shred_v_t sqrt_half = shred_v_set1(SHRED_LOG2_SQRT_HALF);
+	const shred_v_t minus_one = SHRED_V_F(-1.0f);
+	// k goes to float the same way the rounding works, in the mantissa of
+	// 1.5 * 2^23
+	const shred_v_t unbias = shred_v_set1(ShredFloatToData(SHRED_EXP2_ROUND) -
+		float_exp_bias);
+	const shred_v_t unround = SHRED_V_F(-SHRED_EXP2_ROUND);
+	size_t i = 0;
+	switch(accuracy)
+	{
+	case SHRED_APPROX_FAST:
+		SHRED_V_LOG2_LOOP(SHRED_LOG2_FAST)
+		break;
+	case SHRED_APPROX_MEDIUM:
+		SHRED_V_LOG2_LOOP(SHRED_LOG2_MEDIUM)
+		break;
+	default:
+		SHRED_V_LOG2_LOOP(SHRED_LOG2_FULL)
+		break;
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatLog2Approx(in[i], accuracy);
+	}
+}
+
+#define SHRED_V_EXP2_LOOP(poly) \
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES) \
+	{ \
+		shred_v_t v = shred_v_load(in + i); \
+		SHRED_V_APPROX_SKIP(v, shred_v_cmpgt(shred_v_and(v, abs_mask), \
+			limit), slow) \
+		/* subnormals as 0, like the scalar version */ \
+		v = shred_v_and(v, shred_v_cmpgt(shred_v_and(v, abs_mask), \
+			mantissa_mask)); \
+		shred_v_t rounded = shred_v_addf(v, round); \
+		shred_v_t f = shred_v_addf(v, shred_v_addf(SHRED_V_NEG(rounded), \
+			round)); \
+		shred_v_t p = poly(SHRED_V_MAD, SHRED_V_F, f); \
+		shred_v_t result = shred_v_add(p, shred_v_slli( \
+			shred_v_sub(rounded, round), float_exp_offset)); \
+		SHRED_V_APPROX_STORE(result, slow, ShredFloatExp2Approx) \
+	}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatExp2ApproxArray)
+	(const float* in, float* out, size_t n, ShredApprox accuracy)
+{
+	const shred_v_t abs_mask = shred_v_set1(~float_sign_mask);
+	const shred_v_t sign_mask = shred_v_set1(float_sign_mask);
+	const shred_v_t limit = shred_v_set1(ShredFloatToData(SHRED_EXP2_LIMIT) -
+		1);
+	const shred_v_t mantissa_mask = shred_v_set1(float_mantissa_mask);
+	const shred_v_t round = SHRED_V_F(SHRED_EXP2_ROUND);
+	const shred_v_t one = SHRED_V_F(1.0f);
+	size_t i = 0;
+	switch(accuracy)
+	{
+	case SHRED_APPROX_FAST:
+		SHRED_V_EXP2_LOOP(SHRED_EXP2_FAST)
+		break;
+	case SHRED_APPROX_MEDIUM:
+		SHRED_V_EXP2_LOOP(SHRED_EXP2_MEDIUM)
+		break;
+	default:
+		SHRED_V_EXP2_LOOP(SHRED_EXP2_FULL)
+		break;
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatExp2Approx(in[i], accuracy);
+	}
+}
+
+// ShredFloatRsqrtNormal on v at `accuracy`, into y
+#define SHRED_V_RSQRT(v, y, accuracy) \
+	shred_v_t y = shred_v_sub(magic, shred_v_srli((v), 1)); \
+	y = shred_v_mulf(shred_v_mulf(scale, y), shred_v_addf(offset, \
+		SHRED_V_NEG(shred_v_mulf(shred_v_mulf((v), y), y)))); \
+	if((accuracy) >= SHRED_APPROX_MEDIUM) \
+	{ \
+		shred_v_t half = shred_v_mulf(one_half, (v)); \
+		y = shred_v_mulf(y, shred_v_addf(three_halves, \
+			SHRED_V_NEG(shred_v_mulf(shred_v_mulf(half, y), y)))); \
+		if((accuracy) >= SHRED_APPROX_FULL) \
+		{ \
+			y = shred_v_addf(y, shred_v_mulf(y, shred_v_addf(one_half, \
+				SHRED_V_NEG(shred_v_mulf(shred_v_mulf(half, y), y))))); \
+		} \
+	}
+
+#define SHRED_V_RSQRT_CONSTS \
+	SHRED_V_APPROX_NORMALS \
+	const shred_v_t sign_mask = shred_v_set1(float_sign_mask); \
+	const shred_v_t magic = shred_v_set1(SHRED_RSQRT_MAGIC); \
+	const shred_v_t scale = SHRED_V_F(SHRED_RSQRT_SCALE); \
+	const shred_v_t offset = SHRED_V_F(SHRED_RSQRT_OFFSET); \
+	const shred_v_t one_half = SHRED_V_F(0.5f); \
+	const shred_v_t three_halves = SHRED_V_F(1.5f);
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatRsqrtApproxArray)
+	(const float* in, float* out, size_t n, ShredApprox accuracy)
+{
+	SHRED_V_RSQRT_CONSTS
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		SHRED_V_APPROX_SKIP(v, SHRED_V_APPROX_SPECIALS(v), slow)
+		SHRED_V_RSQRT(v, y, accuracy)
+		SHRED_V_APPROX_STORE(y, slow, ShredFloatRsqrtApprox)
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatRsqrtApprox(in[i], accuracy);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatSqrtApproxArray)
+	(const float* in, float* out, size_t n, ShredApprox accuracy)
+{
+	SHRED_V_RSQRT_CONSTS
+	bool heron = accuracy >= SHRED_APPROX_FULL;
+	ShredApprox rsqrt_accuracy = heron ? SHRED_APPROX_MEDIUM : accuracy;
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		SHRED_V_APPROX_SKIP(v, SHRED_V_APPROX_SPECIALS(v), slow)
+		SHRED_V_RSQRT(v, y, rsqrt_accuracy)
+		shred_v_t s = shred_v_mulf(v, y);
+		if(heron)
+		{
+			s = shred_v_addf(s, shred_v_mulf(shred_v_mulf(one_half, y),
+				shred_v_addf(v, SHRED_V_NEG(shred_v_mulf(s, s)))));
+		}
+		SHRED_V_APPROX_STORE(s, slow, ShredFloatSqrtApprox)
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatSqrtApprox(in[i], accuracy);
+	}
+}
+
+SHRED_NO_CONTRACT_END
+
+#undef SHRED_V_F
+#undef SHRED_V_MAD
+#undef SHRED_V_NEG
+#undef SHRED_V_APPROX_SPECIALS
+#undef SHRED_V_APPROX_SKIP
+#undef SHRED_V_APPROX_STORE
+#undef SHRED_V_APPROX_NORMALS
+#undef SHRED_V_LOG2_LOOP
+#undef SHRED_V_EXP2_LOOP
+#undef SHRED_V_RSQRT
+#undef SHRED_V_RSQRT_CONSTS
+
+#undef SHRED_V_ULP_INDEX
+#undef SHRED_V_CMPGT_U
+#undef SHRED_V_ULP_RUN
+
+/*
+	The plane kernels work in blocks of at least 8 floats so every block
+	fills whole bytes of the sign plane. Whatever's left at the end (less
+	than a block, always starting on a byte boundary) goes to the scalar
+	version.
+*/
+#define SHRED_V_BLOCK (SHRED_V_LANES < 8 ? 8 : SHRED_V_LANES)
+#define SHRED_V_LINE 64
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatSplitPlanes)
+	(const float* in, size_t n, uint8_t* signs, uint8_t* exponents,
+	uint32_t* mantissas)
+{
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	const shred_v_t mantissa_mask = shred_v_set1(float_mantissa_mask);
+	size_t i = 0;
+	for(; i + SHRED_V_BLOCK <= n; i += SHRED_V_BLOCK)
+	{
+		uint32_t sign_bits = 0;
+		for(size_t j = 0; j < SHRED_V_BLOCK; j += SHRED_V_LANES)
+		{
+			shred_v_t v = shred_v_load(in + i + j);
+			sign_bits |= shred_v_signbits(v) << j;
+			shred_v_store_u8(exponents + i + j, shred_v_srli(
+				shred_v_and(v, exp_mask), float_exp_offset));
+			shred_v_store(mantissas + i + j, shred_v_and(v, mantissa_mask));
+		}
+		for(size_t k = 0; k < SHRED_V_BLOCK / 8; k++)
+		{
+			signs[i / 8 + k] = (uint8_t)(sign_bits >> (8 * k));
+		}
+	}
+	ShredFloatSplitPlanes_scalar(in + i, n - i, signs + i / 8,
+		exponents + i, mantissas + i);
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatJoinPlanes)
+	(const uint8_t* signs, const uint8_t* exponents,
+	const uint32_t* mantissas, size_t n, float* out)
+{
+	const shred_v_t sign_mask = shred_v_set1(float_sign_mask);
+	const shred_v_t mantissa_mask = shred_v_set1(float_mantissa_mask);
+	size_t i = 0;
+	for(; i + SHRED_V_BLOCK <= n; i += SHRED_V_BLOCK)
+	{
+		uint32_t sign_bits = 0;
+		for(size_t k = 0; k < SHRED_V_BLOCK / 8; k++)
+		{
+			sign_bits |= (uint32_t)signs[i / 8 + k] << (8 * k);
+		}
+		for(size_t j = 0; j < SHRED_V_BLOCK; j += SHRED_V_LANES)
+		{
+			shred_v_t exp = shred_v_slli(shred_v_load_u8(exponents + i + j),
+				float_exp_offset);
+			shred_v_t mant = shred_v_and(shred_v_load(mantissas + i + j),
+				mantissa_mask);
+			shred_v_t sign = shred_v_select_bits(sign_bits >> j, sign_mask);
+			shred_v_store(out + i + j, shred_v_or(shred_v_or(exp, mant), sign));
+		}
+	}
+	ShredFloatJoinPlanes_scalar(signs + i / 8, exponents + i, mantissas + i,
+		n - i, out + i);
+}
+
+/*
+	Where the instruction set can move bytes around directly the shuffles
+	go through shred_v_byte_shuffle, otherwise each byte plane gets shifted
+	down out of the lanes and stored a byte per lane.
+*/
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatByteShuffle)
+	(const float* in, size_t n, uint8_t* out)
+{
+	size_t i = 0;
+#if defined(shred_v_byte_shuffle)
+	for(; i + 4 * SHRED_V_LANES <= n; i += 4 * SHRED_V_LANES)
+	{
+		shred_v_byte_shuffle(in + i, out + i, n);
+	}
+#else
+	const shred_v_t byte_mask = shred_v_set1(0xFF);
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		for(int k = 0; k < float_bit_width / 8; k++)
+		{
+			shred_v_store_u8(out + k * n + i, shred_v_and(shred_v_srli(v,
+				float_bit_width - 8 - 8 * k), byte_mask));
+		}
+	}
+#endif
+	ShredFloatByteShuffle_tail(in, i, n, out);
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatByteUnshuffle)
+	(const uint8_t* in, size_t n, float* out)
+{
+	size_t i = 0;
+#if defined(shred_v_byte_unshuffle)
+	for(; i + 4 * SHRED_V_LANES <= n; i += 4 * SHRED_V_LANES)
+	{
+		shred_v_byte_unshuffle(in + i, n, out + i);
+	}
+#else
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load_u8(in + i);
+		for(int k = 1; k < float_bit_width / 8; k++)
+		{
+			v = shred_v_or(shred_v_slli(v, 8),
+				shred_v_load_u8(in + k * n + i));
+		}
+		shred_v_store(out + i, v);
+	}
+#endif
+	ShredFloatByteUnshuffle_tail(in, i, n, out);
+}
+
+/*
+	The bit shuffles go a byte plane at a time when they can: shifting
+	every lane left by s moves bit 7 - s of every byte to the top of that
+	byte, so eight store_bytesigns write the eight bit planes of a whole
+	vector of bytes. Each block of 4 * SHRED_V_LANES floats is byte
+	shuffled into `bytes` first (one vector per byte plane) to get there.
+
+	Without those, signbits on the floats shifted left by b gives bit plane
+	b for one vector of floats at a time.
+*/
+#if defined(shred_v_byte_shuffle) && defined(shred_v_store_bytesigns)
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatBitShuffle)
+	(const float* in, size_t n, uint8_t* out)
+{
+	size_t plane = ShredSignPlaneSize(n);
+	uint8_t bytes[4 * 4 * SHRED_V_LANES];
+	uint8_t lines[32][SHRED_V_LINE];
+	size_t i = 0;
+	for(; i + 8 * SHRED_V_LINE <= n; i += 8 * SHRED_V_LINE)
+	{
+		for(size_t j = 0; j < 8 * SHRED_V_LINE; j += 4 * SHRED_V_LANES)
+		{
+			shred_v_byte_shuffle(in + i + j, bytes, 4 * SHRED_V_LANES);
+			for(int k = 0; k < 4; k++)
+			{
+				shred_v_t v = shred_v_load(bytes + k * 4 * SHRED_V_LANES);
+				for(int s = 0; s < 8; s++)
+				{
+					shred_v_store_bytesigns(&lines[8 * k + s][j / 8],
+						shred_v_slli(v, s));
+				}
+			}
+		}
+		for(int b = 0; b < float_bit_width; b++)
+		{
+			memcpy(out + b * plane + i / 8, lines[b], SHRED_V_LINE);
+		}
+	}
+	ShredFloatBitShuffle_tail(in, i, n, out);
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatBitUnshuffle)
+	(const uint8_t* in, size_t n, float* out)
+{
+	size_t plane = ShredSignPlaneSize(n);
+	uint8_t bytes[4 * 4 * SHRED_V_LANES];
+	uint8_t lines[32][SHRED_V_LINE];
+	size_t i = 0;
+	for(; i + 8 * SHRED_V_LINE <= n; i += 8 * SHRED_V_LINE)
+	{
+		for(int b = 0; b < float_bit_width; b++)
+		{
+			memcpy(lines[b], in + b * plane + i / 8, SHRED_V_LINE);
+		}
+		for(size_t j = 0; j < 8 * SHRED_V_LINE; j += 4 * SHRED_V_LANES)
+		{
+			for(int k = 0; k < 4; k++)
+			{
+				shred_v_t v = shred_v_set1(0);
+				for(int s = 0; s < 8; s++)
+				{
+					shred_v_t mask = shred_v_load_bytemask(
+						&lines[8 * k + s][j / 8]);
+					v = shred_v_or(v, shred_v_and(mask,
+						shred_v_set1((0x80u >> s) * 0x01010101u)));
+				}
+				shred_v_store(bytes + k * 4 * SHRED_V_LANES, v);
+			}
+			shred_v_byte_unshuffle(bytes, 4 * SHRED_V_LANES, out + i + j);
+		}
+	}
+	ShredFloatBitUnshuffle_tail(in, i, n, out);
+}
+#else
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatBitShuffle)
+	(const float* in, size_t n, uint8_t* out)
+{
+	size_t plane = ShredSignPlaneSize(n);
+	size_t i = 0;
+	for(; i + SHRED_V_BLOCK <= n; i += SHRED_V_BLOCK)
+	{
+		shred_v_t v[SHRED_V_BLOCK / SHRED_V_LANES];
+		for(size_t j = 0; j < SHRED_V_BLOCK / SHRED_V_LANES; j++)
+		{
+			v[j] = shred_v_load(in + i + j * SHRED_V_LANES);
+		}
+		for(int b = 0; b < float_bit_width; b++)
+		{
+			uint32_t bits = 0;
+			for(size_t j = 0; j < SHRED_V_BLOCK / SHRED_V_LANES; j++)
+			{
+				bits |= shred_v_signbits(shred_v_slli(v[j], b)) <<
+					(j * SHRED_V_LANES);
+			}
+			for(size_t k = 0; k < SHRED_V_BLOCK / 8; k++)
+			{
+				out[b * plane + i / 8 + k] = (uint8_t)(bits >> (8 * k));
+			}
+		}
+	}
+	ShredFloatBitShuffle_tail(in, i, n, out);
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatBitUnshuffle)
+	(const uint8_t* in, size_t n, float* out)
+{
+	size_t plane = ShredSignPlaneSize(n);
+	size_t i = 0;
+	for(; i + SHRED_V_BLOCK <= n; i += SHRED_V_BLOCK)
+	{
+		uint32_t bits[32];
+		for(int b = 0; b < float_bit_width; b++)
+		{
+			bits[b] = 0;
+			for(size_t k = 0; k < SHRED_V_BLOCK / 8; k++)
+			{
+				bits[b] |= (uint32_t)in[b * plane + i / 8 + k] << (8 * k);
+			}
+		}
+		for(size_t j = 0; j < SHRED_V_BLOCK; j += SHRED_V_LANES)
+		{
+			shred_v_t v = shred_v_set1(0);
+			for(int b = 0; b < float_bit_width; b++)
+			{
+				v = shred_v_or(v, shred_v_select_bits(bits[b] >> j,
+					shred_v_set1((uint32_t)1 << (float_bit_width - 1 - b))));
+			}
+			shred_v_store(out + i + j, v);
+		}
+	}
+	ShredFloatBitUnshuffle_tail(in, i, n, out);
+}
+#endif
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatClassifyMasks)
+	(const float* in, size_t n, uint8_t* const* masks)
+{
+	SHRED_V_CLASS_CONSTS
+	const uint32_t all = ((uint32_t)1 << SHRED_V_BLOCK) - 1;
+	size_t i = 0;
+	for(; i + SHRED_V_BLOCK <= n; i += SHRED_V_BLOCK)
+	{
+		uint32_t zero_bits = 0;
+		uint32_t sub_bits = 0;
+		uint32_t normal_bits = 0;
+		uint32_t inf_bits = 0;
+		for(size_t j = 0; j < SHRED_V_BLOCK; j += SHRED_V_LANES)
+		{
+			SHRED_V_CLASS_BOUNDS(shred_v_load(in + i + j))
+			zero_bits |= shred_v_signbits(past_zero) << j;
+			sub_bits |= shred_v_signbits(past_sub) << j;
+			normal_bits |= shred_v_signbits(past_normal) << j;
+			inf_bits |= shred_v_signbits(past_inf) << j;
+		}
+		uint32_t bits[SHRED_CLASS_COUNT];
+		bits[SHRED_CLASS_ZERO] = ~zero_bits & all;
+		bits[SHRED_CLASS_SUBNORMAL] = zero_bits & ~sub_bits;
+		bits[SHRED_CLASS_NORMAL] = sub_bits & ~normal_bits;
+		bits[SHRED_CLASS_INFINITE] = normal_bits & ~inf_bits;
+		bits[SHRED_CLASS_NAN] = inf_bits;
+		for(int c = 0; c < SHRED_CLASS_COUNT; c++)
+		{
+			if(!masks[c])
+			{
+				continue;
+			}
+			for(size_t k = 0; k < SHRED_V_BLOCK / 8; k++)
+			{
+				masks[c][i / 8 + k] = (uint8_t)(bits[c] >> (8 * k));
+			}
+		}
+	}
+	uint8_t* tail[SHRED_CLASS_COUNT];
+	for(int c = 0; c < SHRED_CLASS_COUNT; c++)
+	{
+		tail[c] = masks[c] ? masks[c] + i / 8 : NULL;
+	}
+	ShredFloatClassifyMasks_scalar(in + i, n - i, tail);
+}
+
+#undef SHRED_V_CLASS_BOUNDS
+#undef SHRED_V_CLASS_CONSTS
+#undef SHRED_V_BLOCK
+#undef SHRED_V_LINE
+
+/*
+	Conversions to and from the 16-bit formats. Halves use the hardware
+	conversion if this instruction set has one and the scalar version if it
+	doesn't. bfloat16 is the scalar rounding done a vector at a time.
+*/
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatToHalfArray)
+	(const float* in, ShredHalf* out, size_t n)
+{
+	size_t i = 0;
+#if defined(shred_v_store_half)
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_store_half(out + i, shred_v_load(in + i));
+	}
+#endif
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatToHalf(in[i]);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredHalfToFloatArray)
+	(const ShredHalf* in, float* out, size_t n)
+{
+	size_t i = 0;
+#if defined(shred_v_load_half)
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_store(out + i, shred_v_load_half(in + i));
+	}
+#endif
+	for(; i < n; i++)
+	{
+		out[i] = ShredHalfToFloat(in[i]);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatToBFloat16Array)
+	(const float* in, ShredBFloat16* out, size_t n)
+{
+	const shred_v_t abs_mask = shred_v_set1(~float_sign_mask);
+	const shred_v_t exp_mask = shred_v_set1(float_exp_mask);
+	const shred_v_t round = shred_v_set1(0x7FFF);
+	const shred_v_t one = shred_v_set1(1);
+	const shred_v_t quiet = shred_v_set1(0x40);
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_t v = shred_v_load(in + i);
+		shred_v_t is_nan = shred_v_cmpgt(shred_v_and(v, abs_mask), exp_mask);
+		shred_v_t odd = shred_v_and(shred_v_srli(v, 16), one);
+		shred_v_t rounded = shred_v_srli(
+			shred_v_add(v, shred_v_add(round, odd)), 16);
+		shred_v_t nan = shred_v_or(shred_v_srli(v, 16), quiet);
+		shred_v_store_u16(out + i, shred_v_or(shred_v_and(is_nan, nan),
+			shred_v_andnot(is_nan, rounded)));
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredFloatToBFloat16(in[i]);
+	}
+}
+
+SHRED_TARGET static inline void SHRED_KERNEL(ShredBFloat16ToFloatArray)
+	(const ShredBFloat16* in, float* out, size_t n)
+{
+	size_t i = 0;
+	for(; i + SHRED_V_LANES <= n; i += SHRED_V_LANES)
+	{
+		shred_v_store(out + i, shred_v_slli(shred_v_load_u16(in + i), 16));
+	}
+	for(; i < n; i++)
+	{
+		out[i] = ShredBFloat16ToFloat(in[i]);
+	}
+}
+
+/*
+	Block floating point, see ShredFloatToBlockInt8. Every whole block
+	finds its largest magnitude with a vector max (the raw data without the
+	sign compares the same way the magnitudes do), then gets scaled and
+	rounded with the same multiply and add as ShredBlockQuantize. Going
+	back, the integers get sign extended and turned into floats by putting
+	them in the low bits of SHRED_BLOCK_ROUND and subtracting it again.
+	Whatever's left of a block that doesn't fill a vector, and a short last
+	block, go through the scalar code.
+*/
+#define SHRED_V_BLOCK_KERNELS(Width, int_t, store_int, load_int, sign) \
+SHRED_TARGET static inline void SHRED_KERNEL(ShredFloatToBlockInt##Width) \
+	(const float* in, size_t n, size_t block_size, int bits, uint8_t* exps, \
+	int_t* out) \
+{ \
+	const shred_v_t abs_mask = shred_v_set1(~float_sign_mask); \
+	const shred_v_t round = shred_v_set1(SHRED_BLOCK_ROUND); \
+	const shred_v_t low = shred_v_set1(((uint32_t)sign << 1) - 1); \
+	int32_t most = ((int32_t)1 << (bits - 1)) - 1; \
+	const shred_v_t vmost = shred_v_set1(most); \
+	const shred_v_t vleast = shred_v_set1(-most); \
+	for(size_t first = 0; first < n; first += block_size) \
+	{ \
+		const float* block = in + first; \
+		int_t* block_out = out + first; \
+		size_t len = n - first; \
+		if(len < block_size || block_size < SHRED_V_LANES) \
+		{ \
+			len = len < block_size ? len : block_size; \
+			*exps++ = ShredFloatToBlockInt##Width##_block(block, len, bits, \
+				block_out); \
+			continue; \
+		} \
+		len = block_size; \
+		shred_v_t vtop = shred_v_set1(0); \
+		size_t i = 0; \
+		for(; i + SHRED_V_LANES <= len; i += SHRED_V_LANES) \
+		{ \
+			shred_v_t v = shred_v_and(shred_v_load(block + i), abs_mask); \
+			vtop = SHRED_V_SELECT(shred_v_cmpgt(v, vtop), v, vtop); \
+		} \
+		uint32_t top = (uint32_t)shred_v_hmax(vtop); \
+		for(; i < len; i++) \
+		{ \
+			uint32_t data = ShredFloatToData(block[i]) & ~float_sign_mask; \
+			top = data > top ? data : top; \
+		} \
+		uint32_t exp = ShredBlockExp(top, bits); \
+		*exps++ = (uint8_t)exp; \
+		if(exp == SHRED_BLOCK_NAN) \
+		{ \
+			memset(block_out, 0, len * sizeof(int_t)); \
+			continue; \
+		} \
+		float scale = ShredBlockScale(exp, bits); \
+		uint32_t floor = ShredBlockFloor(exp, bits); \
+		const shred_v_t vscale = shred_v_set1(ShredFloatToData(scale)); \
+		/* one below, so a signed compare works for it */ \
+		const shred_v_t vfloor = shred_v_set1(floor - (floor > 0)); \
+		for(i = 0; i + SHRED_V_LANES <= len; i += SHRED_V_LANES) \
+		{ \
+			shred_v_t v = shred_v_load(block + i); \
+			v = shred_v_and(v, shred_v_cmpgt(shred_v_and(v, abs_mask), \
+				vfloor)); \
+			shred_v_t q = shred_v_sub(shred_v_addf(shred_v_mulf(v, vscale), \
+				round), round); \
+			/* all ones is -1, taking back a round past either end */ \
+			q = shred_v_add(q, shred_v_cmpgt(q, vmost)); \
+			q = shred_v_sub(q, shred_v_cmpgt(vleast, q)); \
+			store_int(block_out + i, shred_v_and(q, low)); \
+		} \
+		for(; i < len; i++) \
+		{ \
+			block_out[i] = (int_t)ShredBlockQuantize(block[i], scale, floor, \
+				most); \
+		} \
+	} \
+} \
+\
+SHRED_TARGET static inline void SHRED_KERNEL(ShredBlockInt##Width##ToFloat) \
+	(const uint8_t* exps, const int_t* in, size_t n, size_t block_size, \
+	int bits, float* out) \
+{ \
+	const shred_v_t round = shred_v_set1(SHRED_BLOCK_ROUND); \
+	const shred_v_t unround = shred_v_set1(SHRED_BLOCK_ROUND | \
+		float_sign_mask); \
+	const shred_v_t vsign = shred_v_set1(sign); \
+	for(size_t first = 0; first < n; first += block_size) \
+	{ \
+		const int_t* block = in + first; \
+		float* block_out = out + first; \
+		size_t len = n - first; \
+		uint8_t exp = *exps++; \
+		if(len < block_size || block_size < SHRED_V_LANES || \
+			exp == SHRED_BLOCK_NAN) \
+		{ \
+			len = len < block_size ? len : block_size; \
+			ShredBlockInt##Width##ToFloat_block(exp, block, len, bits, \
+				block_out); \
+			continue; \
+		} \
+		len = block_size; \
+		float step = ShredBlockStep(exp, bits); \
+		const shred_v_t vstep = shred_v_set1(ShredFloatToData(step)); \
+		size_t i = 0; \
+		for(; i + SHRED_V_LANES <= len; i += SHRED_V_LANES) \
+		{ \
+			shred_v_t v = load_int(block + i); \
+			/* sign extend: take the sign bit off twice */ \
+			v = shred_v_sub(v, shred_v_slli(shred_v_and(v, vsign), 1)); \
+			v = shred_v_addf(shred_v_add(v, round), unround); \
+			shred_v_store(block_out + i, shred_v_mulf(v, vstep)); \
+		} \
+		for(; i < len; i++) \
+		{ \
+			block_out[i] = (float)block[i] * step; \
+		} \
+	} \
+}
+
+SHRED_V_BLOCK_KERNELS(8, int8_t, shred_v_store_u8, shred_v_load_u8, 0x80)
+SHRED_V_BLOCK_KERNELS(16, int16_t, shred_v_store_u16, shred_v_load_u16, 0x8000)
+
+#undef SHRED_V_BLOCK_KERNELS
+#undef SHRED_V_SELECT
+
+#undef SHRED_ISA
+#undef SHRED_TARGET
+#undef SHRED_V_LANES
+#undef shred_v_t
+#undef shred_v_load
+#undef shred_v_store
+#undef shred_v_store_u8
+#undef shred_v_set1
+#undef shred_v_and
+#undef shred_v_or
+#undef shred_v_andnot
+#undef shred_v_add
+#undef shred_v_sub
+#undef shred_v_slli
+#undef shred_v_srli
+#undef shred_v_cmpeq
+#undef shred_v_addf
+#undef shred_v_subf
+#undef shred_v_mulf
+#undef shred_v_divf
+#undef shred_v_hmax
+#undef shred_v_bswap
+#undef shred_v_load_u8
+#undef shred_v_signbits
+#undef shred_v_select_bits
+#undef shred_v_cmpgt
+#undef shred_v_load_u16
+#undef shred_v_store_u16
+#undef shred_v_load_half
+#undef shred_v_store_half
+#undef shred_v_byte_shuffle
+#undef shred_v_byte_unshuffle
+#undef shred_v_store_bytesigns
+#undef shred_v_load_bytemask
+#undef shred_v_zeroupper
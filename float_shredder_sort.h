@@ -0,0 +1,333 @@
+#ifndef float_shredder_sort
+#define float_shredder_sort
+
+#include "float_shredder.h"
+
+/*
+	Radix sorting floats by their raw bits.
+
+	Flipping the sign bit of a positive float, or every bit of a negative
+	one, turns its raw data into an unsigned key that sorts in the same
+	order as the floats do (that's ShredFloatToOrderedKey). Negative
+	floats get more negative as their magnitude goes up, so flipping all of
+	their bits turns that order around, and flipping the sign bit of the
+	positive ones puts all of them above the negative ones. That means
+	floats can be sorted as plain integers: least significant digit first,
+	SHRED_RADIX_BITS bits at a time, each pass a stable counting sort on
+	one digit.
+
+	The order comes out as -NaN, -infinity, ..., -0, +0, ..., +infinity,
+	+NaN, which is IEEE 754's totalOrder. So -0 sorts before +0, and NaNs
+	go to whichever end their sign bit says.
+
+	Before any sorting, one pass over the data counts every digit at once.
+	A digit where every key lands in the same bucket (the top digit when the
+	data is all positive and about the same size, say) would just copy the
+	data across unchanged, so that pass gets skipped.
+
+	The sort needs scratch space as big as the data, plus the counts.
+	ShredFloatRadixSort and ShredFloatRadixSortPairs allocate it
+	themselves and return false if they can't. ShredFloatRadixSortScratch
+	takes ShredFloatRadixScratchSize(n, values) bytes from you instead.
+	See ShredFloatRadixSortParallel in float_shredder_threads.h for the
+	multithreaded one.
+*/
+#ifndef SHRED_RADIX_BITS
+#define SHRED_RADIX_BITS 11
+#endif
+#define SHRED_RADIX_BUCKETS ((size_t)1 << SHRED_RADIX_BITS)
+#define SHRED_RADIX_PASSES(bit_width) \
+	(((bit_width) + SHRED_RADIX_BITS - 1) / SHRED_RADIX_BITS)
+
+#define SHRED_DEFINE_RADIX_SORT(Name, real_t, bits_t, prefix, bit_width) \
+static inline SHRED_CONSTEXPR bits_t Shred##Name##RadixKey(bits_t data) \
+{ \
+	return Shred##Name##ToOrderedKey(ShredDataTo##Name(data)); \
+} \
+\
+/* adds the digits of n keys to the counts of every pass */ \
+static inline void Shred##Name##RadixCount(const real_t* in, size_t n, \
+	size_t* counts) \
+{ \
+	for(size_t i = 0; i < n; i++) \
+	{ \
+		bits_t key = Shred##Name##RadixKey(Shred##Name##ToData(in[i])); \
+		for(int p = 0; p < SHRED_RADIX_PASSES(bit_width); p++) \
+		{ \
+			counts[p * SHRED_RADIX_BUCKETS + \
+				((key >> (p * SHRED_RADIX_BITS)) & \
+				(SHRED_RADIX_BUCKETS - 1))]++; \
+		} \
+	} \
+} \
+\
+/* \
+	A pass is pointless when all n keys have the same digit. Any key's \
+	digit will do to check that, so it's the first one. \
+*/ \
+static inline bool Shred##Name##RadixTrivial(const real_t* in, size_t n, \
+	const size_t* counts, int pass) \
+{ \
+	if(n == 0) \
+	{ \
+		return true; \
+	} \
+	bits_t key = Shred##Name##RadixKey(Shred##Name##ToData(in[0])); \
+	return counts[(key >> (pass * SHRED_RADIX_BITS)) & \
+		(SHRED_RADIX_BUCKETS - 1)] == n; \
+} \
+\
+/* \
+	Moves in[begin, end) (and the values with them, if there are any) to \
+	where `offsets` says each digit goes next, bumping the offsets as it \
+	goes. \
+*/ \
+static inline void Shred##Name##RadixScatter(const real_t* in, \
+	const bits_t* values_in, size_t begin, size_t end, real_t* out, \
+	bits_t* values_out, int pass, size_t* offsets) \
+{ \
+	int shift = pass * SHRED_RADIX_BITS; \
+	if(values_in) \
+	{ \
+		for(size_t i = begin; i < end; i++) \
+		{ \
+			bits_t key = Shred##Name##RadixKey(Shred##Name##ToData(in[i])); \
+			size_t at = offsets[(key >> shift) & (SHRED_RADIX_BUCKETS - 1)]++; \
+			out[at] = in[i]; \
+			values_out[at] = values_in[i]; \
+		} \
+	} else { \
+		for(size_t i = begin; i < end; i++) \
+		{ \
+			bits_t key = Shred##Name##RadixKey(Shred##Name##ToData(in[i])); \
+			out[offsets[(key >> shift) & (SHRED_RADIX_BUCKETS - 1)]++] = \
+				in[i]; \
+		} \
+	} \
+} \
+\
+static inline size_t Shred##Name##RadixScratchSize(size_t n, bool values) \
+{ \
+	return SHRED_RADIX_PASSES(bit_width) * SHRED_RADIX_BUCKETS * \
+		sizeof(size_t) + n * sizeof(real_t) + \
+		(values ? n * sizeof(bits_t) : 0); \
+} \
+\
+/* \
+	Sorts keys[0, n) in place, carrying values[i] along with keys[i] if \
+	values isn't NULL. The sort is stable. \
+*/ \
+static inline void Shred##Name##RadixSortScratch(real_t* keys, \
+	bits_t* values, size_t n, void* scratch) \
+{ \
+	size_t* counts = (size_t*)scratch; \
+	real_t* keys_tmp = (real_t*)(void*)(counts + \
+		SHRED_RADIX_PASSES(bit_width) * SHRED_RADIX_BUCKETS); \
+	bits_t* values_tmp = values ? (bits_t*)(void*)(keys_tmp + n) : NULL; \
+	memset(counts, 0, SHRED_RADIX_PASSES(bit_width) * SHRED_RADIX_BUCKETS * \
+		sizeof(size_t)); \
+	Shred##Name##RadixCount(keys, n, counts); \
+\
+	real_t* src = keys; \
+	real_t* dst = keys_tmp; \
+	bits_t* values_src = values; \
+	bits_t* values_dst = values_tmp; \
+	for(int p = 0; p < SHRED_RADIX_PASSES(bit_width); p++) \
+	{ \
+		size_t* offsets = counts + p * SHRED_RADIX_BUCKETS; \
+		if(Shred##Name##RadixTrivial(src, n, offsets, p)) \
+		{ \
+			continue; \
+		} \
+		size_t total = 0; \
+		for(size_t b = 0; b < SHRED_RADIX_BUCKETS; b++) \
+		{ \
+			size_t count = offsets[b]; \
+			offsets[b] = total; \
+			total += count; \
+		} \
+		Shred##Name##RadixScatter(src, values_src, 0, n, dst, values_dst, p, \
+			offsets); \
+		real_t* swap = src; \
+		src = dst; \
+		dst = swap; \
+		bits_t* values_swap = values_src; \
+		values_src = values_dst; \
+		values_dst = values_swap; \
+	} \
+	if(src != keys) \
+	{ \
+		memcpy(keys, src, n * sizeof(real_t)); \
+		if(values) \
+		{ \
+			memcpy(values, values_src, n * sizeof(bits_t)); \
+		} \
+	} \
+} \
+\
+static inline bool Shred##Name##RadixSortPairs(real_t* keys, bits_t* values, \
+	size_t n) \
+{ \
+	void* scratch = malloc(Shred##Name##RadixScratchSize(n, values != NULL)); \
+	if(!scratch) \
+	{ \
+		return false; \
+	} \
+	Shred##Name##RadixSortScratch(keys, values, n, scratch); \
+	free(scratch); \
+	return true; \
+} \
+\
+static inline bool Shred##Name##RadixSort(real_t* keys, size_t n) \
+{ \
+	return Shred##Name##RadixSortPairs(keys, NULL, n); \
+}
+
+SHRED_DEFINE_RADIX_SORT(Float, float, uint32_t, float, 32)
+SHRED_DEFINE_RADIX_SORT(Double, double, uint64_t, double, 64)
+
+/*
+	Partitioning floats by exponent.
+
+	ShredFloatExpPartition scatters n floats into SHRED_PARTITION_BUCKETS
+	contiguous buckets, one for each biased exponent (ShredFloatExpUnbiased,
+	so bucket 0 has the zeros and subnormals and bucket 255 the infs and
+	NaNs), keeping the order they came in within each bucket. Afterwards
+	bucket b is out[offsets[b], offsets[b + 1]), so `offsets` needs
+	SHRED_PARTITION_BUCKETS + 1 entries.
+
+	It's one stable counting sort pass, like the radix sort above, with two
+	changes for a single pass over data that's too big for the cache:
+
+	The counting goes into 4 sets of counters the same way ShredHistogram
+	does, since real data sits in a handful of binades and would otherwise
+	keep incrementing the same counter.
+
+	The scatter goes through a cache line sized buffer for every bucket
+	(software write combining). Scattering straight to 256 places keeps up
+	to 256 partly written lines and pages in flight, and every one of them
+	has to be read in before it can be written. Through the buffers each
+	bucket's output gets written a whole aligned cache line at a time
+	instead, with only the partial lines at the ends of a bucket written
+	piecemeal.
+
+	`in` and `out` can't overlap.
+*/
+#define SHRED_PARTITION_BUCKETS 256
+#define SHRED_PARTITION_LINE (64 / sizeof(float))
+
+typedef struct ShredPartitionBuffer
+{
+	float lines[SHRED_PARTITION_BUCKETS][SHRED_PARTITION_LINE];
+	// where in `out` the bucket's part of its line goes
+	size_t at[SHRED_PARTITION_BUCKETS];
+	// the lines are lined up with the cache lines of `out`, so the first
+	// one of a bucket can start partway in. The bucket's floats are
+	// lines[first, fill).
+	uint8_t first[SHRED_PARTITION_BUCKETS];
+	uint8_t fill[SHRED_PARTITION_BUCKETS];
+} ShredPartitionBuffer;
+
+// adds how many of in[0, n) have each exponent to counts
+static inline void ShredFloatExpCount(const float* in, size_t n,
+	size_t* counts)
+{
+	uint32_t sets[4][SHRED_PARTITION_BUCKETS];
+	memset(sets, 0, sizeof(sets));
+	while(n > 0)
+	{
+		// so the 32-bit counters can't overflow
+		size_t block = n < SHRED_HISTOGRAM_BLOCK ? n : SHRED_HISTOGRAM_BLOCK;
+		size_t i = 0;
+		for(; i + 4 <= block; i += 4)
+		{
+			sets[0][ShredFloatExpUnbiased(in[i])]++;
+			sets[1][ShredFloatExpUnbiased(in[i + 1])]++;
+			sets[2][ShredFloatExpUnbiased(in[i + 2])]++;
+			sets[3][ShredFloatExpUnbiased(in[i + 3])]++;
+		}
+		for(; i < block; i++)
+		{
+			sets[0][ShredFloatExpUnbiased(in[i])]++;
+		}
+		for(int set = 0; set < 4; set++)
+		{
+			for(size_t b = 0; b < SHRED_PARTITION_BUCKETS; b++)
+			{
+				counts[b] += sets[set][b];
+				sets[set][b] = 0;
+			}
+		}
+		in += block;
+		n -= block;
+	}
+}
+
+/*
+	Scatters in[0, n) to out, each float going to offsets[its exponent],
+	and bumps the offsets as it goes. The offsets have to leave room for
+	every float, like they do after ShredFloatExpCount and adding them up.
+*/
+static inline void ShredFloatExpScatter(const float* in, size_t n, float* out,
+	size_t* offsets)
+{
+	ShredPartitionBuffer buffer;
+	for(size_t b = 0; b < SHRED_PARTITION_BUCKETS; b++)
+	{
+		size_t misalign = ((uintptr_t)(out + offsets[b]) / sizeof(float)) %
+			SHRED_PARTITION_LINE;
+		buffer.at[b] = offsets[b];
+		buffer.first[b] = (uint8_t)misalign;
+		buffer.fill[b] = (uint8_t)misalign;
+	}
+	for(size_t i = 0; i < n; i++)
+	{
+		uint32_t b = ShredFloatExpUnbiased(in[i]);
+		uint8_t fill = buffer.fill[b];
+		buffer.lines[b][fill++] = in[i];
+		if(fill == SHRED_PARTITION_LINE)
+		{
+			uint8_t first = buffer.first[b];
+			memcpy(out + buffer.at[b], &buffer.lines[b][first],
+				(SHRED_PARTITION_LINE - first) * sizeof(float));
+			buffer.at[b] += SHRED_PARTITION_LINE - first;
+			buffer.first[b] = 0;
+			fill = 0;
+		}
+		buffer.fill[b] = fill;
+	}
+	for(size_t b = 0; b < SHRED_PARTITION_BUCKETS; b++)
+	{
+		size_t left = (size_t)(buffer.fill[b] - buffer.first[b]);
+		memcpy(out + buffer.at[b], &buffer.lines[b][buffer.first[b]],
+			left * sizeof(float));
+		offsets[b] = buffer.at[b] + left;
+	}
+}
+
+// turns counts into where each bucket starts, with offsets[buckets] = total
+static inline void ShredPartitionOffsets(const size_t* counts,
+	size_t* offsets)
+{
+	size_t total = 0;
+	for(size_t b = 0; b < SHRED_PARTITION_BUCKETS; b++)
+	{
+		offsets[b] = total;
+		total += counts[b];
+	}
+	offsets[SHRED_PARTITION_BUCKETS] = total;
+}
+
+static inline void ShredFloatExpPartition(const float* in, size_t n,
+	float* out, size_t* offsets)
+{
+	size_t counts[SHRED_PARTITION_BUCKETS];
+	memset(counts, 0, sizeof(counts));
+	ShredFloatExpCount(in, n, counts);
+	ShredPartitionOffsets(counts, offsets);
+	size_t next[SHRED_PARTITION_BUCKETS];
+	memcpy(next, offsets, sizeof(next));
+	ShredFloatExpScatter(in, n, out, next);
+}
+
+#endif
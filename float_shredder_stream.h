@@ -0,0 +1,254 @@
+#ifndef float_shredder_stream
+#define float_shredder_stream
+
+#include "float_shredder.h"
+#include <stdio.h>
+
+/*
+	Streaming raw float dumps off disk.
+
+	ShredStreamFile goes through a file of raw floats (or doubles, or
+	halves) a chunk at a time and hands each chunk to a callback, which can
+	run whatever batch functions it wants on it. It never holds more than
+	one chunk at a time, so memory use stays the same however big the file
+	is.
+
+	On POSIX systems the file is memory mapped one chunk-sized window at a
+	time. When the file's byte order matches the machine's, the callback gets
+	a pointer straight into the mapping and nothing gets copied. Each window
+	is unmapped again once the callback is done with it, so the pages it
+	used don't stay counted against the process. When the byte order is
+	different, each chunk gets byte swapped into one reusable buffer first.
+	On other systems (or with SHRED_STREAM_NO_MMAP defined) the file is
+	read into that buffer with fread.
+
+	This is its own header like float_shredder_threads.h, so that the main
+	header doesn't pull in any OS headers.
+*/
+#if (defined(__unix__) || defined(__APPLE__)) && \
+	!defined(SHRED_STREAM_NO_MMAP)
+#define SHRED_STREAM_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// how much of the file gets looked at per callback, rounded up to whole pages
+#ifndef SHRED_STREAM_CHUNK
+#define SHRED_STREAM_CHUNK ((size_t)64 << 20)
+#endif
+
+/*
+	Reverses the bytes of each of the n elements of element_size bytes
+	(2, 4 or 8) from in into out. Floats and doubles go through the batch
+	versions of ShredFloatByteSwap, and halves are a plain enough loop that
+	compilers turn it into a byte shuffle by themselves.
+*/
+static inline void ShredByteSwapArray(const void* in, void* out, size_t n,
+	size_t element_size)
+{
+	if(element_size == 2)
+	{
+		const uint8_t* src = (const uint8_t*)in;
+		uint8_t* dst = (uint8_t*)out;
+		for(size_t i = 0; i < n; i++)
+		{
+			uint16_t x;
+			memcpy(&x, src + i * 2, 2);
+			x = (uint16_t)((x >> 8) | (x << 8));
+			memcpy(dst + i * 2, &x, 2);
+		}
+	} else if(element_size == 4) {
+		ShredFloatByteSwapArray((const float*)in, (float*)out, n);
+	} else if(element_size == 8) {
+		ShredDoubleByteSwapArray((const double*)in, (double*)out, n);
+	}
+}
+
+/*
+	Gets called once per chunk with `count` elements starting at `data`,
+	which is already in native byte order. `first` is the index of data[0]
+	in the whole file. `data` is only good until the callback returns.
+	Returning false stops the stream early.
+*/
+typedef bool (*ShredStreamFunc)(void* ctx, const void* data, size_t count,
+	uint64_t first);
+
+typedef struct ShredStreamInfo
+{
+	// how many whole elements were handed to the callback
+	uint64_t elements;
+	// bytes at the end of the file that didn't make up a whole element
+	uint64_t leftover_bytes;
+	// true if the callback stopped the stream
+	bool stopped;
+} ShredStreamInfo;
+
+// runs the callback on a chunk, byte swapping it into `bounce` if needed
+static inline bool ShredStreamChunk(const void* data, size_t count,
+	uint64_t first, size_t element_size, bool swap, void* bounce,
+	ShredStreamFunc func, void* ctx)
+{
+	if(swap)
+	{
+		ShredByteSwapArray(data, bounce, count, element_size);
+		data = bounce;
+	}
+	return func(ctx, data, count, first);
+}
+
+/*
+	Streams every element of the file at `path` through func. element_size
+	is 2, 4 or 8 and endian is the byte order the file was written in.
+	`info` can be NULL if you don't care about the totals.
+
+	Returns false if the file can't be opened or read, or if element_size
+	isn't one of those. A callback stopping the stream early isn't an error,
+	that just sets info->stopped.
+*/
+static inline bool ShredStreamFile(const char* path, size_t element_size,
+	ShredEndian endian, ShredStreamFunc func, void* ctx,
+	ShredStreamInfo* info)
+{
+	ShredStreamInfo unused;
+	if(!info)
+	{
+		info = &unused;
+	}
+	info->elements = 0;
+	info->leftover_bytes = 0;
+	info->stopped = false;
+	if(element_size != 2 && element_size != 4 && element_size != 8)
+	{
+		return false;
+	}
+	bool swap = !ShredEndianIsNative(endian);
+	void* bounce = NULL;
+	uint64_t first = 0;
+	bool ok = true;
+
+#ifdef SHRED_STREAM_MMAP
+	long page = sysconf(_SC_PAGESIZE);
+	size_t chunk = SHRED_STREAM_CHUNK;
+	if(page > 0)
+	{
+		chunk = (chunk + (size_t)page - 1) / (size_t)page * (size_t)page;
+	}
+	// a chunk is whole pages, so it's always a whole number of elements too
+	int fd = open(path, O_RDONLY);
+	if(fd < 0)
+	{
+		return false;
+	}
+	struct stat st;
+	if(fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	uint64_t size = (uint64_t)st.st_size;
+	info->leftover_bytes = size % element_size;
+	size -= info->leftover_bytes;
+	if(swap && size > 0)
+	{
+		bounce = malloc(size < chunk ? (size_t)size : chunk);
+		if(!bounce)
+		{
+			close(fd);
+			return false;
+		}
+	}
+#if defined(POSIX_FADV_SEQUENTIAL)
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+	for(uint64_t offset = 0; offset < size; offset += chunk)
+	{
+		size_t window =
+			size - offset < chunk ? (size_t)(size - offset) : chunk;
+		void* map = mmap(NULL, window, PROT_READ, MAP_PRIVATE, fd,
+			(off_t)offset);
+		if(map == MAP_FAILED)
+		{
+			ok = false;
+			break;
+		}
+#if defined(MADV_SEQUENTIAL)
+		madvise(map, window, MADV_SEQUENTIAL);
+#endif
+#if defined(MADV_HUGEPAGE)
+		// only some filesystems can back a file mapping with huge pages,
+		// everywhere else this just fails and changes nothing
+		madvise(map, window, MADV_HUGEPAGE);
+#endif
+		size_t count = window / element_size;
+		bool more = ShredStreamChunk(map, count, first, element_size, swap,
+			bounce, func, ctx);
+		munmap(map, window);
+		first += count;
+		if(!more)
+		{
+			info->stopped = true;
+			break;
+		}
+	}
+	close(fd);
+#else
+	size_t chunk = SHRED_STREAM_CHUNK / element_size * element_size;
+	FILE* file = fopen(path, "rb");
+	if(!file)
+	{
+		return false;
+	}
+	bounce = malloc(chunk);
+	if(!bounce)
+	{
+		fclose(file);
+		return false;
+	}
+	for(;;)
+	{
+		size_t got = fread(bounce, 1, chunk, file);
+		size_t count = got / element_size;
+		if(count > 0)
+		{
+			// the chunk's already in our own buffer, so swap it in place
+			bool more = ShredStreamChunk(bounce, count, first, element_size,
+				swap, bounce, func, ctx);
+			first += count;
+			if(!more)
+			{
+				info->stopped = true;
+				break;
+			}
+		}
+		if(got < chunk)
+		{
+			info->leftover_bytes = got % element_size;
+			ok = !ferror(file);
+			break;
+		}
+	}
+	fclose(file);
+#endif
+
+	free(bounce);
+	info->elements = first;
+	return ok;
+}
+
+// ShredStreamFile for files of floats
+static inline bool ShredStreamFloats(const char* path, ShredEndian endian,
+	ShredStreamFunc func, void* ctx, ShredStreamInfo* info)
+{
+	return ShredStreamFile(path, sizeof(float), endian, func, ctx, info);
+}
+
+// ShredStreamFile for files of doubles
+static inline bool ShredStreamDoubles(const char* path, ShredEndian endian,
+	ShredStreamFunc func, void* ctx, ShredStreamInfo* info)
+{
+	return ShredStreamFile(path, sizeof(double), endian, func, ctx, info);
+}
+
+#endif
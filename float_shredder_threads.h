@@ -0,0 +1,922 @@
+#ifndef float_shredder_threads
+#define float_shredder_threads
+
+#include "float_shredder.h"
+#include "float_shredder_codec.h"
+#include "float_shredder_sort.h"
+
+/*
+	Multithreaded versions of the heavier float shredder passes.
+
+	This is a separate header because it needs the platform's threads
+	(pthreads, or the Win32 API on Windows), and float_shredder.h on its own
+	shouldn't make you link against anything. On POSIX systems build with
+	-pthread.
+
+	Everything in here splits the input into one contiguous slice per
+	thread, runs the slices at the same time (the calling thread does the
+	first one itself) and then combines the per-thread results. Passing 0 as
+	the thread count uses one thread per online CPU. Any other count is
+	taken as the most threads you want used, so a program that already
+	hands out its own cores can keep the library to its share of them.
+
+	Threads get started for each call and are gone again when it returns.
+	If you'd rather have a pool that stays around, build with OpenMP and
+	define SHRED_THREADS_OPENMP (or configure CMake with
+	-DFLOAT_SHREDDER_OPENMP=ON) and every parallel region runs on OpenMP's
+	threads instead, which also lets OMP_NUM_THREADS, OMP_PROC_BIND and so
+	on have their say.
+*/
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#if defined(SHRED_THREADS_OPENMP) && defined(_OPENMP)
+#define SHRED_THREADS_USE_OPENMP
+#include <omp.h>
+#endif
+
+/*
+	Slices smaller than this aren't worth starting a thread for, the thread
+	would spend longer starting up than counting.
+*/
+#define SHRED_THREADS_MIN_SLICE ((size_t)1 << 16)
+#define SHRED_THREADS_MAX 256
+
+static inline int ShredThreadCount(void)
+{
+#if defined(SHRED_THREADS_USE_OPENMP)
+	return omp_get_max_threads();
+#elif defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+#else
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return cpus > 0 ? (int)cpus : 1;
+#endif
+}
+
+/*
+	How many threads a job over n elements actually gets: what was asked
+	for (or every CPU for 0), but never so many that a slice ends up smaller
+	than SHRED_THREADS_MIN_SLICE.
+*/
+static inline int ShredThreadsFor(size_t n, int threads)
+{
+	if(threads <= 0)
+	{
+		threads = ShredThreadCount();
+	}
+	if(threads > SHRED_THREADS_MAX)
+	{
+		threads = SHRED_THREADS_MAX;
+	}
+	size_t most = n / SHRED_THREADS_MIN_SLICE;
+	if((size_t)threads > most)
+	{
+		threads = most > 0 ? (int)most : 1;
+	}
+	return threads;
+}
+
+// called once per slice, with the slice's index and [begin, end) range
+typedef void (*ShredSliceFunc)(void* ctx, int slice, size_t begin, size_t end);
+
+#ifndef SHRED_THREADS_USE_OPENMP
+typedef struct ShredSlice
+{
+	ShredSliceFunc func;
+	void* ctx;
+	int slice;
+	size_t begin;
+	size_t end;
+} ShredSlice;
+
+#ifdef _WIN32
+static DWORD WINAPI ShredSliceThread(LPVOID arg)
+{
+	ShredSlice* slice = (ShredSlice*)arg;
+	slice->func(slice->ctx, slice->slice, slice->begin, slice->end);
+	return 0;
+}
+#else
+static void* ShredSliceThread(void* arg)
+{
+	ShredSlice* slice = (ShredSlice*)arg;
+	slice->func(slice->ctx, slice->slice, slice->begin, slice->end);
+	return NULL;
+}
+#endif
+#endif
+
+/*
+	Runs func over [0, n) split into `threads` slices and waits for all of
+	them. If a thread can't be started its slice just runs on the calling
+	thread instead, so this always finishes the whole range.
+*/
+static inline void ShredParallelSlices(size_t n, int threads,
+	ShredSliceFunc func, void* ctx)
+{
+	if(threads < 1)
+	{
+		threads = 1;
+	}
+	if(threads > SHRED_THREADS_MAX)
+	{
+		threads = SHRED_THREADS_MAX;
+	}
+#if defined(SHRED_THREADS_USE_OPENMP)
+	#pragma omp parallel for num_threads(threads) schedule(static, 1)
+	for(int t = 0; t < threads; t++)
+	{
+		func(ctx, t, n / threads * t,
+			t == threads - 1 ? n : n / threads * (t + 1));
+	}
+#else
+	ShredSlice slices[SHRED_THREADS_MAX];
+#ifdef _WIN32
+	HANDLE handles[SHRED_THREADS_MAX];
+#else
+	pthread_t handles[SHRED_THREADS_MAX];
+#endif
+	bool started[SHRED_THREADS_MAX];
+
+	for(int t = 0; t < threads; t++)
+	{
+		slices[t].func = func;
+		slices[t].ctx = ctx;
+		slices[t].slice = t;
+		slices[t].begin = n / threads * t;
+		slices[t].end = t == threads - 1 ? n : n / threads * (t + 1);
+		started[t] = false;
+	}
+	for(int t = 1; t < threads; t++)
+	{
+#ifdef _WIN32
+		handles[t] = CreateThread(NULL, 0, ShredSliceThread, &slices[t], 0,
+			NULL);
+		started[t] = handles[t] != NULL;
+#else
+		started[t] = pthread_create(&handles[t], NULL, ShredSliceThread,
+			&slices[t]) == 0;
+#endif
+	}
+	func(ctx, 0, slices[0].begin, slices[0].end);
+	for(int t = 1; t < threads; t++)
+	{
+		if(!started[t])
+		{
+			func(ctx, t, slices[t].begin, slices[t].end);
+			continue;
+		}
+#ifdef _WIN32
+		WaitForSingleObject(handles[t], INFINITE);
+		CloseHandle(handles[t]);
+#else
+		pthread_join(handles[t], NULL);
+#endif
+	}
+#endif
+}
+
+/*
+	Chunked parallel loops.
+
+	ShredParallelFor runs func over [0, n) in chunks of `grain` elements
+	(the last one can be shorter), spread over up to `threads` threads. It
+	works for any batch function, not just the ones in here: give it a
+	func that calls the batch function on in + begin, out + begin and
+	end - begin.
+
+	Each thread gets the same contiguous home range that
+	ShredParallelSlices would give it and works through it a chunk at a
+	time. A thread that runs out of its own chunks goes on to the other
+	ranges in turn and takes whatever chunks are still unclaimed there,
+	which keeps the threads busy when some of them get held up (by another
+	process, or by a slower core) without giving up on each thread mostly
+	working through its own memory. Every chunk, in a thread's own range
+	or anyone else's, is claimed from the front of the range with one
+	atomic add (ShredAtomicFetchAdd on the range's next chunk), so the
+	owner and any helpers just carry on from wherever the last claim left
+	off. The grain should be big enough that the add doesn't matter: the
+	default SHRED_PARALLEL_GRAIN of 16K elements is 64 KiB of floats.
+
+	func's slice argument is the index of the thread running it, somewhere
+	in [0, threads), so it can still keep per-thread results. Chunks don't
+	run in any particular order.
+
+	On a NUMA machine memory ends up on the node of the thread that first
+	writes to it. ShredParallelFirstTouch zeroes a freshly allocated output
+	with each thread writing its own home range, so that later passes over
+	the same n with the same thread count mostly hit the local node. This
+	only works out if threads stay where they are between the two, so pin
+	them (OMP_PROC_BIND=close with SHRED_THREADS_OPENMP, say).
+*/
+#ifndef SHRED_PARALLEL_GRAIN
+#define SHRED_PARALLEL_GRAIN ((size_t)1 << 14)
+#endif
+
+static inline size_t ShredAtomicFetchAdd(size_t* value, size_t add)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	return (size_t)InterlockedExchangeAdd64((volatile LONG64*)value,
+		(LONG64)add);
+#elif defined(_MSC_VER)
+	return (size_t)InterlockedExchangeAdd((volatile LONG*)value, (LONG)add);
+#else
+	return __atomic_fetch_add(value, add, __ATOMIC_RELAXED);
+#endif
+}
+
+#define SHRED_CACHE_LINE 64
+
+// each on its own cache line, since every thread keeps adding to one
+typedef struct ShredForRange
+{
+	size_t next;
+	size_t end;
+	uint8_t padding[SHRED_CACHE_LINE - 2 * sizeof(size_t)];
+} ShredForRange;
+
+typedef struct ShredForJob
+{
+	ShredSliceFunc func;
+	void* ctx;
+	size_t grain;
+	int threads;
+	ShredForRange ranges[SHRED_THREADS_MAX];
+} ShredForJob;
+
+static inline void ShredForWorker(void* ctx, int slice, size_t begin,
+	size_t end)
+{
+	ShredForJob* job = (ShredForJob*)ctx;
+	(void)begin;
+	(void)end;
+	// its own range first, then everyone else's
+	for(int k = 0; k < job->threads; k++)
+	{
+		ShredForRange* range = &job->ranges[(slice + k) % job->threads];
+		for(;;)
+		{
+			size_t first = ShredAtomicFetchAdd(&range->next, job->grain);
+			if(first >= range->end)
+			{
+				break;
+			}
+			size_t last = range->end - first < job->grain ?
+				range->end : first + job->grain;
+			job->func(job->ctx, slice, first, last);
+		}
+	}
+}
+
+static inline void ShredParallelFor(size_t n, size_t grain, int threads,
+	ShredSliceFunc func, void* ctx)
+{
+	if(grain == 0)
+	{
+		grain = SHRED_PARALLEL_GRAIN;
+	}
+	threads = ShredThreadsFor(n, threads);
+	size_t chunks = (n + grain - 1) / grain;
+	if((size_t)threads > chunks)
+	{
+		threads = chunks > 0 ? (int)chunks : 1;
+	}
+	if(threads == 1)
+	{
+		for(size_t first = 0; first < n; first += grain)
+		{
+			func(ctx, 0, first, n - first < grain ? n : first + grain);
+		}
+		return;
+	}
+
+	ShredForJob job;
+	job.func = func;
+	job.ctx = ctx;
+	job.grain = grain;
+	job.threads = threads;
+	for(int t = 0; t < threads; t++)
+	{
+		job.ranges[t].next = n / threads * t;
+		job.ranges[t].end = t == threads - 1 ? n : n / threads * (t + 1);
+	}
+	ShredParallelSlices((size_t)threads, threads, ShredForWorker, &job);
+}
+
+typedef struct ShredFirstTouchJob
+{
+	uint8_t* data;
+	size_t size;
+} ShredFirstTouchJob;
+
+static inline void ShredFirstTouchSlice(void* ctx, int slice, size_t begin,
+	size_t end)
+{
+	ShredFirstTouchJob* job = (ShredFirstTouchJob*)ctx;
+	(void)slice;
+	memset(job->data + begin * job->size, 0, (end - begin) * job->size);
+}
+
+/*
+	Zeroes n elements of `size` bytes each at `data`, split the way
+	ShredParallelFor splits n elements over `threads` threads.
+*/
+static inline void ShredParallelFirstTouch(void* data, size_t n, size_t size,
+	int threads)
+{
+	ShredFirstTouchJob job;
+	job.data = (uint8_t*)data;
+	job.size = size;
+	ShredParallelSlices(n, ShredThreadsFor(n, threads), ShredFirstTouchSlice,
+		&job);
+}
+
+/*
+	ShredHistogramAdd spread over several threads. Each thread counts its
+	slice into a private histogram (with its own sub-counters, so nothing is
+	shared while counting) and they're merged into `hist` at the end. The
+	first slice gets counted straight into `hist`.
+
+	Returns false, without touching `hist`, if the per-thread histograms
+	can't be allocated.
+*/
+typedef struct ShredHistogramJob
+{
+	const float* in;
+	ShredHistogram* hists;
+} ShredHistogramJob;
+
+static inline void ShredHistogramSlice(void* ctx, int slice, size_t begin,
+	size_t end)
+{
+	ShredHistogramJob* job = (ShredHistogramJob*)ctx;
+	ShredHistogramAdd(&job->hists[slice], job->in + begin, end - begin);
+}
+
+static inline bool ShredHistogramAddParallel(ShredHistogram* hist,
+	const float* in, size_t n, int threads)
+{
+	threads = ShredThreadsFor(n, threads);
+	if(threads == 1)
+	{
+		ShredHistogramAdd(hist, in, n);
+		return true;
+	}
+
+	ShredHistogram* hists =
+		(ShredHistogram*)malloc(threads * sizeof(ShredHistogram));
+	if(!hists)
+	{
+		return false;
+	}
+	hists[0] = *hist;
+	for(int t = 1; t < threads; t++)
+	{
+		if(!ShredHistogramInit(&hists[t], hist->mantissa_bits))
+		{
+			for(int u = 1; u < t; u++)
+			{
+				ShredHistogramFree(&hists[u]);
+			}
+			free(hists);
+			return false;
+		}
+	}
+
+	ShredHistogramJob job;
+	job.in = in;
+	job.hists = hists;
+	ShredParallelSlices(n, threads, ShredHistogramSlice, &job);
+
+	*hist = hists[0];
+	for(int t = 1; t < threads; t++)
+	{
+		ShredHistogramMerge(hist, &hists[t]);
+		ShredHistogramFree(&hists[t]);
+	}
+	free(hists);
+	return true;
+}
+
+/*
+	ShredGorillaDecode with the blocks shared out between threads. Every
+	block has its own spot in the index, so threads don't need anything
+	from each other. Returns false if the stream or any block is corrupt.
+*/
+typedef struct ShredGorillaJob
+{
+	const uint8_t* in;
+	size_t size;
+	ShredGorillaInfo info;
+	float* out;
+	bool ok[SHRED_THREADS_MAX];
+} ShredGorillaJob;
+
+static inline void ShredGorillaSlice(void* ctx, int slice, size_t begin,
+	size_t end)
+{
+	ShredGorillaJob* job = (ShredGorillaJob*)ctx;
+	bool ok = true;
+	for(size_t b = begin; b < end && ok; b++)
+	{
+		ok = ShredGorillaDecodeBlock(job->in, job->size, &job->info, b,
+			job->out + b * job->info.block_size);
+	}
+	job->ok[slice] = ok;
+}
+
+static inline bool ShredGorillaDecodeParallel(const uint8_t* in, size_t size,
+	float* out, int threads)
+{
+	ShredGorillaJob job;
+	if(!ShredGorillaOpen(in, size, &job.info))
+	{
+		return false;
+	}
+	job.in = in;
+	job.size = size;
+	job.out = out;
+	threads = ShredThreadsFor(job.info.count, threads);
+	if((size_t)threads > job.info.blocks)
+	{
+		threads = job.info.blocks > 0 ? (int)job.info.blocks : 1;
+	}
+	ShredParallelSlices(job.info.blocks, threads, ShredGorillaSlice, &job);
+	for(int t = 0; t < threads; t++)
+	{
+		if(!job.ok[t])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+	ShredFloatRadixSortPairs spread over several threads, with the same
+	result. Every pass, each thread counts the current digit of its own
+	slice, the counts get turned into per-thread offsets (thread 0's keys
+	with a digit go before thread 1's, and so on, which keeps it stable),
+	and then every thread scatters its slice at once. The counting has to be
+	redone each pass since the scatter shuffles keys between slices. A
+	digit where all n keys land in one bucket gets skipped like it does in
+	the serial sort.
+
+	values can be NULL. Returns false, with nothing sorted, if the scratch
+	space can't be allocated.
+*/
+typedef struct ShredRadixJob
+{
+	float* src;
+	float* dst;
+	uint32_t* values_src;
+	uint32_t* values_dst;
+	// SHRED_RADIX_BUCKETS for every thread
+	size_t* counts;
+	int pass;
+} ShredRadixJob;
+
+static inline void ShredRadixCountSlice(void* ctx, int slice, size_t begin,
+	size_t end)
+{
+	ShredRadixJob* job = (ShredRadixJob*)ctx;
+	size_t* counts = job->counts + slice * SHRED_RADIX_BUCKETS;
+	int shift = job->pass * SHRED_RADIX_BITS;
+	memset(counts, 0, SHRED_RADIX_BUCKETS * sizeof(size_t));
+	for(size_t i = begin; i < end; i++)
+	{
+		uint32_t key = ShredFloatRadixKey(ShredFloatToData(job->src[i]));
+		counts[(key >> shift) & (SHRED_RADIX_BUCKETS - 1)]++;
+	}
+}
+
+static inline void ShredRadixScatterSlice(void* ctx, int slice, size_t begin,
+	size_t end)
+{
+	ShredRadixJob* job = (ShredRadixJob*)ctx;
+	ShredFloatRadixScatter(job->src, job->values_src, begin, end, job->dst,
+		job->values_dst, job->pass, job->counts + slice * SHRED_RADIX_BUCKETS);
+}
+
+static inline bool ShredFloatRadixSortParallel(float* keys, uint32_t* values,
+	size_t n, int threads)
+{
+	threads = ShredThreadsFor(n, threads);
+	if(threads == 1)
+	{
+		return ShredFloatRadixSortPairs(keys, values, n);
+	}
+	size_t* counts = (size_t*)malloc((size_t)threads * SHRED_RADIX_BUCKETS *
+		sizeof(size_t));
+	float* keys_tmp = (float*)malloc(n * sizeof(float));
+	uint32_t* values_tmp = values ?
+		(uint32_t*)malloc(n * sizeof(uint32_t)) : NULL;
+	if(!counts || !keys_tmp || (values && !values_tmp))
+	{
+		free(counts);
+		free(keys_tmp);
+		free(values_tmp);
+		return false;
+	}
+
+	ShredRadixJob job;
+	job.src = keys;
+	job.dst = keys_tmp;
+	job.values_src = values;
+	job.values_dst = values_tmp;
+	job.counts = counts;
+	for(int p = 0; p < SHRED_RADIX_PASSES(32); p++)
+	{
+		job.pass = p;
+		ShredParallelSlices(n, threads, ShredRadixCountSlice, &job);
+
+		uint32_t first = ShredFloatRadixKey(ShredFloatToData(job.src[0]));
+		size_t digit = (first >> (p * SHRED_RADIX_BITS)) &
+			(SHRED_RADIX_BUCKETS - 1);
+		size_t same = 0;
+		for(int t = 0; t < threads; t++)
+		{
+			same += counts[t * SHRED_RADIX_BUCKETS + digit];
+		}
+		if(same == n)
+		{
+			continue;
+		}
+		size_t total = 0;
+		for(size_t b = 0; b < SHRED_RADIX_BUCKETS; b++)
+		{
+			for(int t = 0; t < threads; t++)
+			{
+				size_t count = counts[t * SHRED_RADIX_BUCKETS + b];
+				counts[t * SHRED_RADIX_BUCKETS + b] = total;
+				total += count;
+			}
+		}
+		ShredParallelSlices(n, threads, ShredRadixScatterSlice, &job);
+		float* swap = job.src;
+		job.src = job.dst;
+		job.dst = swap;
+		uint32_t* values_swap = job.values_src;
+		job.values_src = job.values_dst;
+		job.values_dst = values_swap;
+	}
+	if(job.src != keys)
+	{
+		memcpy(keys, job.src, n * sizeof(float));
+		if(values)
+		{
+			memcpy(values, job.values_src, n * sizeof(uint32_t));
+		}
+	}
+	free(counts);
+	free(keys_tmp);
+	free(values_tmp);
+	return true;
+}
+
+/*
+	ShredFloatExpPartition spread over several threads, with the same
+	result. Every thread counts its own slice, then gets its own range
+	within each bucket (thread 0's floats with an exponent go before
+	thread 1's, and so on, so the order within a bucket is still the input
+	order) and scatters its slice through its own write combining buffers.
+
+	Returns false, with nothing written, if the per-thread counts can't be
+	allocated.
+*/
+typedef struct ShredPartitionJob
+{
+	const float* in;
+	float* out;
+	// SHRED_PARTITION_BUCKETS for every thread
+	size_t* counts;
+} ShredPartitionJob;
+
+static inline void ShredPartitionCountSlice(void* ctx, int slice,
+	size_t begin, size_t end)
+{
+	ShredPartitionJob* job = (ShredPartitionJob*)ctx;
+	ShredFloatExpCount(job->in + begin, end - begin,
+		job->counts + slice * SHRED_PARTITION_BUCKETS);
+}
+
+static inline void ShredPartitionScatterSlice(void* ctx, int slice,
+	size_t begin, size_t end)
+{
+	ShredPartitionJob* job = (ShredPartitionJob*)ctx;
+	ShredFloatExpScatter(job->in + begin, end - begin, job->out,
+		job->counts + slice * SHRED_PARTITION_BUCKETS);
+}
+
+static inline bool ShredFloatExpPartitionParallel(const float* in, size_t n,
+	float* out, size_t* offsets, int threads)
+{
+	threads = ShredThreadsFor(n, threads);
+	if(threads == 1)
+	{
+		ShredFloatExpPartition(in, n, out, offsets);
+		return true;
+	}
+	size_t* counts = (size_t*)calloc((size_t)threads * SHRED_PARTITION_BUCKETS,
+		sizeof(size_t));
+	if(!counts)
+	{
+		return false;
+	}
+
+	ShredPartitionJob job;
+	job.in = in;
+	job.out = out;
+	job.counts = counts;
+	ShredParallelSlices(n, threads, ShredPartitionCountSlice, &job);
+
+	size_t total = 0;
+	for(size_t b = 0; b < SHRED_PARTITION_BUCKETS; b++)
+	{
+		offsets[b] = total;
+		for(int t = 0; t < threads; t++)
+		{
+			size_t count = counts[t * SHRED_PARTITION_BUCKETS + b];
+			counts[t * SHRED_PARTITION_BUCKETS + b] = total;
+			total += count;
+		}
+	}
+	offsets[SHRED_PARTITION_BUCKETS] = total;
+	ShredParallelSlices(n, threads, ShredPartitionScatterSlice, &job);
+	free(counts);
+	return true;
+}
+
+/*
+	Parallel versions of the element-wise batch functions, all of them
+	ShredParallelFor over the plain batch function (so each chunk still
+	gets the SIMD kernels). They take the same arguments plus the thread
+	count and the grain, where 0 means the default for either, and they're
+	named after the batch function with Parallel on the end:
+	ShredFloatExpArrayParallel(in, out, n, threads, grain) and so on.
+
+	The plane splitting and the shuffles aren't here, since their outputs
+	aren't laid out element by element.
+*/
+#define SHRED_DEFINE_PARALLEL_MAP(Func, in_t, out_t) \
+typedef struct Func##Job \
+{ \
+	const in_t* in; \
+	out_t* out; \
+} Func##Job; \
+\
+static inline void Func##Chunk(void* ctx, int slice, size_t begin, \
+	size_t end) \
+{ \
+	Func##Job* job = (Func##Job*)ctx; \
+	(void)slice; \
+	Func(job->in + begin, job->out + begin, end - begin); \
+} \
+\
+static inline void Func##Parallel(const in_t* in, out_t* out, size_t n, \
+	int threads, size_t grain) \
+{ \
+	Func##Job job; \
+	job.in = in; \
+	job.out = out; \
+	ShredParallelFor(n, grain, threads, Func##Chunk, &job); \
+}
+
+// the same for the ones with an extra argument after n
+#define SHRED_DEFINE_PARALLEL_MAP_ARG(Func, in_t, out_t, arg_t) \
+typedef struct Func##Job \
+{ \
+	const in_t* in; \
+	out_t* out; \
+	arg_t arg; \
+} Func##Job; \
+\
+static inline void Func##Chunk(void* ctx, int slice, size_t begin, \
+	size_t end) \
+{ \
+	Func##Job* job = (Func##Job*)ctx; \
+	(void)slice; \
+	Func(job->in + begin, job->out + begin, end - begin, job->arg); \
+} \
+\
+static inline void Func##Parallel(const in_t* in, out_t* out, size_t n, \
+	arg_t arg, int threads, size_t grain) \
+{ \
+	Func##Job job; \
+	job.in = in; \
+	job.out = out; \
+	job.arg = arg; \
+	ShredParallelFor(n, grain, threads, Func##Chunk, &job); \
+}
+
+#define SHRED_DEFINE_PARALLEL_MAPS(Name, real_t, bits_t, sbits_t) \
+	SHRED_DEFINE_PARALLEL_MAP(Shred##Name##ExpUnbiasedArray, real_t, bits_t) \
+	SHRED_DEFINE_PARALLEL_MAP(Shred##Name##ExpUnbiasedRawArray, real_t, \
+		bits_t) \
+	SHRED_DEFINE_PARALLEL_MAP(Shred##Name##ExpArray, real_t, sbits_t) \
+	SHRED_DEFINE_PARALLEL_MAP(Shred##Name##ExpRawArray, real_t, sbits_t) \
+	SHRED_DEFINE_PARALLEL_MAP(Shred##Name##MantissaRawArray, real_t, bits_t) \
+	SHRED_DEFINE_PARALLEL_MAP(Shred##Name##MantissaArray, real_t, real_t) \
+	SHRED_DEFINE_PARALLEL_MAP(Shred##Name##IsNegativeArray, real_t, bool) \
+	SHRED_DEFINE_PARALLEL_MAP(Shred##Name##ClassifyArray, real_t, uint8_t) \
+	SHRED_DEFINE_PARALLEL_MAP_ARG(Shred##Name##ShiftExpUpArray, real_t, \
+		real_t, int) \
+	SHRED_DEFINE_PARALLEL_MAP_ARG(Shred##Name##ShiftExpDownArray, real_t, \
+		real_t, int) \
+	SHRED_DEFINE_PARALLEL_MAP_ARG(Shred##Name##ShiftMantUpArray, real_t, \
+		real_t, int) \
+	SHRED_DEFINE_PARALLEL_MAP_ARG(Shred##Name##ShiftMantDownArray, real_t, \
+		real_t, int) \
+	SHRED_DEFINE_PARALLEL_MAP_ARG(Shred##Name##ScalePow2Array, real_t, \
+		real_t, int) \
+	SHRED_DEFINE_PARALLEL_MAP_ARG(Shred##Name##StepUlpsArray, real_t, \
+		real_t, sbits_t)
+
+SHRED_DEFINE_PARALLEL_MAPS(Float, float, uint32_t, int32_t)
+SHRED_DEFINE_PARALLEL_MAPS(Double, double, uint64_t, int64_t)
+SHRED_DEFINE_PARALLEL_MAP(ShredFloatToHalfArray, float, ShredHalf)
+SHRED_DEFINE_PARALLEL_MAP(ShredHalfToFloatArray, ShredHalf, float)
+SHRED_DEFINE_PARALLEL_MAP(ShredFloatToBFloat16Array, float, ShredBFloat16)
+SHRED_DEFINE_PARALLEL_MAP(ShredBFloat16ToFloatArray, ShredBFloat16, float)
+
+/*
+	The batch functions that reduce to a total, with a total per thread
+	that gets added up at the end. The ULP mean is put back together from
+	every chunk's mean, and the summary's sum from every chunk's sum, so
+	both can differ from the single threaded ones in the last few bits.
+
+	The class counts and ULP totals are smaller than a cache line, so each
+	thread's gets padded out to a line of its own (and the job lined up
+	with the lines by ShredCallocLines). Otherwise neighbouring threads
+	would keep taking the line away from each other every time they added
+	a chunk in.
+*/
+// calloc lined up with a cache line. Free *block rather than the result.
+static inline void* ShredCallocLines(size_t size, void** block)
+{
+	*block = calloc(1, size + SHRED_CACHE_LINE - 1);
+	return *block ? (void*)(((uintptr_t)*block + SHRED_CACHE_LINE - 1) &
+		~(uintptr_t)(SHRED_CACHE_LINE - 1)) : NULL;
+}
+
+#define SHRED_DEFINE_PARALLEL_REDUCE(Name, real_t, bits_t) \
+typedef struct Shred##Name##ClassCounts \
+{ \
+	size_t counts[SHRED_CLASS_COUNT]; \
+	uint8_t padding[SHRED_CACHE_LINE - SHRED_CLASS_COUNT * sizeof(size_t)]; \
+} Shred##Name##ClassCounts; \
+\
+typedef struct Shred##Name##ClassCountJob \
+{ \
+	Shred##Name##ClassCounts slices[SHRED_THREADS_MAX]; \
+	const real_t* in; \
+} Shred##Name##ClassCountJob; \
+\
+static inline void Shred##Name##ClassCountChunk(void* ctx, int slice, \
+	size_t begin, size_t end) \
+{ \
+	Shred##Name##ClassCountJob* job = (Shred##Name##ClassCountJob*)ctx; \
+	size_t counts[SHRED_CLASS_COUNT]; \
+	Shred##Name##ClassCount(job->in + begin, end - begin, counts); \
+	for(int k = 0; k < SHRED_CLASS_COUNT; k++) \
+	{ \
+		job->slices[slice].counts[k] += counts[k]; \
+	} \
+} \
+\
+static inline void Shred##Name##ClassCountParallel(const real_t* in, \
+	size_t n, size_t* counts, int threads, size_t grain) \
+{ \
+	void* block; \
+	Shred##Name##ClassCountJob* job = (Shred##Name##ClassCountJob*) \
+		ShredCallocLines(sizeof(Shred##Name##ClassCountJob), &block); \
+	if(!job) \
+	{ \
+		Shred##Name##ClassCount(in, n, counts); \
+		return; \
+	} \
+	job->in = in; \
+	ShredParallelFor(n, grain, threads, Shred##Name##ClassCountChunk, job); \
+	for(int k = 0; k < SHRED_CLASS_COUNT; k++) \
+	{ \
+		counts[k] = 0; \
+		for(int t = 0; t < SHRED_THREADS_MAX; t++) \
+		{ \
+			counts[k] += job->slices[t].counts[k]; \
+		} \
+	} \
+	free(block); \
+} \
+\
+typedef struct Shred##Name##UlpTotals \
+{ \
+	uint64_t max; \
+	double sum; \
+	size_t nan_mismatches; \
+	uint8_t padding[SHRED_CACHE_LINE - 2 * sizeof(uint64_t) - \
+		sizeof(size_t)]; \
+} Shred##Name##UlpTotals; \
+\
+typedef struct Shred##Name##UlpDistanceJob \
+{ \
+	Shred##Name##UlpTotals totals[SHRED_THREADS_MAX]; \
+	const real_t* a; \
+	const real_t* b; \
+	bits_t* out; \
+} Shred##Name##UlpDistanceJob; \
+\
+static inline void Shred##Name##UlpDistanceChunk(void* ctx, int slice, \
+	size_t begin, size_t end) \
+{ \
+	Shred##Name##UlpDistanceJob* job = (Shred##Name##UlpDistanceJob*)ctx; \
+	ShredUlpStats stats; \
+	Shred##Name##UlpDistanceArray(job->a + begin, job->b + begin, \
+		job->out ? job->out + begin : NULL, end - begin, &stats); \
+	Shred##Name##UlpTotals* totals = &job->totals[slice]; \
+	totals->max = stats.max > totals->max ? stats.max : totals->max; \
+	totals->sum += stats.mean * (double)stats.count; \
+	totals->nan_mismatches += stats.nan_mismatches; \
+} \
+\
+static inline void Shred##Name##UlpDistanceArrayParallel(const real_t* a, \
+	const real_t* b, bits_t* out, size_t n, ShredUlpStats* stats, \
+	int threads, size_t grain) \
+{ \
+	void* block; \
+	Shred##Name##UlpDistanceJob* job = (Shred##Name##UlpDistanceJob*) \
+		ShredCallocLines(sizeof(Shred##Name##UlpDistanceJob), &block); \
+	if(!job) \
+	{ \
+		Shred##Name##UlpDistanceArray(a, b, out, n, stats); \
+		return; \
+	} \
+	job->a = a; \
+	job->b = b; \
+	job->out = out; \
+	ShredParallelFor(n, grain, threads, Shred##Name##UlpDistanceChunk, job); \
+	uint64_t max = 0; \
+	double sum = 0.0; \
+	size_t nan_mismatches = 0; \
+	for(int t = 0; t < SHRED_THREADS_MAX; t++) \
+	{ \
+		max = job->totals[t].max > max ? job->totals[t].max : max; \
+		sum += job->totals[t].sum; \
+		nan_mismatches += job->totals[t].nan_mismatches; \
+	} \
+	ShredUlpStatsFinish(stats, n, max, sum, nan_mismatches); \
+	free(block); \
+} \
+\
+typedef struct Shred##Name##SummarizeJob \
+{ \
+	const real_t* in; \
+	Shred##Name##Summary summaries[SHRED_THREADS_MAX]; \
+} Shred##Name##SummarizeJob; \
+\
+static inline void Shred##Name##SummarizeChunk(void* ctx, int slice, \
+	size_t begin, size_t end) \
+{ \
+	Shred##Name##SummarizeJob* job = (Shred##Name##SummarizeJob*)ctx; \
+	Shred##Name##Summary summary; \
+	Shred##Name##Summarize(job->in + begin, end - begin, &summary); \
+	Shred##Name##SummaryMerge(&job->summaries[slice], &summary); \
+} \
+\
+static inline void Shred##Name##SummarizeParallel(const real_t* in, \
+	size_t n, Shred##Name##Summary* summary, int threads, size_t grain) \
+{ \
+	Shred##Name##SummarizeJob* job = (Shred##Name##SummarizeJob*)malloc( \
+		sizeof(Shred##Name##SummarizeJob)); \
+	if(!job) \
+	{ \
+		Shred##Name##Summarize(in, n, summary); \
+		return; \
+	} \
+	job->in = in; \
+	for(int t = 0; t < SHRED_THREADS_MAX; t++) \
+	{ \
+		Shred##Name##SummaryClear(&job->summaries[t]); \
+	} \
+	ShredParallelFor(n, grain, threads, Shred##Name##SummarizeChunk, job); \
+	Shred##Name##SummaryClear(summary); \
+	for(int t = 0; t < SHRED_THREADS_MAX; t++) \
+	{ \
+		Shred##Name##SummaryMerge(summary, &job->summaries[t]); \
+	} \
+	free(job); \
+}
+
+SHRED_DEFINE_PARALLEL_REDUCE(Float, float, uint32_t)
+SHRED_DEFINE_PARALLEL_REDUCE(Double, double, uint64_t)
+
+#endif
@@ -0,0 +1,148 @@
+/*
+	Checks ShredFloat/ShredDouble BinadeBase, BinadeWidth, BinadeUlp and
+	DecimalExp for every exponent against ldexp, nextafter and log10 in
+	long double, and that random floats and doubles land in the binade
+	their ShredFloatExpUnbiased says, on a multiple of its ULP.
+
+	It exits with 1 if anything failed.
+*/
+#include "float_shredder.h"
+
+#include <limits>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define BINADE_CHECK(cond, ...) \
+	do \
+	{ \
+		if(!(cond)) \
+		{ \
+			printf("FAILED: " __VA_ARGS__); \
+			printf("\n"); \
+			failures++; \
+		} \
+	} while(0)
+
+// xorshift, so the data comes out the same on every run
+static uint32_t BinadeRandom(uint32_t* state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+template <typename real_t>
+static bool BinadeSameBits(real_t a, real_t b)
+{
+	return memcmp(&a, &b, sizeof(real_t)) == 0;
+}
+
+/*
+	Name's functions for biased exponent e, next to what they should be.
+	top is the exponent of infinity and bias and mantissa_bits are what
+	the type has.
+*/
+#define BINADE_DEFINE_CHECK(Name, real_t, bits_t) \
+static void Binade##Name(bits_t e, bits_t top, int bias, int mantissa_bits) \
+{ \
+	typedef std::numeric_limits<real_t> limits; \
+	const real_t inf = limits::infinity(); \
+	real_t base = e == 0 ? 0 : e == top ? inf : \
+		(real_t)ldexp(1.0, (int)e - bias); \
+	real_t width = e == 0 ? limits::min() : base; \
+	real_t ulp = e == top ? inf : e <= 1 ? limits::denorm_min() : \
+		(real_t)ldexp(1.0, (int)e - bias - mantissa_bits); \
+	BINADE_CHECK(BinadeSameBits(Shred##Name##BinadeBase(e), base), \
+		#Name "BinadeBase(%d) is %g", (int)e, \
+		(double)Shred##Name##BinadeBase(e)); \
+	BINADE_CHECK(BinadeSameBits(Shred##Name##BinadeWidth(e), width), \
+		#Name "BinadeWidth(%d) is %g", (int)e, \
+		(double)Shred##Name##BinadeWidth(e)); \
+	BINADE_CHECK(BinadeSameBits(Shred##Name##BinadeUlp(e), ulp), \
+		#Name "BinadeUlp(%d) is %g", (int)e, \
+		(double)Shred##Name##BinadeUlp(e)); \
+	if(e < top) \
+	{ \
+		/* the gap to the next value up, from the bottom of the binade */ \
+		real_t next = nextafter(base, inf); \
+		BINADE_CHECK(next - base == ulp, #Name "BinadeUlp(%d) isn't the " \
+			"gap above %g", (int)e, (double)base); \
+		long double decimal = floorl(log10l((long double)width)); \
+		BINADE_CHECK(Shred##Name##DecimalExp(e) == (int64_t)decimal, \
+			#Name "DecimalExp(%d) is %lld, not %lld", (int)e, \
+			(long long)Shred##Name##DecimalExp(e), (long long)decimal); \
+	} \
+	if(e > 0 && e < top) \
+	{ \
+		/* the top of the binade is at most one decimal exponent up */ \
+		real_t last = nextafter(base + base, (real_t)0); \
+		long double decimal = floorl(log10l((long double)last)); \
+		BINADE_CHECK(decimal - Shred##Name##DecimalExp(e) <= 1, \
+			#Name "DecimalExp(%d) is %lld, but %g is %lld", (int)e, \
+			(long long)Shred##Name##DecimalExp(e), (double)last, \
+			(long long)decimal); \
+	} \
+}
+
+BINADE_DEFINE_CHECK(Float, float, uint32_t)
+BINADE_DEFINE_CHECK(Double, double, uint64_t)
+
+/*
+	Finite x is somewhere in [base, base + width) of its binade, on a
+	multiple of the ULP.
+*/
+template <typename real_t>
+static bool BinadeHolds(real_t x, real_t base, real_t width, real_t ulp)
+{
+	long double a = fabsl((long double)x);
+	return a >= base && a < (long double)base + width &&
+		fmodl(a - base, ulp) == 0;
+}
+
+static void BinadeValues()
+{
+	uint32_t state = 0x9E3779B9u;
+	for(int i = 0; i < 1000000; i++)
+	{
+		float x = ShredDataToFloat(BinadeRandom(&state));
+		uint32_t e = ShredFloatExpUnbiased(x);
+		if(e < 255)
+		{
+			BINADE_CHECK(BinadeHolds(x, ShredFloatBinadeBase(e),
+				ShredFloatBinadeWidth(e), ShredFloatBinadeUlp(e)),
+				"float %a isn't in binade %u", (double)x, e);
+		}
+
+		uint64_t high = BinadeRandom(&state);
+		double d = ShredDataToDouble(high << 32 | BinadeRandom(&state));
+		uint64_t de = ShredDoubleExpUnbiased(d);
+		if(de < 2047)
+		{
+			BINADE_CHECK(BinadeHolds(d, ShredDoubleBinadeBase(de),
+				ShredDoubleBinadeWidth(de), ShredDoubleBinadeUlp(de)),
+				"double %a isn't in binade %llu", d, (unsigned long long)de);
+		}
+	}
+}
+
+int main()
+{
+	for(uint32_t e = 0; e <= 255; e++)
+	{
+		BinadeFloat(e, 255, 127, 23);
+	}
+	for(uint64_t e = 0; e <= 2047; e++)
+	{
+		BinadeDouble(e, 2047, 1023, 52);
+	}
+	BinadeValues();
+	printf("%s: %d failures\n", failures ? "FAILED" : "passed", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+/*
+	Round trips float_shredder_codec.h's Gorilla codec over a few kinds of
+	series and block sizes, checking every float comes back with the same
+	bits, and checks that streams with a broken header get turned away by
+	ShredGorillaOpen and ShredGorillaDecode instead of being half decoded.
+
+	It exits with 1 if anything failed.
+*/
+#include "float_shredder_codec.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static int failures = 0;
+
+#define CODEC_CHECK(cond, ...) \
+	do \
+	{ \
+		if(!(cond)) \
+		{ \
+			printf("FAILED: " __VA_ARGS__); \
+			printf("\n"); \
+			failures++; \
+		} \
+	} while(0)
+
+// xorshift, so the random series comes out the same on every run
+static uint32_t CodecRandom(uint32_t* state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+enum CodecSeries
+{
+	CODEC_CONSTANT,
+	CODEC_SMOOTH,
+	CODEC_RANDOM,
+	CODEC_SERIES_COUNT
+};
+
+static const char* codec_series_names[CODEC_SERIES_COUNT] = {
+	"constant", "smooth", "random"
+};
+
+static std::vector<float> CodecMakeSeries(CodecSeries series, size_t n)
+{
+	std::vector<float> values(n);
+	uint32_t state = 0x9E3779B9u;
+	for(size_t i = 0; i < n; i++)
+	{
+		switch(series)
+		{
+		case CODEC_CONSTANT:
+			values[i] = 21.5f;
+			break;
+		case CODEC_SMOOTH:
+			values[i] = 20.0f + 5.0f * (float)sin((double)i * 0.01);
+			break;
+		default:
+			// every bit pattern, NaN payloads and subnormals included
+			values[i] = ShredDataToFloat(CodecRandom(&state));
+			break;
+		}
+	}
+	return values;
+}
+
+static std::vector<uint8_t> CodecEncode(const std::vector<float>& values,
+	size_t block_size)
+{
+	std::vector<uint8_t> stream(ShredGorillaBound(values.size(), block_size));
+	size_t size = ShredGorillaEncode(values.data(), values.size(), block_size,
+		stream.data());
+	stream.resize(size);
+	return stream;
+}
+
+static void CodecRoundTrip(CodecSeries series, size_t n, size_t block_size)
+{
+	const char* name = codec_series_names[series];
+	std::vector<float> values = CodecMakeSeries(series, n);
+	std::vector<uint8_t> stream = CodecEncode(values, block_size);
+
+	ShredGorillaInfo info;
+	bool opened = ShredGorillaOpen(stream.data(), stream.size(), &info);
+	CODEC_CHECK(opened, "%s n=%zu block_size=%zu: open", name, n,
+		block_size);
+	if(!opened)
+	{
+		return;
+	}
+	size_t expected_block = block_size ? block_size :
+		SHRED_GORILLA_DEFAULT_BLOCK;
+	CODEC_CHECK(info.count == n && info.block_size == expected_block &&
+		info.blocks == ShredGorillaBlockCount(n, expected_block),
+		"%s n=%zu block_size=%zu: header", name, n, block_size);
+
+	std::vector<float> decoded(n + 1);
+	CODEC_CHECK(ShredGorillaDecode(stream.data(), stream.size(),
+		decoded.data()), "%s n=%zu block_size=%zu: decode", name, n,
+		block_size);
+	CODEC_CHECK(n == 0 || memcmp(values.data(), decoded.data(),
+		n * sizeof(float)) == 0, "%s n=%zu block_size=%zu: bits differ",
+		name, n, block_size);
+
+	// the blocks on their own, last first
+	std::vector<float> blocks(n + 1);
+	for(size_t b = info.blocks; b-- > 0;)
+	{
+		CODEC_CHECK(ShredGorillaDecodeBlock(stream.data(), stream.size(),
+			&info, b, blocks.data() + b * info.block_size),
+			"%s n=%zu block_size=%zu: decode block %zu", name, n, block_size,
+			b);
+	}
+	CODEC_CHECK(n == 0 || memcmp(values.data(), blocks.data(),
+		n * sizeof(float)) == 0,
+		"%s n=%zu block_size=%zu: block bits differ", name, n, block_size);
+}
+
+static void CodecRoundTrips()
+{
+	static const size_t sizes[] = {0, 1, 2, 7, 100, 4095, 4096, 4097, 20000};
+	static const size_t block_sizes[] = {0, 1, 3, 64, 1000};
+	for(int series = 0; series < CODEC_SERIES_COUNT; series++)
+	{
+		for(size_t n : sizes)
+		{
+			for(size_t block_size : block_sizes)
+			{
+				CodecRoundTrip((CodecSeries)series, n, block_size);
+			}
+		}
+	}
+}
+
+// a copy of a good stream with its header rewritten, which has to fail
+static void CodecExpectRejected(const std::vector<uint8_t>& good,
+	const char* what, uint32_t block_size, uint64_t count)
+{
+	std::vector<uint8_t> stream = good;
+	ShredPutLE32(stream.data() + 4, block_size);
+	ShredPutLE64(stream.data() + 8, count);
+	ShredGorillaInfo info;
+	CODEC_CHECK(!ShredGorillaOpen(stream.data(), stream.size(), &info),
+		"%s: open accepted it", what);
+	// room for the biggest count above, in case it does get decoded
+	std::vector<float> out(2048);
+	CODEC_CHECK(!ShredGorillaDecode(stream.data(), stream.size(), out.data()),
+		"%s: decode accepted it", what);
+}
+
+static void CodecCorruptHeaders()
+{
+	std::vector<float> values = CodecMakeSeries(CODEC_SMOOTH, 1000);
+	std::vector<uint8_t> good = CodecEncode(values, 100);
+
+	// used to come to 0 blocks, so it opened and decoded nothing
+	CodecExpectRejected(good, "count 2^64 - 1", 100, ~(uint64_t)0);
+	CodecExpectRejected(good, "count 2^64 - 1, block_size 2", 2,
+		~(uint64_t)0);
+	CodecExpectRejected(good, "block_size 0", 0, 1000);
+	// fewer or more blocks than the index has room for
+	CodecExpectRejected(good, "count a block short", 100, 900);
+	CodecExpectRejected(good, "count a block over", 100, 1001);
+	CodecExpectRejected(good, "count 0", 100, 0);
+	CodecExpectRejected(good, "block_size halved", 50, 1000);
+
+	std::vector<uint8_t> bad_magic = good;
+	bad_magic[0] = 'X';
+	ShredGorillaInfo info;
+	CODEC_CHECK(!ShredGorillaOpen(bad_magic.data(), bad_magic.size(), &info),
+		"bad magic: open accepted it");
+
+	// cut off before the end of the last block
+	for(size_t cut = 1; cut < 16; cut++)
+	{
+		std::vector<float> out(values.size());
+		CODEC_CHECK(!ShredGorillaDecode(good.data(), good.size() - cut,
+			out.data()), "truncated by %zu: decode accepted it", cut);
+	}
+	CODEC_CHECK(!ShredGorillaOpen(good.data(), SHRED_GORILLA_HEADER, &info),
+		"header only: open accepted it");
+}
+
+int main()
+{
+	CodecRoundTrips();
+	CodecCorruptHeaders();
+	printf("%s: %d failures\n", failures ? "FAILED" : "passed", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,401 @@
+/*
+	Checks the ShredDouble family, which float_shredder_exhaustive can't
+	cover by trying everything. The scalar functions get checked against
+	libm (ilogb, frexp, ldexp, nextafter, signbit, fpclassify), against
+	their float versions on doubles that are really floats, and against
+	what rounding to float does for TruncateMantissa. Then the batch
+	functions against loops over the scalar ones, the shuffles against
+	their layouts and round trips, and the ordered keys against the order
+	of the doubles.
+
+	The data is the special values, every exponent with a random sign and
+	mantissa, and random bit patterns.
+
+	It exits with 1 if anything failed.
+*/
+#include "float_shredder.h"
+
+#include <float.h>
+#include <limits>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static int failures = 0;
+
+#define DOUBLE_CHECK(cond, ...) \
+	do \
+	{ \
+		if(!(cond)) \
+		{ \
+			printf("FAILED: " __VA_ARGS__); \
+			printf("\n"); \
+			failures++; \
+		} \
+	} while(0)
+
+// xorshift, so the data comes out the same on every run
+static uint32_t DoubleRandom(uint32_t* state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static uint64_t DoubleRandom64(uint32_t* state)
+{
+	uint64_t high = DoubleRandom(state);
+	return high << 32 | DoubleRandom(state);
+}
+
+static bool DoubleSameBits(double a, double b)
+{
+	return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+// the same bits, or both NaN, since libm doesn't promise which NaN
+static bool DoubleSame(double a, double b)
+{
+	return DoubleSameBits(a, b) || (isnan(a) && isnan(b));
+}
+
+template <typename T>
+static bool DoubleSameArray(const std::vector<T>& a, const std::vector<T>& b)
+{
+	return a.size() == b.size() &&
+		(a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+static std::vector<double> DoubleValues()
+{
+	typedef std::numeric_limits<double> limits;
+	std::vector<double> values;
+	const double specials[] = {0.0, 1.0, 1.5, 2.0, 3.0,
+		limits::denorm_min(), 2 * limits::denorm_min(),
+		limits::min() - limits::denorm_min(), limits::min(),
+		nextafter(limits::min(), 1.0), limits::max(),
+		nextafter(limits::max(), 0.0), limits::infinity(),
+		limits::quiet_NaN(), limits::signaling_NaN()};
+	for(double x : specials)
+	{
+		values.push_back(x);
+		values.push_back(ShredDataToDouble(ShredDoubleToData(x) |
+			double_sign_mask));
+	}
+	uint32_t state = 0x9E3779B9u;
+	for(uint64_t e = 0; e <= 2047; e++)
+	{
+		uint64_t r = DoubleRandom64(&state);
+		values.push_back(ShredDataToDouble((r & ~double_exp_mask) |
+			e << double_exp_offset));
+	}
+	for(int i = 0; i < 100000; i++)
+	{
+		values.push_back(ShredDataToDouble(DoubleRandom64(&state)));
+	}
+	return values;
+}
+
+/*
+	What libm says, filled in with what the scalar functions are documented
+	to give where libm doesn't have an answer (the exponent of a zero, say).
+*/
+
+static int64_t LibmExp(double x)
+{
+	if(x == 0 || fpclassify(x) == FP_SUBNORMAL)
+	{
+		return -double_exp_bias;
+	}
+	if(!isfinite(x))
+	{
+		return double_exp_bias + 1;
+	}
+	return ilogb(x);
+}
+
+static double LibmMantissa(double x)
+{
+	if(!isfinite(x))
+	{
+		// 1.mantissa, the same as a normal double's
+		return ShredDataToDouble((ShredDoubleToData(x) &
+			double_mantissa_mask) | ((uint64_t)double_exp_bias <<
+			double_exp_offset));
+	}
+	if(x == 0 || fpclassify(x) == FP_SUBNORMAL)
+	{
+		return ldexp(fabs(x), double_exp_bias - 1);
+	}
+	int exp;
+	return 2 * fabs(frexp(x, &exp));
+}
+
+static ShredClass LibmClassify(double x)
+{
+	switch(fpclassify(x))
+	{
+	case FP_ZERO:
+		return SHRED_CLASS_ZERO;
+	case FP_SUBNORMAL:
+		return SHRED_CLASS_SUBNORMAL;
+	case FP_NORMAL:
+		return SHRED_CLASS_NORMAL;
+	case FP_INFINITE:
+		return SHRED_CLASS_INFINITE;
+	default:
+		return SHRED_CLASS_NAN;
+	}
+}
+
+static void DoubleLibm(const std::vector<double>& values)
+{
+	static const int scales[] = {-5000, -2100, -1075, -1074, -60, -1, 0, 1,
+		60, 1023, 2100, 5000};
+	for(double x : values)
+	{
+		DOUBLE_CHECK(ShredDoubleExp(x) == LibmExp(x), "Exp(%a) is %lld", x,
+			(long long)ShredDoubleExp(x));
+		DOUBLE_CHECK(DoubleSame(ShredDoubleMantissa(x), LibmMantissa(x)),
+			"Mantissa(%a) is %a", x, ShredDoubleMantissa(x));
+		DOUBLE_CHECK(ShredDoubleIsNegative(x) == (signbit(x) != 0),
+			"IsNegative(%a)", x);
+		DOUBLE_CHECK(ShredDoubleClassify(x) == LibmClassify(x),
+			"Classify(%a) is %d", x, (int)ShredDoubleClassify(x));
+		DOUBLE_CHECK(ShredDoubleExpUnbiased(x) ==
+			(ShredDoubleToData(x) >> double_exp_offset & 0x7FF) &&
+			ShredDoubleMantissaRaw(x) ==
+			(ShredDoubleToData(x) & double_mantissa_mask),
+			"the raw fields of %a", x);
+		for(int scale : scales)
+		{
+			// ScalePow2 keeps the NaN it was given, ldexp can quiet it
+			DOUBLE_CHECK(DoubleSame(ShredDoubleScalePow2(x, scale),
+				ldexp(x, scale)), "ScalePow2(%a, %d) is %a", x, scale,
+				ShredDoubleScalePow2(x, scale));
+		}
+		if(!isnan(x))
+		{
+			// stepping onto zero gives +0, where nextafter keeps the sign
+			double up = nextafter(x, INFINITY);
+			double down = nextafter(x, -INFINITY);
+			DOUBLE_CHECK(DoubleSameBits(ShredDoubleStepUlps(x, 1),
+				up == 0 ? 0.0 : up), "StepUlps(%a, 1)", x);
+			DOUBLE_CHECK(DoubleSameBits(ShredDoubleStepUlps(x, -1),
+				down == 0 ? 0.0 : down), "StepUlps(%a, -1)", x);
+			DOUBLE_CHECK(ShredDoubleUlpDistance(x, up) == (x == up ? 0u : 1u),
+				"UlpDistance(%a, %a)", x, up);
+		}
+	}
+}
+
+// on doubles that are really floats, the answers are the float ones
+static void DoubleFloats()
+{
+	uint32_t state = 0x6A09E667u;
+	for(int i = 0; i < 100000; i++)
+	{
+		float f = ShredDataToFloat(DoubleRandom(&state));
+		double d = f;
+		ShredClass c = ShredFloatClassify(f);
+		if(c == SHRED_CLASS_NORMAL || c == SHRED_CLASS_ZERO ||
+			c == SHRED_CLASS_INFINITE)
+		{
+			bool exp = c == SHRED_CLASS_NORMAL ?
+				ShredDoubleExp(d) == ShredFloatExp(f) :
+				ShredDoubleExpUnbiased(d) == 0 ||
+				ShredDoubleExpUnbiased(d) == 2047;
+			DOUBLE_CHECK(exp && ShredDoubleMantissa(d) ==
+				(double)ShredFloatMantissa(f) &&
+				ShredDoubleIsNegative(d) == ShredFloatIsNegative(f) &&
+				ShredDoubleClassify(d) == c, "float %a as a double",
+				(double)f);
+		}
+		DOUBLE_CHECK(ShredDoubleClassify(d) == SHRED_CLASS_NAN ||
+			ShredFloatClassify(f) != SHRED_CLASS_NAN, "NaN %a", (double)f);
+
+		// 52 - 23 bits dropped, to nearest even, is rounding to float
+		uint64_t r = DoubleRandom64(&state);
+		double x = ShredDataToDouble((r & ~double_exp_mask) |
+			(uint64_t)(double_exp_bias - 126 + r % 253) <<
+			double_exp_offset);
+		DOUBLE_CHECK(ShredDoubleTruncateMantissa(x, 29) == (double)(float)x,
+			"TruncateMantissa(%a, 29) is %a, not %a", x,
+			ShredDoubleTruncateMantissa(x, 29), (double)(float)x);
+	}
+}
+
+// every batch function is a loop over its scalar one
+#define DOUBLE_ARRAY_CHECK(func, out_t, ...) \
+	do \
+	{ \
+		std::vector<out_t> got(n), expected(n); \
+		ShredDouble##func##Array(in, got.data(), n, ##__VA_ARGS__); \
+		for(size_t i = 0; i < n; i++) \
+		{ \
+			expected[i] = ShredDouble##func(in[i], ##__VA_ARGS__); \
+		} \
+		DOUBLE_CHECK(DoubleSameArray(got, expected), #func "Array"); \
+	} while(0)
+
+static void DoubleArrays(const std::vector<double>& values)
+{
+	const double* in = values.data();
+	size_t n = values.size();
+	DOUBLE_ARRAY_CHECK(ToData, uint64_t);
+	DOUBLE_ARRAY_CHECK(ExpUnbiased, uint64_t);
+	DOUBLE_ARRAY_CHECK(ExpUnbiasedRaw, uint64_t);
+	DOUBLE_ARRAY_CHECK(Exp, int64_t);
+	DOUBLE_ARRAY_CHECK(ExpRaw, int64_t);
+	DOUBLE_ARRAY_CHECK(MantissaRaw, uint64_t);
+	DOUBLE_ARRAY_CHECK(Mantissa, double);
+	DOUBLE_ARRAY_CHECK(ShiftExpUp, double, 3);
+	DOUBLE_ARRAY_CHECK(ShiftExpDown, double, 3);
+	DOUBLE_ARRAY_CHECK(ShiftMantUp, double, 20);
+	DOUBLE_ARRAY_CHECK(ShiftMantDown, double, 20);
+	DOUBLE_ARRAY_CHECK(ScalePow2, double, -1030);
+	DOUBLE_ARRAY_CHECK(ScalePow2, double, 700);
+	DOUBLE_ARRAY_CHECK(StepUlps, double, -1000000007);
+	DOUBLE_ARRAY_CHECK(ByteSwap, double);
+
+	std::vector<uint8_t> negatives(n), classes(n);
+	ShredDoubleIsNegativeArray(in, (bool*)negatives.data(), n);
+	ShredDoubleClassifyArray(in, classes.data(), n);
+	size_t counts[SHRED_CLASS_COUNT], expected_counts[SHRED_CLASS_COUNT] = {0};
+	ShredDoubleClassCount(in, n, counts);
+	bool same = true;
+	for(size_t i = 0; i < n; i++)
+	{
+		same = same && negatives[i] == ShredDoubleIsNegative(in[i]) &&
+			classes[i] == ShredDoubleClassify(in[i]);
+		expected_counts[ShredDoubleClassify(in[i])]++;
+	}
+	DOUBLE_CHECK(same, "IsNegativeArray and ClassifyArray");
+	DOUBLE_CHECK(memcmp(counts, expected_counts, sizeof(counts)) == 0,
+		"ClassCount");
+
+	std::vector<double> truncated(n);
+	ShredTruncateStats stats;
+	ShredDoubleTruncateMantissaArray(in, truncated.data(), n, 17, &stats);
+	same = true;
+	for(size_t i = 0; i < n; i++)
+	{
+		same = same && DoubleSameBits(truncated[i],
+			ShredDoubleTruncateMantissa(in[i], 17));
+	}
+	DOUBLE_CHECK(same, "TruncateMantissaArray");
+
+	std::vector<double> stepped(n);
+	std::vector<uint64_t> distances(n);
+	ShredDoubleStepUlpsArray(in, stepped.data(), n, 12345);
+	ShredDoubleUlpDistanceArray(in, stepped.data(), distances.data(), n,
+		NULL);
+	same = true;
+	for(size_t i = 0; i < n; i++)
+	{
+		same = same && distances[i] ==
+			ShredDoubleUlpDistance(in[i], stepped[i]) && (isnan(in[i]) ||
+			isinf(stepped[i]) || distances[i] == 12345);
+	}
+	DOUBLE_CHECK(same, "UlpDistanceArray");
+}
+
+// the planes are most significant byte or bit first
+static void DoubleShuffles(const std::vector<double>& values)
+{
+	static const size_t sizes[] = {0, 1, 7, 8, 9, 1000, 1003};
+	for(size_t n : sizes)
+	{
+		const double* in = values.data() + 31;
+		std::vector<uint8_t> bytes(8 * n + 1), bits(64 *
+			ShredSignPlaneSize(n) + 1);
+		ShredDoubleByteShuffle(in, n, bytes.data());
+		ShredDoubleBitShuffle(in, n, bits.data());
+		bool layout = true;
+		for(size_t i = 0; i < n; i++)
+		{
+			uint64_t data = ShredDoubleToData(in[i]);
+			for(int k = 0; k < 8; k++)
+			{
+				layout = layout &&
+					bytes[k * n + i] == (uint8_t)(data >> (56 - 8 * k));
+			}
+			for(int b = 0; b < 64; b++)
+			{
+				layout = layout && ((bits[b * ShredSignPlaneSize(n) + i / 8] >>
+					(i % 8)) & 1) == ((data >> (63 - b)) & 1);
+			}
+		}
+		DOUBLE_CHECK(layout, "shuffle layout n=%zu", n);
+
+		std::vector<double> from_bytes(n), from_bits(n);
+		ShredDoubleByteUnshuffle(bytes.data(), n, from_bytes.data());
+		ShredDoubleBitUnshuffle(bits.data(), n, from_bits.data());
+		std::vector<double> original(in, in + n);
+		DOUBLE_CHECK(DoubleSameArray(from_bytes, original) &&
+			DoubleSameArray(from_bits, original), "unshuffle n=%zu", n);
+	}
+}
+
+// the keys sort the doubles, and turn back into them
+static void DoubleKeys(const std::vector<double>& values)
+{
+	size_t n = values.size();
+	std::vector<uint64_t> keys(n), big(n), canonical(n);
+	std::vector<double> back(n);
+	ShredDoubleToOrderedKeyArray(values.data(), keys.data(), n,
+		SHRED_ENDIAN_NATIVE);
+	ShredDoubleToOrderedKeyArray(values.data(), big.data(), n,
+		ShredNativeIsBigEndian() ? SHRED_ENDIAN_LITTLE : SHRED_ENDIAN_BIG);
+	ShredDoubleToCanonicalKeyArray(values.data(), canonical.data(), n,
+		SHRED_ENDIAN_NATIVE);
+	ShredDoubleFromOrderedKeyArray(keys.data(), back.data(), n,
+		SHRED_ENDIAN_NATIVE);
+	bool same = true;
+	for(size_t i = 0; i < n; i++)
+	{
+		same = same && keys[i] == ShredDoubleToOrderedKey(values[i]) &&
+			big[i] == ShredByteSwap64(keys[i]) &&
+			canonical[i] == ShredDoubleToCanonicalKey(values[i]);
+	}
+	DOUBLE_CHECK(same, "key arrays");
+	DOUBLE_CHECK(DoubleSameArray(back, values), "FromOrderedKeyArray");
+
+	// neighbours in the data, compared both ways
+	for(size_t i = 1; i < n; i++)
+	{
+		double a = values[i - 1];
+		double b = values[i];
+		if(isnan(a) || isnan(b))
+		{
+			continue;
+		}
+		uint64_t ka = ShredDoubleToOrderedKey(a);
+		uint64_t kb = ShredDoubleToOrderedKey(b);
+		bool zeros = a == 0 && b == 0;
+		DOUBLE_CHECK(zeros ? (ka < kb) == (signbit(a) && !signbit(b)) :
+			(ka < kb) == (a < b) && (ka == kb) == (a == b),
+			"ordered keys of %a and %a", a, b);
+		uint64_t ca = ShredDoubleToCanonicalKey(a);
+		uint64_t cb = ShredDoubleToCanonicalKey(b);
+		DOUBLE_CHECK((ca < cb) == (a < b) && (ca == cb) == (a == b),
+			"canonical keys of %a and %a", a, b);
+	}
+}
+
+int main()
+{
+	std::vector<double> values = DoubleValues();
+	DoubleLibm(values);
+	DoubleFloats();
+	DoubleArrays(values);
+	DoubleShuffles(values);
+	DoubleKeys(values);
+	printf("%s: %d failures\n", failures ? "FAILED" : "passed", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,342 @@
+/*
+	Runs every kernel in float_shredder_gpu.cuh and checks its results bit
+	for bit against the host: the element-wise ones against a loop over the
+	scalar function, the histograms against ShredHistogramAdd and Remove,
+	and block floats against ShredFloatToBlockInt8 and the rest. The sizes
+	go past one grid's worth of threads, so the stride loops get run too.
+
+	It exits with 1 if anything failed, and with 77 (which ctest counts as
+	skipped) if there's no device to run on.
+*/
+#include "float_shredder_gpu.cuh"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+static int failures = 0;
+
+#define GPU_CHECK(cond, ...) \
+	do \
+	{ \
+		if(!(cond)) \
+		{ \
+			printf("FAILED: " __VA_ARGS__); \
+			printf("\n"); \
+			failures++; \
+		} \
+	} while(0)
+
+#define GPU_SKIPPED 77
+
+// xorshift, so the data comes out the same on every run
+static uint32_t GpuRandom(uint32_t* state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+// every bit pattern, specials included
+static std::vector<float> GpuFloats(size_t n)
+{
+	std::vector<float> values(n);
+	uint32_t state = 0x9E3779B9u;
+	for(float& v : values)
+	{
+		v = ShredDataToFloat(GpuRandom(&state));
+	}
+	return values;
+}
+
+static std::vector<double> GpuDoubles(size_t n)
+{
+	std::vector<double> values(n);
+	uint32_t state = 0x2545F491u;
+	for(double& v : values)
+	{
+		uint64_t high = GpuRandom(&state);
+		v = ShredDataToDouble(high << 32 | GpuRandom(&state));
+	}
+	return values;
+}
+
+// mostly finite, so most blocks get quantized rather than turned into NaN
+static std::vector<float> GpuBlockFloats(size_t n)
+{
+	std::vector<float> values(n);
+	uint32_t state = 0x6A09E667u;
+	for(size_t i = 0; i < n; i++)
+	{
+		uint32_t r = GpuRandom(&state);
+		values[i] = i % 1000 == 999 ? NAN : i % 300 == 7 ?
+			ShredDataToFloat(r & 0x807FFFFFu) :
+			(float)(int32_t)r * ldexpf(1.0f, (int)(r % 40) - 50);
+	}
+	return values;
+}
+
+template <typename T>
+static T* GpuUpload(const std::vector<T>& values)
+{
+	T* dev = NULL;
+	// one spare, so an empty vector still gets a real pointer
+	cudaMalloc((void**)&dev, (values.size() + 1) * sizeof(T));
+	cudaMemcpy(dev, values.data(), values.size() * sizeof(T),
+		cudaMemcpyHostToDevice);
+	return dev;
+}
+
+template <typename T>
+static T* GpuAlloc(size_t n)
+{
+	T* dev = NULL;
+	cudaMalloc((void**)&dev, (n + 1) * sizeof(T));
+	return dev;
+}
+
+// waits for the kernels, then copies n results back
+template <typename T>
+static std::vector<T> GpuDownload(const T* dev, size_t n)
+{
+	std::vector<T> values(n);
+	cudaDeviceSynchronize();
+	cudaMemcpy(values.data(), dev, n * sizeof(T), cudaMemcpyDeviceToHost);
+	return values;
+}
+
+template <typename T>
+static bool GpuSameBits(const std::vector<T>& a, const std::vector<T>& b)
+{
+	return a.size() == b.size() &&
+		(a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+template <typename real_t, typename out_t, typename Scalar>
+static void GpuMap(const char* name, const std::vector<real_t>& in,
+	const real_t* dev_in,
+	ShredGpuError (*async)(const real_t*, out_t*, size_t, ShredGpuStream),
+	Scalar scalar)
+{
+	// a vector<bool> has no data(), but a bool is a byte of 0 or 1 anyway
+	typedef typename std::conditional<std::is_same<out_t, bool>::value,
+		uint8_t, out_t>::type host_t;
+	size_t n = in.size();
+	out_t* dev_out = GpuAlloc<out_t>(n);
+	GPU_CHECK(async(dev_in, dev_out, n, 0) == cudaSuccess,
+		"%s n=%zu: launch", name, n);
+	std::vector<host_t> expected(n);
+	for(size_t i = 0; i < n; i++)
+	{
+		expected[i] = (host_t)(out_t)scalar(in[i]);
+	}
+	GPU_CHECK(GpuSameBits(GpuDownload((const host_t*)dev_out, n), expected),
+		"%s n=%zu: differs from the scalar function", name, n);
+	cudaFree(dev_out);
+}
+
+// arg goes through the same cast the call would give it
+template <typename real_t, typename arg_t, typename Scalar>
+static void GpuMapArg(const char* name, const std::vector<real_t>& in,
+	const real_t* dev_in,
+	ShredGpuError (*async)(const real_t*, real_t*, size_t, arg_t,
+		ShredGpuStream),
+	Scalar scalar, long long arg)
+{
+	size_t n = in.size();
+	real_t* dev_out = GpuAlloc<real_t>(n);
+	GPU_CHECK(async(dev_in, dev_out, n, (arg_t)arg, 0) == cudaSuccess,
+		"%s(%lld) n=%zu: launch", name, arg, n);
+	std::vector<real_t> expected(n);
+	for(size_t i = 0; i < n; i++)
+	{
+		expected[i] = scalar(in[i], (arg_t)arg);
+	}
+	GPU_CHECK(GpuSameBits(GpuDownload(dev_out, n), expected),
+		"%s(%lld) n=%zu: differs from the scalar function", name, arg, n);
+	cudaFree(dev_out);
+}
+
+// the same list as SHRED_DEFINE_GPU_MAPS
+#define GPU_MAP(Name, real_t, Func, out_t) \
+	GpuMap<real_t, out_t>(#Name #Func, in, dev_in, \
+		Shred##Name##Func##ArrayAsync, \
+		[](real_t x) { return Shred##Name##Func(x); })
+
+#define GPU_MAP_ARG(Name, real_t, Func, arg_t, arg) \
+	GpuMapArg<real_t, arg_t>(#Name #Func, in, dev_in, \
+		Shred##Name##Func##ArrayAsync, \
+		[](real_t x, arg_t a) { return Shred##Name##Func(x, a); }, arg)
+
+#define GPU_MAPS(Name, real_t, bits_t, sbits_t) \
+	GPU_MAP(Name, real_t, ExpUnbiased, bits_t); \
+	GPU_MAP(Name, real_t, ExpUnbiasedRaw, bits_t); \
+	GPU_MAP(Name, real_t, Exp, sbits_t); \
+	GPU_MAP(Name, real_t, ExpRaw, sbits_t); \
+	GPU_MAP(Name, real_t, MantissaRaw, bits_t); \
+	GPU_MAP(Name, real_t, Mantissa, real_t); \
+	GPU_MAP(Name, real_t, IsNegative, bool); \
+	GPU_MAP(Name, real_t, Classify, uint8_t); \
+	GPU_MAP(Name, real_t, ByteSwap, real_t); \
+	GPU_MAP(Name, real_t, ToOrderedKey, bits_t); \
+	GPU_MAP(Name, real_t, ToCanonicalKey, bits_t); \
+	GPU_MAP_ARG(Name, real_t, ShiftExpUp, int, 3); \
+	GPU_MAP_ARG(Name, real_t, ShiftExpDown, int, 5); \
+	GPU_MAP_ARG(Name, real_t, ShiftMantUp, int, 7); \
+	GPU_MAP_ARG(Name, real_t, ShiftMantDown, int, 9); \
+	GPU_MAP_ARG(Name, real_t, ScalePow2, int, -40); \
+	GPU_MAP_ARG(Name, real_t, ScalePow2, int, 100); \
+	GPU_MAP_ARG(Name, real_t, TruncateMantissa, int, 11); \
+	GPU_MAP_ARG(Name, real_t, StepUlps, sbits_t, -1000); \
+	GPU_MAP_ARG(Name, real_t, StepUlps, sbits_t, 1)
+
+static void GpuMaps(size_t n)
+{
+	{
+		std::vector<float> in = GpuFloats(n);
+		float* dev_in = GpuUpload(in);
+		GPU_MAPS(Float, float, uint32_t, int32_t);
+		cudaFree(dev_in);
+	}
+	{
+		std::vector<double> in = GpuDoubles(n);
+		double* dev_in = GpuUpload(in);
+		GPU_MAPS(Double, double, uint64_t, int64_t);
+		cudaFree(dev_in);
+	}
+}
+
+static bool GpuSameHistogram(const ShredHistogram* a, const ShredHistogram* b)
+{
+	return a->count == b->count &&
+		memcmp(a->exponents, b->exponents, sizeof(a->exponents)) == 0 &&
+		memcmp(a->mantissas, b->mantissas,
+			ShredHistogramMantissaBins(a) * sizeof(uint64_t)) == 0;
+}
+
+/*
+	Adds everything and takes the first third back off, on both sides, so
+	the removing gets checked as well as the adding. The mantissa_bits
+	straddle SHRED_GPU_HISTOGRAM_SHARED_BITS, where the counting moves out
+	of shared memory.
+*/
+static void GpuHistograms(size_t n)
+{
+	static const int mantissa_bits[] = {0, 8, SHRED_GPU_HISTOGRAM_SHARED_BITS,
+		SHRED_GPU_HISTOGRAM_SHARED_BITS + 1, SHRED_HISTOGRAM_MAX_MANTISSA_BITS};
+	std::vector<float> in = GpuFloats(n);
+	float* dev_in = GpuUpload(in);
+	for(int bits : mantissa_bits)
+	{
+		ShredHistogram expected, merged;
+		ShredGpuHistogram hist;
+		if(!ShredHistogramInit(&expected, bits) ||
+			!ShredHistogramInit(&merged, bits) ||
+			!ShredGpuHistogramInit(&hist, bits, 0))
+		{
+			GPU_CHECK(false, "histogram %d bits n=%zu: init", bits, n);
+			continue;
+		}
+		ShredHistogramAdd(&expected, in.data(), n);
+		ShredHistogramRemove(&expected, in.data(), n / 3);
+		GPU_CHECK(ShredGpuHistogramAddAsync(&hist, dev_in, n, 0) ==
+			cudaSuccess && ShredGpuHistogramRemoveAsync(&hist, dev_in, n / 3,
+			0) == cudaSuccess, "histogram %d bits n=%zu: launch", bits, n);
+		GPU_CHECK(ShredGpuHistogramMerge(&merged, &hist, 0),
+			"histogram %d bits n=%zu: merge", bits, n);
+		GPU_CHECK(GpuSameHistogram(&merged, &expected),
+			"histogram %d bits n=%zu: counts differ", bits, n);
+		ShredGpuHistogramFree(&hist);
+		ShredHistogramFree(&expected);
+		ShredHistogramFree(&merged);
+	}
+	cudaFree(dev_in);
+}
+
+#define GPU_BLOCK(Width, int_t) \
+static void GpuBlock##Width(const std::vector<float>& in, \
+	const float* dev_in, size_t block_size, int bits) \
+{ \
+	size_t n = in.size(); \
+	size_t blocks = ShredBlockCount(n, block_size); \
+	std::vector<uint8_t> exps(blocks); \
+	std::vector<int_t> ints(n); \
+	std::vector<float> floats(n); \
+	ShredFloatToBlockInt##Width(in.data(), n, block_size, bits, exps.data(), \
+		ints.data()); \
+	ShredBlockInt##Width##ToFloat(exps.data(), ints.data(), n, block_size, \
+		bits, floats.data()); \
+\
+	uint8_t* dev_exps = GpuAlloc<uint8_t>(blocks); \
+	int_t* dev_ints = GpuAlloc<int_t>(n); \
+	float* dev_floats = GpuAlloc<float>(n); \
+	GPU_CHECK(ShredFloatToBlockInt##Width##Async(dev_in, n, block_size, bits, \
+		dev_exps, dev_ints, 0) == cudaSuccess, \
+		"Int" #Width " block_size=%zu bits=%d n=%zu: launch", block_size, \
+		bits, n); \
+	GPU_CHECK(GpuSameBits(GpuDownload(dev_exps, blocks), exps) && \
+		GpuSameBits(GpuDownload(dev_ints, n), ints), \
+		"Int" #Width " block_size=%zu bits=%d n=%zu: encoding differs", \
+		block_size, bits, n); \
+	/* the decoder gets the host's encoding, so it's checked on its own */ \
+	cudaMemcpy(dev_exps, exps.data(), blocks, cudaMemcpyHostToDevice); \
+	cudaMemcpy(dev_ints, ints.data(), n * sizeof(int_t), \
+		cudaMemcpyHostToDevice); \
+	GPU_CHECK(ShredBlockInt##Width##ToFloatAsync(dev_exps, dev_ints, n, \
+		block_size, bits, dev_floats, 0) == cudaSuccess, \
+		"Int" #Width " block_size=%zu bits=%d n=%zu: decode launch", \
+		block_size, bits, n); \
+	GPU_CHECK(GpuSameBits(GpuDownload(dev_floats, n), floats), \
+		"Int" #Width " block_size=%zu bits=%d n=%zu: decoding differs", \
+		block_size, bits, n); \
+	cudaFree(dev_exps); \
+	cudaFree(dev_ints); \
+	cudaFree(dev_floats); \
+}
+
+GPU_BLOCK(8, int8_t)
+GPU_BLOCK(16, int16_t)
+
+static void GpuBlocks(size_t n)
+{
+	static const size_t block_sizes[] = {0, 1, 7, 32, 33, 1000};
+	std::vector<float> in = GpuBlockFloats(n);
+	float* dev_in = GpuUpload(in);
+	for(size_t block_size : block_sizes)
+	{
+		// out of range bits get clamped the same on both sides
+		GpuBlock8(in, dev_in, block_size, 3);
+		GpuBlock8(in, dev_in, block_size, 8);
+		GpuBlock8(in, dev_in, block_size, 20);
+		GpuBlock16(in, dev_in, block_size, 12);
+		GpuBlock16(in, dev_in, block_size, 16);
+	}
+	cudaFree(dev_in);
+}
+
+int main()
+{
+	int devices = 0;
+	if(cudaGetDeviceCount(&devices) != cudaSuccess || devices == 0)
+	{
+		printf("no CUDA device, skipped\n");
+		return GPU_SKIPPED;
+	}
+	// the last is a whole grid and then some
+	const size_t sizes[] = {0, 1, 1000, 100003,
+		(size_t)SHRED_GPU_MAX_BLOCKS * SHRED_GPU_THREADS + 4097};
+	for(size_t n : sizes)
+	{
+		GpuMaps(n);
+		GpuHistograms(n);
+		GpuBlocks(n);
+	}
+	printf("%s: %d failures\n", failures ? "FAILED" : "passed", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,370 @@
+/*
+	Checks float_shredder.h's ShredHistogram against a plain loop that
+	counts every float's exponent and top mantissa bits: adding batches
+	small enough to go straight into the totals and big enough to go
+	through the sub-counters, removing them again, and merging and
+	subtracting whole histograms.
+
+	Then ShredFloatTally and ShredDoubleTally: a window sliding over some
+	data has to summarize the same as ShredFloatSummarize does from
+	scratch, apart from the sum's rounding and a removed min or max, which
+	has to come back as a bound in the right binade with TallySummary
+	returning false.
+
+	It exits with 1 if anything failed.
+*/
+#include "float_shredder.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static int failures = 0;
+
+#define HIST_CHECK(cond, ...) \
+	do \
+	{ \
+		if(!(cond)) \
+		{ \
+			printf("FAILED: " __VA_ARGS__); \
+			printf("\n"); \
+			failures++; \
+		} \
+	} while(0)
+
+// xorshift, so the data comes out the same on every run
+static uint32_t HistRandom(uint32_t* state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+// every bit pattern, with a third of them piled into one binade like real
+// data, so the same counters get hit over and over
+static std::vector<float> HistFloats(size_t n, uint32_t seed)
+{
+	std::vector<float> values(n);
+	uint32_t state = seed;
+	for(size_t i = 0; i < n; i++)
+	{
+		uint32_t r = HistRandom(&state);
+		values[i] = ShredDataToFloat(i % 3 ? r : 0x41200000u | (r >> 9));
+	}
+	return values;
+}
+
+// the histogram of in[0, n), the slow way
+struct HistExpected
+{
+	uint64_t count = 0;
+	std::vector<uint64_t> exponents = std::vector<uint64_t>(
+		SHRED_HISTOGRAM_EXP_BINS);
+	std::vector<uint64_t> mantissas;
+
+	HistExpected(int mantissa_bits, const float* in, size_t n) :
+		mantissas((size_t)1 << mantissa_bits)
+	{
+		count = n;
+		for(size_t i = 0; i < n; i++)
+		{
+			uint32_t data = ShredFloatToData(in[i]);
+			exponents[ShredFloatExpUnbiased(in[i])]++;
+			mantissas[(data & float_mantissa_mask) >>
+				(float_mantissa_bits - mantissa_bits)]++;
+		}
+	}
+};
+
+static bool HistSame(const ShredHistogram* hist, const HistExpected& expected)
+{
+	return hist->count == expected.count &&
+		memcmp(hist->exponents, expected.exponents.data(),
+			sizeof(hist->exponents)) == 0 &&
+		memcmp(hist->mantissas, expected.mantissas.data(),
+			expected.mantissas.size() * sizeof(uint64_t)) == 0;
+}
+
+static bool HistEmpty(const ShredHistogram* hist)
+{
+	HistExpected nothing(hist->mantissa_bits, NULL, 0);
+	return HistSame(hist, nothing);
+}
+
+/*
+	Batches under SHRED_HISTOGRAM_SETS * (256 + bins) go straight into the
+	totals, and bigger ones through the sub-counters and a fold, so the
+	sizes land on both sides of that for every mantissa_bits.
+*/
+static void HistAddRemove(int mantissa_bits, size_t n)
+{
+	std::vector<float> in = HistFloats(n, 0x9E3779B9u);
+	ShredHistogram hist;
+	if(!ShredHistogramInit(&hist, mantissa_bits))
+	{
+		HIST_CHECK(false, "%d bits: init", mantissa_bits);
+		return;
+	}
+	HIST_CHECK(HistEmpty(&hist), "%d bits: init left counts", mantissa_bits);
+
+	ShredHistogramAdd(&hist, in.data(), n);
+	HIST_CHECK(HistSame(&hist, HistExpected(mantissa_bits, in.data(), n)),
+		"%d bits n=%zu: add", mantissa_bits, n);
+
+	// a sliding window: the front falls off, the rest is what's left
+	size_t front = n / 3;
+	ShredHistogramRemove(&hist, in.data(), front);
+	HIST_CHECK(HistSame(&hist, HistExpected(mantissa_bits, in.data() + front,
+		n - front)), "%d bits n=%zu: remove the front", mantissa_bits, n);
+
+	ShredHistogramRemove(&hist, in.data() + front, n - front);
+	HIST_CHECK(HistEmpty(&hist), "%d bits n=%zu: remove everything",
+		mantissa_bits, n);
+
+	// the same floats one at a time, which can't go through the sub-counters
+	for(size_t i = 0; i < n && i < 1000; i++)
+	{
+		ShredHistogramAdd(&hist, &in[i], 1);
+	}
+	size_t some = n < 1000 ? n : 1000;
+	HIST_CHECK(HistSame(&hist, HistExpected(mantissa_bits, in.data(), some)),
+		"%d bits n=%zu: one at a time", mantissa_bits, n);
+
+	ShredHistogramClear(&hist);
+	HIST_CHECK(HistEmpty(&hist), "%d bits n=%zu: clear", mantissa_bits, n);
+	ShredHistogramFree(&hist);
+}
+
+static void HistMergeSubtract(int mantissa_bits)
+{
+	size_t n = 100000;
+	std::vector<float> in = HistFloats(n, 0x2545F491u);
+	size_t half = n / 2 + 3;
+	ShredHistogram a, b, whole, other;
+	ShredHistogramInit(&a, mantissa_bits);
+	ShredHistogramInit(&b, mantissa_bits);
+	ShredHistogramInit(&whole, mantissa_bits);
+	ShredHistogramInit(&other, mantissa_bits == 0 ? 1 : mantissa_bits - 1);
+	ShredHistogramAdd(&a, in.data(), half);
+	ShredHistogramAdd(&b, in.data() + half, n - half);
+	ShredHistogramAdd(&whole, in.data(), n);
+
+	HIST_CHECK(ShredHistogramMerge(&a, &b), "%d bits: merge", mantissa_bits);
+	HIST_CHECK(HistSame(&a, HistExpected(mantissa_bits, in.data(), n)),
+		"%d bits: merged counts", mantissa_bits);
+	HIST_CHECK(ShredHistogramSubtract(&whole, &b), "%d bits: subtract",
+		mantissa_bits);
+	HIST_CHECK(HistSame(&whole, HistExpected(mantissa_bits, in.data(), half)),
+		"%d bits: subtracted counts", mantissa_bits);
+	HIST_CHECK(ShredHistogramSubtract(&whole, &whole) && HistEmpty(&whole),
+		"%d bits: subtract from itself", mantissa_bits);
+
+	// different mantissa_bits can't be combined, and nothing changes
+	HIST_CHECK(!ShredHistogramMerge(&a, &other) &&
+		!ShredHistogramSubtract(&a, &other) &&
+		!ShredHistogramMerge(&other, &a),
+		"%d bits: combined with other bits", mantissa_bits);
+	HIST_CHECK(HistSame(&a, HistExpected(mantissa_bits, in.data(), n)),
+		"%d bits: changed by a failed merge", mantissa_bits);
+
+	ShredHistogramFree(&a);
+	ShredHistogramFree(&b);
+	ShredHistogramFree(&whole);
+	ShredHistogramFree(&other);
+}
+
+static void HistAll()
+{
+	static const int mantissa_bits[] = {0, 1, 5, 12,
+		SHRED_HISTOGRAM_MAX_MANTISSA_BITS};
+	static const size_t sizes[] = {0, 1, 3, 1000, 5000, 300000};
+	for(int bits : mantissa_bits)
+	{
+		for(size_t n : sizes)
+		{
+			HistAddRemove(bits, n);
+		}
+		HistMergeSubtract(bits);
+	}
+
+	ShredHistogram hist;
+	HIST_CHECK(!ShredHistogramInit(&hist, -1) && !hist.mantissas &&
+		!ShredHistogramInit(&hist, SHRED_HISTOGRAM_MAX_MANTISSA_BITS + 1) &&
+		!hist.mantissas, "out of range mantissa_bits accepted");
+}
+
+static std::vector<double> TallyDoubles(size_t n, uint32_t seed)
+{
+	std::vector<float> floats = HistFloats(n, seed);
+	return std::vector<double>(floats.begin(), floats.end());
+}
+
+/*
+	Slides a window of `window` floats along in by `step` at a time,
+	comparing the tally with a fresh summary after every step. Steps over
+	SHRED_TALLY_BLOCK go through the tally a block at a time. The sum only
+	has to be close, and the min and max exact unless TallySummary says
+	they're bounds, in which case they have to be in the same binade as the
+	real ones and on the right side of them.
+*/
+#define TALLY_DEFINE_WINDOW(Name, real_t, prefix) \
+static bool Tally##Name##Bound(real_t bound, real_t exact, bool below) \
+{ \
+	bool ordered = below ? \
+		Shred##Name##ToOrderedKey(bound) <= Shred##Name##ToOrderedKey(exact) : \
+		Shred##Name##ToOrderedKey(bound) >= Shred##Name##ToOrderedKey(exact); \
+	return ordered && Shred##Name##ToData(bound) >> prefix##_exp_offset == \
+		Shred##Name##ToData(exact) >> prefix##_exp_offset; \
+} \
+\
+static void Tally##Name##Window(const std::vector<real_t>& in, size_t window, \
+	size_t step) \
+{ \
+	Shred##Name##Tally tally; \
+	Shred##Name##TallyClear(&tally); \
+	double magnitudes = 0.0; \
+	for(real_t x : in) \
+	{ \
+		magnitudes += isfinite(x) ? fabs((double)x) : 0.0; \
+	} \
+	size_t end = 0; \
+	size_t bounds = 0; \
+	while(end < in.size()) \
+	{ \
+		size_t add = in.size() - end < step ? in.size() - end : step; \
+		Shred##Name##TallyAdd(&tally, in.data() + end, add); \
+		end += add; \
+		size_t start = end > window ? end - window : 0; \
+		size_t old = end - add > window ? end - add - window : 0; \
+		Shred##Name##TallyRemove(&tally, in.data() + old, start - old); \
+\
+		Shred##Name##Summary got, expected; \
+		bool exact = Shred##Name##TallySummary(&tally, &got); \
+		Shred##Name##Summarize(in.data() + start, end - start, &expected); \
+		HIST_CHECK(got.count == expected.count && \
+			got.nans == expected.nans && got.infs == expected.infs && \
+			got.negatives == expected.negatives && \
+			got.negative_zeros == expected.negative_zeros && \
+			got.exp_min == expected.exp_min && \
+			got.exp_max == expected.exp_max, \
+			#Name " window=%zu step=%zu end=%zu: counts", window, step, end); \
+		HIST_CHECK(fabs(got.sum - expected.sum) <= 1e-9 * magnitudes, \
+			#Name " window=%zu step=%zu end=%zu: sum %.17g, not %.17g", \
+			window, step, end, got.sum, expected.sum); \
+		if(exact) \
+		{ \
+			HIST_CHECK(Shred##Name##ToData(got.min) == \
+				Shred##Name##ToData(expected.min) && \
+				Shred##Name##ToData(got.max) == \
+				Shred##Name##ToData(expected.max), \
+				#Name " window=%zu step=%zu end=%zu: min and max", window, \
+				step, end); \
+		} else { \
+			bounds++; \
+			HIST_CHECK(Tally##Name##Bound(got.min, expected.min, true) && \
+				Tally##Name##Bound(got.max, expected.max, false), \
+				#Name " window=%zu step=%zu end=%zu: min and max bounds", \
+				window, step, end); \
+		} \
+	} \
+	/* with data this random some window has to lose its min or max */ \
+	HIST_CHECK(in.size() <= 2 * window || bounds > 0, \
+		#Name " window=%zu step=%zu: never a bound", window, step); \
+\
+	/* and taking the rest off leaves nothing at all */ \
+	size_t start = end > window ? end - window : 0; \
+	Shred##Name##TallyRemove(&tally, in.data() + start, end - start); \
+	Shred##Name##Summary got, nothing; \
+	Shred##Name##SummaryClear(&nothing); \
+	HIST_CHECK(Shred##Name##TallySummary(&tally, &got) && \
+		memcmp(&got, &nothing, sizeof(got)) == 0, \
+		#Name " window=%zu step=%zu: not empty at the end", window, step); \
+	bool zeros = true; \
+	for(uint64_t bin : tally.bins) \
+	{ \
+		zeros = zeros && bin == 0; \
+	} \
+	HIST_CHECK(zeros, #Name " window=%zu step=%zu: bins left", window, step); \
+}
+
+TALLY_DEFINE_WINDOW(Float, float, float)
+TALLY_DEFINE_WINDOW(Double, double, double)
+
+static void TallyWindows()
+{
+	std::vector<float> floats = HistFloats(30000, 0x6A09E667u);
+	std::vector<double> doubles = TallyDoubles(30000, 0xBB67AE85u);
+	// the last two step past SHRED_TALLY_BLOCK
+	static const size_t windows[][2] = {{1, 1}, {100, 7}, {3000, 700},
+		{10000, 4500}, {20000, 20000}};
+	for(const size_t* w : windows)
+	{
+		TallyFloatWindow(floats, w[0], w[1]);
+		TallyDoubleWindow(doubles, w[0], w[1]);
+	}
+}
+
+// the remove path, by hand
+static void TallyRemoves()
+{
+	ShredFloatTally tally;
+	ShredFloatSummary summary;
+	ShredFloatTallyClear(&tally);
+	float some[] = {1.5f, 2.5f, 3.0f, 5.0f, NAN};
+	ShredFloatTallyAdd(&tally, some, 5);
+	HIST_CHECK(ShredFloatTallySummary(&tally, &summary) &&
+		summary.min == 1.5f && summary.max == 5.0f, "tally: exact");
+
+	// 2.5 is left in [2, 4), so the min's bound is 2
+	ShredFloatTallyRemove(&tally, some, 1);
+	HIST_CHECK(!ShredFloatTallySummary(&tally, &summary) &&
+		summary.min == 2.0f && summary.max == 5.0f,
+		"tally: removed min gives %g", summary.min);
+
+	// anything below the bound makes it exact again
+	float below = -1.0f;
+	ShredFloatTallyAdd(&tally, &below, 1);
+	HIST_CHECK(ShredFloatTallySummary(&tally, &summary) &&
+		summary.min == -1.0f, "tally: added min");
+
+	// and the max's bound is the top of [2, 4)
+	ShredFloatTallyRemove(&tally, some + 3, 1);
+	HIST_CHECK(!ShredFloatTallySummary(&tally, &summary) &&
+		summary.max == ShredDataToFloat(0x407FFFFFu) && summary.count == 4,
+		"tally: removed max gives %g", summary.max);
+
+	// only the NaN left, so nothing to have a min or max
+	ShredFloatTallyRemove(&tally, some + 1, 2);
+	ShredFloatTallyRemove(&tally, &below, 1);
+	HIST_CHECK(ShredFloatTallySummary(&tally, &summary) &&
+		isnan(summary.min) && isnan(summary.max) && summary.count == 1 &&
+		summary.nans == 1 && summary.sum == 0.0, "tally: only a NaN left");
+
+	// sums that would round differently on the way off still end up at 0
+	// once only infs are left
+	float rounding[] = {1e30f, 1.0f, -1e30f, 3.0f, INFINITY};
+	ShredFloatTallyClear(&tally);
+	ShredFloatTallyAdd(&tally, rounding, 5);
+	ShredFloatTallyRemove(&tally, rounding, 1);
+	ShredFloatTallyRemove(&tally, rounding + 1, 1);
+	ShredFloatTallyRemove(&tally, rounding + 2, 2);
+	// (-1e30 went, so the min is a bound, even if it's the inf itself)
+	ShredFloatTallySummary(&tally, &summary);
+	HIST_CHECK(summary.sum == 0.0 && summary.infs == 1 && summary.count == 1 &&
+		summary.min == INFINITY, "tally: sum %g with only an inf left",
+		summary.sum);
+}
+
+int main()
+{
+	HistAll();
+	TallyWindows();
+	TallyRemoves();
+	printf("%s: %d failures\n", failures ? "FAILED" : "passed", failures);
+	return failures ? 1 : 0;
+}
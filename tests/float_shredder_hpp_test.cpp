@@ -0,0 +1,243 @@
+/*
+	Checks float_shredder.hpp: that the span functions give what the C
+	Array functions give, that reading a pipeline as a range gives the same
+	bits as shred::store running it a block at a time, and (at compile
+	time) that the concepts turn away the steps and pipelines they should.
+
+	It exits with 1 if anything failed.
+*/
+#include "float_shredder.hpp"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static int failures = 0;
+
+#define HPP_CHECK(cond, ...) \
+	do \
+	{ \
+		if(!(cond)) \
+		{ \
+			printf("FAILED: " __VA_ARGS__); \
+			printf("\n"); \
+			failures++; \
+		} \
+	} while(0)
+
+// whether source | step compiles
+template <typename Source, typename Step>
+concept pipeable = requires(const Source& source, const Step& step)
+{
+	source | step;
+};
+
+using float_view = shred::source<float>;
+using double_view = shred::source<double>;
+
+static_assert(shred::real<float> && shred::real<double>);
+static_assert(!shred::real<int> && !shred::real<long double>);
+static_assert(!shred::real<const float>);
+static_assert(shred::step<shred::truncate_step, float>);
+static_assert(shred::step<shred::exponent_step, double>);
+// the approximations only come in float
+static_assert(shred::step<shred::log2_approx_step, float>);
+static_assert(!shred::step<shred::log2_approx_step, double>);
+static_assert(!shred::step<int, float>);
+static_assert(!shred::stage<std::vector<float>>);
+static_assert(!shred::stage<std::span<const float>>);
+static_assert(pipeable<float_view, shred::truncate_step>);
+static_assert(!pipeable<double_view, shred::sqrt_approx_step>);
+// a step that turns floats into ints has to go last
+static_assert(pipeable<float_view, shred::exponent_step>);
+static_assert(!pipeable<shred::pipeline<float_view, shred::exponent_step>,
+	shred::truncate_step>);
+static_assert(!pipeable<std::vector<float>, shred::truncate_step>);
+static_assert(std::ranges::random_access_range<
+	shred::pipeline<float_view, shred::exponent_step>>);
+static_assert(std::ranges::borrowed_range<float_view>);
+
+// SHRED_CONSTEXPR is constexpr under C++20, so the steps are too
+static_assert(shred::exponent()(8.0f) == 3);
+// 1.11b with a mantissa bit left is a tie, so it rounds to even
+static_assert(shred::truncate(22)(1.75f) == 2.0f);
+static_assert(shred::truncate(0)(1.75) == 1.75);
+
+// xorshift, so the data comes out the same on every run
+static uint32_t HppRandom(uint32_t* state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+// every bit pattern, specials included
+static std::vector<float> HppFloats(size_t n)
+{
+	std::vector<float> values(n);
+	uint32_t state = 0x9E3779B9u;
+	for(float& v : values)
+	{
+		v = ShredDataToFloat(HppRandom(&state));
+	}
+	return values;
+}
+
+static std::vector<double> HppDoubles(size_t n)
+{
+	std::vector<double> values(n);
+	uint32_t state = 0x2545F491u;
+	for(double& v : values)
+	{
+		uint64_t high = HppRandom(&state);
+		v = ShredDataToDouble(high << 32 | HppRandom(&state));
+	}
+	return values;
+}
+
+template <typename T>
+static bool HppSameBits(const std::vector<T>& a, const std::vector<T>& b)
+{
+	return a.size() == b.size() &&
+		(a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+static void HppSpans()
+{
+	std::vector<float> in = HppFloats(1000);
+	std::vector<double> din = HppDoubles(1000);
+
+	std::vector<int32_t> exps(in.size()), c_exps(in.size());
+	HPP_CHECK(shred::exponent(in, exps) == in.size(), "exponent: count");
+	ShredFloatExpArray(in.data(), c_exps.data(), in.size());
+	HPP_CHECK(HppSameBits(exps, c_exps), "exponent: results");
+
+	std::vector<float> truncated(in.size()), c_truncated(in.size());
+	shred::truncate(in, truncated, 8);
+	ShredFloatTruncateMantissaArray(in.data(), c_truncated.data(), in.size(),
+		8, NULL);
+	HPP_CHECK(HppSameBits(truncated, c_truncated), "truncate: results");
+
+	std::vector<double> dscaled(din.size()), c_dscaled(din.size());
+	shred::scale_pow2(din, dscaled, 5);
+	ShredDoubleScalePow2Array(din.data(), c_dscaled.data(), din.size(), 5);
+	HPP_CHECK(HppSameBits(dscaled, c_dscaled), "double scale_pow2: results");
+
+	std::vector<uint64_t> keys(din.size()), c_keys(din.size());
+	shred::ordered_key(din, keys, true);
+	ShredDoubleToCanonicalKeyArray(din.data(), c_keys.data(), din.size(),
+		SHRED_ENDIAN_NATIVE);
+	HPP_CHECK(HppSameBits(keys, c_keys), "double ordered_key: results");
+
+	std::vector<float> logs(in.size()), c_logs(in.size());
+	shred::log2_approx(in, logs, SHRED_APPROX_MEDIUM);
+	ShredFloatLog2ApproxArray(in.data(), c_logs.data(), in.size(),
+		SHRED_APPROX_MEDIUM);
+	HPP_CHECK(HppSameBits(logs, c_logs), "log2_approx: results");
+
+	// only min(in, out) gets written
+	std::vector<int32_t> short_out(10, -999);
+	HPP_CHECK(shred::exponent(in, std::span<int32_t>(short_out.data(), 7)) ==
+		7, "short out: count");
+	HPP_CHECK(short_out[6] == c_exps[6] && short_out[7] == -999,
+		"short out: wrote past the end");
+	HPP_CHECK(shred::exponent(std::span<const float>(in.data(), 3),
+		short_out) == 3, "short in: count");
+
+	// big steps saturate rather than wrapping round to small ones
+	std::vector<float> stepped(in.size()), c_stepped(in.size());
+	shred::step_ulps(in, stepped, ((int64_t)1 << 32) + 1);
+	ShredFloatStepUlpsArray(in.data(), c_stepped.data(), in.size(),
+		INT32_MAX);
+	HPP_CHECK(HppSameBits(stepped, c_stepped), "step_ulps 2^32 + 1");
+	shred::step_ulps(in, stepped, -((int64_t)1 << 40));
+	ShredFloatStepUlpsArray(in.data(), c_stepped.data(), in.size(),
+		INT32_MIN);
+	HPP_CHECK(HppSameBits(stepped, c_stepped), "step_ulps -2^40");
+	HPP_CHECK(shred::step_ulps((int64_t)1 << 31)(1.0f) ==
+		ShredFloatStepUlps(1.0f, INT32_MAX), "step_ulps 2^31 scalar");
+}
+
+// the range and store give the same bits, and so do the C functions
+template <typename Stage>
+static void HppCompare(const char* name, const Stage& stage,
+	const std::vector<typename Stage::value_type>& expected)
+{
+	using value_type = typename Stage::value_type;
+	size_t n = stage.size();
+	std::vector<value_type> ranged;
+	for(value_type v : stage)
+	{
+		ranged.push_back(v);
+	}
+	std::vector<value_type> stored(n);
+	HPP_CHECK(shred::store(stage, stored) == n, "%s n=%zu: store count",
+		name, n);
+	HPP_CHECK(HppSameBits(ranged, stored), "%s n=%zu: range != store", name,
+		n);
+	HPP_CHECK(HppSameBits(stored, expected), "%s n=%zu: store != C", name,
+		n);
+	HPP_CHECK(n == 0 || (stage[n - 1] == expected[n - 1] ||
+		stage[n - 1] != stage[n - 1]), "%s n=%zu: indexing", name, n);
+}
+
+static void HppPipelines()
+{
+	static const size_t sizes[] = {0, 1, 7, SHRED_PIPELINE_BLOCK - 1,
+		SHRED_PIPELINE_BLOCK, SHRED_PIPELINE_BLOCK + 1,
+		3 * SHRED_PIPELINE_BLOCK + 17};
+	for(size_t n : sizes)
+	{
+		std::vector<float> in = HppFloats(n);
+		std::vector<double> din = HppDoubles(n);
+
+		// a bare view gives back the data
+		HppCompare("view", shred::view(in), in);
+
+		std::vector<float> a(n), b(n);
+		std::vector<int32_t> exps(n);
+		ShredFloatTruncateMantissaArray(in.data(), a.data(), n, 8, NULL);
+		ShredFloatScalePow2Array(a.data(), b.data(), n, -3);
+		ShredFloatExpArray(b.data(), exps.data(), n);
+		HppCompare("truncate | scale_pow2 | exponent", shred::view(in) |
+			shred::truncate(8) | shred::scale_pow2(-3) | shred::exponent(),
+			exps);
+
+		// only the approximations' positive normal path vectorizes, but
+		// the rest has to agree too
+		std::vector<float> roots(n);
+		ShredFloatByteSwapArray(in.data(), a.data(), n);
+		ShredFloatSqrtApproxArray(a.data(), roots.data(), n,
+			SHRED_APPROX_FAST);
+		HppCompare("byte_swap | sqrt_approx", shred::view(in) |
+			shred::byte_swap() | shred::sqrt_approx(SHRED_APPROX_FAST),
+			roots);
+
+		std::vector<uint32_t> keys(n);
+		ShredFloatStepUlpsArray(in.data(), a.data(), n, 3);
+		ShredFloatToOrderedKeyArray(a.data(), keys.data(), n,
+			SHRED_ENDIAN_NATIVE);
+		HppCompare("step_ulps | ordered_key", shred::view(in) |
+			shred::step_ulps(3) | shred::ordered_key(), keys);
+
+		std::vector<double> d(n);
+		std::vector<uint8_t> classes(n);
+		ShredDoubleShiftMantDownArray(din.data(), d.data(), n, 4);
+		ShredDoubleClassifyArray(d.data(), classes.data(), n);
+		HppCompare("double shift_mant_down | classify", shred::view(din) |
+			shred::shift_mant_down(4) | shred::classify(), classes);
+	}
+}
+
+int main()
+{
+	HppSpans();
+	HppPipelines();
+	printf("%s: %d failures\n", failures ? "FAILED" : "passed", failures);
+	return failures ? 1 : 0;
+}
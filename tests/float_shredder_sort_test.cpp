@@ -0,0 +1,402 @@
+/*
+	Checks float_shredder_sort.h's radix sorts against std::stable_sort on
+	the ordered keys: that the order is totalOrder (-0 before +0, NaNs at
+	the end their sign says), that equal keys keep their order and their
+	values, that skipping a digit everybody shares still sorts, and that
+	the scratch and parallel versions give the same as the plain one.
+
+	Then the same for ShredFloatExpPartition: every bucket has to hold
+	just the floats with its exponent, in the order they came in, and the
+	parallel version has to give the same bits.
+
+	It exits with 1 if anything failed.
+*/
+#include "float_shredder_threads.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static int failures = 0;
+
+#define SORT_CHECK(cond, ...) \
+	do \
+	{ \
+		if(!(cond)) \
+		{ \
+			printf("FAILED: " __VA_ARGS__); \
+			printf("\n"); \
+			failures++; \
+		} \
+	} while(0)
+
+// xorshift, so the data comes out the same on every run
+static uint32_t SortRandom(uint32_t* state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+enum SortData
+{
+	// every bit pattern, NaN payloads and subnormals included
+	SORT_RANDOM,
+	// a handful of values, so most keys have equals to keep in order
+	SORT_FEW,
+	// all in [1, 1.5), so the top digit (mantissa bit 22 up) is the same
+	SORT_ONE_BINADE,
+	// positive, with only the top 10 bits varying, so the bottom two
+	// digits get skipped (negative keys have their low bits flipped to 1s)
+	SORT_TOP_BITS,
+	SORT_DATA_COUNT
+};
+
+static const char* sort_data_names[SORT_DATA_COUNT] = {
+	"random", "few", "one binade", "top bits"
+};
+
+static std::vector<float> SortMakeData(SortData data, size_t n)
+{
+	static const uint32_t few[] = {
+		0x00000000u, 0x80000000u, 0x7FC00000u, 0xFFC00000u, 0x7F800001u,
+		0x3F800000u, 0xBF800000u, 0x00000001u
+	};
+	std::vector<float> values(n);
+	uint32_t state = 0x9E3779B9u;
+	for(size_t i = 0; i < n; i++)
+	{
+		uint32_t r = SortRandom(&state);
+		switch(data)
+		{
+		case SORT_FEW:
+			values[i] = ShredDataToFloat(few[r % 8]);
+			break;
+		case SORT_ONE_BINADE:
+			values[i] = ShredDataToFloat(0x3F800000u | (r >> 10));
+			break;
+		case SORT_TOP_BITS:
+			values[i] = ShredDataToFloat(r & 0x7FC00000u);
+			break;
+		default:
+			values[i] = ShredDataToFloat(r);
+			break;
+		}
+	}
+	return values;
+}
+
+/*
+	What a stable sort on the ordered keys gives, with each key's index as
+	its value.
+*/
+static void SortExpected(const std::vector<float>& in,
+	std::vector<float>* keys, std::vector<uint32_t>* values)
+{
+	std::vector<uint32_t> order(in.size());
+	for(size_t i = 0; i < in.size(); i++)
+	{
+		order[i] = (uint32_t)i;
+	}
+	std::stable_sort(order.begin(), order.end(),
+		[&](uint32_t a, uint32_t b)
+		{
+			return ShredFloatToOrderedKey(in[a]) <
+				ShredFloatToOrderedKey(in[b]);
+		});
+	keys->resize(in.size());
+	*values = order;
+	for(size_t i = 0; i < in.size(); i++)
+	{
+		(*keys)[i] = in[order[i]];
+	}
+}
+
+static std::vector<uint32_t> SortIndices(size_t n)
+{
+	std::vector<uint32_t> values(n);
+	for(size_t i = 0; i < n; i++)
+	{
+		values[i] = (uint32_t)i;
+	}
+	return values;
+}
+
+template <typename T>
+static bool SortSameBits(const std::vector<T>& a, const std::vector<T>& b)
+{
+	return a.size() == b.size() &&
+		(a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+static void SortFloats(SortData data, size_t n)
+{
+	const char* name = sort_data_names[data];
+	std::vector<float> in = SortMakeData(data, n);
+	std::vector<float> expected_keys;
+	std::vector<uint32_t> expected_values;
+	SortExpected(in, &expected_keys, &expected_values);
+
+	std::vector<float> keys = in;
+	SORT_CHECK(ShredFloatRadixSort(keys.data(), n), "%s n=%zu: sort", name,
+		n);
+	SORT_CHECK(SortSameBits(keys, expected_keys), "%s n=%zu: sort order",
+		name, n);
+
+	keys = in;
+	std::vector<uint32_t> values = SortIndices(n);
+	SORT_CHECK(ShredFloatRadixSortPairs(keys.data(), values.data(), n),
+		"%s n=%zu: pairs", name, n);
+	SORT_CHECK(SortSameBits(keys, expected_keys) &&
+		SortSameBits(values, expected_values), "%s n=%zu: pairs order", name,
+		n);
+
+	// the scratch is used as it is, so a dirty one has to work too
+	keys = in;
+	values = SortIndices(n);
+	size_t size = ShredFloatRadixScratchSize(n, true);
+	std::vector<uint8_t> scratch(size + 64, 0xA5);
+	ShredFloatRadixSortScratch(keys.data(), values.data(), n, scratch.data());
+	SORT_CHECK(SortSameBits(keys, expected_keys) &&
+		SortSameBits(values, expected_values), "%s n=%zu: scratch order",
+		name, n);
+	bool untouched = true;
+	for(size_t i = size; i < scratch.size(); i++)
+	{
+		untouched = untouched && scratch[i] == 0xA5;
+	}
+	SORT_CHECK(untouched, "%s n=%zu: scratch written past its size", name, n);
+
+	// 3 threads don't split the data evenly, and 0 is every CPU
+	static const int threads[] = {1, 2, 3, 0};
+	for(int t : threads)
+	{
+		keys = in;
+		values = SortIndices(n);
+		SORT_CHECK(ShredFloatRadixSortParallel(keys.data(), values.data(), n,
+			t), "%s n=%zu threads=%d: parallel", name, n, t);
+		SORT_CHECK(SortSameBits(keys, expected_keys) &&
+			SortSameBits(values, expected_values),
+			"%s n=%zu threads=%d: parallel pairs order", name, n, t);
+		keys = in;
+		SORT_CHECK(ShredFloatRadixSortParallel(keys.data(), NULL, n, t) &&
+			SortSameBits(keys, expected_keys),
+			"%s n=%zu threads=%d: parallel order", name, n, t);
+	}
+}
+
+static void SortAll()
+{
+	// the big ones give every thread at least a SHRED_THREADS_MIN_SLICE
+	static const size_t sizes[] = {0, 1, 2, 100, 5000,
+		3 * SHRED_THREADS_MIN_SLICE + 77};
+	for(int data = 0; data < SORT_DATA_COUNT; data++)
+	{
+		for(size_t n : sizes)
+		{
+			SortFloats((SortData)data, n);
+		}
+	}
+}
+
+// totalOrder, spelled out
+static void SortTotalOrder()
+{
+	static const uint32_t sorted[] = {
+		0xFFC00001u, 0xFFC00000u, 0xFF800001u, 0xFF800000u, 0xBF800000u,
+		0x80000001u, 0x80000000u, 0x00000000u, 0x00000001u, 0x3F800000u,
+		0x7F800000u, 0x7F800001u, 0x7FC00000u, 0x7FC00001u
+	};
+	size_t n = sizeof(sorted) / sizeof(sorted[0]);
+	std::vector<float> keys(n);
+	uint32_t state = 0x1234567u;
+	// backwards, then shuffled
+	for(size_t i = 0; i < n; i++)
+	{
+		keys[i] = ShredDataToFloat(sorted[n - 1 - i]);
+	}
+	for(size_t i = n - 1; i > 0; i--)
+	{
+		std::swap(keys[i], keys[SortRandom(&state) % (i + 1)]);
+	}
+	ShredFloatRadixSort(keys.data(), n);
+	for(size_t i = 0; i < n; i++)
+	{
+		SORT_CHECK(ShredFloatToData(keys[i]) == sorted[i],
+			"total order: %zu is %08X, not %08X", i,
+			ShredFloatToData(keys[i]), sorted[i]);
+	}
+
+	std::vector<double> doubles = {0.0, -0.0, -INFINITY, 1.0, -NAN, NAN,
+		-1.0, INFINITY, 5e-324, -5e-324};
+	ShredDoubleRadixSort(doubles.data(), doubles.size());
+	SORT_CHECK(signbit(doubles[0]) && isnan(doubles[0]) &&
+		doubles[1] == -INFINITY && doubles[2] == -1.0 &&
+		doubles[3] == -5e-324 && signbit(doubles[4]) && doubles[4] == 0.0 &&
+		!signbit(doubles[5]) && doubles[5] == 0.0 && doubles[6] == 5e-324 &&
+		doubles[7] == 1.0 && doubles[8] == INFINITY &&
+		!signbit(doubles[9]) && isnan(doubles[9]),
+		"double total order");
+}
+
+// the digits everybody shares are the ones that get skipped
+static void SortTrivialDigits()
+{
+	size_t counts[SHRED_RADIX_PASSES(32) * SHRED_RADIX_BUCKETS];
+	std::vector<float> in = SortMakeData(SORT_TOP_BITS, 1000);
+	memset(counts, 0, sizeof(counts));
+	ShredFloatRadixCount(in.data(), in.size(), counts);
+	for(int p = 0; p < SHRED_RADIX_PASSES(32); p++)
+	{
+		bool top = (p + 1) * SHRED_RADIX_BITS > 22;
+		SORT_CHECK(ShredFloatRadixTrivial(in.data(), in.size(),
+			counts + p * SHRED_RADIX_BUCKETS, p) == !top,
+			"top bits: pass %d", p);
+	}
+
+	in = SortMakeData(SORT_ONE_BINADE, 1000);
+	memset(counts, 0, sizeof(counts));
+	ShredFloatRadixCount(in.data(), in.size(), counts);
+	int last = SHRED_RADIX_PASSES(32) - 1;
+	SORT_CHECK(ShredFloatRadixTrivial(in.data(), in.size(),
+		counts + last * SHRED_RADIX_BUCKETS, last), "one binade: top pass");
+	SORT_CHECK(!ShredFloatRadixTrivial(in.data(), in.size(), counts, 0),
+		"one binade: bottom pass");
+}
+
+static void SortDoubles()
+{
+	static const size_t sizes[] = {0, 1, 3000};
+	for(size_t n : sizes)
+	{
+		std::vector<double> in(n);
+		uint32_t state = 0x2545F491u;
+		for(double& v : in)
+		{
+			uint64_t high = SortRandom(&state);
+			// half of them the same, to check the order they keep
+			v = high & 1 ? 1.5 : ShredDataToDouble(high << 32 |
+				SortRandom(&state));
+		}
+		std::vector<uint64_t> values(n);
+		for(size_t i = 0; i < n; i++)
+		{
+			values[i] = i;
+		}
+		std::vector<uint64_t> expected = values;
+		std::stable_sort(expected.begin(), expected.end(),
+			[&](uint64_t a, uint64_t b)
+			{
+				return ShredDoubleToOrderedKey(in[a]) <
+					ShredDoubleToOrderedKey(in[b]);
+			});
+		std::vector<double> keys = in;
+		SORT_CHECK(ShredDoubleRadixSortPairs(keys.data(), values.data(), n),
+			"double n=%zu: pairs", n);
+		bool ordered = SortSameBits(values, expected);
+		for(size_t i = 0; i < n && ordered; i++)
+		{
+			ordered = ShredDoubleToData(keys[i]) ==
+				ShredDoubleToData(in[expected[i]]);
+		}
+		SORT_CHECK(ordered, "double n=%zu: pairs order", n);
+	}
+}
+
+/*
+	Bucket b has to be exactly the floats with exponent b, in input order.
+	That also covers offsets[0] = 0 and offsets[256] = n.
+*/
+static bool PartitionExpected(const std::vector<float>& in, const float* out,
+	const size_t* offsets)
+{
+	std::vector<size_t> next(offsets, offsets + SHRED_PARTITION_BUCKETS);
+	if(offsets[0] != 0 || offsets[SHRED_PARTITION_BUCKETS] != in.size())
+	{
+		return false;
+	}
+	for(float x : in)
+	{
+		uint32_t b = ShredFloatExpUnbiased(x);
+		if(next[b] >= offsets[b + 1] ||
+			ShredFloatToData(out[next[b]++]) != ShredFloatToData(x))
+		{
+			return false;
+		}
+	}
+	// and nothing left over, which also rules out offsets going backwards
+	for(size_t b = 0; b < SHRED_PARTITION_BUCKETS; b++)
+	{
+		if(next[b] != offsets[b + 1])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+	out starts `skew` floats into a cache line, so the buffers' first lines
+	start partway in, and the float past the end has to stay as it was.
+*/
+static void PartitionFloats(SortData data, size_t n, size_t skew)
+{
+	const char* name = sort_data_names[data];
+	std::vector<float> in = SortMakeData(data, n);
+	std::vector<float> storage(n + SHRED_PARTITION_LINE + 1, 7.0f);
+	float* out = storage.data() + skew;
+	size_t offsets[SHRED_PARTITION_BUCKETS + 1];
+	ShredFloatExpPartition(in.data(), n, out, offsets);
+	SORT_CHECK(PartitionExpected(in, out, offsets),
+		"partition %s n=%zu skew=%zu: buckets", name, n, skew);
+	SORT_CHECK(out[n] == 7.0f, "partition %s n=%zu skew=%zu: wrote past n",
+		name, n, skew);
+
+	std::vector<float> serial(out, out + n);
+	static const int threads[] = {1, 2, 3, 0};
+	for(int t : threads)
+	{
+		std::vector<float> parallel(n + 1, 7.0f);
+		size_t parallel_offsets[SHRED_PARTITION_BUCKETS + 1];
+		SORT_CHECK(ShredFloatExpPartitionParallel(in.data(), n,
+			parallel.data(), parallel_offsets, t),
+			"partition %s n=%zu threads=%d: parallel", name, n, t);
+		SORT_CHECK(memcmp(parallel_offsets, offsets, sizeof(offsets)) == 0 &&
+			(n == 0 || memcmp(parallel.data(), serial.data(),
+			n * sizeof(float)) == 0) && parallel[n] == 7.0f,
+			"partition %s n=%zu threads=%d: differs from serial", name, n, t);
+	}
+}
+
+static void PartitionAll()
+{
+	static const size_t sizes[] = {0, 1, 15, 16, 17, 5000,
+		3 * SHRED_THREADS_MIN_SLICE + 77};
+	for(int data = 0; data < SORT_DATA_COUNT; data++)
+	{
+		for(size_t n : sizes)
+		{
+			for(size_t skew = 0; skew < SHRED_PARTITION_LINE; skew += 5)
+			{
+				PartitionFloats((SortData)data, n, skew);
+			}
+		}
+	}
+}
+
+int main()
+{
+	SortAll();
+	SortTotalOrder();
+	SortTrivialDigits();
+	SortDoubles();
+	PartitionAll();
+	printf("%s: %d failures\n", failures ? "FAILED" : "passed", failures);
+	return failures ? 1 : 0;
+}
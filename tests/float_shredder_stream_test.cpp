@@ -0,0 +1,350 @@
+/*
+	Streams little and big endian dumps of floats, doubles and halves
+	through float_shredder_stream.h's ShredStreamFile and checks that the
+	callback sees every element in order and in native byte order, that a
+	partial element at the end gets reported rather than handed over, and
+	that a callback returning false stops it.
+
+	The chunks are shrunk to 64 KiB, still whole pages anywhere, so the
+	files span several of them.
+	CMake builds this twice, once as it is and once with
+	SHRED_STREAM_NO_MMAP, so both the mmap and the fread versions get run.
+
+	Then that the Endian batch functions, which swap SHRED_SWAP_BLOCK
+	elements at a time, give the same as swapping everything first and
+	calling the normal function, for every instruction set this CPU has.
+
+	It exits with 1 if anything failed.
+*/
+#define SHRED_STREAM_CHUNK ((size_t)64 << 10)
+#include "float_shredder_stream.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <string.h>
+#include <vector>
+
+static int failures = 0;
+
+#define STREAM_CHECK(cond, ...) \
+	do \
+	{ \
+		if(!(cond)) \
+		{ \
+			printf("FAILED: " __VA_ARGS__); \
+			printf("\n"); \
+			failures++; \
+		} \
+	} while(0)
+
+// xorshift, so the data comes out the same on every run
+static uint32_t StreamRandom(uint32_t* state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+// n elements of element_size random bytes each, in native byte order
+static std::vector<uint8_t> StreamElements(size_t n, size_t element_size)
+{
+	std::vector<uint8_t> bytes(n * element_size);
+	uint32_t state = 0x9E3779B9u;
+	for(uint8_t& b : bytes)
+	{
+		b = (uint8_t)StreamRandom(&state);
+	}
+	return bytes;
+}
+
+// the same elements as the file would hold them, plus `tail` stray bytes
+static std::vector<uint8_t> StreamDump(const std::vector<uint8_t>& native,
+	size_t element_size, ShredEndian endian, size_t tail)
+{
+	std::vector<uint8_t> dump = native;
+	if(!ShredEndianIsNative(endian))
+	{
+		for(size_t i = 0; i < dump.size(); i += element_size)
+		{
+			for(size_t j = 0; j < element_size / 2; j++)
+			{
+				uint8_t swap = dump[i + j];
+				dump[i + j] = dump[i + element_size - 1 - j];
+				dump[i + element_size - 1 - j] = swap;
+			}
+		}
+	}
+	for(size_t i = 0; i < tail; i++)
+	{
+		dump.push_back((uint8_t)(0xA0 + i));
+	}
+	return dump;
+}
+
+static bool StreamWrite(const std::string& path,
+	const std::vector<uint8_t>& bytes)
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if(!file)
+	{
+		return false;
+	}
+	bool ok = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+	return fclose(file) == 0 && ok;
+}
+
+typedef struct StreamJob
+{
+	size_t element_size;
+	std::vector<uint8_t> seen;
+	size_t calls;
+	// stop after this many calls, or never with 0
+	size_t stop_after;
+	bool in_order;
+} StreamJob;
+
+static bool StreamCallback(void* ctx, const void* data, size_t count,
+	uint64_t first)
+{
+	StreamJob* job = (StreamJob*)ctx;
+	job->in_order = job->in_order && count > 0 &&
+		first == job->seen.size() / job->element_size;
+	const uint8_t* bytes = (const uint8_t*)data;
+	job->seen.insert(job->seen.end(), bytes, bytes + count * job->element_size);
+	job->calls++;
+	return job->stop_after == 0 || job->calls < job->stop_after;
+}
+
+static void StreamCheck(const std::string& path, size_t element_size,
+	ShredEndian endian, size_t n, size_t tail)
+{
+	const char* order = endian == SHRED_ENDIAN_BIG ? "big" : "little";
+	std::vector<uint8_t> native = StreamElements(n, element_size);
+	if(!StreamWrite(path, StreamDump(native, element_size, endian, tail)))
+	{
+		STREAM_CHECK(false, "couldn't write %s", path.c_str());
+		return;
+	}
+
+	StreamJob job;
+	job.element_size = element_size;
+	job.calls = 0;
+	job.stop_after = 0;
+	job.in_order = true;
+	ShredStreamInfo info;
+	bool ok = ShredStreamFile(path.c_str(), element_size, endian,
+		StreamCallback, &job, &info);
+	STREAM_CHECK(ok && !info.stopped && info.elements == n &&
+		info.leftover_bytes == tail,
+		"%s %zu-byte n=%zu tail=%zu: ok %d elements %llu leftover %llu",
+		order, element_size, n, tail, ok, (unsigned long long)info.elements,
+		(unsigned long long)info.leftover_bytes);
+	STREAM_CHECK(job.seen == native && job.in_order,
+		"%s %zu-byte n=%zu tail=%zu: contents", order, element_size, n, tail);
+	size_t chunk_elements = SHRED_STREAM_CHUNK / element_size;
+	STREAM_CHECK(job.calls == (n + chunk_elements - 1) / chunk_elements,
+		"%s %zu-byte n=%zu tail=%zu: %zu chunks", order, element_size, n,
+		tail, job.calls);
+
+	// stopping after the first chunk, which might also be the last
+	if(n > 0)
+	{
+		job.seen.clear();
+		job.calls = 0;
+		job.stop_after = 1;
+		job.in_order = true;
+		ok = ShredStreamFile(path.c_str(), element_size, endian,
+			StreamCallback, &job, &info);
+		size_t expected = n < chunk_elements ? n : chunk_elements;
+		STREAM_CHECK(ok && info.stopped && job.calls == 1 &&
+			info.elements == expected && job.seen.size() ==
+			expected * element_size && memcmp(job.seen.data(), native.data(),
+			job.seen.size()) == 0,
+			"%s %zu-byte n=%zu tail=%zu: early stop", order, element_size, n,
+			tail);
+	}
+}
+
+static void StreamAll(const std::string& path)
+{
+	static const size_t element_sizes[] = {2, 4, 8};
+	static const ShredEndian endians[] = {SHRED_ENDIAN_LITTLE,
+		SHRED_ENDIAN_BIG};
+	for(size_t element_size : element_sizes)
+	{
+		size_t chunk_elements = SHRED_STREAM_CHUNK / element_size;
+		// empty, under a chunk, exactly some chunks, and a partial one
+		const size_t sizes[] = {0, 1, 100, chunk_elements,
+			3 * chunk_elements, 3 * chunk_elements + 17};
+		for(ShredEndian endian : endians)
+		{
+			for(size_t n : sizes)
+			{
+				for(size_t tail = 0; tail < element_size; tail += 1 +
+					element_size / 4)
+				{
+					StreamCheck(path, element_size, endian, n, tail);
+				}
+			}
+		}
+	}
+
+	ShredStreamInfo info;
+	StreamJob job;
+	job.element_size = 4;
+	job.calls = 0;
+	job.stop_after = 0;
+	job.in_order = true;
+	StreamWrite(path, std::vector<uint8_t>(12));
+	STREAM_CHECK(!ShredStreamFile(path.c_str(), 3, SHRED_ENDIAN_NATIVE,
+		StreamCallback, &job, &info) && job.calls == 0,
+		"element_size 3 accepted");
+	remove(path.c_str());
+	STREAM_CHECK(!ShredStreamFile(path.c_str(), 4, SHRED_ENDIAN_NATIVE,
+		StreamCallback, &job, NULL) && job.calls == 0,
+		"missing file accepted");
+}
+
+// reverses the bytes of each element, without the library's help
+template <typename T>
+static std::vector<T> EndianSwapped(const std::vector<T>& in)
+{
+	std::vector<T> out(in.size());
+	for(size_t i = 0; i < in.size(); i++)
+	{
+		const uint8_t* from = (const uint8_t*)&in[i];
+		uint8_t* to = (uint8_t*)&out[i];
+		for(size_t j = 0; j < sizeof(T); j++)
+		{
+			to[j] = from[sizeof(T) - 1 - j];
+		}
+	}
+	return out;
+}
+
+// out_t can be bool, so the outputs are kept as bytes
+template <typename real_t, typename out_t>
+static void EndianCheck(const char* name,
+	void (*array)(const real_t*, out_t*, size_t),
+	void (*endian_array)(const real_t*, out_t*, size_t, ShredEndian),
+	const std::vector<real_t>& in, const std::vector<real_t>& dump,
+	ShredEndian endian)
+{
+	size_t n = in.size();
+	std::vector<uint8_t> expected(n * sizeof(out_t) + 1);
+	std::vector<uint8_t> got(n * sizeof(out_t) + 1);
+	array(in.data(), (out_t*)expected.data(), n);
+	endian_array(dump.data(), (out_t*)got.data(), n, endian);
+	STREAM_CHECK(expected == got, "%s %s %s n=%zu", ShredDispatchName(), name,
+		endian == SHRED_ENDIAN_BIG ? "big" : "little", n);
+}
+
+#define ENDIAN_CHECK(Name, func) \
+	EndianCheck(#Name #func, Shred##Name##func##Array, \
+		Shred##Name##func##ArrayEndian, in, dump, endian)
+
+#define ENDIAN_CHECK_ALL(Name) \
+	ENDIAN_CHECK(Name, ToData); \
+	ENDIAN_CHECK(Name, ExpUnbiased); \
+	ENDIAN_CHECK(Name, ExpUnbiasedRaw); \
+	ENDIAN_CHECK(Name, Exp); \
+	ENDIAN_CHECK(Name, ExpRaw); \
+	ENDIAN_CHECK(Name, MantissaRaw); \
+	ENDIAN_CHECK(Name, Mantissa); \
+	ENDIAN_CHECK(Name, IsNegative); \
+	ENDIAN_CHECK(Name, Classify)
+
+static void EndianFloats(const std::vector<float>& in, ShredEndian endian)
+{
+	std::vector<float> dump = ShredEndianIsNative(endian) ? in :
+		EndianSwapped(in);
+	ENDIAN_CHECK_ALL(Float);
+
+	size_t n = in.size();
+	size_t counts[SHRED_CLASS_COUNT], expected[SHRED_CLASS_COUNT];
+	ShredFloatClassCount(in.data(), n, expected);
+	ShredFloatClassCountEndian(dump.data(), n, counts, endian);
+	STREAM_CHECK(memcmp(counts, expected, sizeof(counts)) == 0,
+		"%s FloatClassCount n=%zu", ShredDispatchName(), n);
+
+	std::vector<uint8_t> signs(ShredSignPlaneSize(n) + 1);
+	std::vector<uint8_t> exps(n + 1);
+	std::vector<uint32_t> mantissas(n + 1);
+	std::vector<uint8_t> expected_signs = signs;
+	std::vector<uint8_t> expected_exps = exps;
+	std::vector<uint32_t> expected_mantissas = mantissas;
+	ShredFloatSplitPlanes(in.data(), n, expected_signs.data(),
+		expected_exps.data(), expected_mantissas.data());
+	ShredFloatSplitPlanesEndian(dump.data(), n, signs.data(), exps.data(),
+		mantissas.data(), endian);
+	STREAM_CHECK(signs == expected_signs && exps == expected_exps &&
+		mantissas == expected_mantissas, "%s FloatSplitPlanes n=%zu",
+		ShredDispatchName(), n);
+}
+
+static void EndianDoubles(const std::vector<double>& in, ShredEndian endian)
+{
+	std::vector<double> dump = ShredEndianIsNative(endian) ? in :
+		EndianSwapped(in);
+	ENDIAN_CHECK_ALL(Double);
+
+	size_t counts[SHRED_CLASS_COUNT], expected[SHRED_CLASS_COUNT];
+	ShredDoubleClassCount(in.data(), in.size(), expected);
+	ShredDoubleClassCountEndian(dump.data(), in.size(), counts, endian);
+	STREAM_CHECK(memcmp(counts, expected, sizeof(counts)) == 0,
+		"%s DoubleClassCount n=%zu", ShredDispatchName(), in.size());
+}
+
+static void EndianAll()
+{
+	// either side of a block and of several, and not a whole byte of signs
+	const size_t sizes[] = {0, 1, 7, SHRED_SWAP_BLOCK - 1, SHRED_SWAP_BLOCK,
+		SHRED_SWAP_BLOCK + 1, 3 * SHRED_SWAP_BLOCK + 5};
+	static const ShredEndian endians[] = {SHRED_ENDIAN_LITTLE,
+		SHRED_ENDIAN_BIG};
+	static const ShredIsa isas[] = {SHRED_ISA_SCALAR, SHRED_ISA_SSE2,
+		SHRED_ISA_AVX2, SHRED_ISA_AVX512, SHRED_ISA_NEON};
+	for(ShredIsa isa : isas)
+	{
+		if(!ShredDispatchForce(isa))
+		{
+			continue;
+		}
+		for(size_t n : sizes)
+		{
+			// every bit pattern, specials included
+			std::vector<float> floats(n);
+			std::vector<double> doubles(n);
+			uint32_t state = 0x6A09E667u;
+			for(size_t i = 0; i < n; i++)
+			{
+				floats[i] = ShredDataToFloat(StreamRandom(&state));
+				uint64_t high = StreamRandom(&state);
+				doubles[i] = ShredDataToDouble(high << 32 |
+					StreamRandom(&state));
+			}
+			for(ShredEndian endian : endians)
+			{
+				EndianFloats(floats, endian);
+				EndianDoubles(doubles, endian);
+			}
+		}
+	}
+	ShredDispatchInit();
+}
+
+int main(int argc, char** argv)
+{
+	// named after the program, so the two builds don't share a file
+	std::string path = std::string(argc > 0 ? argv[0] :
+		"float_shredder_stream_test") + ".tmp";
+	StreamAll(path);
+	EndianAll();
+	remove(path.c_str());
+	printf("%s: %d failures\n", failures ? "FAILED" : "passed", failures);
+	return failures ? 1 : 0;
+}
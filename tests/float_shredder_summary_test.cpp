@@ -0,0 +1,425 @@
+/*
+	Checks ShredFloatSummarize and ShredDoubleSummarize against plain loops
+	over the same data, under every instruction set this CPU has, and that
+	SummarizeParallel and SummaryMerge of the pieces give the same summary
+	as the whole.
+
+	Everything but the sum has to come out exactly the same. The scalar sum
+	has to be within 1e-15 of the sum of the magnitudes of the right answer
+	and the SIMD ones within 1e-11, which is what ShredFloatSummary says
+	they're good to. Sums of small integers have to be exact everywhere,
+	and floats near FLT_MAX, which overflow the SIMD lanes and get added up
+	again in double, still have to come out finite and close.
+
+	It exits with 1 if anything failed.
+*/
+#include "float_shredder_threads.h"
+
+#include <float.h>
+#include <limits>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static int failures = 0;
+
+#define SUMMARY_CHECK(cond, ...) \
+	do \
+	{ \
+		if(!(cond)) \
+		{ \
+			printf("FAILED: " __VA_ARGS__); \
+			printf("\n"); \
+			failures++; \
+		} \
+	} while(0)
+
+// xorshift, so the data comes out the same on every run
+static uint32_t SummaryRandom(uint32_t* state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+enum SummaryData
+{
+	// every bit pattern, specials included
+	SUMMARY_BITS,
+	// small integers, which every instruction set has to add up exactly
+	SUMMARY_INTEGERS,
+	// a few binades either side of 1, with specials and zeros mixed in
+	SUMMARY_MIXED,
+	// near the top of the range, so a lane's float sum overflows
+	SUMMARY_HUGE,
+	// big values that cancel, leaving the small ones
+	SUMMARY_CANCEL,
+	SUMMARY_DATA_COUNT
+};
+
+static const char* summary_data_names[SUMMARY_DATA_COUNT] = {
+	"bits", "integers", "mixed", "huge", "cancel"
+};
+
+template <typename real_t>
+static std::vector<real_t> SummaryValues(size_t n, SummaryData data)
+{
+	typedef std::numeric_limits<real_t> limits;
+	std::vector<real_t> values(n);
+	uint32_t state = 0x9E3779B9u + (uint32_t)data;
+	for(size_t i = 0; i < n; i++)
+	{
+		uint32_t r = SummaryRandom(&state);
+		real_t sign = r & 1 ? -1 : 1;
+		real_t& v = values[i];
+		switch(data)
+		{
+		case SUMMARY_BITS:
+			if(sizeof(real_t) == 4)
+			{
+				uint32_t bits = r;
+				memcpy(&v, &bits, sizeof(v));
+			} else {
+				uint64_t bits = (uint64_t)r << 32 | SummaryRandom(&state);
+				memcpy(&v, &bits, sizeof(v));
+			}
+			break;
+		case SUMMARY_INTEGERS:
+			v = (real_t)((int32_t)(r % 2001) - 1000);
+			break;
+		case SUMMARY_MIXED:
+			switch(r % 37)
+			{
+			case 0:
+				v = sign * limits::quiet_NaN();
+				break;
+			case 1:
+				v = sign * limits::infinity();
+				break;
+			case 2:
+				v = sign * (real_t)0;
+				break;
+			case 3:
+				v = sign * limits::denorm_min() * (real_t)(r >> 8);
+				break;
+			default:
+				v = sign * (real_t)ldexp(1.0 + (r >> 8) / 16777216.0,
+					(int)(r >> 2) % 41 - 20);
+				break;
+			}
+			break;
+		case SUMMARY_HUGE:
+			// mostly the same sign, so the sum keeps growing
+			v = (r % 5 == 0 ? -1 : 1) * limits::max() /
+				(real_t)(1 + (r >> 8) % 4);
+			break;
+		case SUMMARY_CANCEL:
+			v = i % 2 ? -values[i - 1] : sign * (real_t)ldexp(1.0 +
+				(r >> 8) / 16777216.0, 40);
+			if(r % 7 == 0)
+			{
+				v += (real_t)(r >> 20) / 1024;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return values;
+}
+
+// what the summary should be, and the magnitudes the sum gets judged by
+template <typename real_t>
+struct SummaryExpected
+{
+	bool has_min;
+	real_t min;
+	real_t max;
+	long double sum;
+	long double magnitudes;
+	size_t count;
+	size_t nans;
+	size_t infs;
+	size_t negatives;
+	size_t negative_zeros;
+	int64_t exp_min;
+	int64_t exp_max;
+};
+
+// a < b, with -0 below +0
+template <typename real_t>
+static bool SummaryBelow(real_t a, real_t b)
+{
+	return a < b || (a == b && signbit(a) && !signbit(b));
+}
+
+template <typename real_t>
+static SummaryExpected<real_t> SummaryExpect(const real_t* in, size_t n)
+{
+	typedef std::numeric_limits<real_t> limits;
+	SummaryExpected<real_t> e;
+	memset(&e, 0, sizeof(e));
+	e.count = n;
+	e.exp_min = INT64_MAX;
+	e.exp_max = INT64_MIN;
+	long double comp = 0;
+	for(size_t i = 0; i < n; i++)
+	{
+		real_t x = in[i];
+		e.negatives += signbit(x) != 0;
+		e.negative_zeros += x == 0 && signbit(x);
+		if(isnan(x))
+		{
+			e.nans++;
+			continue;
+		}
+		if(!e.has_min || SummaryBelow(x, e.min))
+		{
+			e.min = x;
+		}
+		if(!e.has_min || SummaryBelow(e.max, x))
+		{
+			e.max = x;
+		}
+		e.has_min = true;
+		if(isinf(x))
+		{
+			e.infs++;
+			continue;
+		}
+		int64_t exp = fpclassify(x) == FP_NORMAL ? ilogb(x) :
+			1 - limits::max_exponent;
+		e.exp_min = exp < e.exp_min ? exp : e.exp_min;
+		e.exp_max = exp > e.exp_max ? exp : e.exp_max;
+		// Neumaier in long double, for a sum better than the library's
+		long double t = e.sum + x;
+		comp += fabsl(e.sum) >= fabsl((long double)x) ? (e.sum - t) + x :
+			(x - t) + e.sum;
+		e.sum = t;
+		e.magnitudes += fabsl((long double)x);
+	}
+	e.sum += comp;
+	return e;
+}
+
+template <typename real_t, typename summary_t>
+static bool SummarySameBits(const summary_t& a, const summary_t& b)
+{
+	return memcmp(&a.min, &b.min, sizeof(real_t)) == 0 &&
+		memcmp(&a.max, &b.max, sizeof(real_t)) == 0;
+}
+
+// everything but the sum, which gets checked against tolerance
+template <typename real_t, typename summary_t>
+static bool SummaryMatches(const summary_t& s,
+	const SummaryExpected<real_t>& e)
+{
+	bool range = e.has_min ? memcmp(&s.min, &e.min, sizeof(real_t)) == 0 &&
+		memcmp(&s.max, &e.max, sizeof(real_t)) == 0 :
+		isnan(s.min) && isnan(s.max);
+	bool exps = e.exp_min <= e.exp_max ? s.exp_min == e.exp_min &&
+		s.exp_max == e.exp_max : s.exp_min > s.exp_max;
+	return range && exps && s.count == e.count && s.nans == e.nans &&
+		s.infs == e.infs && s.negatives == e.negatives &&
+		s.negative_zeros == e.negative_zeros;
+}
+
+template <typename real_t>
+static bool SummarySumWithin(double sum, const SummaryExpected<real_t>& e,
+	double tolerance)
+{
+	// past DBL_MAX the library's sum is inf, so there's nothing to compare
+	if(e.magnitudes > (long double)DBL_MAX / 4)
+	{
+		return true;
+	}
+	return isfinite(sum) &&
+		fabsl((long double)sum - e.sum) <= tolerance * e.magnitudes;
+}
+
+template <typename real_t, typename summary_t>
+static bool SummarySame(const summary_t& a, const summary_t& b)
+{
+	return SummarySameBits<real_t>(a, b) && a.count == b.count &&
+		a.nans == b.nans && a.infs == b.infs && a.negatives == b.negatives &&
+		a.negative_zeros == b.negative_zeros && a.exp_min == b.exp_min &&
+		a.exp_max == b.exp_max;
+}
+
+static void SummaryFloats(const std::vector<float>& in, SummaryData data)
+{
+	const char* name = summary_data_names[data];
+	size_t n = in.size();
+	SummaryExpected<float> e = SummaryExpect(in.data(), n);
+
+	ShredFloatSummary scalar;
+	ShredFloatSummarize_scalar(in.data(), n, &scalar);
+	SUMMARY_CHECK(SummaryMatches(scalar, e), "scalar float %s n=%zu", name,
+		n);
+	SUMMARY_CHECK(SummarySumWithin(scalar.sum, e, 1e-15),
+		"scalar float %s n=%zu: sum %.17g, not %.17Lg", name, n, scalar.sum,
+		e.sum);
+
+	ShredFloatSummary summary;
+	ShredFloatSummarize(in.data(), n, &summary);
+	SUMMARY_CHECK(SummaryMatches(summary, e), "%s float %s n=%zu",
+		ShredDispatchName(), name, n);
+	// integers and the overflowing lanes don't lose anything
+	double tolerance = data == SUMMARY_INTEGERS ? 0 :
+		data == SUMMARY_HUGE ? 1e-15 : 1e-11;
+	SUMMARY_CHECK(SummarySumWithin(summary.sum, e, tolerance),
+		"%s float %s n=%zu: sum %.17g, not %.17Lg", ShredDispatchName(), name,
+		n, summary.sum, e.sum);
+
+	// the summary of pieces, merged, is the summary of the whole
+	const size_t cuts[] = {0, 1, n / 3, n / 2 + 5, n};
+	for(size_t cut : cuts)
+	{
+		cut = cut < n ? cut : n;
+		ShredFloatSummary merged, left, right;
+		ShredFloatSummaryClear(&merged);
+		ShredFloatSummarize(in.data(), cut, &left);
+		ShredFloatSummarize(in.data() + cut, n - cut, &right);
+		ShredFloatSummaryMerge(&merged, &left);
+		ShredFloatSummaryMerge(&merged, &right);
+		SUMMARY_CHECK(SummarySame<float>(merged, summary) &&
+			SummarySumWithin(merged.sum, e, tolerance),
+			"%s float %s n=%zu: merged at %zu", ShredDispatchName(), name, n,
+			cut);
+	}
+}
+
+static void SummaryDoubles(const std::vector<double>& in, SummaryData data)
+{
+	const char* name = summary_data_names[data];
+	size_t n = in.size();
+	SummaryExpected<double> e = SummaryExpect(in.data(), n);
+
+	ShredDoubleSummary summary;
+	ShredDoubleSummarize(in.data(), n, &summary);
+	SUMMARY_CHECK(SummaryMatches(summary, e), "double %s n=%zu", name, n);
+	SUMMARY_CHECK(SummarySumWithin(summary.sum, e,
+		data == SUMMARY_INTEGERS ? 0 : 1e-15),
+		"double %s n=%zu: sum %.17g, not %.17Lg", name, n, summary.sum,
+		e.sum);
+
+	ShredDoubleSummary merged, left, right;
+	ShredDoubleSummaryClear(&merged);
+	ShredDoubleSummarize(in.data(), n / 3, &left);
+	ShredDoubleSummarize(in.data() + n / 3, n - n / 3, &right);
+	ShredDoubleSummaryMerge(&merged, &right);
+	ShredDoubleSummaryMerge(&merged, &left);
+	SUMMARY_CHECK(SummarySame<double>(merged, summary) &&
+		SummarySumWithin(merged.sum, e, data == SUMMARY_INTEGERS ? 0 : 1e-15),
+		"double %s n=%zu: merged", name, n);
+}
+
+static void SummaryAll()
+{
+	// either side of a vector and of a run of SIMD sums
+	static const size_t sizes[] = {0, 1, 5, 17, 1000, 3 * 1024 + 13,
+		100003};
+	static const ShredIsa isas[] = {SHRED_ISA_SCALAR, SHRED_ISA_SSE2,
+		SHRED_ISA_AVX2, SHRED_ISA_AVX512, SHRED_ISA_NEON};
+	for(int d = 0; d < SUMMARY_DATA_COUNT; d++)
+	{
+		SummaryData data = (SummaryData)d;
+		for(size_t n : sizes)
+		{
+			std::vector<float> floats = SummaryValues<float>(n, data);
+			for(ShredIsa isa : isas)
+			{
+				if(ShredDispatchForce(isa))
+				{
+					SummaryFloats(floats, data);
+				}
+			}
+			SummaryDoubles(SummaryValues<double>(n, data), data);
+		}
+	}
+	ShredDispatchInit();
+}
+
+// nothing but NaNs has no range, and -0 goes below +0
+static void SummaryEdges()
+{
+	std::vector<float> nans(100, NAN);
+	ShredFloatSummary summary;
+	ShredFloatSummarize(nans.data(), nans.size(), &summary);
+	SUMMARY_CHECK(isnan(summary.min) && isnan(summary.max) &&
+		summary.nans == 100 && summary.sum == 0 &&
+		summary.exp_min > summary.exp_max, "all NaNs");
+
+	std::vector<float> zeros(100, 0.0f);
+	zeros[37] = -0.0f;
+	ShredFloatSummarize(zeros.data(), zeros.size(), &summary);
+	SUMMARY_CHECK(signbit(summary.min) && !signbit(summary.max) &&
+		summary.negative_zeros == 1 && summary.exp_min == -127 &&
+		summary.exp_max == -127, "zeros");
+
+	// merging in nothing changes nothing, and the other way round
+	ShredFloatSummary empty, merged;
+	ShredFloatSummaryClear(&empty);
+	merged = summary;
+	ShredFloatSummaryMerge(&merged, &empty);
+	SUMMARY_CHECK(SummarySame<float>(merged, summary) &&
+		merged.sum == summary.sum, "merging an empty summary");
+	merged = empty;
+	ShredFloatSummaryMerge(&merged, &summary);
+	SUMMARY_CHECK(SummarySame<float>(merged, summary) &&
+		merged.sum == summary.sum, "merging into an empty summary");
+}
+
+static void SummaryParallel()
+{
+	size_t n = 5 * SHRED_THREADS_MIN_SLICE + 123;
+	static const int threads[] = {0, 1, 3, 8};
+	static const size_t grains[] = {0, 1000, 77777};
+	for(int d = 0; d < SUMMARY_DATA_COUNT; d++)
+	{
+		SummaryData data = (SummaryData)d;
+		std::vector<float> floats = SummaryValues<float>(n, data);
+		std::vector<double> doubles = SummaryValues<double>(n, data);
+		SummaryExpected<float> e = SummaryExpect(floats.data(), n);
+		SummaryExpected<double> de = SummaryExpect(doubles.data(), n);
+		ShredFloatSummary serial;
+		ShredFloatSummarize(floats.data(), n, &serial);
+		ShredDoubleSummary double_serial;
+		ShredDoubleSummarize(doubles.data(), n, &double_serial);
+		for(int t : threads)
+		{
+			for(size_t grain : grains)
+			{
+				ShredFloatSummary summary;
+				ShredFloatSummarizeParallel(floats.data(), n, &summary, t,
+					grain);
+				SUMMARY_CHECK(SummarySame<float>(summary, serial) &&
+					SummarySumWithin(summary.sum, e, 1e-11),
+					"float %s SummarizeParallel threads=%d grain=%zu",
+					summary_data_names[d], t, grain);
+
+				ShredDoubleSummary double_summary;
+				ShredDoubleSummarizeParallel(doubles.data(), n,
+					&double_summary, t, grain);
+				SUMMARY_CHECK(SummarySame<double>(double_summary,
+					double_serial) && SummarySumWithin(double_summary.sum, de,
+					1e-15), "double %s SummarizeParallel threads=%d grain=%zu",
+					summary_data_names[d], t, grain);
+			}
+		}
+	}
+}
+
+int main()
+{
+	SummaryAll();
+	SummaryEdges();
+	SummaryParallel();
+	printf("%s: %d failures\n", failures ? "FAILED" : "passed", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,278 @@
+/*
+	Checks float_shredder_threads.h's chunked loops: that ShredParallelFor
+	hands every element to func exactly once, in chunks no bigger than the
+	grain and on slices below the thread count, including for n = 0, a
+	grain of 0 (the default) or 1, and more threads than chunks. Then that
+	the Parallel wrappers give the same results as the batch functions
+	they split up.
+
+	It exits with 1 if anything failed.
+*/
+#include "float_shredder_threads.h"
+
+#include <atomic>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static int failures = 0;
+
+#define THREADS_CHECK(cond, ...) \
+	do \
+	{ \
+		if(!(cond)) \
+		{ \
+			printf("FAILED: " __VA_ARGS__); \
+			printf("\n"); \
+			failures++; \
+		} \
+	} while(0)
+
+// xorshift, so the data comes out the same on every run
+static uint32_t ThreadsRandom(uint32_t* state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+// every bit pattern, specials included
+static std::vector<float> ThreadsFloats(size_t n, uint32_t seed)
+{
+	std::vector<float> values(n);
+	uint32_t state = seed;
+	for(float& v : values)
+	{
+		v = ShredDataToFloat(ThreadsRandom(&state));
+	}
+	return values;
+}
+
+static std::vector<double> ThreadsDoubles(size_t n)
+{
+	std::vector<double> values(n);
+	uint32_t state = 0x2545F491u;
+	for(double& v : values)
+	{
+		uint64_t high = ThreadsRandom(&state);
+		v = ShredDataToDouble(high << 32 | ThreadsRandom(&state));
+	}
+	return values;
+}
+
+template <typename T>
+static bool ThreadsSameBits(const std::vector<T>& a, const std::vector<T>& b)
+{
+	return a.size() == b.size() &&
+		(a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+// what func got called with, checked once ShredParallelFor is done
+typedef struct ThreadsForJob
+{
+	// chunks don't overlap, so every element only gets written by one
+	std::vector<uint8_t> visits;
+	size_t grain;
+	std::atomic<size_t> calls;
+	std::atomic<size_t> too_big;
+	std::atomic<int> top_slice;
+} ThreadsForJob;
+
+static void ThreadsForChunk(void* ctx, int slice, size_t begin, size_t end)
+{
+	ThreadsForJob* job = (ThreadsForJob*)ctx;
+	job->calls++;
+	if(end <= begin || end - begin > job->grain || end > job->visits.size())
+	{
+		job->too_big++;
+		return;
+	}
+	int top = job->top_slice;
+	while(slice > top && !job->top_slice.compare_exchange_weak(top, slice))
+	{
+	}
+	for(size_t i = begin; i < end; i++)
+	{
+		job->visits[i]++;
+	}
+}
+
+static void ThreadsFor(size_t n, size_t grain, int threads)
+{
+	ThreadsForJob job;
+	job.visits.assign(n, 0);
+	job.grain = grain ? grain : SHRED_PARALLEL_GRAIN;
+	job.calls = 0;
+	job.too_big = 0;
+	job.top_slice = -1;
+	ShredParallelFor(n, grain, threads, ThreadsForChunk, &job);
+
+	bool once = true;
+	for(uint8_t visits : job.visits)
+	{
+		once = once && visits == 1;
+	}
+	THREADS_CHECK(once, "for n=%zu grain=%zu threads=%d: not every element "
+		"exactly once", n, grain, threads);
+	THREADS_CHECK(job.too_big == 0, "for n=%zu grain=%zu threads=%d: a "
+		"chunk was empty, over the grain or past n", n, grain, threads);
+	size_t chunks = (n + job.grain - 1) / job.grain;
+	int most = ShredThreadsFor(n, threads);
+	most = (size_t)most > chunks ? (int)chunks : most;
+	THREADS_CHECK(job.top_slice < (most > 1 ? most : 1),
+		"for n=%zu grain=%zu threads=%d: slice %d", n, grain, threads,
+		(int)job.top_slice);
+	// every range can end in a short chunk, but no more than that
+	THREADS_CHECK(job.calls >= chunks && job.calls <= chunks + (size_t)most,
+		"for n=%zu grain=%zu threads=%d: %zu chunks, not %zu", n, grain,
+		threads, (size_t)job.calls, chunks);
+	THREADS_CHECK(n > 0 || job.calls == 0, "for n=0 threads=%d: func called",
+		threads);
+}
+
+static void ThreadsFors()
+{
+	// big enough that ShredThreadsFor allows several threads
+	size_t big = 5 * SHRED_THREADS_MIN_SLICE + 123;
+	static const int threads[] = {0, 1, 2, 3, 8};
+	for(int t : threads)
+	{
+		ThreadsFor(0, 0, t);
+		ThreadsFor(1, 0, t);
+		ThreadsFor(1000, 1, t);
+		ThreadsFor(big, 0, t);
+		ThreadsFor(big, 1, t);
+		ThreadsFor(big, 1000, t);
+		// more threads than chunks
+		ThreadsFor(big, big / 2, t);
+		ThreadsFor(big, big, t);
+		ThreadsFor(big, big * 4, t);
+	}
+}
+
+// a few of the maps, on both sides of their arguments and both types
+static void ThreadsMaps(size_t n, int threads, size_t grain)
+{
+	std::vector<float> in = ThreadsFloats(n, 0x9E3779B9u);
+	std::vector<double> din = ThreadsDoubles(n);
+
+	std::vector<int32_t> exps(n), serial_exps(n);
+	ShredFloatExpArrayParallel(in.data(), exps.data(), n, threads, grain);
+	ShredFloatExpArray(in.data(), serial_exps.data(), n);
+	THREADS_CHECK(ThreadsSameBits(exps, serial_exps),
+		"ExpArray n=%zu threads=%d grain=%zu", n, threads, grain);
+
+	std::vector<float> shifted(n), serial_shifted(n);
+	ShredFloatShiftExpUpArrayParallel(in.data(), shifted.data(), n, 5,
+		threads, grain);
+	ShredFloatShiftExpUpArray(in.data(), serial_shifted.data(), n, 5);
+	THREADS_CHECK(ThreadsSameBits(shifted, serial_shifted),
+		"ShiftExpUpArray n=%zu threads=%d grain=%zu", n, threads, grain);
+
+	std::vector<ShredHalf> halves(n), serial_halves(n);
+	ShredFloatToHalfArrayParallel(in.data(), halves.data(), n, threads,
+		grain);
+	ShredFloatToHalfArray(in.data(), serial_halves.data(), n);
+	THREADS_CHECK(ThreadsSameBits(halves, serial_halves),
+		"ToHalfArray n=%zu threads=%d grain=%zu", n, threads, grain);
+
+	std::vector<double> stepped(n), serial_stepped(n);
+	ShredDoubleStepUlpsArrayParallel(din.data(), stepped.data(), n, -3,
+		threads, grain);
+	ShredDoubleStepUlpsArray(din.data(), serial_stepped.data(), n, -3);
+	THREADS_CHECK(ThreadsSameBits(stepped, serial_stepped),
+		"double StepUlpsArray n=%zu threads=%d grain=%zu", n, threads, grain);
+}
+
+static void ThreadsReduces(size_t n, int threads, size_t grain)
+{
+	std::vector<float> a = ThreadsFloats(n, 0x9E3779B9u);
+	std::vector<float> b = a;
+	uint32_t state = 0x6A09E667u;
+	for(float& x : b)
+	{
+		uint32_t r = ThreadsRandom(&state);
+		x = r % 4 == 0 ? ShredFloatStepUlps(x, (int32_t)(r >> 20) - 2048) :
+			r % 4 == 1 ? NAN : x;
+	}
+
+	size_t counts[SHRED_CLASS_COUNT], serial_counts[SHRED_CLASS_COUNT];
+	ShredFloatClassCountParallel(a.data(), n, counts, threads, grain);
+	ShredFloatClassCount(a.data(), n, serial_counts);
+	THREADS_CHECK(memcmp(counts, serial_counts, sizeof(counts)) == 0,
+		"ClassCount n=%zu threads=%d grain=%zu", n, threads, grain);
+
+	std::vector<double> din = ThreadsDoubles(n);
+	ShredDoubleClassCountParallel(din.data(), n, counts, threads, grain);
+	ShredDoubleClassCount(din.data(), n, serial_counts);
+	THREADS_CHECK(memcmp(counts, serial_counts, sizeof(counts)) == 0,
+		"double ClassCount n=%zu threads=%d grain=%zu", n, threads, grain);
+
+	// the mean gets put back together from the chunks', so it's only close
+	std::vector<uint32_t> ulps(n), serial_ulps(n);
+	ShredUlpStats stats, serial_stats;
+	ShredFloatUlpDistanceArrayParallel(a.data(), b.data(), ulps.data(), n,
+		&stats, threads, grain);
+	ShredFloatUlpDistanceArray(a.data(), b.data(), serial_ulps.data(), n,
+		&serial_stats);
+	THREADS_CHECK(ThreadsSameBits(ulps, serial_ulps) &&
+		stats.max == serial_stats.max && stats.count == serial_stats.count &&
+		stats.nan_mismatches == serial_stats.nan_mismatches &&
+		fabs(stats.mean - serial_stats.mean) <= 1e-9 * serial_stats.mean,
+		"UlpDistanceArray n=%zu threads=%d grain=%zu", n, threads, grain);
+
+	ShredHistogram hist, serial_hist;
+	ShredHistogramInit(&hist, 8);
+	ShredHistogramInit(&serial_hist, 8);
+	THREADS_CHECK(ShredHistogramAddParallel(&hist, a.data(), n, threads),
+		"HistogramAddParallel n=%zu threads=%d", n, threads);
+	ShredHistogramAdd(&serial_hist, a.data(), n);
+	THREADS_CHECK(hist.count == serial_hist.count &&
+		memcmp(hist.exponents, serial_hist.exponents,
+		sizeof(hist.exponents)) == 0 && memcmp(hist.mantissas,
+		serial_hist.mantissas, 256 * sizeof(uint64_t)) == 0,
+		"HistogramAddParallel n=%zu threads=%d: counts", n, threads);
+	ShredHistogramFree(&hist);
+	ShredHistogramFree(&serial_hist);
+
+	std::vector<float> touched(n, 1.0f);
+	ShredParallelFirstTouch(touched.data(), n, sizeof(float), threads);
+	bool zeroed = true;
+	for(float x : touched)
+	{
+		zeroed = zeroed && ShredFloatToData(x) == 0;
+	}
+	THREADS_CHECK(zeroed, "FirstTouch n=%zu threads=%d", n, threads);
+}
+
+static void ThreadsWrappers()
+{
+	static const size_t sizes[] = {0, 1, 1000,
+		5 * SHRED_THREADS_MIN_SLICE + 123};
+	static const int threads[] = {0, 1, 3, 8};
+	static const size_t grains[] = {0, 1, 777};
+	for(size_t n : sizes)
+	{
+		for(int t : threads)
+		{
+			for(size_t grain : grains)
+			{
+				ThreadsMaps(n, t, grain);
+				ThreadsReduces(n, t, grain);
+			}
+		}
+	}
+}
+
+int main()
+{
+	ThreadsFors();
+	ThreadsWrappers();
+	printf("%s: %d failures\n", failures ? "FAILED" : "passed", failures);
+	return failures ? 1 : 0;
+}